@@ -1,21 +1,9 @@
 #include <stdlib.h>
 #include <stdio.h>
-#include "datatypes.h"
-
-/* C prototype for LAPACK routine DGELS */
-void dgels_(
-	const char * trans,  /* 'N' or 'T'             */
-	const int * m,       /* rows in A              */
-	const int * n,       /* cols in A              */
-	const int * nrhs,    /* cols in B              */
-	double * A,          /* array A                */
-	const int * lda,     /* leading dimension of A */
-	double * B,          /* array B                */
-	const int * ldb,     /* leading dimension of B */
-	double * work,       /* workspace array        */
-	int * lwork,         /* workspace size         */
-	int * info           /* status code            */
-);
+#include <string.h>
+#include "call_dgels.h"
+#include "lapack.h"
+
 /* call_dgels : wrapper for LAPACK's DGELS routine
 
 Purpose:
@@ -32,7 +20,8 @@ following exceptions: the return value is
 
 	-12 if the input A is NULL and/or the input b is NULL
 	-13 if A->shape[0]<A->shape[1]
-	-14 if the dimensions of $A$ and $b$ are incompatible
+	-14 if the dimensions of $A$ and $b$ are incompatible (or m does not fit
+	    in a lapack_int, see lapack.h)
 	-15 in case of memory allocation errors.
 */
 
@@ -49,15 +38,15 @@ int call_dgels(array2d_t * A, array_t * b) {
 		return -13;
 	}
 
-	if(A->shape[0]!=b->len) {
+	if(A->shape[0]!=b->len || !lapack_int_fits(A->shape[0])) {
 		fprintf(stderr, "Error: The number of rows in A must be"
 		"equal to the number of columns in A \n");
 		return -14;
 	}
 	
 	// initialisation
-	int m = (int) A->shape[0], n = (int) A->shape[1];
-	int nrhs = 1, ldb=m, lda=m, info, lwork;
+	lapack_int m = (lapack_int) A->shape[0], n = (lapack_int) A->shape[1];
+	lapack_int nrhs = 1, ldb=m, lda=m, info, lwork;
 	char trans = 'N';
 	double*work;
 	double wkopt;
@@ -65,13 +54,13 @@ int call_dgels(array2d_t * A, array_t * b) {
 	// calculate optimal work size
   	lwork = -1;
 	dgels_(&trans,&m,&n,&nrhs,A->val,&lda,b->val,&ldb,&wkopt,&lwork,&info);
-	lwork = (int)wkopt;
+	lwork = (lapack_int)wkopt;
     
 	// alocate array for work
-	work = (double*)malloc( lwork*sizeof(double) );
+	work = (double*)malloc( (size_t)lwork*sizeof(double) );
 	if(!work) {
 		fprintf(stderr, "Error: Failed to allocate memory\n");
-		return -14;
+		return -15;
 	}
 	
 	// solve system depending on whether A is row- or colmajor
@@ -94,8 +83,173 @@ int call_dgels(array2d_t * A, array_t * b) {
 		fprintf(stderr, "Error: A does not have full rank\n");
 	}
 	else {
-		fprintf(stderr, "Error: Parameter numper %d of dgels_ had an illigal value\n", -info);
+		fprintf(stderr, "Error: Parameter numper %ld of dgels_ had an illigal value\n", (long)-info);
+	}
+
+	return (int)info;	
+}
+
+/* ls_factor : QR factorization for repeated least-squares solves
+
+Purpose:
+Computes a QR factorization of a copy of A (m >= n) once, so that the
+least-squares problem
+
+   minimize  || A*x-b ||_2^2
+
+can be solved for many right-hand sides with ls_solve at a cost of O(mn)
+each, instead of redoing the O(mn^2) factorization in every call to
+call_dgels. The LAPACK workspace is queried and allocated once and cached in
+the returned ls_t.
+
+If A is stored in ColMajor order, A = Q*R is computed with DGEQRF. If A is
+stored in RowMajor order, the buffer A->val is A^T in ColMajor order, and
+A^T = L*Q is computed in place with DGELQF, i.e., A = Q^T*L^T and R = L^T.
+No transpose of A is formed.
+
+Return value:
+A pointer to an ls_t, or NULL if A is NULL, if A->shape[0] < A->shape[1],
+if A does not have full rank, or if an error occurs.
+*/
+ls_t *ls_factor(const array2d_t *A)
+{
+	if(!A) {
+		fprintf(stderr, "Error: A is a NULL pointer \n");
+		return NULL;
+	}
+	if(A->shape[0] < A->shape[1]) {
+		fprintf(stderr, "Error: The number of rows in A must be "
+		"greater than or equal to the number of columns in A \n");
+		return NULL;
+	}
+
+	if(!lapack_int_fits(A->shape[0])) {
+		fprintf(stderr, "Error: A is too large for the LAPACK integer type\n");
+		return NULL;
+	}
+
+	ls_t *ls = calloc(1, sizeof(*ls));
+	if(!ls) {
+		fprintf(stderr, "Error: Failed to allocate memory\n");
+		return NULL;
 	}
+	lapack_int m = (lapack_int) A->shape[0], n = (lapack_int) A->shape[1];
+	lapack_int nrhs = 1, info, lwork = -1;
+	lapack_int lda = (A->order == ColMajor) ? m : n;
+	char side = 'L', trans = (A->order == ColMajor) ? 'T' : 'N';
+	double wkopt_f = 0.0, wkopt_s = 0.0;
 
-	return info;	
-}
\ No newline at end of file
+	ls->QR = array2d_alloc(A->shape, A->order);
+	ls->tau = malloc((n > 0 ? n : 1) * sizeof(double));
+	if(!ls->QR || !ls->tau) {
+		fprintf(stderr, "Error: Failed to allocate memory\n");
+		ls_dealloc(ls);
+		return NULL;
+	}
+	memcpy(ls->QR->val, A->val, A->shape[0] * A->shape[1] * sizeof(double));
+
+	// query the optimal work size for the factorization and for the solves
+	if(A->order == ColMajor) {
+		dgeqrf_(&m,&n,ls->QR->val,&lda,ls->tau,&wkopt_f,&lwork,&info);
+		dormqr_(&side,&trans,&m,&nrhs,&n,ls->QR->val,&lda,ls->tau,NULL,&m,&wkopt_s,&lwork,&info);
+	}
+	else {
+		dgelqf_(&n,&m,ls->QR->val,&lda,ls->tau,&wkopt_f,&lwork,&info);
+		dormlq_(&side,&trans,&m,&nrhs,&n,ls->QR->val,&lda,ls->tau,NULL,&m,&wkopt_s,&lwork,&info);
+	}
+	ls->lwork = (lapack_int) (wkopt_f > wkopt_s ? wkopt_f : wkopt_s);
+	if(ls->lwork < 1) ls->lwork = 1;
+	ls->work = malloc((size_t) ls->lwork * sizeof(double));
+	if(!ls->work) {
+		fprintf(stderr, "Error: Failed to allocate memory\n");
+		ls_dealloc(ls);
+		return NULL;
+	}
+
+	// factorize
+	if(A->order == ColMajor) {
+		dgeqrf_(&m,&n,ls->QR->val,&lda,ls->tau,ls->work,&ls->lwork,&info);
+	}
+	else {
+		dgelqf_(&n,&m,ls->QR->val,&lda,ls->tau,ls->work,&ls->lwork,&info);
+	}
+	if(info != 0) {
+		fprintf(stderr, "Error: Parameter numper %ld of the QR factorization had an illigal value\n", (long)-info);
+		ls_dealloc(ls);
+		return NULL;
+	}
+
+	// the diagonal of R (or L) is zero if A does not have full rank
+	for(lapack_int k = 0; k < n; k++) {
+		if(ls->QR->val[k + (size_t) k * lda] == 0.0) {
+			fprintf(stderr, "Error: A does not have full rank\n");
+			ls_dealloc(ls);
+			return NULL;
+		}
+	}
+	return ls;
+}
+
+/* ls_dealloc : deallocates an ls_t */
+void ls_dealloc(ls_t *ls)
+{
+	if(!ls) return;
+	array2d_dealloc(ls->QR);
+	free(ls->tau);
+	free(ls->work);
+	free(ls);
+}
+
+/* ls_solve : least-squares solve with a cached QR factorization
+
+Purpose:
+Solves the least-squares problem for the matrix A factored by ls_factor,
+i.e., computes c = Q^T*b with DORMQR (or Q*b with DORMLQ in the RowMajor
+case) and solves R*x = c(1:n) with DTRTRS. The cost is O(mn). Upon exit,
+the leading n elements of b contain the solution x and b->len is n.
+
+Return value:
+The function returns the output `info` from LAPACK with the following
+exceptions: the return value is
+
+	-12 if the input ls is NULL and/or the input b is NULL
+	-14 if the dimensions of A and b are incompatible.
+*/
+int ls_solve(ls_t *ls, array_t *b)
+{
+	if(!ls || !b) {
+		fprintf(stderr, "Error: ls or b is a NULL pointer \n");
+		return -12;
+	}
+	if(ls->QR->shape[0] != b->len) {
+		fprintf(stderr, "Error: The number of rows in A must be"
+		"equal to the length of b \n");
+		return -14;
+	}
+
+	lapack_int m = (lapack_int) ls->QR->shape[0], n = (lapack_int) ls->QR->shape[1];
+	lapack_int nrhs = 1, ldb = m, info;
+	char side = 'L', diag = 'N';
+
+	if(ls->QR->order == ColMajor) {
+		// c = Q^T*b, then solve R*x = c
+		char trans = 'T', uplo = 'U', notrans = 'N';
+		lapack_int lda = m;
+		dormqr_(&side,&trans,&m,&nrhs,&n,ls->QR->val,&lda,ls->tau,b->val,&ldb,ls->work,&ls->lwork,&info);
+		if(info == 0)
+			dtrtrs_(&uplo,&notrans,&diag,&n,&nrhs,ls->QR->val,&lda,b->val,&ldb,&info);
+	}
+	else {
+		// A = Q^T*L^T: c = Q*b, then solve L^T*x = c
+		char trans = 'N', uplo = 'L', transl = 'T';
+		lapack_int lda = n;
+		dormlq_(&side,&trans,&m,&nrhs,&n,ls->QR->val,&lda,ls->tau,b->val,&ldb,ls->work,&ls->lwork,&info);
+		if(info == 0)
+			dtrtrs_(&uplo,&transl,&diag,&n,&nrhs,ls->QR->val,&lda,b->val,&ldb,&info);
+	}
+
+	if(info == 0) {
+		b->len = n;
+	}
+	return (int)info;
+}
@@ -0,0 +1,21 @@
+#ifndef CALL_DGELS_H
+#define CALL_DGELS_H
+#include "array.h"
+#include "array2d.h"
+#include "lapack.h"
+
+typedef struct ls /* QR factorization for repeated least-squares solves */
+{
+    array2d_t *QR;    // QR factors of A (LQ factors of A^T if A is RowMajor)
+    double *tau;      // scalar factors of the elementary reflectors
+    double *work;     // cached LAPACK workspace
+    lapack_int lwork; // size of work
+} ls_t;
+
+int call_dgels(array2d_t *A, array_t *b);
+
+ls_t *ls_factor(const array2d_t *A);
+void ls_dealloc(ls_t *ls);
+int ls_solve(ls_t *ls, array_t *b);
+
+#endif
@@ -0,0 +1,272 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "lsq_stream.h"
+#include "lapack.h"
+
+/* lsq_stream_alloc : allocates a streaming least-squares accumulator
+
+Purpose:
+Allocates an accumulator for the least-squares problem
+
+   minimize  || A*x-b ||_2^2
+
+where the rows of A (with n columns) and b arrive in blocks. Only the n-by-n
+triangular factor R and the vector c = Q^T*b are kept, so the memory use is
+O(n^2) regardless of the number of rows (plus one row block during an update).
+
+Return value:
+A pointer to an lsq_stream_t, or NULL in case of memory allocation errors.
+*/
+lsq_stream_t *lsq_stream_alloc(size_t n)
+{
+	lsq_stream_t *s = calloc(1, sizeof(*s));
+	if(!s) {
+		fprintf(stderr, "Error: Failed to allocate memory\n");
+		return NULL;
+	}
+	s->n = n;
+	s->nb = (n < 32) ? (lapack_int) (n > 0 ? n : 1) : 32;
+	s->R = calloc(n * n + 1, sizeof(double));
+	s->c = calloc(n + 1, sizeof(double));
+	s->T = malloc((s->nb * n + 1) * sizeof(double));
+	s->work = malloc((s->nb * n + 1) * sizeof(double));
+	if(!s->R || !s->c || !s->T || !s->work) {
+		fprintf(stderr, "Error: Failed to allocate memory\n");
+		lsq_stream_dealloc(s);
+		return NULL;
+	}
+	return s;
+}
+
+/* lsq_stream_dealloc : deallocates an lsq_stream_t */
+void lsq_stream_dealloc(lsq_stream_t *s)
+{
+	if(!s) return;
+	free(s->R);
+	free(s->c);
+	free(s->T);
+	free(s->work);
+	free(s->B);
+	free(s);
+}
+
+/* lsq_stream_update : adds a block of rows to the accumulator
+
+Purpose:
+Updates the QR factorization with the rows of the block A (k-by-n) and the
+corresponding k elements of b, i.e., computes the QR factorization of
+
+   [ R ]        [ c ]
+   [ A ]  and   [ b ]
+
+with LAPACK's DTPQRT/DTPMQRT, which exploit that R is triangular. The cost is
+O(k*n^2) and the inputs are not modified.
+
+Return value:
+The function returns the output `info` from LAPACK with the following
+exceptions: the return value is
+
+	-12 if the input s, A and/or b is NULL
+	-14 if the dimensions of A and b are incompatible
+	-15 in case of memory allocation errors.
+*/
+int lsq_stream_update(lsq_stream_t *s, const array2d_t *A, const array_t *b)
+{
+	if(!s || !A || !b) {
+		fprintf(stderr, "Error: s, A or b is a NULL pointer \n");
+		return -12;
+	}
+	if(A->shape[1] != s->n || A->shape[0] != b->len || !lapack_int_fits(A->shape[0])) {
+		fprintf(stderr, "Error: The row block of A must have n columns "
+		"and as many rows as b has elements \n");
+		return -14;
+	}
+	size_t k = A->shape[0], n = s->n;
+	if(k == 0 || n == 0) {
+		s->nrows += k;
+		for(size_t i = 0; i < k; i++) s->rss += b->val[i] * b->val[i];
+		return 0;
+	}
+
+	// ColMajor copy of the block (and b), since DTPQRT overwrites it
+	if(k > s->cap) {
+		double *tmp = realloc(s->B, k * (n + 1) * sizeof(double));
+		if(!tmp) {
+			fprintf(stderr, "Error: Failed to allocate memory\n");
+			return -15;
+		}
+		s->B = tmp;
+		s->cap = k;
+	}
+	size_t st0 = (A->order == RowMajor) ? n : 1;
+	size_t st1 = (A->order == RowMajor) ? 1 : k;
+	for(size_t j = 0; j < n; j++)
+		for(size_t i = 0; i < k; i++)
+			s->B[i + j * k] = A->val[i * st0 + j * st1];
+	double *bk = s->B + k * n;
+	memcpy(bk, b->val, k * sizeof(double));
+
+	lapack_int m = (lapack_int) k, in = (lapack_int) n, l = 0, nrhs = 1, info;
+	char side = 'L', trans = 'T';
+	dtpqrt_(&m,&in,&l,&s->nb,s->R,&in,s->B,&m,s->T,&s->nb,s->work,&info);
+	if(info == 0)
+		dtpmqrt_(&side,&trans,&m,&nrhs,&in,&l,&s->nb,s->B,&m,s->T,&s->nb,s->c,&in,bk,&m,s->work,&info);
+	if(info != 0) {
+		fprintf(stderr, "Error: Parameter numper %ld of the QR update had an illigal value\n", (long)-info);
+		return (int)info;
+	}
+
+	// the rotated-out part of b contributes to the residual
+	for(size_t i = 0; i < k; i++)
+		s->rss += bk[i] * bk[i];
+	s->nrows += k;
+	return 0;
+}
+
+/* lsq_stream_solve : solves the accumulated least-squares problem
+
+Purpose:
+Solves R*x = c with DTRTRS. Upon exit, x (with capacity at least n) contains
+the solution and x->len is n. The residual norm || A*x-b ||_2 is sqrt(s->rss).
+
+Return value:
+The function returns the output `info` from DTRTRS (info > 0 if A does not
+have full rank) with the following exceptions: the return value is
+
+	-12 if the input s and/or x is NULL
+	-13 if fewer than n rows have been consumed
+	-14 if the capacity of x is less than n.
+*/
+int lsq_stream_solve(const lsq_stream_t *s, array_t *x)
+{
+	if(!s || !x) {
+		fprintf(stderr, "Error: s or x is a NULL pointer \n");
+		return -12;
+	}
+	if(s->nrows < s->n) {
+		fprintf(stderr, "Error: The number of rows in A must be "
+		"greater than or equal to the number of columns in A \n");
+		return -13;
+	}
+	if(x->capacity < s->n) {
+		return -14;
+	}
+	lapack_int n = (lapack_int) s->n, nrhs = 1, info = 0;
+	char uplo = 'U', trans = 'N', diag = 'N';
+	memcpy(x->val, s->c, s->n * sizeof(double));
+	if(n > 0)
+		dtrtrs_(&uplo,&trans,&diag,&n,&nrhs,s->R,&n,x->val,&n,&info);
+	if(info == 0) {
+		x->len = s->n;
+	}
+	else if(info > 0) {
+		fprintf(stderr, "Error: A does not have full rank\n");
+	}
+	return (int)info;
+}
+
+// Returns 1 if a line of text contains only whitespace
+static int is_blank(const char *line)
+{
+	return strspn(line, " \t\r\n") == strlen(line);
+}
+
+/* lsq_stream_from_files : streaming least-squares solve from text files
+
+Purpose:
+Solves the least-squares problem for A and b stored in text files (in the
+format read by array2d_from_file and array_from_file) without loading A into
+memory: A and b are read in blocks of `chunk` rows that are passed to
+lsq_stream_update. The memory use is O(n^2 + chunk*n). Blank lines may
+only trail A, and b must have as many rows as A.
+
+Return value:
+A pointer to an array_t with the solution x, or NULL if an error occurs.
+*/
+array_t *lsq_stream_from_files(const char *file_A, const char *file_b, size_t chunk)
+{
+	FILE *fa = fopen(file_A, "r"), *fb = fopen(file_b, "r");
+	char *line = NULL;
+	size_t sz_line = 0, n = 0, rows = 0;
+	lsq_stream_t *s = NULL;
+	array_t *bk = NULL, *x = NULL;
+	double *buf = NULL;
+	int err = 0;
+	if(!fa || !fb) {
+		fprintf(stderr, "Error: could not open %s\n", fa ? file_b : file_A);
+		goto cleanup;
+	}
+	if(chunk == 0) chunk = 1;
+
+	// the first line of A determines the number of columns
+	if(getline(&line, &sz_line, fa) < 0 || (n = array2d_parse_row(line, NULL, 0)) == 0) {
+		fprintf(stderr, "Error: could not read the first row of %s\n", file_A);
+		goto cleanup;
+	}
+	s = lsq_stream_alloc(n);
+	bk = array_alloc(chunk);
+	buf = malloc(chunk * n * sizeof(double));
+	if(!s || !bk || !buf) {
+		fprintf(stderr, "Error: Failed to allocate memory\n");
+		goto cleanup;
+	}
+
+	for(int more = 1; more && !err; ) {
+		// read the next block of rows of A and b
+		rows = 0;
+		do {
+			if(array2d_parse_row(line, buf + rows * n, n) != n) {
+				if(is_blank(line)) {
+					// a blank line ends A, but only if nothing but blank lines follow
+					while(getline(&line, &sz_line, fa) >= 0 && is_blank(line))
+						;
+					if(!feof(fa)) {
+						fprintf(stderr, "Error: %s has rows after a blank line\n", file_A);
+						err = 1;
+					}
+					more = 0;
+					break;
+				}
+				fprintf(stderr, "Error: different column counts encountered.\n");
+				err = 1;
+				break;
+			}
+			if(fscanf(fb, "%lf", bk->val + rows) != 1) {
+				fprintf(stderr, "Error: %s has fewer rows than %s\n", file_b, file_A);
+				err = 1;
+				break;
+			}
+			rows++;
+			if(getline(&line, &sz_line, fa) < 0) { more = 0; break; }
+		} while(rows < chunk);
+		if(err) break;
+
+		array2d_t blk = {{rows, n}, RowMajor, buf};
+		bk->len = rows;
+		if(lsq_stream_update(s, &blk, bk) != 0) err = 1;
+	}
+
+	if(!err && fscanf(fb, " %*c") != EOF) {
+		fprintf(stderr, "Error: %s has more rows than %s\n", file_b, file_A);
+		err = 1;
+	}
+	if(!err) {
+		x = array_alloc(n);
+		if(x && lsq_stream_solve(s, x) != 0) {
+			array_dealloc(x);
+			x = NULL;
+		}
+	}
+
+cleanup:
+	if(fa) fclose(fa);
+	if(fb) fclose(fb);
+	free(line);
+	free(buf);
+	array_dealloc(bk);
+	lsq_stream_dealloc(s);
+	return x;
+}
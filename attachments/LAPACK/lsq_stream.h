@@ -0,0 +1,27 @@
+#ifndef LSQ_STREAM_H
+#define LSQ_STREAM_H
+#include "array.h"
+#include "array2d.h"
+#include "lapack.h"
+
+typedef struct lsq_stream /* streaming least-squares accumulator */
+{
+    size_t n;      // number of columns of A
+    size_t nrows;  // number of rows consumed so far
+    double *R;     // n-by-n upper triangular factor (ColMajor)
+    double *c;     // leading n elements of Q^T*b
+    double rss;    // squared norm of the residual so far
+    double *T;     // block reflector factors (nb-by-n)
+    double *work;  // workspace (nb*n)
+    double *B;     // ColMajor copy of the current row block
+    size_t cap;    // capacity of B in rows
+    lapack_int nb; // block size of the Householder updates
+} lsq_stream_t;
+
+lsq_stream_t *lsq_stream_alloc(size_t n);
+void lsq_stream_dealloc(lsq_stream_t *s);
+int lsq_stream_update(lsq_stream_t *s, const array2d_t *A, const array_t *b);
+int lsq_stream_solve(const lsq_stream_t *s, array_t *x);
+array_t *lsq_stream_from_files(const char *file_A, const char *file_b, size_t chunk);
+
+#endif
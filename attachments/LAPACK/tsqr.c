@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "tsqr.h"
+#include "lapack.h"
+#include "threadpool.h"
+
+typedef struct tsqr_block /* one row block, later one node of the reduction tree */
+{
+	array2d_t *A;  // full matrix (row block r0..r1 is factored in place)
+	double *b;     // full right-hand side
+	size_t r0, r1; // row range of the block
+	double *R;     // n-by-n upper triangular factor (ColMajor)
+	double *c;     // leading n elements of Q^T*b for the block
+	struct tsqr_block *other; // block merged into this one during the reduction
+	lapack_int info;
+} tsqr_block_t;
+
+// LAPACK workspace of the size returned by a query (NULL on failure)
+static double *alloc_work(double wkopt, lapack_int *lwork)
+{
+	*lwork = (wkopt > 1.0) ? (lapack_int) wkopt : 1;
+	return malloc((size_t) *lwork * sizeof(double));
+}
+
+// Factors the rows r0..r1 of A in place and extracts R and c
+static void factor_block(void *arg)
+{
+	tsqr_block_t *blk = arg;
+	array2d_t *A = blk->A;
+	lapack_int m = (lapack_int) A->shape[0], n = (lapack_int) A->shape[1];
+	lapack_int mi = (lapack_int) (blk->r1 - blk->r0), nrhs = 1, lwork = -1, info;
+	char side = 'L';
+	double wkopt, wkopt2, *work, *tau = malloc((n > 0 ? n : 1) * sizeof(double));
+	double *c = blk->b + blk->r0;
+	if(!tau) {
+		blk->info = -15;
+		return;
+	}
+
+	if(A->order == ColMajor) {
+		// the block is an mi-by-n submatrix with leading dimension m: A_i = Q_i*R_i
+		char trans = 'T';
+		double *Ai = A->val + blk->r0;
+		dgeqrf_(&mi,&n,Ai,&m,tau,&wkopt,&lwork,&info);
+		dormqr_(&side,&trans,&mi,&nrhs,&n,Ai,&m,tau,c,&mi,&wkopt2,&lwork,&info);
+		work = alloc_work(wkopt > wkopt2 ? wkopt : wkopt2, &lwork);
+		if(!work) {
+			free(tau);
+			blk->info = -15;
+			return;
+		}
+		dgeqrf_(&mi,&n,Ai,&m,tau,work,&lwork,&info);
+		if(info == 0)
+			dormqr_(&side,&trans,&mi,&nrhs,&n,Ai,&m,tau,c,&mi,work,&lwork,&info);
+		for(size_t j = 0; j < (size_t) n; j++)
+			for(size_t i = 0; i <= j; i++)
+				blk->R[i + j * n] = Ai[i + j * (size_t) m];
+	}
+	else {
+		// the block is A_i^T in ColMajor order (n-by-mi): A_i^T = L_i*Q_i, R_i = L_i^T
+		char trans = 'N';
+		lapack_int lda = n;
+		double *Ai = A->val + blk->r0 * n;
+		dgelqf_(&n,&mi,Ai,&lda,tau,&wkopt,&lwork,&info);
+		dormlq_(&side,&trans,&mi,&nrhs,&n,Ai,&lda,tau,c,&mi,&wkopt2,&lwork,&info);
+		work = alloc_work(wkopt > wkopt2 ? wkopt : wkopt2, &lwork);
+		if(!work) {
+			free(tau);
+			blk->info = -15;
+			return;
+		}
+		dgelqf_(&n,&mi,Ai,&lda,tau,work,&lwork,&info);
+		if(info == 0)
+			dormlq_(&side,&trans,&mi,&nrhs,&n,Ai,&lda,tau,c,&mi,work,&lwork,&info);
+		for(size_t j = 0; j < (size_t) n; j++)
+			for(size_t i = 0; i <= j; i++)
+				blk->R[i + j * n] = Ai[j + i * (size_t) n];
+	}
+	memcpy(blk->c, c, n * sizeof(double));
+	blk->info = info;
+	free(work);
+	free(tau);
+}
+
+// Replaces (R, c) of a block by the QR factorization of [R; R_other] and
+// [c; c_other] with DTPQRT/DTPMQRT, which exploit that both factors are
+// triangular (R_other is overwritten by the Householder vectors)
+static void merge_blocks(void *arg)
+{
+	tsqr_block_t *blk = arg, *oth = blk->other;
+	lapack_int n = (lapack_int) blk->A->shape[1], l = n, nrhs = 1, info;
+	lapack_int nb = (n < 32) ? n : 32;
+	char side = 'L', trans = 'T';
+	double *T = malloc(2 * (size_t) nb * (size_t) n * sizeof(double));
+	if(!T) {
+		blk->info = -15;
+		return;
+	}
+	double *work = T + (size_t) nb * (size_t) n;
+
+	dtpqrt_(&n,&n,&l,&nb,blk->R,&n,oth->R,&n,T,&nb,work,&info);
+	if(info == 0)
+		dtpmqrt_(&side,&trans,&n,&nrhs,&n,&l,&nb,oth->R,&n,T,&nb,blk->c,&n,oth->c,&n,work,&info);
+	blk->info = info;
+	free(T);
+}
+
+/* tsqr_dgels : parallel tall-skinny QR least-squares solver
+
+Purpose:
+Solves the least-squares problem
+
+   minimize  || A*x-b ||_2^2
+
+for a tall and skinny A (m >> n) with the TSQR algorithm: the rows of A are
+split into one block per thread, the blocks are QR-factored in parallel on a
+thread pool (in place, with DGEQRF or with DGELQF on the RowMajor buffer as
+in ls_factor), and the n-by-n R factors and the projected right-hand sides
+are then combined pairwise in a binary reduction tree. Each merge factors
+two stacked triangles with DTPQRT/DTPMQRT (as lsq_stream_update does), which
+costs about 2/3*n^3 flops instead of the 10/3*n^3 of DGEQRF on the 2n-by-n
+block. The result is the
+same solution as call_dgels. Upon exit, A is overwritten, the leading n
+elements of b contain the solution x, and b->len is n.
+
+The number of blocks is reduced if a block would have fewer than n rows.
+With nthreads = 1 the problem is solved by a single QR factorization.
+
+Return value:
+The function returns the output `info` from LAPACK (info > 0 if A does not
+have full rank) with the following exceptions: the return value is
+
+	-12 if the input A is NULL and/or the input b is NULL
+	-13 if A->shape[0]<A->shape[1]
+	-14 if the dimensions of A and b are incompatible
+	-15 in case of memory allocation errors.
+*/
+int tsqr_dgels(array2d_t *A, array_t *b, size_t nthreads)
+{
+	if(!A || !b) {
+		fprintf(stderr, "Error: A or b is a NULL pointer \n");
+		return -12;
+	}
+	if(A->shape[0] < A->shape[1]) {
+		fprintf(stderr, "Error: The number of rows in A must be "
+		"greater than or equal to the number of columns in A \n");
+		return -13;
+	}
+	if(A->shape[0] != b->len || !lapack_int_fits(A->shape[0])) {
+		fprintf(stderr, "Error: The number of rows in A must be"
+		"equal to the length of b \n");
+		return -14;
+	}
+
+	size_t m = A->shape[0], n = A->shape[1];
+	if(n == 0) {
+		b->len = 0;
+		return 0;
+	}
+	size_t p = (nthreads > 0) ? nthreads : 1;
+	if(p > m / n)
+		p = m / n;
+
+	tsqr_block_t *blk = calloc(p, sizeof(*blk));
+	double *buf = malloc(p * (n * n + n) * sizeof(double));
+	threadpool_t *pool = (p > 1) ? threadpool_alloc(p) : NULL;
+	if(!blk || !buf || (p > 1 && !pool)) {
+		fprintf(stderr, "Error: Failed to allocate memory\n");
+		free(blk);
+		free(buf);
+		threadpool_dealloc(pool);
+		return -15;
+	}
+
+	// factor the row blocks in parallel
+	for(size_t k = 0; k < p; k++) {
+		blk[k].A = A;
+		blk[k].b = b->val;
+		blk[k].r0 = k * m / p;
+		blk[k].r1 = (k + 1) * m / p;
+		blk[k].R = buf + k * (n * n + n);
+		blk[k].c = blk[k].R + n * n;
+		// a block that cannot be queued is factored by the calling thread
+		if(threadpool_submit(pool, factor_block, blk + k) != MSP_SUCCESS)
+			factor_block(blk + k);
+	}
+	threadpool_wait(pool);
+	lapack_int info = 0;
+	for(size_t k = 0; k < p && info == 0; k++)
+		info = blk[k].info;
+
+	// reduce the R factors pairwise in a binary tree
+	for(size_t step = 1; step < p && info == 0; step *= 2) {
+		for(size_t k = 0; k + step < p; k += 2 * step) {
+			blk[k].other = blk + k + step;
+			if(threadpool_submit(pool, merge_blocks, blk + k) != MSP_SUCCESS)
+				merge_blocks(blk + k);
+		}
+		threadpool_wait(pool);
+		for(size_t k = 0; k + step < p && info == 0; k += 2 * step)
+			info = blk[k].info;
+	}
+
+	// solve R*x = c
+	if(info == 0) {
+		lapack_int in = (lapack_int) n, nrhs = 1;
+		char uplo = 'U', trans = 'N', diag = 'N';
+		dtrtrs_(&uplo,&trans,&diag,&in,&nrhs,blk[0].R,&in,blk[0].c,&in,&info);
+	}
+	if(info == 0) {
+		memcpy(b->val, blk[0].c, n * sizeof(double));
+		b->len = n;
+	}
+	else if (info > 0) {
+		fprintf(stderr, "Error: A does not have full rank\n");
+	}
+
+	threadpool_dealloc(pool);
+	free(buf);
+	free(blk);
+	return (int)info;
+}
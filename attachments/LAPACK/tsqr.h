@@ -0,0 +1,8 @@
+#ifndef TSQR_H
+#define TSQR_H
+#include "array.h"
+#include "array2d.h"
+
+int tsqr_dgels(array2d_t *A, array_t *b, size_t nthreads);
+
+#endif
@@ -157,6 +157,40 @@ array2d_t *array2d_from_file(const char *filename)
   return arr;
 }
 
+size_t array2d_parse_row(const char *line, double *val, size_t max)
+/*
+  Purpose:
+
+    Parses the numbers on a line of text in the format read by
+    array2d_from_file. Readers that process a file row by row (instead of
+    loading it with array2d_from_file) use it to read one row at a time;
+    with max = 0 it counts the columns of a row.
+
+  Arguments:
+    line       a null-terminated string
+    val        a pointer to at least max doubles (may be NULL if max is 0)
+    max        the largest number of values stored in val
+
+  Return value:
+    The number of values on the line (which may exceed max).
+*/
+{
+  size_t cnt = 0;
+  const char *p = line;
+  char *end;
+  for (;;)
+  {
+    double v = strtod(p, &end);
+    if (end == p)
+      break;
+    if (cnt < max)
+      val[cnt] = v;
+    cnt++;
+    p = end;
+  }
+  return cnt;
+}
+
 int array2d_to_file(const char *filename, const array2d_t *a)
 /*
   Purpose:
@@ -14,6 +14,7 @@ typedef struct array2d /* two-dimensional array */
 array2d_t *array2d_alloc(const size_t shape[2], enum storage_order order);
 void array2d_dealloc(array2d_t *a);
 array2d_t *array2d_from_file(const char *filename);
+size_t array2d_parse_row(const char *line, double *val, size_t max);
 int array2d_to_file(const char *filename, const array2d_t *a);
 int array2d_reshape(array2d_t *a, const size_t new_shape[2]);
 void array2d_fprint(FILE *stream, const array2d_t *a);
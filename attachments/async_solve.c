@@ -0,0 +1,263 @@
+#define _POSIX_C_SOURCE 200809L
+#include "async_solve.h"
+#include "call_dgesv.h"
+#include "threadpool.h"
+#ifndef MSP_NO_LAPACK
+#include "call_dgels.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+enum job_kind
+{
+  JobDgesv,
+  JobDgesvMulti,
+  JobDgels
+};
+
+struct async_solver
+{
+  threadpool_t *pool;
+};
+
+struct solve_job
+{
+  enum job_kind kind;
+  array2d_t *A;
+  array_t *b;
+  array2d_t *B;
+  solve_callback_t callback;
+  void *data;
+  pthread_mutex_t lock;
+  pthread_cond_t done_cond;
+  int info;
+  int done;     // set when the solve and the callback have completed
+  int detached; // the worker deallocates the job when it completes
+};
+
+static void job_free(solve_job_t *job)
+{
+  pthread_mutex_destroy(&job->lock);
+  pthread_cond_destroy(&job->done_cond);
+  free(job);
+}
+
+// Worker task: runs the solve and the callback, then wakes the waiters
+static void run_job(void *arg)
+{
+  solve_job_t *job = arg;
+  int info;
+  if (job->kind == JobDgesv)
+    info = call_dgesv(job->A, job->b);
+  else if (job->kind == JobDgesvMulti)
+    info = call_dgesv_multi(job->A, job->B);
+  else
+#ifndef MSP_NO_LAPACK
+    info = call_dgels(job->A, job->b);
+#else
+    info = -9;
+#endif
+  if (job->callback)
+    job->callback(info, job->data);
+
+  pthread_mutex_lock(&job->lock);
+  job->info = info;
+  job->done = 1;
+  int detached = job->detached;
+  pthread_cond_broadcast(&job->done_cond);
+  pthread_mutex_unlock(&job->lock);
+  if (detached)
+    job_free(job);
+}
+
+static solve_job_t *submit(async_solver_t *solver, enum job_kind kind, array2d_t *A, array_t *b, array2d_t *B,
+                           solve_callback_t callback, void *data)
+{
+  if (solver == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return NULL;
+  }
+  solve_job_t *job = calloc(1, sizeof(*job));
+  if (job == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  job->kind = kind;
+  job->A = A;
+  job->b = b;
+  job->B = B;
+  job->callback = callback;
+  job->data = data;
+  pthread_mutex_init(&job->lock, NULL);
+  pthread_cond_init(&job->done_cond, NULL);
+  if (threadpool_submit(solver->pool, run_job, job) != MSP_SUCCESS)
+  {
+    job_free(job);
+    return NULL;
+  }
+  return job;
+}
+
+async_solver_t *async_solver_alloc(size_t nthreads)
+/*
+  Purpose:
+
+    Creates a pool of worker threads for asynchronous solves. Jobs are run
+    in submission order by the first free worker, so independent systems
+    are solved concurrently while the caller continues (e.g. with reading
+    or parsing the next system). If LAPACK/BLAS is multithreaded itself,
+    limit its threads (e.g. OPENBLAS_NUM_THREADS=1) to avoid
+    oversubscription.
+
+  Example:
+
+    ```c
+    async_solver_t *solver = async_solver_alloc(4);
+    solve_job_t *job = async_dgesv(solver, A, b, NULL, NULL);
+    ...                               // other work
+    int info = solve_job_wait(job);   // b holds the solution if info == 0
+    solve_job_dealloc(job);
+    async_solver_dealloc(solver);
+    ```
+
+  Arguments:
+    nthreads     number of worker threads (0: one per online processor)
+
+  Return value:
+    A pointer to an async_solver_t, or NULL if an error occurs.
+*/
+{
+  async_solver_t *solver = malloc(sizeof(*solver));
+  if (solver == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  if (nthreads == 0)
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = ncpu > 0 ? (size_t)ncpu : 1;
+  }
+  solver->pool = threadpool_alloc(nthreads);
+  if (solver->pool == NULL)
+  {
+    free(solver);
+    return NULL;
+  }
+  return solver;
+}
+
+void async_solver_dealloc(async_solver_t *solver)
+/* Purpose: Completes all submitted jobs and deallocates the solver (job handles stay valid). */
+{
+  if (solver == NULL)
+    return;
+  threadpool_dealloc(solver->pool);
+  free(solver);
+}
+
+solve_job_t *async_dgesv(async_solver_t *solver, array2d_t *A, array_t *b, solve_callback_t callback, void *data)
+/*
+  Purpose:
+
+    Queues the solve of A*x = b with call_dgesv and returns immediately.
+    A and b must not be accessed or deallocated until the job has completed
+    (see solve_job_poll and solve_job_wait); then b holds the solution and
+    A its LU factors, as after call_dgesv. If callback is not NULL, it is
+    called as callback(info, data) on the worker thread when the solve has
+    completed.
+
+  Arguments:
+    solver     a pointer to an async_solver_t
+    A          a pointer to a square array2d_t
+    b          a pointer to an array_t
+    callback   completion callback (or NULL)
+    data       argument passed to callback
+
+  Return value:
+    A handle that must be released with solve_job_dealloc or
+    solve_job_detach, or NULL if the job could not be queued.
+*/
+{
+  return submit(solver, JobDgesv, A, b, NULL, callback, data);
+}
+
+solve_job_t *async_dgesv_multi(async_solver_t *solver, array2d_t *A, array2d_t *B, solve_callback_t callback,
+                               void *data)
+/* Purpose: As async_dgesv, but solves A*X = B with call_dgesv_multi. */
+{
+  return submit(solver, JobDgesvMulti, A, NULL, B, callback, data);
+}
+
+#ifndef MSP_NO_LAPACK
+solve_job_t *async_dgels(async_solver_t *solver, array2d_t *A, array_t *b, solve_callback_t callback, void *data)
+/* Purpose: As async_dgesv, but solves the least-squares problem min ||A*x-b|| with call_dgels. */
+{
+  return submit(solver, JobDgels, A, b, NULL, callback, data);
+}
+#endif
+
+int solve_job_poll(solve_job_t *job)
+/* Purpose: Returns 1 if the job (including its callback) has completed and 0 otherwise. */
+{
+  if (job == NULL)
+    return 0;
+  pthread_mutex_lock(&job->lock);
+  int done = job->done;
+  pthread_mutex_unlock(&job->lock);
+  return done;
+}
+
+int solve_job_wait(solve_job_t *job)
+/*
+  Purpose:
+
+    Blocks until the job (including its callback) has completed. May be
+    called any number of times.
+
+  Return value:
+    The return value of the solver (e.g. `info` from call_dgesv), or -9 if
+    job is NULL.
+*/
+{
+  if (job == NULL)
+    return -9;
+  pthread_mutex_lock(&job->lock);
+  while (!job->done)
+    pthread_cond_wait(&job->done_cond, &job->lock);
+  int info = job->info;
+  pthread_mutex_unlock(&job->lock);
+  return info;
+}
+
+void solve_job_detach(solve_job_t *job)
+/* Purpose: Releases the handle without waiting; the job is deallocated when it completes (fire and forget with a callback). */
+{
+  if (job == NULL)
+    return;
+  pthread_mutex_lock(&job->lock);
+  int done = job->done;
+  job->detached = 1;
+  pthread_mutex_unlock(&job->lock);
+  if (done)
+    job_free(job);
+}
+
+void solve_job_dealloc(solve_job_t *job)
+/* Purpose: Waits for the job to complete and deallocates the handle. */
+{
+  if (job == NULL)
+    return;
+  solve_job_wait(job);
+  job_free(job);
+}
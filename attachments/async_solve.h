@@ -0,0 +1,27 @@
+#ifndef ASYNC_SOLVE_H
+#define ASYNC_SOLVE_H
+#include "array.h"
+#include "array2d.h"
+
+typedef struct async_solver async_solver_t; /* thread pool that runs solve jobs */
+typedef struct solve_job solve_job_t;       /* handle of a submitted solve */
+
+/* Called on the worker thread when a job completes (before solve_job_wait returns) */
+typedef void (*solve_callback_t)(int info, void *data);
+
+async_solver_t *async_solver_alloc(size_t nthreads);
+void async_solver_dealloc(async_solver_t *solver);
+
+solve_job_t *async_dgesv(async_solver_t *solver, array2d_t *A, array_t *b, solve_callback_t callback, void *data);
+solve_job_t *async_dgesv_multi(async_solver_t *solver, array2d_t *A, array2d_t *B, solve_callback_t callback,
+                               void *data);
+#ifndef MSP_NO_LAPACK
+solve_job_t *async_dgels(async_solver_t *solver, array2d_t *A, array_t *b, solve_callback_t callback, void *data);
+#endif
+
+int solve_job_poll(solve_job_t *job);
+int solve_job_wait(solve_job_t *job);
+void solve_job_detach(solve_job_t *job);
+void solve_job_dealloc(solve_job_t *job);
+
+#endif
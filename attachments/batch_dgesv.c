@@ -0,0 +1,310 @@
+#include "batch_dgesv.h"
+#include "threadpool.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <limits.h>
+
+// Number of interleaved systems handled together by the batch-major kernel
+#define BATCH_LANES 8
+
+typedef struct batch_task /* range k0..k1 of the batch solved by one task */
+{
+  ndarray_t *A;
+  ndarray_t *B;
+  size_t k0, k1;
+  size_t first_singular; // index+1 of the first singular system, or 0
+} batch_task_t;
+
+// Gaussian elimination with partial pivoting on [A | b] for one RowMajor
+// n-by-n system, followed by back substitution (b is overwritten by x).
+// Returns 1 if A is singular and 0 otherwise.
+static inline int solve_rowmajor(double *restrict a, double *restrict b, const size_t n)
+{
+  int singular = 0;
+  for (size_t j = 0; j < n; j++)
+  {
+    size_t p = j;
+    double amax = fabs(a[j * n + j]);
+    for (size_t i = j + 1; i < n; i++)
+    {
+      if (fabs(a[i * n + j]) > amax)
+      {
+        amax = fabs(a[i * n + j]);
+        p = i;
+      }
+    }
+    if (amax == 0.0)
+    {
+      singular = 1;
+      continue;
+    }
+    if (p != j)
+    {
+      for (size_t c = j; c < n; c++)
+      {
+        double t = a[j * n + c];
+        a[j * n + c] = a[p * n + c];
+        a[p * n + c] = t;
+      }
+      double t = b[j];
+      b[j] = b[p];
+      b[p] = t;
+    }
+    double r = 1.0 / a[j * n + j];
+    for (size_t i = j + 1; i < n; i++)
+    {
+      double l = a[i * n + j] * r;
+      a[i * n + j] = l;
+      for (size_t c = j + 1; c < n; c++)
+        a[i * n + c] -= l * a[j * n + c];
+      b[i] -= l * b[j];
+    }
+  }
+  if (singular)
+    return 1;
+  for (size_t i = n; i-- > 0;)
+  {
+    double s = b[i];
+    for (size_t c = i + 1; c < n; c++)
+      s -= a[i * n + c] * b[c];
+    b[i] = s / a[i * n + i];
+  }
+  return 0;
+}
+
+// Same as solve_rowmajor for nl <= BATCH_LANES interleaved systems: entry
+// (i,j) of system l is a[l + ld*(i + n*j)] and entry i of its right-hand side
+// is b[l + ld*i], so the elimination is vectorized across the systems. Pivot
+// rows are chosen and swapped per system. Sets sing[l] = 1 for singular systems.
+static inline void solve_interleaved(double *restrict a, double *restrict b, const size_t n,
+                                     const size_t ld, const size_t nl, int *sing)
+{
+  double r[BATCH_LANES], m[BATCH_LANES];
+  const size_t ldc = ld * n; // distance between columns
+  for (size_t l = 0; l < nl; l++)
+    sing[l] = 0;
+  for (size_t j = 0; j < n; j++)
+  {
+    for (size_t l = 0; l < nl; l++)
+    {
+      size_t p = j;
+      double amax = fabs(a[l + ld * j + ldc * j]);
+      for (size_t i = j + 1; i < n; i++)
+      {
+        if (fabs(a[l + ld * i + ldc * j]) > amax)
+        {
+          amax = fabs(a[l + ld * i + ldc * j]);
+          p = i;
+        }
+      }
+      if (p != j)
+      {
+        for (size_t c = j; c < n; c++)
+        {
+          double t = a[l + ld * j + ldc * c];
+          a[l + ld * j + ldc * c] = a[l + ld * p + ldc * c];
+          a[l + ld * p + ldc * c] = t;
+        }
+        double t = b[l + ld * j];
+        b[l + ld * j] = b[l + ld * p];
+        b[l + ld * p] = t;
+      }
+      if (amax == 0.0)
+        sing[l] = 1;
+    }
+    for (size_t l = 0; l < nl; l++)
+    {
+      double d = a[l + ld * j + ldc * j];
+      r[l] = (d != 0.0) ? 1.0 / d : 0.0;
+    }
+    for (size_t i = j + 1; i < n; i++)
+    {
+      for (size_t l = 0; l < nl; l++)
+      {
+        m[l] = a[l + ld * i + ldc * j] * r[l];
+        a[l + ld * i + ldc * j] = m[l];
+        b[l + ld * i] -= m[l] * b[l + ld * j];
+      }
+      for (size_t c = j + 1; c < n; c++)
+        for (size_t l = 0; l < nl; l++)
+          a[l + ld * i + ldc * c] -= m[l] * a[l + ld * j + ldc * c];
+    }
+  }
+  for (size_t i = n; i-- > 0;)
+  {
+    for (size_t c = i + 1; c < n; c++)
+      for (size_t l = 0; l < nl; l++)
+        b[l + ld * i] -= a[l + ld * i + ldc * c] * b[l + ld * c];
+    for (size_t l = 0; l < nl; l++)
+      b[l + ld * i] /= a[l + ld * i + ldc * i];
+  }
+}
+
+// Size-specialized kernels: n (and the lane count) are compile-time
+// constants, so the loops above are unrolled and vectorized
+#define BATCH_KERNELS(N)                                                        \
+  static int solve_rowmajor_##N(double *restrict a, double *restrict b)         \
+  {                                                                             \
+    return solve_rowmajor(a, b, N);                                             \
+  }                                                                             \
+  static void solve_interleaved_##N(double *restrict a, double *restrict b,     \
+                                    size_t ld, int *sing)                       \
+  {                                                                             \
+    solve_interleaved(a, b, N, ld, BATCH_LANES, sing);                          \
+  }
+
+// Sizes with a specialized kernel (2, 3, and every n from 4 to BATCH_MAX_N)
+#define BATCH_MAX_N 32
+#define BATCH_SIZES(X)                                                          \
+  X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)   \
+  X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27)       \
+  X(28) X(29) X(30) X(31) X(32)
+
+BATCH_SIZES(BATCH_KERNELS)
+
+#define ROWMAJOR_ENTRY(N) [N] = solve_rowmajor_##N,
+#define INTERLEAVED_ENTRY(N) [N] = solve_interleaved_##N,
+
+// Kernels indexed by n (NULL: use the generic kernel)
+static int (*const rowmajor_kernels[BATCH_MAX_N + 1])(double *restrict, double *restrict) = {
+    BATCH_SIZES(ROWMAJOR_ENTRY)};
+static void (*const interleaved_kernels[BATCH_MAX_N + 1])(double *restrict, double *restrict, size_t, int *) = {
+    BATCH_SIZES(INTERLEAVED_ENTRY)};
+
+// Solves the systems k0..k1 of a batch stored matrix by matrix (RowMajor)
+static void solve_range_rowmajor(batch_task_t *task)
+{
+  size_t n = task->A->shape[1];
+  int (*kernel)(double *restrict, double *restrict) = (n <= BATCH_MAX_N) ? rowmajor_kernels[n] : NULL;
+  for (size_t k = task->k0; k < task->k1; k++)
+  {
+    double *a = task->A->val + k * n * n, *b = task->B->val + k * n;
+    int singular = kernel ? kernel(a, b) : solve_rowmajor(a, b, n);
+    if (singular && task->first_singular == 0)
+      task->first_singular = k + 1;
+  }
+}
+
+// Solves the systems k0..k1 of a batch-major (ColMajor) batch, BATCH_LANES at a time
+static void solve_range_interleaved(batch_task_t *task)
+{
+  size_t batch = task->A->shape[0], n = task->A->shape[1];
+  void (*kernel)(double *restrict, double *restrict, size_t, int *) =
+      (n <= BATCH_MAX_N) ? interleaved_kernels[n] : NULL;
+  int sing[BATCH_LANES];
+  for (size_t k = task->k0; k < task->k1; k += BATCH_LANES)
+  {
+    size_t nl = (task->k1 - k < BATCH_LANES) ? task->k1 - k : BATCH_LANES;
+    double *a = task->A->val + k, *b = task->B->val + k;
+    if (kernel && nl == BATCH_LANES)
+      kernel(a, b, batch, sing);
+    else
+      solve_interleaved(a, b, n, batch, nl, sing);
+    for (size_t l = 0; l < nl && task->first_singular == 0; l++)
+      if (sing[l])
+        task->first_singular = k + l + 1;
+  }
+}
+
+static void solve_range(void *arg)
+{
+  batch_task_t *task = arg;
+  if (task->A->order == RowMajor)
+    solve_range_rowmajor(task);
+  else
+    solve_range_interleaved(task);
+}
+
+/* call_dgesv_batch : solves a batch of small square linear systems
+
+Purpose:
+Solves the independent linear systems A[k]*x[k] = b[k], k = 0..batch-1, where
+A is a contiguous 3-D array of shape [batch, n, n] and B is a contiguous 2-D
+array of shape [batch, n] with the same storage order. Upon exit, B holds the
+solutions and A is overwritten by the (row-permuted) LU factors.
+
+The storage order selects the layout of the batch:
+  RowMajor   matrix by matrix: A[k] is the RowMajor n-by-n matrix starting at
+             A->val + k*n*n and b[k] starts at B->val + k*n.
+  ColMajor   batch-major ("interleaved"): entry (i,j) of A[k] is
+             A->val[k + batch*(i + n*j)] and b[k][i] is B->val[k + batch*i],
+             so the same entry of consecutive systems is contiguous. The
+             systems are eliminated BATCH_LANES at a time across the batch,
+             which lets the compiler use SIMD instructions for any n.
+
+Each system is solved by Gaussian elimination with partial pivoting. Kernels
+with a compile-time size are used for n = 2..32, and a generic kernel
+otherwise. The batch is split into one contiguous range per thread of pool,
+and the ranges are solved in parallel (pool == NULL solves the batch in the
+calling thread). The pool is owned by the caller, so it can be reused for
+many batches; the function waits for all tasks of the pool (threadpool_wait)
+and must not be called from one of them. The function is intended for small
+n; use call_dgesv for large systems.
+
+Return value:
+The function returns 0 if all systems were solved, and k+1 if A[k] is the
+first exactly singular matrix in the batch, or INT_MAX if k+1 > INT_MAX (the
+solutions of the singular systems are undefined, all others are computed).
+Otherwise the return value is
+
+  -9 if the input A is NULL and/or the input B is NULL
+  -10 if A is not of shape [batch, n, n]
+  -11 if B is not of shape [batch, n], the storage orders differ, or one of
+      the arrays is not contiguous
+  -12 in case of memory allocation errors.
+*/
+int call_dgesv_batch(ndarray_t *A, ndarray_t *B, threadpool_t *pool)
+{
+  if (A == NULL || B == NULL)
+  {
+    return -9;
+  }
+  if (A->ndim != 3 || A->shape[1] != A->shape[2])
+  {
+    return -10;
+  }
+  if (B->ndim != 2 || B->shape[0] != A->shape[0] || B->shape[1] != A->shape[1] ||
+      B->order != A->order || !ndarray_iscontiguous(A) || !ndarray_iscontiguous(B))
+  {
+    return -11;
+  }
+
+  size_t batch = A->shape[0];
+  if (batch == 0 || A->shape[1] == 0)
+  {
+    return 0;
+  }
+
+  // Ranges start at multiples of BATCH_LANES so interleaved groups stay full
+  size_t groups = (batch + BATCH_LANES - 1) / BATCH_LANES;
+  size_t p = threadpool_size(pool);
+  if (p > groups)
+    p = groups;
+  batch_task_t *task = calloc(p, sizeof(*task));
+  if (task == NULL)
+  {
+    return -12;
+  }
+
+  for (size_t t = 0; t < p; t++)
+  {
+    task[t].A = A;
+    task[t].B = B;
+    task[t].k0 = (t * groups / p) * BATCH_LANES;
+    task[t].k1 = ((t + 1) * groups / p) * BATCH_LANES;
+    if (task[t].k1 > batch)
+      task[t].k1 = batch;
+    // a range that cannot be queued is solved by the calling thread
+    if (threadpool_submit(pool, solve_range, task + t) != MSP_SUCCESS)
+      solve_range(task + t);
+  }
+  threadpool_wait(pool);
+
+  size_t first = 0;
+  for (size_t t = 0; t < p && first == 0; t++)
+    first = task[t].first_singular;
+
+  free(task);
+  return (first > INT_MAX) ? INT_MAX : (int)first;
+}
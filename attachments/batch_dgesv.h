@@ -0,0 +1,8 @@
+#ifndef BATCH_DGESV_H
+#define BATCH_DGESV_H
+#include "ndarray.h"
+#include "threadpool.h"
+
+int call_dgesv_batch(ndarray_t *A, ndarray_t *B, threadpool_t *pool);
+
+#endif
@@ -0,0 +1,115 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "msptools.h"
+#include "call_dgesv.h"
+#include "async_solve.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Completion callback: counts the failed solves
+static void count_failures(int info, void *data)
+{
+  if (info != 0)
+    __atomic_add_fetch((int *)data, 1, __ATOMIC_RELAXED);
+}
+
+// Fills the k'th system with pseudo-random values (stands in for reading it from a file)
+static void generate(array2d_t *A, array_t *b, size_t k)
+{
+  size_t n = b->len;
+  srand((unsigned)k);
+  for (size_t i = 0; i < n * n; i++)
+    A->val[i] = (double)rand() / RAND_MAX - 0.5;
+  for (size_t i = 0; i < n; i++)
+    b->val[i] = 1.0;
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_async [count [n [nthreads]]]: independent solves, one by one versus asynchronously
+  size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200;
+  size_t n = (argc > 2) ? strtoul(argv[2], NULL, 10) : 300;
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t nthreads = (argc > 3) ? strtoul(argv[3], NULL, 10) : (ncpu > 0 ? (size_t)ncpu : 1);
+
+  array2d_t **A = malloc(count * sizeof(*A));
+  array_t **b = malloc(count * sizeof(*b));
+  double *x = malloc(count * n * sizeof(*x));
+  solve_job_t **jobs = malloc(count * sizeof(*jobs));
+  if (!A || !b || !x || !jobs)
+  {
+    fprintf(stderr, "Error: failed to allocate %zu systems of size %zu\n", count, n);
+    return EXIT_FAILURE;
+  }
+  for (size_t k = 0; k < count; k++)
+  {
+    A[k] = array2d_alloc((size_t[]){n, n}, RowMajor);
+    b[k] = array_alloc(n);
+    if (!A[k] || !b[k])
+    {
+      fprintf(stderr, "Error: failed to allocate %zu systems of size %zu\n", count, n);
+      return EXIT_FAILURE;
+    }
+    b[k]->len = n;
+  }
+
+  // Generate and solve one system at a time
+  double t_sync = wtime();
+  for (size_t k = 0; k < count; k++)
+  {
+    generate(A[k], b[k], k);
+    if (call_dgesv(A[k], b[k]) != 0)
+      fprintf(stderr, "Error: call_dgesv failed for system %zu\n", k);
+  }
+  t_sync = wtime() - t_sync;
+  for (size_t k = 0; k < count; k++)
+    memcpy(x + k * n, b[k]->val, n * sizeof(*x));
+
+  // Generate the next system while the previous ones are solved
+  async_solver_t *solver = async_solver_alloc(nthreads);
+  if (solver == NULL)
+    return EXIT_FAILURE;
+  int failures = 0;
+  double t_async = wtime();
+  for (size_t k = 0; k < count; k++)
+  {
+    generate(A[k], b[k], k);
+    jobs[k] = async_dgesv(solver, A[k], b[k], count_failures, &failures);
+  }
+  for (size_t k = 0; k < count; k++)
+    solve_job_dealloc(jobs[k]);
+  t_async = wtime() - t_async;
+  async_solver_dealloc(solver);
+  if (failures)
+    fprintf(stderr, "Error: %d asynchronous solves failed\n", failures);
+
+  double dx = 0.0;
+  for (size_t k = 0; k < count; k++)
+    for (size_t i = 0; i < n; i++)
+      dx = fmax(dx, fabs(x[k * n + i] - b[k]->val[i]));
+  printf("%8s %6s %8s %12s %12s %8s %12s\n", "count", "n", "threads", "sync [s]", "async [s]", "speedup",
+         "max |dx|");
+  printf("%8zu %6zu %8zu %12.4f %12.4f %8.2f %12.3e\n", count, n, nthreads, t_sync, t_async, t_sync / t_async, dx);
+
+  for (size_t k = 0; k < count; k++)
+  {
+    array2d_dealloc(A[k]);
+    array_dealloc(b[k]);
+  }
+  free(A);
+  free(b);
+  free(x);
+  free(jobs);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "msptools.h"
+#include "call_dgesv.h"
+#include "batch_dgesv.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Maximum difference between the RowMajor solutions x and the interleaved solutions xi
+static double max_diff(const double *x, const double *xi, size_t batch, size_t n, int interleaved)
+{
+  double d = 0.0;
+  for (size_t k = 0; k < batch; k++)
+    for (size_t i = 0; i < n; i++)
+    {
+      double e = fabs(x[k * n + i] - (interleaved ? xi[k + batch * i] : xi[k * n + i]));
+      if (e > d)
+        d = e;
+    }
+  return d;
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_batch [batch [nthreads]]
+  size_t batch = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100000;
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t nthreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : (ncpu > 0 ? (size_t)ncpu : 1);
+  const size_t sizes[] = {4, 5, 8, 12, 16, 24, 32};
+  // one pool for all batches, so thread creation is not timed
+  threadpool_t *pool = (nthreads > 1) ? threadpool_alloc(nthreads) : NULL;
+  if (nthreads > 1 && pool == NULL)
+    return EXIT_FAILURE;
+
+  printf("batch = %zu, threads = %zu (times in s, rate in systems/s)\n", batch, nthreads);
+  printf("%4s %10s %10s %10s %10s %10s %12s %10s\n", "n", "dgesv", "batch/1", "batch/p",
+         "interl/p", "speedup", "rate", "max |dx|");
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    size_t n = sizes[s], nn = n * n;
+    ndarray_t *A0 = ndarray_alloc(3, (size_t[]){batch, n, n}, RowMajor);
+    ndarray_t *B0 = ndarray_alloc(2, (size_t[]){batch, n}, RowMajor);
+    ndarray_t *A = ndarray_alloc(3, (size_t[]){batch, n, n}, RowMajor);
+    ndarray_t *B = ndarray_alloc(2, (size_t[]){batch, n}, RowMajor);
+    ndarray_t *Ai = ndarray_alloc(3, (size_t[]){batch, n, n}, ColMajor);
+    ndarray_t *Bi = ndarray_alloc(2, (size_t[]){batch, n}, ColMajor);
+    double *x = malloc(batch * n * sizeof(double));
+    if (!A0 || !B0 || !A || !B || !Ai || !Bi || !x)
+    {
+      fprintf(stderr, "Error: failed to allocate batch of %zu systems of size %zu\n", batch, n);
+      return EXIT_FAILURE;
+    }
+    srand(0);
+    for (size_t k = 0; k < batch * nn; k++)
+      A0->val[k] = (double)rand() / RAND_MAX - 0.5;
+    for (size_t k = 0; k < batch * n; k++)
+      B0->val[k] = (double)rand() / RAND_MAX;
+
+    // One call_dgesv per system
+    memcpy(A->val, A0->val, batch * nn * sizeof(double));
+    memcpy(x, B0->val, batch * n * sizeof(double));
+    double t_ref = wtime();
+    for (size_t k = 0; k < batch; k++)
+    {
+      array2d_t Ak = {{n, n}, RowMajor, A->val + k * nn};
+      array_t bk = {n, n, x + k * n};
+      if (call_dgesv(&Ak, &bk) != 0)
+        fprintf(stderr, "Error: call_dgesv failed for system %zu\n", k);
+    }
+    t_ref = wtime() - t_ref;
+
+    // Batched, matrix by matrix, with one and nthreads threads
+    double t_batch[2];
+    int info = 0;
+    for (int r = 0; r < 2; r++)
+    {
+      memcpy(A->val, A0->val, batch * nn * sizeof(double));
+      memcpy(B->val, B0->val, batch * n * sizeof(double));
+      t_batch[r] = wtime();
+      info |= call_dgesv_batch(A, B, r == 0 ? NULL : pool);
+      t_batch[r] = wtime() - t_batch[r];
+    }
+    double dx = max_diff(x, B->val, batch, n, 0);
+
+    // Batched, interleaved (the conversion is not timed)
+    for (size_t k = 0; k < batch; k++)
+    {
+      for (size_t i = 0; i < n; i++)
+      {
+        for (size_t j = 0; j < n; j++)
+          Ai->val[k + batch * (i + n * j)] = A0->val[k * nn + i * n + j];
+        Bi->val[k + batch * i] = B0->val[k * n + i];
+      }
+    }
+    double t_il = wtime();
+    info |= call_dgesv_batch(Ai, Bi, pool);
+    t_il = wtime() - t_il;
+    double dxi = max_diff(x, Bi->val, batch, n, 1);
+    if (info != 0)
+      fprintf(stderr, "Error: call_dgesv_batch reported a singular system\n");
+
+    double t_best = (t_il < t_batch[1]) ? t_il : t_batch[1];
+    printf("%4zu %10.4f %10.4f %10.4f %10.4f %10.2f %12.3e %10.2e\n", n, t_ref, t_batch[0], t_batch[1],
+           t_il, t_ref / t_best, batch / t_best, dx > dxi ? dx : dxi);
+    fflush(stdout);
+
+    ndarray_dealloc(A0);
+    ndarray_dealloc(B0);
+    ndarray_dealloc(A);
+    ndarray_dealloc(B);
+    ndarray_dealloc(Ai);
+    ndarray_dealloc(Bi);
+    free(x);
+  }
+
+  threadpool_dealloc(pool);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "msptools.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// 5-point stencil on a g-by-g grid with d coupled degrees of freedom per node (dense d-by-d blocks)
+static coo_t *multi_dof(size_t g, size_t d)
+{
+  size_t n = g * g * d;
+  coo_t *sp = coo_alloc((size_t[]){n, n}, 5 * g * g * d * d);
+  if (sp == NULL)
+    return NULL;
+  size_t k = 0;
+  for (size_t i = 0; i < g; i++)
+    for (size_t j = 0; j < g; j++)
+    {
+      size_t node = i * g + j;
+      size_t nb[5] = {node, node - g, node + g, node - 1, node + 1};
+      int ok[5] = {1, i > 0, i + 1 < g, j > 0, j + 1 < g};
+      for (int l = 0; l < 5; l++)
+        if (ok[l])
+          for (size_t r = 0; r < d; r++)
+            for (size_t c = 0; c < d; c++, k++)
+            {
+              sp->rowidx[k] = node * d + r;
+              sp->colidx[k] = nb[l] * d + c;
+              sp->val[k] = (l == 0) ? ((r == c) ? 4.0 + d : 0.5) : -1.0 / (1.0 + r + c);
+            }
+    }
+  sp->nnz = k;
+  return sp;
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_bsr [g [nrhs]]: CSR versus BSR SpMV/SpMM for d = 1..6 degrees of freedom per grid node
+  size_t g = (argc > 1) ? strtoul(argv[1], NULL, 10) : 300;
+  size_t nrhs = (argc > 2) ? strtoul(argv[2], NULL, 10) : 8;
+  printf("grid %zu x %zu, SpMM with %zu right-hand sides (time per right-hand side)\n", g, g, nrhs);
+  printf("%3s %3s %10s %10s %10s %10s %10s %12s %12s %8s\n", "d", "bs", "rows", "nnz", "csr [MB]", "bsr [MB]",
+         "csr [us]", "bsr spmv", "bsr spmm", "speedup");
+  for (size_t d = 1; d <= 6; d++)
+  {
+    coo_t *sp = multi_dof(g, d);
+    csp_t *csr = sp ? csp_from_coo(sp, CSR) : NULL;
+    size_t bs = sp ? bsr_block_size(sp) : 0;
+    bsr_t *bsr = sp ? bsr_from_coo(sp, bs) : NULL;
+    size_t n = g * g * d;
+    array_t *x = array_zeros(n), *y = array_zeros(n), *yref = array_zeros(n);
+    array2d_t *X = array2d_alloc((size_t[]){n, nrhs}, RowMajor), *Y = array2d_alloc((size_t[]){n, nrhs}, RowMajor);
+    if (!csr || !bsr || !x || !y || !yref || !X || !Y)
+    {
+      fprintf(stderr, "Error: failed to allocate the problem with d = %zu\n", d);
+      return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < n; i++)
+      x->val[i] = 1.0 / (1.0 + i % 13);
+    for (size_t k = 0; k < n * nrhs; k++)
+      X->val[k] = 1.0 / (1.0 + k % 11);
+
+    size_t reps = 0;
+    double t_csr = wtime(), t_bsr, t_spmm, elapsed;
+    do
+    {
+      csp_spmv(1.0, csr, x, 0.0, yref);
+      reps++;
+    } while ((elapsed = wtime() - t_csr) < 0.2);
+    t_csr = elapsed / reps;
+    reps = 0;
+    t_bsr = wtime();
+    do
+    {
+      bsr_spmv(1.0, bsr, x, 0.0, y);
+      reps++;
+    } while ((elapsed = wtime() - t_bsr) < 0.2);
+    t_bsr = elapsed / reps;
+    reps = 0;
+    t_spmm = wtime();
+    do
+    {
+      bsr_spmm(1.0, bsr, X, 0.0, Y);
+      reps++;
+    } while ((elapsed = wtime() - t_spmm) < 0.2);
+    t_spmm = elapsed / reps / nrhs;
+
+    double dy = 0.0;
+    for (size_t i = 0; i < n; i++)
+      dy = fmax(dy, fabs(y->val[i] - yref->val[i]));
+    if (dy > 1e-10)
+      fprintf(stderr, "Error: BSR and CSR differ by %.3e\n", dy);
+    size_t nnz = csr->ptr[n];
+    double mb_csr = (nnz * (sizeof(double) + sizeof(size_t)) + (n + 1) * sizeof(size_t)) / 1e6;
+    double mb_bsr = (bsr->nblocks * (bs * bs * sizeof(double) + sizeof(size_t)) + (n / bs + 1) * sizeof(size_t)) / 1e6;
+    printf("%3zu %3zu %10zu %10zu %10.1f %10.1f %10.1f %12.1f %12.1f %8.2f\n", d, bs, n, nnz, mb_csr, mb_bsr,
+           1e6 * t_csr, 1e6 * t_bsr, 1e6 * t_spmm, t_csr / t_bsr);
+
+    coo_dealloc(sp);
+    csp_dealloc(csr);
+    bsr_dealloc(bsr);
+    array_dealloc(x);
+    array_dealloc(y);
+    array_dealloc(yref);
+    array2d_dealloc(X);
+    array2d_dealloc(Y);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "msptools.h"
+#include "call_dgesv.h"
+#include "lapack.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Previous RowMajor path of call_dgesv: copy A, scatter it back transposed and
+// call DGESV. The copy lives on the heap here, since the original stack VLA
+// overflows long before n = 8000. Returns the time spent on the transpose.
+static double legacy_dgesv(array2d_t *A, array_t *b, lapack_int *info)
+{
+  lapack_int m = (lapack_int)A->shape[0], n = (lapack_int)A->shape[1];
+  lapack_int nrhs = 1, ldb = m, lda = m;
+  size_t nm = (size_t)n * m;
+  lapack_int *ipiv = malloc(n * sizeof(*ipiv));
+  double *xrow = malloc(nm * sizeof(*xrow));
+  if (ipiv == NULL || xrow == NULL)
+  {
+    free(ipiv);
+    free(xrow);
+    *info = -12;
+    return 0.0;
+  }
+  double t = wtime();
+  for (size_t i = 0; i < nm; i++)
+  {
+    xrow[i] = A->val[i];
+  }
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      A->val[k++] = xrow[i + n * j];
+    }
+  }
+  t = wtime() - t;
+  dgesv_(&m, &nrhs, A->val, &lda, ipiv, b->val, &ldb, info);
+  free(xrow);
+  free(ipiv);
+  return t;
+}
+
+// Fills a RowMajor matrix with random, diagonally dominant entries
+static void random_system(array2d_t *A, array_t *b)
+{
+  size_t n = A->shape[0];
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      A->val[i * n + j] = (double)rand() / RAND_MAX - 0.5;
+    }
+    A->val[i * n + i] += n;
+    b->val[i] = (double)rand() / RAND_MAX;
+  }
+  b->len = n;
+}
+
+int main(int argc, char *argv[])
+{
+  // Problem sizes can be given on the command line: bench_dgesv [nmin [nmax]]
+  size_t nmin = (argc > 1) ? strtoul(argv[1], NULL, 10) : 500;
+  size_t nmax = (argc > 2) ? strtoul(argv[2], NULL, 10) : 8000;
+
+  printf("%8s %12s %12s %12s %10s\n", "n", "legacy [s]", "transp [s]", "rowmajor [s]", "speedup");
+  for (size_t n = nmin; n <= nmax; n *= 2)
+  {
+    array2d_t *A = array2d_alloc((size_t[]){n, n}, RowMajor);
+    array2d_t *A0 = array2d_alloc((size_t[]){n, n}, RowMajor);
+    array_t *b = array_alloc(n);
+    array_t *b0 = array_alloc(n);
+    if (!A || !A0 || !b || !b0)
+    {
+      fprintf(stderr, "Error: failed to allocate problem of size %zu\n", n);
+      return EXIT_FAILURE;
+    }
+    srand(0);
+    random_system(A0, b0);
+
+    lapack_int info;
+    memcpy(A->val, A0->val, n * n * sizeof(double));
+    memcpy(b->val, b0->val, n * sizeof(double));
+    b->len = n;
+    double t_legacy = wtime();
+    double t_transp = legacy_dgesv(A, b, &info);
+    t_legacy = wtime() - t_legacy;
+    if (info != 0)
+    {
+      fprintf(stderr, "Error: legacy path returned info = %ld\n", (long)info);
+    }
+
+    memcpy(A->val, A0->val, n * n * sizeof(double));
+    memcpy(b->val, b0->val, n * sizeof(double));
+    double t_rowmajor = wtime();
+    info = call_dgesv(A, b);
+    t_rowmajor = wtime() - t_rowmajor;
+    if (info != 0)
+    {
+      fprintf(stderr, "Error: call_dgesv returned info = %ld\n", (long)info);
+    }
+
+    printf("%8zu %12.4f %12.4f %12.4f %10.2f\n", n, t_legacy, t_transp, t_rowmajor, t_legacy / t_rowmajor);
+    fflush(stdout);
+
+    array2d_dealloc(A);
+    array2d_dealloc(A0);
+    array_dealloc(b);
+    array_dealloc(b0);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "lapack.h"
+#include "native_lu.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_lu [nmin [nmax]]: native_dgetrf versus LAPACK's DGETRF
+  size_t nmin = (argc > 1) ? strtoul(argv[1], NULL, 10) : 250;
+  size_t nmax = (argc > 2) ? strtoul(argv[2], NULL, 10) : 4000;
+
+  printf("%8s %12s %12s %12s %12s %8s %12s\n", "n", "lapack [s]", "GFLOP/s", "native [s]", "GFLOP/s", "ratio", "max |dx|");
+  for (size_t n = nmin; n <= nmax; n *= 2)
+  {
+    double *A0 = malloc(n * n * sizeof(double));
+    double *A = malloc(n * n * sizeof(double));
+    double *x1 = malloc(n * sizeof(double));
+    double *x2 = malloc(n * sizeof(double));
+    lapack_int *ipiv = malloc(n * sizeof(*ipiv));
+    int *ipiv_native = malloc(n * sizeof(*ipiv_native));
+    if (!A0 || !A || !x1 || !x2 || !ipiv || !ipiv_native)
+    {
+      fprintf(stderr, "Error: failed to allocate problem of size %zu\n", n);
+      return EXIT_FAILURE;
+    }
+    srand(0);
+    for (size_t k = 0; k < n * n; k++)
+      A0[k] = (double)rand() / RAND_MAX - 0.5;
+    lapack_int in = (lapack_int)n, nrhs = 1, info;
+    char trans = 'N';
+    double flops = 2.0 / 3.0 * n * n * n;
+
+    memcpy(A, A0, n * n * sizeof(double));
+    for (size_t k = 0; k < n; k++)
+      x1[k] = 1.0;
+    double t_lapack = wtime();
+    dgetrf_(&in, &in, A, &in, ipiv, &info);
+    t_lapack = wtime() - t_lapack;
+    dgetrs_(&trans, &in, &nrhs, A, &in, ipiv, x1, &in, &info);
+
+    memcpy(A, A0, n * n * sizeof(double));
+    for (size_t k = 0; k < n; k++)
+      x2[k] = 1.0;
+    double t_native = wtime();
+    info = native_dgetrf((int)n, (int)n, A, (int)n, ipiv_native);
+    t_native = wtime() - t_native;
+    native_dgetrs('N', (int)n, 1, A, (int)n, ipiv_native, x2, (int)n);
+    if (info != 0)
+      fprintf(stderr, "Error: native_dgetrf returned info = %ld\n", (long)info);
+
+    double err = 0.0;
+    for (size_t k = 0; k < n; k++)
+      err = fmax(err, fabs(x1[k] - x2[k]));
+    printf("%8zu %12.4f %12.2f %12.4f %12.2f %8.2f %12.3e\n", n, t_lapack, 1e-9 * flops / t_lapack,
+           t_native, 1e-9 * flops / t_native, t_native / t_lapack, err);
+    fflush(stdout);
+
+    free(A0);
+    free(A);
+    free(x1);
+    free(x2);
+    free(ipiv);
+    free(ipiv_native);
+  }
+  return EXIT_SUCCESS;
+}
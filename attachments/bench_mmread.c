@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "msptools.h"
+#include "mm_read.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// The previous reader: one fscanf call per entry
+static coo_t *fscanf_from_file(const char *filename)
+{
+  char buf[MM_MAX_LINE_LENGTH], *line;
+  size_t m, n, nnz;
+  FILE *fp = fopen(filename, "r");
+  if (fp == NULL)
+    return NULL;
+  while ((line = fgets(buf, sizeof(buf), fp)) && line[0] == '%')
+    continue;
+  coo_t *sp = (line && sscanf(line, "%zu %zu %zu", &m, &n, &nnz) == 3) ? coo_alloc((size_t[]){m, n}, nnz) : NULL;
+  for (size_t k = 0; sp && k < nnz; k++)
+  {
+    if (fscanf(fp, "%zu %zu %lf", sp->rowidx + k, sp->colidx + k, sp->val + k) != 3)
+    {
+      coo_dealloc(sp);
+      sp = NULL;
+      break;
+    }
+    sp->rowidx[k]--;
+    sp->colidx[k]--;
+  }
+  if (sp)
+    sp->nnz = nnz;
+  fclose(fp);
+  return sp;
+}
+
+// Returns 1 if two CSR matrices have the same arrays
+static int same_csr(const csp_t *a, const csp_t *b)
+{
+  size_t m = a->shape[0];
+  return b != NULL && b->shape[0] == m && memcmp(a->ptr, b->ptr, (m + 1) * sizeof(size_t)) == 0 &&
+         memcmp(a->idx, b->idx, a->ptr[m] * sizeof(size_t)) == 0 &&
+         memcmp(a->val, b->val, a->ptr[m] * sizeof(double)) == 0;
+}
+
+// Writes a random n-by-n matrix with nnz entries (15 significant digits, as written by most tools)
+static int write_random(const char *filename, size_t n, size_t nnz)
+{
+  FILE *fp = fopen(filename, "w");
+  if (fp == NULL)
+    return -1;
+  fprintf(fp, "%%%%MatrixMarket matrix coordinate real general\n%% random test matrix\n");
+  fprintf(fp, "%zu %zu %zu\n", n, n, nnz);
+  srand(0);
+  for (size_t k = 0; k < nnz; k++)
+    fprintf(fp, "%zu %zu %.15g\n", (size_t)rand() % n + 1, (size_t)rand() % n + 1,
+            ((double)rand() / RAND_MAX - 0.5) * 1e3);
+  return fclose(fp);
+}
+
+static int same(const coo_t *a, const coo_t *b)
+{
+  if (a == NULL || b == NULL || a->nnz != b->nnz)
+    return 0;
+  for (size_t k = 0; k < a->nnz; k++)
+    if (a->rowidx[k] != b->rowidx[k] || a->colidx[k] != b->colidx[k] || a->val[k] != b->val[k])
+      return 0;
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_mmread [file.mtx|nnz [maxthreads]]: fscanf versus buffered and parallel parsing, and
+  // loading the CSR matrix from a csp_to_binary file (MB/s of the binary file)
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t maxthreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : (ncpu > 0 ? (size_t)ncpu : 1);
+  char tmp[64] = "", bin[64];
+  const char *filename = (argc > 1) ? argv[1] : NULL;
+  if (filename == NULL || strtoul(filename, NULL, 10) > 0)
+  {
+    size_t nnz = filename ? strtoul(filename, NULL, 10) : 5000000;
+    snprintf(tmp, sizeof(tmp), "/tmp/bench_mmread.%ld.mtx", (long)getpid());
+    if (write_random(tmp, nnz / 10 + 1, nnz) != 0)
+    {
+      fprintf(stderr, "Error: could not write %s\n", tmp);
+      return EXIT_FAILURE;
+    }
+    filename = tmp;
+  }
+  struct stat st;
+  if (stat(filename, &st) != 0)
+  {
+    fprintf(stderr, "Error: could not open %s\n", filename);
+    return EXIT_FAILURE;
+  }
+  double mb = st.st_size / 1e6;
+
+  double t = wtime();
+  coo_t *ref = fscanf_from_file(filename);
+  double t_ref = wtime() - t;
+  if (ref == NULL)
+  {
+    fprintf(stderr, "Error: could not read %s\n", filename);
+    return EXIT_FAILURE;
+  }
+  printf("%s: %.1f MB, nnz = %zu\n", filename, mb, ref->nnz);
+  printf("%-20s %10s %10s %10s %8s\n", "reader", "time [s]", "MB/s", "speedup", "equal");
+  printf("%-20s %10.3f %10.1f %10.2f %8s\n", "fscanf", t_ref, mb / t_ref, 1.0, "-");
+
+  t = wtime();
+  coo_t *sp = coo_from_file(filename);
+  t = wtime() - t;
+  printf("%-20s %10.3f %10.1f %10.2f %8s\n", "coo_from_file", t, mb / t, t_ref / t, same(ref, sp) ? "yes" : "NO");
+  coo_dealloc(sp);
+
+  for (size_t p = 1; p <= maxthreads; p *= 2)
+  {
+    char label[32];
+    snprintf(label, sizeof(label), "parallel (%zu)", p);
+    t = wtime();
+    sp = coo_from_file_parallel(filename, p);
+    t = wtime() - t;
+    printf("%-20s %10.3f %10.1f %10.2f %8s\n", label, t, mb / t, t_ref / t, same(ref, sp) ? "yes" : "NO");
+    coo_dealloc(sp);
+  }
+
+  snprintf(bin, sizeof(bin), "/tmp/bench_mmread.%ld.csp", (long)getpid());
+  csp_t *csr = csp_from_coo(ref, CSR);
+  if (csr == NULL || csp_to_binary(bin, csr) != MSP_SUCCESS || stat(bin, &st) != 0)
+  {
+    fprintf(stderr, "Error: could not write %s\n", bin);
+    return EXIT_FAILURE;
+  }
+  for (int verify = 0; verify <= 1; verify++)
+  {
+    t = wtime();
+    csp_t *A = csp_from_binary(bin, verify);
+    t = wtime() - t;
+    printf("%-20s %10.3f %10.1f %10.2f %8s\n", verify ? "binary (verify)" : "binary (mmap)", t, st.st_size / 1e6 / t,
+           t_ref / t, same_csr(csr, A) ? "yes" : "NO");
+    csp_dealloc(A);
+  }
+  remove(bin);
+  csp_dealloc(csr);
+
+  coo_dealloc(ref);
+  if (tmp[0])
+    remove(tmp);
+  return EXIT_SUCCESS;
+}
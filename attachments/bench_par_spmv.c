@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "msptools.h"
+#include "par_spmv.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Random n-by-n matrix with power-law row lengths (about avg nonzeros per row, rows in random order)
+static coo_t *power_law(size_t n, size_t avg)
+{
+  double h = 0.0;
+  for (size_t i = 0; i < n; i++)
+    h += 1.0 / (i + 1);
+  double c = (double)avg * n / h;
+  size_t nnz = 0;
+  for (size_t i = 0; i < n; i++)
+    nnz += (size_t)ceil(c / (i + 1)) < n ? (size_t)ceil(c / (i + 1)) : n;
+  size_t *perm = malloc(n * sizeof(*perm));
+  coo_t *sp = coo_alloc((size_t[]){n, n}, nnz);
+  if (sp == NULL || perm == NULL)
+  {
+    free(perm);
+    coo_dealloc(sp);
+    return NULL;
+  }
+  srand(0);
+  for (size_t i = 0; i < n; i++)
+    perm[i] = i;
+  for (size_t i = n - 1; i > 0; i--)
+  {
+    size_t j = (size_t)rand() % (i + 1), t = perm[i];
+    perm[i] = perm[j];
+    perm[j] = t;
+  }
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t len = (size_t)ceil(c / (i + 1)) < n ? (size_t)ceil(c / (i + 1)) : n;
+    for (size_t l = 0; l < len; l++, k++)
+    {
+      sp->rowidx[k] = perm[i];
+      sp->colidx[k] = ((size_t)rand() * RAND_MAX + rand()) % n;
+      sp->val[k] = (double)rand() / RAND_MAX - 0.5;
+    }
+  }
+  sp->nnz = k;
+  free(perm);
+  return sp;
+}
+
+// Seconds per product, repeated for at least 0.2 s
+static double time_exec(spmv_plan_t *plan, const array_t *x, array_t *y)
+{
+  size_t reps = 0;
+  double t = wtime(), elapsed;
+  do
+  {
+    spmv_plan_exec(plan, 1.0, x, 0.0, y);
+    reps++;
+  } while ((elapsed = wtime() - t) < 0.2);
+  return elapsed / reps;
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_par_spmv [n|file.mtx [maxthreads]]: merge-path versus static row split
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t maxthreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : (ncpu > 0 ? (size_t)ncpu : 1);
+  coo_t *sp;
+  if (argc > 1 && strtoul(argv[1], NULL, 10) == 0)
+    sp = coo_from_file(argv[1]);
+  else
+    sp = power_law((argc > 1) ? strtoul(argv[1], NULL, 10) : 500000, 10);
+  csp_t *A = sp ? csp_from_coo(sp, CSR) : NULL;
+  coo_dealloc(sp);
+  if (A == NULL)
+  {
+    fprintf(stderr, "Error: failed to create the matrix\n");
+    return EXIT_FAILURE;
+  }
+  size_t m = A->shape[0], n = A->shape[1], nnz = A->ptr[m], maxrow = 0;
+  for (size_t i = 0; i < m; i++)
+    maxrow = (A->ptr[i + 1] - A->ptr[i] > maxrow) ? A->ptr[i + 1] - A->ptr[i] : maxrow;
+  array_t *x = array_zeros(n), *y = array_zeros(m), *yref = array_zeros(m);
+  if (!x || !y || !yref)
+    return EXIT_FAILURE;
+  for (size_t j = 0; j < n; j++)
+    x->val[j] = 1.0 / (1.0 + j % 13);
+  csp_spmv(1.0, A, x, 0.0, yref);
+
+  printf("rows = %zu, nnz = %zu, longest row = %zu\n", m, nnz, maxrow);
+  printf("%8s %-10s %12s %10s %10s %10s %12s\n", "threads", "split", "time [us]", "GFLOP/s", "speedup",
+         "imbalance", "max |dy|");
+  double t1[2] = {0.0, 0.0};
+  for (size_t p = 1; p <= maxthreads; p *= 2)
+  {
+    for (int s = 0; s < 2; s++)
+    {
+      enum spmv_split split = s ? SpmvMergePath : SpmvRowSplit;
+      spmv_plan_t *plan = spmv_plan_alloc(A, p, split);
+      if (plan == NULL)
+        return EXIT_FAILURE;
+      double t = time_exec(plan, x, y), dy = 0.0;
+      for (size_t i = 0; i < m; i++)
+        dy = fmax(dy, fabs(y->val[i] - yref->val[i]));
+      if (p == 1)
+        t1[s] = t;
+      printf("%8zu %-10s %12.1f %10.3f %10.2f %10.2f %12.3e\n", p, s ? "merge-path" : "rows", 1e6 * t,
+             2.0 * nnz / t * 1e-9, t1[s] / t, spmv_plan_imbalance(plan), dy);
+      spmv_plan_dealloc(plan);
+    }
+  }
+
+  csp_dealloc(A);
+  array_dealloc(x);
+  array_dealloc(y);
+  array_dealloc(yref);
+  return EXIT_SUCCESS;
+}
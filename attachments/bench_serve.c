@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "msptools.h"
+#include "call_dgesv.h"
+#include "solve_server.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+typedef struct client_arg
+{
+  const char *path;
+  size_t n, nrequests;
+  double *lat; // latency of each request
+  int err;
+} client_arg_t;
+
+static void *run_server(void *arg)
+{
+  solve_server_run(arg);
+  return NULL;
+}
+
+// Sends nrequests solves with random right-hand sides over one connection
+static void *run_client(void *arg)
+{
+  client_arg_t *c = arg;
+  int fd = solve_client_connect(c->path);
+  array2d_t *B = array2d_alloc((size_t[]){c->n, 1}, ColMajor);
+  if (fd < 0 || B == NULL)
+  {
+    c->err = 1;
+    array2d_dealloc(B);
+    solve_client_close(fd);
+    return NULL;
+  }
+  for (size_t r = 0; r < c->nrequests; r++)
+  {
+    for (size_t i = 0; i < c->n; i++)
+      B->val[i] = 1.0 + (double)(i % 7);
+    double t = wtime();
+    c->err |= solve_client_solve(fd, "A", B) != 0;
+    c->lat[r] = wtime() - t;
+  }
+  array2d_dealloc(B);
+  solve_client_close(fd);
+  return NULL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// q-quantile of the sorted array v
+static double quantile(const double *v, size_t len, double q)
+{
+  size_t k = (size_t)(q * (len - 1) + 0.5);
+  return v[k < len ? k : len - 1];
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_serve [n [nclients [nrequests]]]: request latency of the daemon versus call_dgesv
+  size_t nsizes = (argc > 1) ? 1 : 3, sizes[3] = {64, 256, 1024};
+  if (argc > 1)
+    sizes[0] = strtoul(argv[1], NULL, 10);
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t nclients = (argc > 2) ? strtoul(argv[2], NULL, 10) : (ncpu > 0 ? (size_t)ncpu : 1);
+  size_t nrequests = (argc > 3) ? strtoul(argv[3], NULL, 10) : 1000;
+  if (nclients == 0 || nrequests == 0)
+  {
+    fprintf(stderr, "Usage: %s [n [nclients [nrequests]]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/bench_serve.%ld.sock", (long)getpid());
+
+  printf("clients = %zu, requests per client = %zu (latency in us)\n", nclients, nrequests);
+  printf("%6s %10s %10s %10s %12s %12s %12s\n", "n", "load", "p50", "p99", "req/s", "dgesv p50",
+         "dgesv p99");
+  for (size_t s = 0; s < nsizes; s++)
+  {
+    size_t n = sizes[s], nref = (nrequests < 100) ? nrequests : 100;
+    array2d_t *A0 = array2d_alloc((size_t[]){n, n}, RowMajor);
+    array2d_t *A = array2d_alloc((size_t[]){n, n}, RowMajor);
+    array_t *b = array_alloc(n);
+    double *lat = malloc(nclients * nrequests * sizeof(double));
+    client_arg_t *args = malloc(nclients * sizeof(*args));
+    pthread_t *threads = malloc(nclients * sizeof(*threads));
+    if (!A0 || !A || !b || !lat || !args || !threads)
+    {
+      fprintf(stderr, "Error: failed to allocate problem of size %zu\n", n);
+      return EXIT_FAILURE;
+    }
+    srand(0);
+    for (size_t k = 0; k < n * n; k++)
+      A0->val[k] = (double)rand() / RAND_MAX - 0.5;
+
+    // Reference: factor and solve in the calling process for every request
+    for (size_t r = 0; r < nref; r++)
+    {
+      memcpy(A->val, A0->val, n * n * sizeof(double));
+      for (size_t i = 0; i < n; i++)
+        b->val[i] = 1.0 + (double)(i % 7);
+      b->len = n;
+      double t = wtime();
+      call_dgesv(A, b);
+      lat[r] = wtime() - t;
+    }
+    qsort(lat, nref, sizeof(double), cmp_double);
+    double ref50 = quantile(lat, nref, 0.5), ref99 = quantile(lat, nref, 0.99);
+
+    solve_server_t *srv = solve_server_alloc(path, nclients + 1); // + the connection that loads A
+    pthread_t server;
+    if (srv == NULL || pthread_create(&server, NULL, run_server, srv) != 0)
+    {
+      fprintf(stderr, "Error: failed to start the server\n");
+      return EXIT_FAILURE;
+    }
+    int fd = solve_client_connect(path);
+    double t_load = wtime();
+    int info = solve_client_load(fd, "A", A0);
+    t_load = wtime() - t_load;
+    if (info != 0)
+      fprintf(stderr, "Error: solve_client_load returned %d\n", info);
+
+    double t = wtime();
+    for (size_t c = 0; c < nclients; c++)
+    {
+      args[c] = (client_arg_t){path, n, nrequests, lat + c * nrequests, 0};
+      pthread_create(threads + c, NULL, run_client, args + c);
+    }
+    int err = 0;
+    for (size_t c = 0; c < nclients; c++)
+    {
+      pthread_join(threads[c], NULL);
+      err |= args[c].err;
+    }
+    t = wtime() - t;
+    if (err)
+      fprintf(stderr, "Error: a request failed\n");
+
+    solve_client_stop(fd);
+    solve_client_close(fd);
+    pthread_join(server, NULL);
+    solve_server_dealloc(srv);
+
+    size_t total = nclients * nrequests;
+    qsort(lat, total, sizeof(double), cmp_double);
+    printf("%6zu %10.0f %10.1f %10.1f %12.0f %12.1f %12.1f\n", n, 1e6 * t_load,
+           1e6 * quantile(lat, total, 0.5), 1e6 * quantile(lat, total, 0.99), total / t, 1e6 * ref50,
+           1e6 * ref99);
+    fflush(stdout);
+
+    array2d_dealloc(A0);
+    array2d_dealloc(A);
+    array_dealloc(b);
+    free(lat);
+    free(args);
+    free(threads);
+  }
+  return EXIT_SUCCESS;
+}
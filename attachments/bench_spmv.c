@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include "msptools.h"
+
+#define DATA_DIR "msptools/data"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Reference: y = A*x with a plain row loop (CSR)
+static void naive_spmv(const csp_t *A, const double *x, double *y)
+{
+  for (size_t i = 0; i < A->shape[0]; i++)
+  {
+    double s = 0.0;
+    for (size_t k = A->ptr[i]; k < A->ptr[i + 1]; k++)
+      s += A->val[k] * x[A->idx[k]];
+    y[i] = s;
+  }
+}
+
+// 5-point Laplacian on a g-by-g grid (lower triangle, symmetric)
+static coo_t *laplacian(size_t g)
+{
+  size_t n = g * g;
+  coo_t *sp = coo_alloc((size_t[]){n, n}, 5 * n);
+  if (sp == NULL)
+    return NULL;
+  size_t k = 0;
+  for (size_t i = 0; i < g; i++)
+    for (size_t j = 0; j < g; j++)
+    {
+      size_t r = i * g + j;
+      size_t nb[5] = {r, r - g, r + g, r - 1, r + 1};
+      int ok[5] = {1, i > 0, i + 1 < g, j > 0, j + 1 < g};
+      for (int l = 0; l < 5; l++)
+        if (ok[l] && nb[l] <= r)
+        {
+          sp->rowidx[k] = r;
+          sp->colidx[k] = nb[l];
+          sp->val[k++] = (l == 0) ? 4.0 : -1.0;
+        }
+    }
+  sp->nnz = k;
+  sp->sym = Symmetric;
+  return sp;
+}
+
+// Returns 1 if the file starts with a Matrix Market banner
+static int is_matrix_market(const char *filename)
+{
+  char buf[16] = {0};
+  FILE *fp = fopen(filename, "r");
+  if (fp == NULL)
+    return 0;
+  size_t len = fread(buf, 1, 14, fp);
+  fclose(fp);
+  return len == 14 && strncmp(buf, "%%MatrixMarket", 14) == 0;
+}
+
+// Times one kernel (k = 0: naive, 1: csp_spmv, 2: csp_spmv_t), prints a result line and returns the time
+static double run(const char *name, const char *label, const csp_t *A, array_t *x, array_t *y, int k, double t_csr)
+{
+  size_t m = A->shape[0], n = A->shape[1];
+  size_t nptr = (A->csx == CSC) ? n : (A->csx == CSR) ? m : (m + A->chunk - 1) / A->chunk;
+  size_t nnz = (A->csx == SELL) ? A->nnz : A->ptr[nptr], stored = A->ptr[nptr];
+  if (A->sym != General)
+  {
+    // half storage: every off-diagonal entry is used twice
+    nnz = 2 * stored;
+    for (size_t o = 0; o < nptr; o++)
+      for (size_t k = A->ptr[o]; k < A->ptr[o + 1]; k++)
+        nnz -= (A->idx[k] == o);
+  }
+  x->len = (k == 2) ? m : n;
+  y->len = (k == 2) ? n : m;
+  for (size_t i = 0; i < x->len; i++)
+    x->val[i] = 1.0 / (1.0 + i % 13);
+  size_t reps = 0;
+  double t = wtime(), elapsed;
+  do
+  {
+    if (k == 0)
+      naive_spmv(A, x->val, y->val);
+    else if (k == 1)
+      csp_spmv(1.0, A, x, 1.0, y);
+    else
+      csp_spmv_t(1.0, A, x, 1.0, y);
+    reps++;
+  } while ((elapsed = wtime() - t) < 0.2);
+  t = elapsed / reps;
+  // compulsory traffic: val and idx (with padding), ptr (and perm), x once, and y read and written
+  double bytes = stored * (sizeof(double) + sizeof(size_t)) + (nptr + 1) * sizeof(size_t) +
+                 (A->csx == SELL ? m * sizeof(size_t) : 0) + x->len * sizeof(double) + 2 * y->len * sizeof(double);
+  printf("%-16s %-10s %10zu %10zu %12.2f %10.3f %10.3f %9.1f%% %8.2f\n", name, label, m, nnz, 1e6 * t,
+         2.0 * nnz / t * 1e-9, bytes / t * 1e-9, stored > nnz ? 100.0 * (stored - nnz) / nnz : 0.0, t_csr > 0 ? t_csr / t : 1.0);
+  return t;
+}
+
+static void bench(const char *name, const coo_t *sp)
+{
+  // the general kernels use both triangles of a symmetric matrix
+  coo_t *full = coo_expand(sp);
+  csp_t *csr = full ? csp_from_coo(full, CSR) : NULL, *csc = full ? csp_from_coo(full, CSC) : NULL;
+  csp_t *canon = full ? csp_canonical_from_coo(full, CSR) : NULL;
+  size_t len = sp->shape[0] > sp->shape[1] ? sp->shape[0] : sp->shape[1];
+  array_t *x = array_zeros(len), *y = array_zeros(len);
+  coo_dealloc(full);
+  if (!csr || !csc || !canon || !x || !y)
+  {
+    fprintf(stderr, "Error: failed to allocate %s\n", name);
+    exit(EXIT_FAILURE);
+  }
+  run(name, "naive", csr, x, y, 0, 0.0);
+  double t_csr = run(name, "csr", csr, x, y, 1, 0.0);
+  run(name, "csr^T", csr, x, y, 2, 0.0);
+  run(name, "csc", csc, x, y, 1, t_csr);
+  run(name, "csc^T", csc, x, y, 2, 0.0);
+  // sorted indices without duplicates
+  run(name, "csr-canon", canon, x, y, 1, t_csr);
+  // half storage of a symmetric matrix (one pass over the lower triangle), also canonical
+  for (int k = 0; sp->sym != General && k < 4; k++)
+  {
+    const char *labels[4] = {"csc-half", "csr-half", "csc-half-c", "csr-half-c"};
+    csp_t *half = csp_half_from_coo(sp, (k % 2) ? CSR : CSC, k >= 2);
+    if (half == NULL)
+      continue;
+    run(name, labels[k], half, x, y, 1, t_csr);
+    csp_dealloc(half);
+  }
+  // SELL-C-sigma for C = 4, 8, 16 and sigma = 1 (no sorting), 32, 1024
+  size_t chunks[] = {4, 8, 16}, sigmas[] = {1, 32, 1024};
+  for (size_t c = 0; c < 3; c++)
+    for (size_t s = 0; s < 3; s++)
+    {
+      char label[32];
+      csp_t *sell = csp_sell_from_csp(csr, chunks[c], sigmas[s]);
+      if (sell == NULL)
+        continue;
+      snprintf(label, sizeof(label), "sell-%zu-%zu", chunks[c], sigmas[s]);
+      run(name, label, sell, x, y, 1, t_csr);
+      csp_dealloc(sell);
+    }
+  csp_dealloc(csr);
+  csp_dealloc(csc);
+  csp_dealloc(canon);
+  array_dealloc(x);
+  array_dealloc(y);
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_spmv [file.mtx ...]: without arguments, the Matrix Market files in msptools/data and a 2D Laplacian
+  printf("%-16s %-10s %10s %10s %12s %10s %10s %10s %8s\n", "matrix", "kernel", "rows", "nnz", "time [us]",
+         "GFLOP/s", "GB/s", "padding", "vs csr");
+  if (argc > 1)
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      coo_t *sp = coo_from_file(argv[i]);
+      if (sp == NULL)
+      {
+        fprintf(stderr, "Error: could not read %s\n", argv[i]);
+        continue;
+      }
+      const char *name = strrchr(argv[i], '/');
+      bench(name ? name + 1 : argv[i], sp);
+      coo_dealloc(sp);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  DIR *dir = opendir(DATA_DIR);
+  struct dirent *e;
+  while (dir && (e = readdir(dir)) != NULL)
+  {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", DATA_DIR, e->d_name);
+    if (e->d_name[0] == '.' || !is_matrix_market(path))
+      continue;
+    coo_t *sp = coo_from_file(path);
+    if (sp != NULL)
+      bench(e->d_name, sp);
+    coo_dealloc(sp);
+  }
+  if (dir)
+    closedir(dir);
+
+  // a Laplacian that fits in cache (where SpMV is not bound by memory bandwidth) and one that does not
+  size_t grids[] = {100, 1000};
+  for (size_t g = 0; g < 2; g++)
+  {
+    char name[32];
+    coo_t *sp = laplacian(grids[g]);
+    if (sp == NULL)
+      return EXIT_FAILURE;
+    snprintf(name, sizeof(name), "laplace2d-%zu", grids[g]);
+    bench(name, sp);
+    coo_dealloc(sp);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "msptools.h"
+#include "lapack.h"
+#include "tiled.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Relative residual ||b - A*x||_inf / (||A||_inf*||x||_inf) for a ColMajor A
+static double rel_residual(const array2d_t *A, const double *b, const double *x)
+{
+  size_t n = A->shape[0];
+  double rmax = 0.0, anorm = 0.0, xnorm = 0.0;
+  for (size_t i = 0; i < n; i++)
+  {
+    double r = b[i], s = 0.0;
+    for (size_t j = 0; j < n; j++)
+    {
+      r -= A->val[i + j * n] * x[j];
+      s += fabs(A->val[i + j * n]);
+    }
+    rmax = fmax(rmax, fabs(r));
+    anorm = fmax(anorm, s);
+    xnorm = fmax(xnorm, fabs(x[i]));
+  }
+  return rmax / (anorm * xnorm);
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_tiled [n [nb [maxthreads]]]
+  size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 8000;
+  size_t nb = (argc > 2) ? strtoul(argv[2], NULL, 10) : 256;
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t maxthreads = (argc > 3) ? strtoul(argv[3], NULL, 10) : (ncpu > 0 ? (size_t)ncpu : 1);
+
+  // S is symmetric positive definite, G is a general matrix
+  array2d_t *S = array2d_alloc((size_t[]){n, n}, ColMajor);
+  array2d_t *G = array2d_alloc((size_t[]){n, n}, ColMajor);
+  array2d_t *F = array2d_alloc((size_t[]){n, n}, ColMajor);
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  lapack_int *ipiv = malloc(n * sizeof(*ipiv));
+  if (!S || !G || !F || !b || !x || !ipiv)
+  {
+    fprintf(stderr, "Error: failed to allocate problem of size %zu\n", n);
+    return EXIT_FAILURE;
+  }
+  srand(0);
+  for (size_t j = 0; j < n; j++)
+  {
+    for (size_t i = 0; i <= j; i++)
+      S->val[i + j * n] = S->val[j + i * n] = (double)rand() / RAND_MAX - 0.5;
+    S->val[j + j * n] += n;
+    b[j] = (double)rand() / RAND_MAX;
+  }
+  for (size_t k = 0; k < n * n; k++)
+    G->val[k] = (double)rand() / RAND_MAX - 0.5;
+
+  // Fork-join reference: one LAPACK call (threaded as the BLAS library is)
+  lapack_int in = (lapack_int)n, info, nrhs = 1;
+  char uplo = 'L', trans = 'N';
+  memcpy(F->val, S->val, n * n * sizeof(double));
+  double t_potrf = wtime();
+  dpotrf_(&uplo, &in, F->val, &in, &info);
+  t_potrf = wtime() - t_potrf;
+  memcpy(F->val, G->val, n * n * sizeof(double));
+  double t_getrf = wtime();
+  dgetrf_(&in, &in, F->val, &in, ipiv, &info);
+  t_getrf = wtime() - t_getrf;
+
+  double flops_chol = n * (double)n * n / 3.0, flops_lu = 2.0 * n * (double)n * n / 3.0;
+  printf("n = %zu, nb = %zu (run with OPENBLAS_NUM_THREADS=1 or equivalent)\n", n, nb);
+  printf("LAPACK dpotrf: %.3f s (%.2f GFLOP/s), dgetrf: %.3f s (%.2f GFLOP/s)\n", t_potrf,
+         1e-9 * flops_chol / t_potrf, t_getrf, 1e-9 * flops_lu / t_getrf);
+  printf("%8s %10s %9s %8s %10s %10s %9s %8s %10s\n", "threads", "chol [s]", "GFLOP/s", "eff",
+         "resid", "lu [s]", "GFLOP/s", "eff", "resid");
+
+  double t1_chol = 0.0, t1_lu = 0.0;
+  // 1, 2, 4, ... threads and finally maxthreads
+  for (size_t p = 1;; p = (2 * p < maxthreads) ? 2 * p : maxthreads)
+  {
+    // Cholesky (conversion to/from tile layout is not timed)
+    tiled_t *T = array2d_to_tiled(S, nb);
+    if (T == NULL)
+      return EXIT_FAILURE;
+    double t_chol = wtime();
+    info = tiled_dpotrf(T, p);
+    t_chol = wtime() - t_chol;
+    tiled_to_array2d(T, F);
+    tiled_dealloc(T);
+    memcpy(x, b, n * sizeof(double));
+    if (info == 0)
+      dpotrs_(&uplo, &in, &nrhs, F->val, &in, x, &in, &info);
+    double res_chol = (info == 0) ? rel_residual(S, b, x) : NAN;
+
+    // LU
+    T = array2d_to_tiled(G, nb);
+    if (T == NULL)
+      return EXIT_FAILURE;
+    double t_lu = wtime();
+    info = tiled_dgetrf(T, ipiv, p);
+    t_lu = wtime() - t_lu;
+    tiled_to_array2d(T, F);
+    tiled_dealloc(T);
+    memcpy(x, b, n * sizeof(double));
+    if (info == 0)
+      dgetrs_(&trans, &in, &nrhs, F->val, &in, ipiv, x, &in, &info);
+    double res_lu = (info == 0) ? rel_residual(G, b, x) : NAN;
+
+    if (p == 1)
+    {
+      t1_chol = t_chol;
+      t1_lu = t_lu;
+    }
+    printf("%8zu %10.3f %9.2f %8.2f %10.2e %10.3f %9.2f %8.2f %10.2e\n", p, t_chol,
+           1e-9 * flops_chol / t_chol, t1_chol / (p * t_chol), res_chol, t_lu,
+           1e-9 * flops_lu / t_lu, t1_lu / (p * t_lu), res_lu);
+    fflush(stdout);
+    if (p == maxthreads)
+      break;
+  }
+
+  array2d_dealloc(S);
+  array2d_dealloc(G);
+  array2d_dealloc(F);
+  free(b);
+  free(x);
+  free(ipiv);
+  return EXIT_SUCCESS;
+}
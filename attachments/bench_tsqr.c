@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "msptools.h"
+#include "call_dgels.h"
+#include "tsqr.h"
+
+// Wall clock time in seconds
+static double wtime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+  // bench_tsqr [m [n [maxthreads]]]
+  size_t m = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+  size_t n = (argc > 2) ? strtoul(argv[2], NULL, 10) : 20;
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t maxthreads = (argc > 3) ? strtoul(argv[3], NULL, 10) : (ncpu > 0 ? (size_t)ncpu : 1);
+
+  array2d_t *A0 = array2d_alloc((size_t[]){m, n}, RowMajor);
+  array2d_t *A = array2d_alloc((size_t[]){m, n}, RowMajor);
+  array_t *b0 = array_alloc(m);
+  array_t *b = array_alloc(m);
+  array_t *x = array_alloc(m);
+  if (!A0 || !A || !b0 || !b || !x)
+  {
+    fprintf(stderr, "Error: failed to allocate problem of size %zu x %zu\n", m, n);
+    return EXIT_FAILURE;
+  }
+  srand(0);
+  for (size_t k = 0; k < m * n; k++)
+    A0->val[k] = (double)rand() / RAND_MAX - 0.5;
+  for (size_t k = 0; k < m; k++)
+    b0->val[k] = (double)rand() / RAND_MAX;
+  b0->len = m;
+
+  // Reference solution with call_dgels
+  memcpy(A->val, A0->val, m * n * sizeof(double));
+  memcpy(x->val, b0->val, m * sizeof(double));
+  x->len = m;
+  double t_ref = wtime();
+  if (call_dgels(A, x) != 0)
+    return EXIT_FAILURE;
+  t_ref = wtime() - t_ref;
+
+  printf("m = %zu, n = %zu, call_dgels: %.4f s\n", m, n, t_ref);
+  printf("%8s %12s %10s %10s %12s\n", "threads", "tsqr [s]", "speedup", "vs dgels", "max |dx|");
+  double t1 = 0.0;
+  for (size_t p = 1; p <= maxthreads; p *= 2)
+  {
+    memcpy(A->val, A0->val, m * n * sizeof(double));
+    memcpy(b->val, b0->val, m * sizeof(double));
+    b->len = m;
+    double t = wtime();
+    int info = tsqr_dgels(A, b, p);
+    t = wtime() - t;
+    if (info != 0)
+    {
+      fprintf(stderr, "Error: tsqr_dgels returned info = %d\n", info);
+      return EXIT_FAILURE;
+    }
+    if (p == 1)
+      t1 = t;
+    double err = 0.0;
+    for (size_t k = 0; k < n; k++)
+      err = fmax(err, fabs(b->val[k] - x->val[k]));
+    printf("%8zu %12.4f %10.2f %10.2f %12.3e\n", p, t, t1 / t, t_ref / t, err);
+    if (p < maxthreads && 2 * p > maxthreads)
+      p = maxthreads / 2; // always include maxthreads
+  }
+
+  array2d_dealloc(A0);
+  array2d_dealloc(A);
+  array_dealloc(b0);
+  array_dealloc(b);
+  array_dealloc(x);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,31 @@
+#ifndef BSR_H
+#define BSR_H
+#include "misc.h"
+#include "array.h"
+#include "array2d.h"
+#include "sparse.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#define BSR_MAX_BLOCK 6 /* largest block size with specialized kernels (one per size in bsr.c) */
+
+typedef struct bsr /* block compressed sparse row format (BSR) */
+{
+    size_t shape[2]; // row and column dimensions (multiples of bs)
+    size_t bs;       // block size (bs-by-bs blocks)
+    size_t nblocks;  // number of stored blocks
+    size_t *ptr;     // start of each block row in idx (shape[0]/bs + 1)
+    size_t *idx;     // block column indices (sorted within each block row)
+    double *val;     // blocks in RowMajor order, bs*bs values per block
+} bsr_t;
+
+bsr_t *bsr_alloc(const size_t shape[2], size_t bs, size_t nblocks);
+void bsr_dealloc(bsr_t *sp);
+size_t bsr_block_size(const coo_t *sp);
+bsr_t *bsr_from_coo(const coo_t *sp, size_t bs);
+int bsr_spmv(double alpha, const bsr_t *A, const array_t *x, double beta, array_t *y);
+int bsr_spmm(double alpha, const bsr_t *A, const array2d_t *X, double beta, array2d_t *Y);
+void bsr_fprint(FILE *stream, const bsr_t *sp);
+void bsr_print(const bsr_t *sp);
+
+#endif
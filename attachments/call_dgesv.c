@@ -1,99 +1,661 @@
 #include "call_dgesv.h"
-#include "datatypes.h"
+#include "lapack.h"
+#include "lu.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
+#include <float.h>
 
-/* C prototype for LAPACK routine DGESV */
-void dgesv_(int *n,    /* columns/rows in A          */
-            int *nrhs, /* number of right-hand sides */
-            double *A,       /* array A                    */
-            int *lda,  /* leading dimension of A     */
-            int *ipiv,       /* pivoting array             */
-            double *B,       /* array B                    */
-            int *ldb,  /* leading dimension of B     */
-            int *info        /* status code                */
-);
-
-// function for solving the linear system
-int call_dgesv(array2d_t * A, array_t * b) {
-<<<<<<< HEAD
- 
-  // checks if both Matrix A and vector b, are not empty
-=======
-
->>>>>>> 1f75698a3d6955cde18b939167ca905246644155
-  if (A == NULL || b == NULL){
+/* call_dgesv : solves a square linear system
+
+Purpose:
+Solves the linear system A*x = b. Upon exit, b is overwritten by the solution
+x and A is overwritten by its LU factors.
+
+If A is stored in ColMajor order, LAPACK's DGESV is called directly. If A is
+stored in RowMajor order, the buffer A->val is the ColMajor representation of
+A^T, so A^T is factored in place with DGETRF and the system is solved with
+DGETRS using trans = 'T'. This avoids copying and transposing A. In that case
+A->val holds the LU factors of A^T on exit.
+
+Return value:
+The function returns the output `info` from LAPACK with the following
+exceptions: the return value is
+
+  -9 if the input A is NULL and/or the input b is NULL
+  -10 if A is not square
+  -11 if the dimensions of A and b are incompatible (or n does not fit in a
+      lapack_int, see lapack.h)
+  -12 in case of memory allocation errors.
+*/
+int call_dgesv(array2d_t *A, array_t *b)
+{
+
+  // Checks if both Matrix A and vector b are not empty
+  if (A == NULL || b == NULL)
+  {
     return -9;
   }
 
-<<<<<<< HEAD
-  // checks if the Matrix A is square
-  if (A->shape[0] != A->shape[1]){
+  // Checks if the Matrix A is square
+  if (A->shape[0] != A->shape[1])
+  {
     return -10;
   }
 
-  // Checks if vector b is of the dame dim af matrix A so the problem can be solved
-  if (A->shape[0] != b->len){
-   return -11;
+  // Checks if vector b is of the same dim as matrix A so the problem can be solved
+  // (and that n fits in a lapack_int)
+  if (A->shape[0] != b->len || !lapack_int_fits(A->shape[0]))
+  {
+    return -11;
   }
 
-  // Initializing 
-  int m = (int) A->shape[0], n = (int) A->shape[1]; 
-  int nrhs = 1, ldb=m, lda=m, info; 
-  int ipiv[n];
-    
+  // Initializing (ipiv lives on the heap so large systems do not overflow the stack)
+  lapack_int m = (lapack_int)A->shape[0], n = (lapack_int)A->shape[1];
+  lapack_int nrhs = 1, ldb = m, lda = m, info;
+  lapack_int *ipiv = malloc((n > 0 ? (size_t)n : 1) * sizeof(*ipiv));
+  if (ipiv == NULL)
+  {
+    return -12;
+  }
+
+  if (A->order == ColMajor)
+  {
+    // dgesv assumes colmajor so we do nothing to the values of A and call the function
+    dgesv_(&m, &nrhs, A->val, &lda, ipiv, b->val, &ldb, &info);
+  }
+  else
+  {
+    // The RowMajor buffer is A^T in ColMajor order: factor A^T in place and
+    // solve (A^T)^T x = b, i.e. no copy and no transpose of A is needed
+    char trans = 'T';
+    dgetrf_(&m, &n, A->val, &lda, ipiv, &info);
+    if (info == 0)
+    {
+      dgetrs_(&trans, &n, &nrhs, A->val, &lda, ipiv, b->val, &ldb, &info);
+    }
+  }
+
+  free(ipiv);
+  return (int)info;
+}
+
+/* call_dgesv_multi : solves a square linear system with several right-hand sides
 
-=======
+Purpose:
+Solves the linear systems A*X = B for all columns of B at once. Upon exit, B
+is overwritten by the solution X and A is overwritten by its LU factors (of
+A^T if A is stored in RowMajor order, see call_dgesv).
+
+A is factored once and all columns of B are passed to a single call of
+DGETRS, so the solve runs as BLAS-3 (matrix-matrix) operations instead of k
+separate factorizations and matrix-vector solves. A RowMajor B is solved on
+a ColMajor copy (see lu_solve_many).
+
+Return value:
+The function returns the output `info` from LAPACK with the following
+exceptions: the return value is
+
+  -9 if the input A is NULL and/or the input B is NULL
+  -10 if A is not square
+  -11 if the dimensions of A and B are incompatible (or do not fit in a
+      lapack_int, see lapack.h)
+  -12 in case of memory allocation errors.
+*/
+int call_dgesv_multi(array2d_t *A, array2d_t *B)
+{
+  // Checks if both Matrix A and Matrix B are not empty
+  if (A == NULL || B == NULL)
+  {
+    return -9;
+  }
+
+  // Checks if the Matrix A is square
   if (A->shape[0] != A->shape[1])
   {
     return -10;
   }
 
-  if (A->shape[0] != b->len)
+  // Checks if B has as many rows as A
+  if (A->shape[0] != B->shape[0] || !lapack_int_fits(A->shape[0]) || !lapack_int_fits(B->shape[1]))
   {
     return -11;
   }
 
-  int m = (int) A->shape[0], n = (int) A->shape[1];
-    int nrhs = 1, ldb=m, lda=m, info;
-    int ipiv[n];
->>>>>>> 1f75698a3d6955cde18b939167ca905246644155
-
-    if (A->order == ColMajor){
-        // dgesv assumes colmajor we do nothing to the values of A and calls the fundtion
-        dgesv_( &m, &nrhs, A->val, &lda, ipiv, b->val, &ldb, &info );
-    } else{
-        // Initializing vector and dim of vector
-        int nm = n*m;
-        double xrow[nm];
-
-        //saving the values of A in a new vector
-        for (size_t i = 0; i < nm; i++){
-           xrow[i] = A->val[i];
-        }
-        int k = 0;
-
-<<<<<<< HEAD
-        // Rearranges the values of A so its on Colmajor
-=======
-
->>>>>>> 1f75698a3d6955cde18b939167ca905246644155
-        for (size_t i = 0; i < n; i++){
-
-            for (size_t j = 0; j < n; j++)
-            {
-               A->val[k] = xrow[i+n*j];
-               k = k+1;
-            }
-        }
-<<<<<<< HEAD
-        
-        // call the function
-=======
-
->>>>>>> 1f75698a3d6955cde18b939167ca905246644155
-        dgesv_( &m, &nrhs, A->val, &lda, ipiv, b->val, &ldb, &info );
+  lapack_int n = (lapack_int)A->shape[0], lda = n, info;
+  lapack_int *ipiv = malloc((n > 0 ? (size_t)n : 1) * sizeof(*ipiv));
+  if (ipiv == NULL)
+  {
+    return -12;
+  }
+
+  // Factor A in place and solve through a view of the factors
+  dgetrf_(&n, &n, A->val, &lda, ipiv, &info);
+  if (info == 0)
+  {
+    lu_t lu = {A, ipiv};
+    info = lu_solve_many(&lu, B);
+  }
+
+  free(ipiv);
+  return (int)info;
+}
+
+#ifndef MSP_NO_LAPACK
+
+// Infinity norm of a vector
+static double norm_inf(const double *x, size_t n)
+{
+  double nrm = 0.0;
+  for (size_t i = 0; i < n; i++)
+  {
+    double a = fabs(x[i]);
+    if (a > nrm)
+      nrm = a;
+  }
+  return nrm;
+}
+
+// Infinity norm (maximum absolute row sum) of a square matrix
+static double mat_norm_inf(const array2d_t *A)
+{
+  size_t n = A->shape[0];
+  size_t st0 = (A->order == RowMajor) ? n : 1;
+  size_t st1 = (A->order == RowMajor) ? 1 : n;
+  double nrm = 0.0;
+  for (size_t i = 0; i < n; i++)
+  {
+    double s = 0.0;
+    for (size_t j = 0; j < n; j++)
+      s += fabs(A->val[i * st0 + j * st1]);
+    if (s > nrm)
+      nrm = s;
+  }
+  return nrm;
+}
+
+// r = b - A*x using the buffer of A as it is stored
+static void residual(const array2d_t *A, const double *b, const double *x, double *r)
+{
+  lapack_int n = (lapack_int)A->shape[0], lda = n, inc = 1;
+  double alpha = -1.0, beta = 1.0;
+  char trans = (A->order == RowMajor) ? 'T' : 'N';
+  for (size_t i = 0; i < A->shape[0]; i++)
+    r[i] = b[i];
+  dgemv_(&trans, &n, &n, &alpha, A->val, &lda, (double *)x, &inc, &beta, r, &inc);
+}
+
+/* call_dgesv_mixed : mixed-precision solver with iterative refinement
+
+Purpose:
+Solves the linear system A*x = b in the style of LAPACK's DSGESV. A is
+rounded to single precision and factored with SGETRF, which halves the memory
+traffic of the factorization, and the single-precision solution is refined in
+double precision:
+
+   r = b - A*x (double),  solve A*d = r (single),  x = x + d
+
+until the normwise backward error satisfies
+
+   ||r||_inf <= tol * ||A||_inf * ||x||_inf
+
+or maxiter steps have been taken. If refinement does not converge (or A
+cannot be factored in single precision), the system is solved in full double
+precision with DGETRF/DGETRS instead. A is not modified. Upon exit, b is
+overwritten by the solution x.
+
+If tol <= 0, tol = sqrt(n) * eps is used, and if maxiter <= 0, maxiter = 30
+is used (the defaults of DSGESV).
+
+Output:
+  iter   the number of refinement steps if refinement converged, or a
+         negative number if the double-precision fallback was used
+         (-maxiter-1 if refinement did not converge, -1 if the single
+         precision factorization failed)
+  resid  the infinity norm of the final residual b - A*x
+Either pointer may be NULL.
+
+Return value:
+The function returns the output `info` from LAPACK with the following
+exceptions: the return value is
+
+  -9 if the input A is NULL and/or the input b is NULL
+  -10 if A is not square
+  -11 if the dimensions of A and b are incompatible (or n does not fit in a
+      lapack_int, see lapack.h)
+  -12 in case of memory allocation errors.
+*/
+int call_dgesv_mixed(const array2d_t *A, array_t *b, double tol, int maxiter, int *iter, double *resid)
+{
+  if (A == NULL || b == NULL)
+  {
+    return -9;
+  }
+  if (A->shape[0] != A->shape[1])
+  {
+    return -10;
+  }
+  if (A->shape[0] != b->len || !lapack_int_fits(A->shape[0]))
+  {
+    return -11;
+  }
+
+  lapack_int n = (lapack_int)A->shape[0], lda = n, ldb = n, nrhs = 1, info;
+  int it = 0;
+  size_t nn = A->shape[0] * A->shape[1];
+  char trans = (A->order == RowMajor) ? 'T' : 'N';
+  if (tol <= 0.0)
+    tol = sqrt((double)n) * DBL_EPSILON;
+  if (maxiter <= 0)
+    maxiter = 30;
+
+  size_t len = (n > 0) ? (size_t)n : 1;
+  lapack_int *ipiv = malloc(len * sizeof(*ipiv));
+  double *x = malloc(len * sizeof(*x));
+  double *r = malloc(len * sizeof(*r));
+  float *rs = malloc(len * sizeof(*rs));
+  float *As = malloc((nn > 0 ? nn : 1) * sizeof(*As));
+  if (ipiv == NULL || x == NULL || r == NULL || rs == NULL || As == NULL)
+  {
+    free(ipiv);
+    free(x);
+    free(r);
+    free(rs);
+    free(As);
+    return -12;
+  }
+
+  // Single-precision factorization of A as it is stored (A^T if RowMajor)
+  int converged = 0;
+  for (size_t i = 0; i < nn; i++)
+    As[i] = (float)A->val[i];
+  sgetrf_(&n, &n, As, &lda, ipiv, &info);
+  if (info == 0)
+  {
+    double anrm = mat_norm_inf(A);
+
+    // Initial solution in single precision
+    for (size_t i = 0; i < b->len; i++)
+      rs[i] = (float)b->val[i];
+    sgetrs_(&trans, &n, &nrhs, As, &lda, ipiv, rs, &ldb, &info);
+    for (size_t i = 0; i < b->len; i++)
+      x[i] = rs[i];
+
+    // Iterative refinement with double-precision residuals
+    for (;;)
+    {
+      residual(A, b->val, x, r);
+      if (norm_inf(r, b->len) <= tol * anrm * norm_inf(x, b->len))
+      {
+        converged = 1;
+        break;
+      }
+      if (it == maxiter)
+        break;
+      for (size_t i = 0; i < b->len; i++)
+        rs[i] = (float)r[i];
+      sgetrs_(&trans, &n, &nrhs, As, &lda, ipiv, rs, &ldb, &info);
+      for (size_t i = 0; i < b->len; i++)
+        x[i] += rs[i];
+      it++;
+    }
+  }
+  free(rs);
+  free(As);
+
+  if (!converged)
+  {
+    // Fall back to a double-precision factorization of a copy of A
+    it = (info == 0) ? -maxiter - 1 : -1;
+    double *Ad = malloc((nn > 0 ? nn : 1) * sizeof(*Ad));
+    if (Ad == NULL)
+    {
+      free(ipiv);
+      free(x);
+      free(r);
+      return -12;
     }
+    for (size_t i = 0; i < nn; i++)
+      Ad[i] = A->val[i];
+    for (size_t i = 0; i < b->len; i++)
+      x[i] = b->val[i];
+    dgetrf_(&n, &n, Ad, &lda, ipiv, &info);
+    if (info == 0)
+      dgetrs_(&trans, &n, &nrhs, Ad, &lda, ipiv, x, &ldb, &info);
+    free(Ad);
+    if (info == 0)
+      residual(A, b->val, x, r);
+  }
 
-    return info;
+  if (info == 0)
+  {
+    if (resid)
+      *resid = norm_inf(r, b->len);
+    for (size_t i = 0; i < b->len; i++)
+      b->val[i] = x[i];
+  }
+  if (iter)
+    *iter = it;
+
+  free(ipiv);
+  free(x);
+  free(r);
+  return (int)info;
 }
+
+const char *solve_path_name(enum solve_path path)
+/* Purpose: Returns a short name for a solver path. */
+{
+  switch (path)
+  {
+  case SolveTriangular:
+    return "triangular (dtrtrs)";
+  case SolveBanded:
+    return "banded (dgbsv)";
+  case SolveSPD:
+    return "symmetric positive definite (dpotrf/dpotrs)";
+  default:
+    return "general (dgesv)";
+  }
+}
+
+// Lower and upper bandwidth of a square matrix, scanned in storage order
+static void bandwidth(const array2d_t *A, size_t *kl, size_t *ku)
+{
+  size_t n = A->shape[0];
+  *kl = 0;
+  *ku = 0;
+  for (size_t p = 0; p < n; p++)
+  {
+    const double *v = A->val + p * n;
+    for (size_t q = 0; q < n; q++)
+    {
+      if (v[q] == 0.0)
+        continue;
+      // (p,q) is (row,col) in RowMajor order and (col,row) in ColMajor order
+      size_t i = (A->order == RowMajor) ? p : q;
+      size_t j = (A->order == RowMajor) ? q : p;
+      if (i > j && i - j > *kl)
+        *kl = i - j;
+      if (j > i && j - i > *ku)
+        *ku = j - i;
+    }
+  }
+}
+
+// Checks if a square matrix is symmetric with a positive diagonal
+static int maybe_spd(const array2d_t *A)
+{
+  size_t n = A->shape[0];
+  for (size_t j = 0; j < n; j++)
+  {
+    if (!(A->val[j * n + j] > 0.0))
+      return 0;
+    for (size_t i = j + 1; i < n; i++)
+      if (A->val[j * n + i] != A->val[i * n + j])
+        return 0;
+  }
+  return 1;
+}
+
+/* call_dgesv_auto : solves a square linear system with a structure-aware solver
+
+Purpose:
+Solves the linear system A*x = b like call_dgesv, but first detects cheaply
+(in O(n^2) time and O(1) extra memory) whether A is triangular, banded or
+symmetric positive definite and dispatches to the matching LAPACK routine:
+
+  triangular   DTRTRS (O(n^2) flops, no factorization)
+  banded       DGBSV on a band copy of A, if the band storage 2*kl+ku+1 rows
+               is less than half of n (O(n*kl*(kl+ku)) flops)
+  SPD          DPOTRF/DPOTRS (half the flops of LU and no pivoting)
+  otherwise    call_dgesv
+
+A matrix that is symmetric with a positive diagonal is only a candidate for
+the SPD path: if DPOTRF fails, A is restored and solved with call_dgesv.
+Upon exit, b is overwritten by the solution x and A may be overwritten by its
+factors. The path that was taken is stored in *path (if path is not NULL).
+
+Return value:
+The function returns the output `info` from LAPACK with the following
+exceptions: the return value is
+
+  -9 if the input A is NULL and/or the input b is NULL
+  -10 if A is not square
+  -11 if the dimensions of A and b are incompatible (or n does not fit in a
+      lapack_int, see lapack.h)
+  -12 in case of memory allocation errors.
+*/
+int call_dgesv_auto(array2d_t *A, array_t *b, enum solve_path *path)
+{
+  if (A == NULL || b == NULL)
+  {
+    return -9;
+  }
+  if (A->shape[0] != A->shape[1])
+  {
+    return -10;
+  }
+  if (A->shape[0] != b->len || !lapack_int_fits(A->shape[0]))
+  {
+    return -11;
+  }
+
+  lapack_int n = (lapack_int)A->shape[0], lda = n, ldb = n, nrhs = 1, info;
+  size_t N = A->shape[0], kl, ku;
+  enum solve_path taken = SolveGeneral;
+  bandwidth(A, &kl, &ku);
+
+  if (N > 0 && (kl == 0 || ku == 0))
+  {
+    // Triangular: the RowMajor buffer holds A^T, which flips uplo
+    taken = SolveTriangular;
+    int lower = (ku == 0);
+    if (A->order == RowMajor)
+      lower = !lower;
+    char uplo = lower ? 'L' : 'U', diag = 'N';
+    char trans = (A->order == RowMajor) ? 'T' : 'N';
+    dtrtrs_(&uplo, &trans, &diag, &n, &nrhs, A->val, &lda, b->val, &ldb, &info);
+  }
+  else if (4 * kl + 2 * ku + 2 < N)
+  {
+    // Banded: copy the band of A into LAPACK band storage with room for fill-in
+    taken = SolveBanded;
+    lapack_int ikl = (lapack_int)kl, iku = (lapack_int)ku, ldab = (lapack_int)(2 * kl + ku + 1);
+    size_t st0 = (A->order == RowMajor) ? N : 1;
+    size_t st1 = (A->order == RowMajor) ? 1 : N;
+    double *AB = calloc((size_t)ldab * N, sizeof(*AB));
+    lapack_int *ipiv = malloc(N * sizeof(*ipiv));
+    if (AB == NULL || ipiv == NULL)
+    {
+      free(AB);
+      free(ipiv);
+      return -12;
+    }
+    for (size_t j = 0; j < N; j++)
+    {
+      size_t i0 = (j > ku) ? j - ku : 0;
+      size_t i1 = (j + kl < N - 1) ? j + kl : N - 1;
+      for (size_t i = i0; i <= i1; i++)
+        AB[(kl + ku + i - j) + j * ldab] = A->val[i * st0 + j * st1];
+    }
+    dgbsv_(&n, &ikl, &iku, &nrhs, AB, &ldab, ipiv, b->val, &ldb, &info);
+    free(AB);
+    free(ipiv);
+  }
+  else if (N > 0 && maybe_spd(A))
+  {
+    // Symmetric with positive diagonal: try a Cholesky factorization, which
+    // only touches the lower triangle of the buffer (A^T = A if RowMajor)
+    char uplo = 'L';
+    double *diag = malloc(N * sizeof(*diag));
+    if (diag == NULL)
+      return -12;
+    for (size_t j = 0; j < N; j++)
+      diag[j] = A->val[j * N + j];
+    dpotrf_(&uplo, &n, A->val, &lda, &info);
+    if (info == 0)
+    {
+      taken = SolveSPD;
+      dpotrs_(&uplo, &n, &nrhs, A->val, &lda, b->val, &ldb, &info);
+    }
+    else
+    {
+      // Not positive definite: restore A from its upper triangle
+      for (size_t j = 0; j < N; j++)
+      {
+        A->val[j * N + j] = diag[j];
+        for (size_t i = j + 1; i < N; i++)
+          A->val[j * N + i] = A->val[i * N + j];
+      }
+      info = call_dgesv(A, b);
+    }
+    free(diag);
+  }
+  else
+  {
+    info = call_dgesv(A, b);
+  }
+
+  if (path)
+    *path = taken;
+  return (int)info;
+}
+
+// One norm (maximum absolute column sum) of a square matrix
+static double mat_norm_one(const array2d_t *A)
+{
+  size_t n = A->shape[0];
+  size_t st0 = (A->order == RowMajor) ? n : 1;
+  size_t st1 = (A->order == RowMajor) ? 1 : n;
+  double nrm = 0.0;
+  for (size_t j = 0; j < n; j++)
+  {
+    double s = 0.0;
+    for (size_t i = 0; i < n; i++)
+      s += fabs(A->val[i * st0 + j * st1]);
+    if (s > nrm)
+      nrm = s;
+  }
+  return nrm;
+}
+
+// Componentwise backward error max_i |r_i| / (|A|*|x| + |b|)_i (as in DGERFS)
+static double backward_error(const array2d_t *A, const double *b, const double *x, const double *r)
+{
+  size_t n = A->shape[0];
+  size_t st0 = (A->order == RowMajor) ? n : 1;
+  size_t st1 = (A->order == RowMajor) ? 1 : n;
+  double berr = 0.0;
+  for (size_t i = 0; i < n; i++)
+  {
+    double den = fabs(b[i]);
+    for (size_t j = 0; j < n; j++)
+      den += fabs(A->val[i * st0 + j * st1]) * fabs(x[j]);
+    double e;
+    if (den > 0.0)
+      e = fabs(r[i]) / den;
+    else
+      e = (r[i] == 0.0) ? 0.0 : INFINITY;
+    if (e > berr)
+      berr = e;
+  }
+  return berr;
+}
+
+/* call_dgesv_diag : solves a square linear system and reports its accuracy
+
+Purpose:
+Solves the linear system A*x = b like call_dgesv and fills diag with
+
+  anorm  the 1-norm of A
+  rcond  an estimate of the reciprocal condition number 1/(||A||_1*||A^-1||_1)
+         computed by DGECON from the LU factors
+  berr   the componentwise backward error max_i |b-A*x|_i / (|A|*|x|+|b|)_i,
+         i.e. the smallest relative perturbation of the entries of A and b
+         for which x is an exact solution
+  resid  the infinity norm of the residual b - A*x.
+
+A rough bound on the relative forward error is berr/rcond; a result with
+rcond close to machine precision should not be trusted. The diagnostics reuse
+the LU factors and cost O(n^2) on top of the factorization, but A and b are
+copied to compute the residual. For a RowMajor A the factors are those of A^T,
+so DGECON is called with the infinity norm (||A^T||_inf = ||A||_1). Upon exit,
+b is overwritten by x and A by its LU factors. If A is singular, rcond is 0
+and berr and resid are NAN.
+
+Return value:
+The function returns the output `info` from LAPACK with the following
+exceptions: the return value is
+
+  -9 if the input A, b and/or diag is NULL
+  -10 if A is not square
+  -11 if the dimensions of A and b are incompatible (or n does not fit in a
+      lapack_int, see lapack.h)
+  -12 in case of memory allocation errors.
+*/
+int call_dgesv_diag(array2d_t *A, array_t *b, dgesv_diag_t *diag)
+{
+  if (A == NULL || b == NULL || diag == NULL)
+  {
+    return -9;
+  }
+  if (A->shape[0] != A->shape[1])
+  {
+    return -10;
+  }
+  if (A->shape[0] != b->len || !lapack_int_fits(A->shape[0]))
+  {
+    return -11;
+  }
+
+  size_t N = A->shape[0];
+  lapack_int n = (lapack_int)N, lda = n, nrhs = 1, info;
+  char trans = (A->order == RowMajor) ? 'T' : 'N';
+  char norm = (A->order == RowMajor) ? 'I' : '1';
+  lapack_int *ipiv = malloc((N > 0 ? 2 * N : 1) * sizeof(*ipiv));
+  double *A0 = malloc((N * N + 6 * N + 1) * sizeof(double));
+  if (ipiv == NULL || A0 == NULL)
+  {
+    free(ipiv);
+    free(A0);
+    return -12;
+  }
+  lapack_int *iwork = ipiv + n;
+  double *b0 = A0 + N * N, *r = b0 + N, *work = r + N;
+  for (size_t k = 0; k < N * N; k++)
+    A0[k] = A->val[k];
+  for (size_t k = 0; k < N; k++)
+    b0[k] = b->val[k];
+  array2d_t Acopy = {{N, N}, A->order, A0};
+
+  diag->anorm = mat_norm_one(A);
+  diag->rcond = 0.0;
+  diag->berr = NAN;
+  diag->resid = NAN;
+
+  dgetrf_(&n, &n, A->val, &lda, ipiv, &info);
+  if (info == 0)
+  {
+    dgetrs_(&trans, &n, &nrhs, A->val, &lda, ipiv, b->val, &lda, &info);
+  }
+  if (info == 0 && n > 0)
+  {
+    lapack_int cinfo;
+    dgecon_(&norm, &n, A->val, &lda, &diag->anorm, &diag->rcond, work, iwork, &cinfo);
+    residual(&Acopy, b0, b->val, r);
+    diag->resid = norm_inf(r, N);
+    diag->berr = backward_error(&Acopy, b0, b->val, r);
+  }
+  else if (info == 0)
+  {
+    diag->rcond = 1.0;
+    diag->berr = diag->resid = 0.0;
+  }
+
+  free(A0);
+  free(ipiv);
+  return (int)info;
+}
+
+#endif
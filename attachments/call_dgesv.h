@@ -0,0 +1,33 @@
+#ifndef CALL_DGESV_H
+#define CALL_DGESV_H
+#include "array.h"
+#include "array2d.h"
+
+enum solve_path /* solver chosen by call_dgesv_auto */
+{
+    SolveGeneral,
+    SolveTriangular,
+    SolveBanded,
+    SolveSPD
+};
+
+typedef struct dgesv_diag /* diagnostics computed by call_dgesv_diag */
+{
+    double anorm; // 1-norm of A
+    double rcond; // estimate of 1/cond_1(A) (0 if A is singular)
+    double berr;  // componentwise backward error of x
+    double resid; // infinity norm of the residual b - A*x
+} dgesv_diag_t;
+
+int call_dgesv(array2d_t *A, array_t *b);
+int call_dgesv_multi(array2d_t *A, array2d_t *B);
+
+/* Not available with the native backend (MSP_NO_LAPACK) */
+#ifndef MSP_NO_LAPACK
+int call_dgesv_mixed(const array2d_t *A, array_t *b, double tol, int maxiter, int *iter, double *resid);
+int call_dgesv_auto(array2d_t *A, array_t *b, enum solve_path *path);
+const char *solve_path_name(enum solve_path path);
+int call_dgesv_diag(array2d_t *A, array_t *b, dgesv_diag_t *diag);
+#endif
+
+#endif
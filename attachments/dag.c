@@ -0,0 +1,469 @@
+#define _POSIX_C_SOURCE 200809L
+#include "dag.h"
+#include "misc.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+typedef struct dag_task /* node of the task graph */
+{
+  void (*fn)(void *);
+  void *arg;               // private copy of the argument
+  size_t npred;            // unfinished predecessors (updated atomically by dag_run)
+  struct dag_task **succ;  // tasks that depend on this task
+  size_t nsucc, capsucc;
+} dag_task_t;
+
+typedef struct dag_data /* last accesses to one piece of data */
+{
+  const void *key;
+  dag_task_t *writer;    // last task that wrote the data
+  dag_task_t **readers;  // tasks that read the data since the last write
+  size_t nreaders, capreaders;
+} dag_data_t;
+
+typedef struct dag_deque /* per-worker ready queue */
+{
+  pthread_mutex_t lock;
+  dag_task_t **task;
+  size_t head, tail, cap; // owner works at the tail, thieves steal from the head
+} dag_deque_t;
+
+struct dag
+{
+  dag_task_t **task;
+  size_t ntasks, captasks;
+  dag_data_t *data; // open-addressing hash table keyed by data address
+  size_t ndata, capdata;
+
+  // state of dag_run
+  dag_deque_t *deque;
+  size_t nworkers;
+  size_t remaining; // tasks not yet completed
+  size_t nready;    // tasks in the deques
+  size_t sleepers;  // workers waiting for ready tasks
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+};
+
+typedef struct dag_worker
+{
+  dag_t *dag;
+  size_t id;
+} dag_worker_t;
+
+// Appends t to the array *a of length *n and capacity *cap
+static int push_task(dag_task_t ***a, size_t *n, size_t *cap, dag_task_t *t)
+{
+  if (*n == *cap)
+  {
+    size_t c = (*cap > 0) ? 2 * *cap : 4;
+    dag_task_t **tmp = realloc(*a, c * sizeof(**a));
+    if (tmp == NULL)
+      return MSP_MEM_ERR;
+    *a = tmp;
+    *cap = c;
+  }
+  (*a)[(*n)++] = t;
+  return MSP_SUCCESS;
+}
+
+static size_t hash_ptr(const void *p, size_t cap)
+{
+  uint64_t h = (uint64_t)(uintptr_t)p;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (size_t)h & (cap - 1);
+}
+
+// Returns the access record of data, inserting it if needed (NULL on failure)
+static dag_data_t *find_data(dag_t *dag, const void *key)
+{
+  if (2 * (dag->ndata + 1) > dag->capdata)
+  {
+    size_t cap = (dag->capdata > 0) ? 2 * dag->capdata : 64;
+    dag_data_t *tab = calloc(cap, sizeof(*tab));
+    if (tab == NULL)
+      return NULL;
+    for (size_t k = 0; k < dag->capdata; k++)
+    {
+      if (dag->data[k].key == NULL)
+        continue;
+      size_t h = hash_ptr(dag->data[k].key, cap);
+      while (tab[h].key != NULL)
+        h = (h + 1) & (cap - 1);
+      tab[h] = dag->data[k];
+    }
+    free(dag->data);
+    dag->data = tab;
+    dag->capdata = cap;
+  }
+  size_t h = hash_ptr(key, dag->capdata);
+  while (dag->data[h].key != NULL && dag->data[h].key != key)
+    h = (h + 1) & (dag->capdata - 1);
+  if (dag->data[h].key == NULL)
+  {
+    dag->data[h].key = key;
+    dag->ndata++;
+  }
+  return dag->data + h;
+}
+
+// Adds the edge pred -> t (pred must complete before t starts)
+static int add_edge(dag_task_t *pred, dag_task_t *t)
+{
+  if (pred == NULL || pred == t)
+    return MSP_SUCCESS;
+  if (push_task(&pred->succ, &pred->nsucc, &pred->capsucc, t) != MSP_SUCCESS)
+    return MSP_MEM_ERR;
+  t->npred++;
+  return MSP_SUCCESS;
+}
+
+dag_t *dag_alloc(void)
+/*
+  Purpose:
+
+    Allocates an empty task graph. Tasks are added in sequential program
+    order with dag_insert, which derives the dependencies between them from
+    the data they read and write (like a superscalar processor does for
+    instructions), and the graph is then executed in parallel by dag_run.
+
+  Example:
+
+    ```c
+    dag_t *dag = dag_alloc();
+    if (dag==NULL) exit(EXIT_FAILURE);
+    // x = f(x) then y = g(x, y): g runs after f
+    dag_insert(dag, f, &x, sizeof(x), 1, (dag_dep_t[]){{&x, DagWrite}});
+    dag_insert(dag, g, &xy, sizeof(xy), 2, (dag_dep_t[]){{&x, DagRead}, {&y, DagWrite}});
+    dag_run(dag, 4);
+    dag_dealloc(dag);
+    ```
+
+  Return value:
+    A pointer to a dag_t, or NULL if an error occurs.
+*/
+{
+  dag_t *dag = calloc(1, sizeof(*dag));
+  if (dag == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  return dag;
+}
+
+void dag_dealloc(dag_t *dag)
+/* Purpose: Deallocates a task graph and the argument copies of its tasks. */
+{
+  if (dag == NULL)
+    return;
+  for (size_t k = 0; k < dag->ntasks; k++)
+  {
+    free(dag->task[k]->arg);
+    free(dag->task[k]->succ);
+    free(dag->task[k]);
+  }
+  for (size_t k = 0; k < dag->capdata; k++)
+    free(dag->data[k].readers);
+  free(dag->task);
+  free(dag->data);
+  free(dag);
+}
+
+size_t dag_size(const dag_t *dag)
+/* Purpose: Returns the number of tasks in the graph. */
+{
+  return dag ? dag->ntasks : 0;
+}
+
+int dag_insert(dag_t *dag, void (*fn)(void *), const void *arg, size_t argsize,
+               size_t ndeps, const dag_dep_t *deps)
+/*
+  Purpose:
+
+    Appends the task fn(arg) to the graph. The argsize bytes at arg are
+    copied, so arg may point to a temporary. The task accesses the data
+    listed in deps: it runs after the last task that wrote any of them,
+    and a task that writes (DagWrite) also runs after all tasks that read
+    the data since then. Tasks without a mutual dependency may run
+    concurrently.
+
+  Arguments:
+    dag          task graph
+    fn           task function
+    arg          argument of fn (copied), or NULL
+    argsize      size of the argument in bytes
+    ndeps        number of entries in deps
+    deps         data addresses and how the task accesses them
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_ILLEGAL_INPUT if dag or fn is NULL,
+    and MSP_MEM_ERR if memory allocation fails.
+*/
+{
+  if (dag == NULL || fn == NULL || (ndeps > 0 && deps == NULL))
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  dag_task_t *t = calloc(1, sizeof(*t));
+  if (t == NULL)
+    goto mem_err;
+  t->fn = fn;
+  if (arg != NULL && argsize > 0)
+  {
+    t->arg = malloc(argsize);
+    if (t->arg == NULL)
+    {
+      free(t);
+      goto mem_err;
+    }
+    memcpy(t->arg, arg, argsize);
+  }
+  if (push_task(&dag->task, &dag->ntasks, &dag->captasks, t) != MSP_SUCCESS)
+  {
+    free(t->arg);
+    free(t);
+    goto mem_err;
+  }
+
+  for (size_t k = 0; k < ndeps; k++)
+  {
+    dag_data_t *d = find_data(dag, deps[k].data);
+    if (d == NULL || add_edge(d->writer, t) != MSP_SUCCESS)
+      goto mem_err;
+    if (deps[k].mode == DagRead)
+    {
+      if (push_task(&d->readers, &d->nreaders, &d->capreaders, t) != MSP_SUCCESS)
+        goto mem_err;
+    }
+    else
+    {
+      for (size_t r = 0; r < d->nreaders; r++)
+        if (add_edge(d->readers[r], t) != MSP_SUCCESS)
+          goto mem_err;
+      d->nreaders = 0;
+      d->writer = t;
+    }
+  }
+  return MSP_SUCCESS;
+
+mem_err:
+#ifndef NDEBUG
+  MEM_ERR;
+#endif
+  return MSP_MEM_ERR;
+}
+
+static void run_task(dag_t *dag, size_t id, dag_task_t *t);
+
+// Pushes a ready task onto the tail of a worker's deque
+static void deque_push(dag_t *dag, size_t id, dag_task_t *t)
+{
+  dag_deque_t *q = dag->deque + id;
+  pthread_mutex_lock(&q->lock);
+  if (q->tail == q->cap)
+  {
+    // compact, or grow the array
+    if (q->head > 0)
+    {
+      memmove(q->task, q->task + q->head, (q->tail - q->head) * sizeof(*q->task));
+      q->tail -= q->head;
+      q->head = 0;
+    }
+    if (q->tail == q->cap)
+    {
+      dag_task_t **tmp = realloc(q->task, 2 * q->cap * sizeof(*q->task));
+      if (tmp == NULL)
+      {
+        // out of memory: run the task right away instead of queueing it
+        pthread_mutex_unlock(&q->lock);
+        run_task(dag, id, t);
+        return;
+      }
+      q->task = tmp;
+      q->cap *= 2;
+    }
+  }
+  q->task[q->tail++] = t;
+  pthread_mutex_unlock(&q->lock);
+
+  __atomic_add_fetch(&dag->nready, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&dag->sleepers, __ATOMIC_SEQ_CST) > 0)
+  {
+    pthread_mutex_lock(&dag->lock);
+    pthread_cond_signal(&dag->wake);
+    pthread_mutex_unlock(&dag->lock);
+  }
+}
+
+// Takes a task from the tail (own deque) or the head (stealing) of a deque
+static dag_task_t *deque_take(dag_t *dag, size_t id, int steal)
+{
+  dag_deque_t *q = dag->deque + id;
+  dag_task_t *t = NULL;
+  pthread_mutex_lock(&q->lock);
+  if (q->head < q->tail)
+    t = steal ? q->task[q->head++] : q->task[--q->tail];
+  pthread_mutex_unlock(&q->lock);
+  if (t != NULL)
+    __atomic_sub_fetch(&dag->nready, 1, __ATOMIC_SEQ_CST);
+  return t;
+}
+
+// Runs a task on worker id and releases its successors
+static void run_task(dag_t *dag, size_t id, dag_task_t *t)
+{
+  t->fn(t->arg);
+
+  // the successor inserted first is pushed last, so the worker runs it next
+  for (size_t k = t->nsucc; k-- > 0;)
+  {
+    dag_task_t *s = t->succ[k];
+    if (__atomic_sub_fetch(&s->npred, 1, __ATOMIC_ACQ_REL) == 0)
+      deque_push(dag, id, s);
+  }
+  if (__atomic_sub_fetch(&dag->remaining, 1, __ATOMIC_SEQ_CST) == 0)
+  {
+    pthread_mutex_lock(&dag->lock);
+    pthread_cond_broadcast(&dag->wake);
+    pthread_mutex_unlock(&dag->lock);
+  }
+}
+
+// Worker loop: runs own tasks, steals from the other workers when idle
+static void *worker(void *arg)
+{
+  dag_worker_t *w = arg;
+  dag_t *dag = w->dag;
+  size_t p = dag->nworkers;
+  while (__atomic_load_n(&dag->remaining, __ATOMIC_SEQ_CST) > 0)
+  {
+    dag_task_t *t = deque_take(dag, w->id, 0);
+    for (size_t k = 1; k < p && t == NULL; k++)
+      t = deque_take(dag, (w->id + k) % p, 1);
+    if (t == NULL)
+    {
+      // sleep until a task becomes ready or the graph is done
+      pthread_mutex_lock(&dag->lock);
+      __atomic_add_fetch(&dag->sleepers, 1, __ATOMIC_SEQ_CST);
+      while (__atomic_load_n(&dag->nready, __ATOMIC_SEQ_CST) == 0 &&
+             __atomic_load_n(&dag->remaining, __ATOMIC_SEQ_CST) > 0)
+        pthread_cond_wait(&dag->wake, &dag->lock);
+      __atomic_sub_fetch(&dag->sleepers, 1, __ATOMIC_SEQ_CST);
+      pthread_mutex_unlock(&dag->lock);
+      continue;
+    }
+
+    run_task(dag, w->id, t);
+  }
+  return NULL;
+}
+
+int dag_run(dag_t *dag, size_t nthreads)
+/*
+  Purpose:
+
+    Executes all tasks of the graph on nthreads workers (the calling thread
+    and nthreads-1 new threads) and returns when they have completed. Each
+    worker keeps its own deque of ready tasks: tasks released by a finished
+    task are pushed onto the worker's deque and popped in LIFO order, which
+    follows the critical path (e.g. a panel factorization is started as soon
+    as its column is updated), while idle workers steal the oldest tasks from
+    the other deques. A graph can be run once.
+
+  Arguments:
+    dag          task graph
+    nthreads     number of workers (at least 1)
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_ILLEGAL_INPUT if dag is NULL, and
+    MSP_MEM_ERR or MSP_FAILURE if the workers could not be started.
+*/
+{
+  if (dag == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  if (dag->ntasks == 0)
+    return MSP_SUCCESS;
+  size_t p = (nthreads > 0) ? nthreads : 1;
+  dag->deque = calloc(p, sizeof(*dag->deque));
+  dag_worker_t *w = malloc(p * sizeof(*w));
+  pthread_t *threads = malloc(p * sizeof(*threads));
+  int status = MSP_SUCCESS;
+  if (dag->deque == NULL || w == NULL || threads == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    free(dag->deque);
+    free(w);
+    free(threads);
+    return MSP_MEM_ERR;
+  }
+  for (size_t k = 0; k < p; k++)
+  {
+    pthread_mutex_init(&dag->deque[k].lock, NULL);
+    dag->deque[k].cap = (dag->ntasks < 256) ? dag->ntasks : 256;
+    dag->deque[k].task = malloc(dag->deque[k].cap * sizeof(dag_task_t *));
+    if (dag->deque[k].task == NULL)
+      status = MSP_MEM_ERR;
+    w[k].dag = dag;
+    w[k].id = k;
+  }
+  pthread_mutex_init(&dag->lock, NULL);
+  pthread_cond_init(&dag->wake, NULL);
+  dag->nworkers = p;
+  dag->remaining = dag->ntasks;
+
+  // deal the initially ready tasks round-robin
+  if (status == MSP_SUCCESS)
+  {
+    size_t next = 0;
+    for (size_t k = 0; k < dag->ntasks; k++)
+      if (dag->task[k]->npred == 0)
+        deque_push(dag, next++ % p, dag->task[k]);
+  }
+
+  size_t started = 1;
+  for (; status == MSP_SUCCESS && started < p; started++)
+  {
+    if (pthread_create(threads + started, NULL, worker, w + started) != 0)
+    {
+      fprintf(stderr, "%s: failed to create thread\n", __func__);
+      break;
+    }
+  }
+  if (status == MSP_SUCCESS)
+  {
+    // workers that failed to start leave their deques to be stolen from
+    worker(w);
+  }
+  for (size_t k = 1; k < started; k++)
+    pthread_join(threads[k], NULL);
+
+  for (size_t k = 0; k < p; k++)
+  {
+    pthread_mutex_destroy(&dag->deque[k].lock);
+    free(dag->deque[k].task);
+  }
+  pthread_mutex_destroy(&dag->lock);
+  pthread_cond_destroy(&dag->wake);
+  free(dag->deque);
+  dag->deque = NULL;
+  free(w);
+  free(threads);
+  return status;
+}
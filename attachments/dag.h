@@ -0,0 +1,26 @@
+#ifndef DAG_H
+#define DAG_H
+#include <stdlib.h>
+
+typedef struct dag dag_t; /* task graph with data-flow dependencies */
+
+enum dag_access
+{
+  DagRead,  // task reads the data
+  DagWrite  // task reads and writes the data
+};
+
+typedef struct dag_dep /* data accessed by a task */
+{
+  const void *data;
+  enum dag_access mode;
+} dag_dep_t;
+
+dag_t *dag_alloc(void);
+void dag_dealloc(dag_t *dag);
+size_t dag_size(const dag_t *dag);
+int dag_insert(dag_t *dag, void (*fn)(void *), const void *arg, size_t argsize,
+               size_t ndeps, const dag_dep_t *deps);
+int dag_run(dag_t *dag, size_t nthreads);
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef LAPACK_H
+#define LAPACK_H
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+
+/* Integer type of LAPACK/BLAS: 64-bit with an ILP64 library (make ILP64=1,
+   which defines MSP_ILP64), otherwise int. All dimensions, leading
+   dimensions, pivots, workspace sizes and info values passed to LAPACK and
+   BLAS use this type. */
+#ifdef MSP_ILP64
+typedef int64_t lapack_int;
+#define LAPACK_INT_MAX INT64_MAX
+#ifdef MSP_NO_LAPACK
+#error "MSP_ILP64 requires an external ILP64 LAPACK/BLAS (not LAPACK=native)"
+#endif
+#else
+typedef int lapack_int;
+#define LAPACK_INT_MAX INT_MAX
+#endif
+
+/* Checks that a dimension can be passed to LAPACK/BLAS as a lapack_int */
+static inline int lapack_int_fits(size_t n)
+{
+    return n <= (size_t)LAPACK_INT_MAX;
+}
+
+/* ILP64 libraries that are installed next to an LP64 one (e.g. OpenBLAS
+   built with INTERFACE64=1 SYMBOLSUFFIX=64_) append a suffix to the names */
+#ifdef MSP_ILP64_SUFFIX
+#define dgesv_ dgesv_64_
+#define dgetrf_ dgetrf_64_
+#define dgetrs_ dgetrs_64_
+#define sgetrf_ sgetrf_64_
+#define sgetrs_ sgetrs_64_
+#define dpotrf_ dpotrf_64_
+#define dpotrs_ dpotrs_64_
+#define dgbsv_ dgbsv_64_
+#define dtrtrs_ dtrtrs_64_
+#define dgels_ dgels_64_
+#define dgeqrf_ dgeqrf_64_
+#define dormqr_ dormqr_64_
+#define dgelqf_ dgelqf_64_
+#define dormlq_ dormlq_64_
+#define dtpqrt_ dtpqrt_64_
+#define dtpmqrt_ dtpmqrt_64_
+#define dgecon_ dgecon_64_
+#define dgemv_ dgemv_64_
+#define dtrsm_ dtrsm_64_
+#define dsyrk_ dsyrk_64_
+#define dgemm_ dgemm_64_
+#endif
+
+#ifndef MSP_NO_LAPACK
+
+/* C prototype for LAPACK routine DGESV */
+void dgesv_(lapack_int *n,    /* columns/rows in A          */
+            lapack_int *nrhs, /* number of right-hand sides */
+            double *A,        /* array A                    */
+            lapack_int *lda,  /* leading dimension of A     */
+            lapack_int *ipiv, /* pivoting array             */
+            double *B,        /* array B                    */
+            lapack_int *ldb,  /* leading dimension of B     */
+            lapack_int *info  /* status code                */
+);
+
+/* C prototype for LAPACK routine DGETRF */
+void dgetrf_(lapack_int *m,    /* rows in A                  */
+             lapack_int *n,    /* columns in A               */
+             double *A,        /* array A                    */
+             lapack_int *lda,  /* leading dimension of A     */
+             lapack_int *ipiv, /* pivoting array             */
+             lapack_int *info  /* status code                */
+);
+
+/* C prototype for LAPACK routine DGETRS */
+void dgetrs_(char *trans,      /* 'N' or 'T'                 */
+             lapack_int *n,    /* columns/rows in A          */
+             lapack_int *nrhs, /* number of right-hand sides */
+             double *A,        /* LU factors from DGETRF     */
+             lapack_int *lda,  /* leading dimension of A     */
+             lapack_int *ipiv, /* pivoting array             */
+             double *B,        /* array B                    */
+             lapack_int *ldb,  /* leading dimension of B     */
+             lapack_int *info  /* status code                */
+);
+
+#else
+
+/* Native fallback backend (see native_lu.c): DGESV, DGETRF and DGETRS are
+   provided without an external LAPACK. The remaining routines below are not
+   available in this configuration. */
+#include "native_lu.h"
+
+static inline void dgetrf_(lapack_int *m, lapack_int *n, double *A, lapack_int *lda, lapack_int *ipiv,
+                           lapack_int *info)
+{
+    *info = native_dgetrf(*m, *n, A, *lda, ipiv);
+}
+
+static inline void dgetrs_(char *trans, lapack_int *n, lapack_int *nrhs, double *A, lapack_int *lda,
+                           lapack_int *ipiv, double *B, lapack_int *ldb, lapack_int *info)
+{
+    *info = native_dgetrs(*trans, *n, *nrhs, A, *lda, ipiv, B, *ldb);
+}
+
+static inline void dgesv_(lapack_int *n, lapack_int *nrhs, double *A, lapack_int *lda, lapack_int *ipiv,
+                          double *B, lapack_int *ldb, lapack_int *info)
+{
+    char trans = 'N';
+    dgetrf_(n, n, A, lda, ipiv, info);
+    if (*info == 0)
+        dgetrs_(&trans, n, nrhs, A, lda, ipiv, B, ldb, info);
+}
+
+#endif
+
+/* C prototype for LAPACK routine SGETRF */
+void sgetrf_(lapack_int *m,    /* rows in A                  */
+             lapack_int *n,    /* columns in A               */
+             float *A,         /* array A                    */
+             lapack_int *lda,  /* leading dimension of A     */
+             lapack_int *ipiv, /* pivoting array             */
+             lapack_int *info  /* status code                */
+);
+
+/* C prototype for LAPACK routine SGETRS */
+void sgetrs_(char *trans,      /* 'N' or 'T'                 */
+             lapack_int *n,    /* columns/rows in A          */
+             lapack_int *nrhs, /* number of right-hand sides */
+             float *A,         /* LU factors from SGETRF     */
+             lapack_int *lda,  /* leading dimension of A     */
+             lapack_int *ipiv, /* pivoting array             */
+             float *B,         /* array B                    */
+             lapack_int *ldb,  /* leading dimension of B     */
+             lapack_int *info  /* status code                */
+);
+
+/* C prototype for LAPACK routine DPOTRF */
+void dpotrf_(char *uplo,      /* 'U' or 'L'                 */
+             lapack_int *n,   /* columns/rows in A          */
+             double *A,       /* array A                    */
+             lapack_int *lda, /* leading dimension of A     */
+             lapack_int *info /* status code                */
+);
+
+/* C prototype for LAPACK routine DPOTRS */
+void dpotrs_(char *uplo,       /* 'U' or 'L'                 */
+             lapack_int *n,    /* columns/rows in A          */
+             lapack_int *nrhs, /* number of right-hand sides */
+             double *A,        /* Cholesky factor            */
+             lapack_int *lda,  /* leading dimension of A     */
+             double *B,        /* array B                    */
+             lapack_int *ldb,  /* leading dimension of B     */
+             lapack_int *info  /* status code                */
+);
+
+/* C prototype for LAPACK routine DGBSV */
+void dgbsv_(lapack_int *n,    /* columns/rows in A          */
+            lapack_int *kl,   /* subdiagonals in A          */
+            lapack_int *ku,   /* superdiagonals in A        */
+            lapack_int *nrhs, /* number of right-hand sides */
+            double *AB,       /* A in band storage          */
+            lapack_int *ldab, /* leading dimension of AB    */
+            lapack_int *ipiv, /* pivoting array             */
+            double *B,        /* array B                    */
+            lapack_int *ldb,  /* leading dimension of B     */
+            lapack_int *info  /* status code                */
+);
+
+/* C prototype for LAPACK routine DTRTRS */
+void dtrtrs_(char *uplo,       /* 'U' or 'L'                 */
+             char *trans,      /* 'N' or 'T'                 */
+             char *diag,       /* 'N' or 'U' (unit diagonal) */
+             lapack_int *n,    /* columns/rows in A          */
+             lapack_int *nrhs, /* number of right-hand sides */
+             double *A,        /* triangular array A         */
+             lapack_int *lda,  /* leading dimension of A     */
+             double *B,        /* array B                    */
+             lapack_int *ldb,  /* leading dimension of B     */
+             lapack_int *info  /* status code                */
+);
+
+/* C prototype for LAPACK routine DGELS */
+void dgels_(char *trans,       /* 'N' or 'T'             */
+            lapack_int *m,     /* rows in A              */
+            lapack_int *n,     /* cols in A              */
+            lapack_int *nrhs,  /* cols in B              */
+            double *A,         /* array A                */
+            lapack_int *lda,   /* leading dimension of A */
+            double *B,         /* array B                */
+            lapack_int *ldb,   /* leading dimension of B */
+            double *work,      /* workspace array        */
+            lapack_int *lwork, /* workspace size         */
+            lapack_int *info   /* status code            */
+);
+
+/* C prototype for LAPACK routine DGEQRF */
+void dgeqrf_(lapack_int *m,     /* rows in A                  */
+             lapack_int *n,     /* columns in A               */
+             double *A,         /* array A                    */
+             lapack_int *lda,   /* leading dimension of A     */
+             double *tau,       /* scalar factors of Q        */
+             double *work,      /* workspace array            */
+             lapack_int *lwork, /* workspace size             */
+             lapack_int *info   /* status code                */
+);
+
+/* C prototype for LAPACK routine DORMQR */
+void dormqr_(char *side,        /* 'L' or 'R'                 */
+             char *trans,       /* 'N' or 'T'                 */
+             lapack_int *m,     /* rows in C                  */
+             lapack_int *n,     /* columns in C               */
+             lapack_int *k,     /* number of reflectors       */
+             double *A,         /* reflectors from DGEQRF     */
+             lapack_int *lda,   /* leading dimension of A     */
+             double *tau,       /* scalar factors of Q        */
+             double *C,         /* array C                    */
+             lapack_int *ldc,   /* leading dimension of C     */
+             double *work,      /* workspace array            */
+             lapack_int *lwork, /* workspace size             */
+             lapack_int *info   /* status code                */
+);
+
+/* C prototype for LAPACK routine DGELQF */
+void dgelqf_(lapack_int *m,     /* rows in A                  */
+             lapack_int *n,     /* columns in A               */
+             double *A,         /* array A                    */
+             lapack_int *lda,   /* leading dimension of A     */
+             double *tau,       /* scalar factors of Q        */
+             double *work,      /* workspace array            */
+             lapack_int *lwork, /* workspace size             */
+             lapack_int *info   /* status code                */
+);
+
+/* C prototype for LAPACK routine DORMLQ */
+void dormlq_(char *side,        /* 'L' or 'R'                 */
+             char *trans,       /* 'N' or 'T'                 */
+             lapack_int *m,     /* rows in C                  */
+             lapack_int *n,     /* columns in C               */
+             lapack_int *k,     /* number of reflectors       */
+             double *A,         /* reflectors from DGELQF     */
+             lapack_int *lda,   /* leading dimension of A     */
+             double *tau,       /* scalar factors of Q        */
+             double *C,         /* array C                    */
+             lapack_int *ldc,   /* leading dimension of C     */
+             double *work,      /* workspace array            */
+             lapack_int *lwork, /* workspace size             */
+             lapack_int *info   /* status code                */
+);
+
+/* C prototype for LAPACK routine DTPQRT */
+void dtpqrt_(lapack_int *m,   /* rows in B                  */
+             lapack_int *n,   /* columns in A and B         */
+             lapack_int *l,   /* trapezoidal rows of B      */
+             lapack_int *nb,  /* block size                 */
+             double *A,       /* upper triangular array A   */
+             lapack_int *lda, /* leading dimension of A     */
+             double *B,       /* pentagonal array B         */
+             lapack_int *ldb, /* leading dimension of B     */
+             double *T,       /* block reflector factors    */
+             lapack_int *ldt, /* leading dimension of T     */
+             double *work,    /* workspace array            */
+             lapack_int *info /* status code                */
+);
+
+/* C prototype for LAPACK routine DTPMQRT */
+void dtpmqrt_(char *side,      /* 'L' or 'R'                 */
+              char *trans,     /* 'N' or 'T'                 */
+              lapack_int *m,   /* rows in B                  */
+              lapack_int *n,   /* columns in A and B         */
+              lapack_int *k,   /* number of reflectors       */
+              lapack_int *l,   /* trapezoidal rows of V      */
+              lapack_int *nb,  /* block size                 */
+              double *V,       /* reflectors from DTPQRT     */
+              lapack_int *ldv, /* leading dimension of V     */
+              double *T,       /* block reflector factors    */
+              lapack_int *ldt, /* leading dimension of T     */
+              double *A,       /* array A                    */
+              lapack_int *lda, /* leading dimension of A     */
+              double *B,       /* array B                    */
+              lapack_int *ldb, /* leading dimension of B     */
+              double *work,    /* workspace array            */
+              lapack_int *info /* status code                */
+);
+
+/* C prototype for LAPACK routine DGECON */
+void dgecon_(char *norm,        /* '1'/'O' or 'I'             */
+             lapack_int *n,     /* columns/rows in A          */
+             double *A,         /* LU factors from DGETRF     */
+             lapack_int *lda,   /* leading dimension of A     */
+             double *anorm,     /* norm of the original A     */
+             double *rcond,     /* reciprocal condition num.  */
+             double *work,      /* workspace (length 4*n)     */
+             lapack_int *iwork, /* workspace (length n)       */
+             lapack_int *info   /* status code                */
+);
+
+/* C prototype for BLAS routine DGEMV */
+void dgemv_(char *trans,      /* 'N' or 'T'                 */
+            lapack_int *m,    /* rows in A                  */
+            lapack_int *n,    /* columns in A               */
+            double *alpha,    /* scalar alpha               */
+            double *A,        /* array A                    */
+            lapack_int *lda,  /* leading dimension of A     */
+            double *x,        /* vector x                   */
+            lapack_int *incx, /* stride of x                */
+            double *beta,     /* scalar beta                */
+            double *y,        /* vector y                   */
+            lapack_int *incy  /* stride of y                */
+);
+
+/* C prototype for BLAS routine DTRSM */
+void dtrsm_(char *side,      /* 'L' or 'R'                 */
+            char *uplo,      /* 'U' or 'L'                 */
+            char *transa,    /* 'N' or 'T'                 */
+            char *diag,      /* 'N' or 'U' (unit diagonal) */
+            lapack_int *m,   /* rows in B                  */
+            lapack_int *n,   /* columns in B               */
+            double *alpha,   /* scalar alpha               */
+            double *A,       /* triangular array A         */
+            lapack_int *lda, /* leading dimension of A     */
+            double *B,       /* array B                    */
+            lapack_int *ldb  /* leading dimension of B     */
+);
+
+/* C prototype for BLAS routine DSYRK */
+void dsyrk_(char *uplo,      /* 'U' or 'L'                 */
+            char *trans,     /* 'N' or 'T'                 */
+            lapack_int *n,   /* rows/columns in C          */
+            lapack_int *k,   /* columns in A ('N')         */
+            double *alpha,   /* scalar alpha               */
+            double *A,       /* array A                    */
+            lapack_int *lda, /* leading dimension of A     */
+            double *beta,    /* scalar beta                */
+            double *C,       /* array C                    */
+            lapack_int *ldc  /* leading dimension of C     */
+);
+
+/* C prototype for BLAS routine DGEMM */
+void dgemm_(char *transa,    /* 'N' or 'T'                 */
+            char *transb,    /* 'N' or 'T'                 */
+            lapack_int *m,   /* rows in C                  */
+            lapack_int *n,   /* columns in C               */
+            lapack_int *k,   /* inner dimension            */
+            double *alpha,   /* scalar alpha               */
+            double *A,       /* array A                    */
+            lapack_int *lda, /* leading dimension of A     */
+            double *B,       /* array B                    */
+            lapack_int *ldb, /* leading dimension of B     */
+            double *beta,    /* scalar beta                */
+            double *C,       /* array C                    */
+            lapack_int *ldc  /* leading dimension of C     */
+);
+
+#endif
@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+#include "lu.h"
+#include "lapack.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+lu_t *lu_factor(const array2d_t *A)
+/*
+  Purpose:
+
+    Computes the LU factorization of a square matrix with LAPACK's DGETRF
+    so that it can be reused for any number of right-hand sides. The input
+    A is not modified. If A is stored in RowMajor order, A^T is factored in
+    place (see call_dgesv), and the solves use trans = 'T'.
+
+  Example:
+
+    ```c
+    lu_t *lu = lu_factor(A);
+    if (lu==NULL) exit(EXIT_FAILURE);
+    lu_solve(lu, b1);   // O(n^2) per right-hand side
+    lu_solve(lu, b2);
+    lu_dealloc(lu);
+    ```
+
+  Arguments:
+    A          a pointer to a square array2d_t
+
+  Return value:
+    A pointer to an lu_t, or NULL if A is NULL, not square, singular, or
+    if an error occurs.
+*/
+{
+  if (A == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return NULL;
+  }
+  if (A->shape[0] != A->shape[1])
+  {
+    fprintf(stderr, "Error: A must be square\n");
+    return NULL;
+  }
+  if (!lapack_int_fits(A->shape[0]))
+  {
+    fprintf(stderr, "Error: n = %zu is too large for the LAPACK integer type\n", A->shape[0]);
+    return NULL;
+  }
+  lu_t *lu = malloc(sizeof(*lu));
+  if (lu == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  lapack_int n = (lapack_int)A->shape[0], lda = n, info;
+  lu->map = NULL;
+  lu->mapsize = 0;
+  lu->LU = array2d_alloc(A->shape, A->order);
+  lu->ipiv = malloc((n > 0 ? (size_t)n : 1) * sizeof(*lu->ipiv));
+  if (lu->LU == NULL || lu->ipiv == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    lu_dealloc(lu);
+    return NULL;
+  }
+  memcpy(lu->LU->val, A->val, A->shape[0] * A->shape[1] * sizeof(*A->val));
+
+  // Factor the buffer as it is stored (A^T if A is RowMajor)
+  dgetrf_(&n, &n, lu->LU->val, &lda, lu->ipiv, &info);
+  if (info != 0)
+  {
+    if (info > 0)
+      fprintf(stderr, "Error: A is singular (U(%ld,%ld) is zero)\n", (long)info, (long)info);
+    lu_dealloc(lu);
+    return NULL;
+  }
+  return lu;
+}
+
+void lu_dealloc(lu_t *lu)
+/* Purpose: Deallocates an lu_t (and unmaps the factors if they are mapped from a file). */
+{
+  if (lu == NULL)
+    return;
+  if (lu->map != NULL)
+  {
+    // LU->val and ipiv point into the mapping
+    munmap(lu->map, lu->mapsize);
+    free(lu->LU);
+    free(lu);
+    return;
+  }
+  array2d_dealloc(lu->LU);
+  free(lu->ipiv);
+  free(lu);
+}
+
+int lu_solve(const lu_t *lu, array_t *b)
+/*
+  Purpose:
+
+    Solves A*x = b using an LU factorization computed by lu_factor. Upon
+    exit, b is overwritten by the solution x. The cost is O(n^2).
+
+  Arguments:
+    lu         a pointer to an lu_t
+    b          a pointer to an array_t of length n
+
+  Return value:
+    The output `info` from DGETRS, -9 if lu and/or b is NULL, and -11 if the
+    dimensions of A and b are incompatible.
+*/
+{
+  if (lu == NULL || b == NULL)
+    return -9;
+  if (lu->LU->shape[0] != b->len)
+    return -11;
+  lapack_int n = (lapack_int)lu->LU->shape[0], nrhs = 1, lda = n, ldb = n, info;
+  char trans = (lu->LU->order == RowMajor) ? 'T' : 'N';
+  dgetrs_(&trans, &n, &nrhs, lu->LU->val, &lda, lu->ipiv, b->val, &ldb, &info);
+  return (int)info;
+}
+
+int lu_solve_many(const lu_t *lu, array2d_t *B)
+/*
+  Purpose:
+
+    Solves A*X = B for all columns of B using an LU factorization computed
+    by lu_factor. Upon exit, B is overwritten by the solution X. All
+    right-hand sides are passed to a single call of DGETRS. A RowMajor B is
+    transposed into a ColMajor workspace first, which costs O(n*nrhs) and
+    is negligible compared to the O(n^2*nrhs) solve.
+
+  Arguments:
+    lu         a pointer to an lu_t
+    B          a pointer to an array2d_t with n rows
+
+  Return value:
+    The output `info` from DGETRS, -9 if lu and/or B is NULL, -11 if the
+    dimensions of A and B are incompatible (or B has more columns than fit
+    in a lapack_int), and -12 in case of memory
+    allocation errors.
+*/
+{
+  if (lu == NULL || B == NULL)
+    return -9;
+  if (lu->LU->shape[0] != B->shape[0] || !lapack_int_fits(B->shape[1]))
+    return -11;
+  lapack_int n = (lapack_int)lu->LU->shape[0], nrhs = (lapack_int)B->shape[1], lda = n, ldb = n, info;
+  char trans = (lu->LU->order == RowMajor) ? 'T' : 'N';
+  if (nrhs == 0)
+    return 0;
+  if (B->order == ColMajor)
+  {
+    dgetrs_(&trans, &n, &nrhs, lu->LU->val, &lda, lu->ipiv, B->val, &ldb, &info);
+    return (int)info;
+  }
+
+  // RowMajor B: solve on a ColMajor copy and scatter the solution back
+  size_t m = B->shape[0], k = B->shape[1];
+  double *work = malloc(m * k * sizeof(*work));
+  if (work == NULL)
+    return -12;
+  for (size_t i = 0; i < m; i++)
+    for (size_t j = 0; j < k; j++)
+      work[i + j * m] = B->val[i * k + j];
+  dgetrs_(&trans, &n, &nrhs, lu->LU->val, &lda, lu->ipiv, work, &ldb, &info);
+  for (size_t i = 0; i < m; i++)
+    for (size_t j = 0; j < k; j++)
+      B->val[i * k + j] = work[i + j * m];
+  free(work);
+  return (int)info;
+}
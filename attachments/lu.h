@@ -0,0 +1,20 @@
+#ifndef LU_H
+#define LU_H
+#include "array.h"
+#include "array2d.h"
+#include "lapack.h"
+
+typedef struct lu /* LU factorization of a square matrix */
+{
+    array2d_t *LU;    // LU factors (of A^T if A is RowMajor)
+    lapack_int *ipiv; // pivot indices from DGETRF
+    void *map;        // file mapping holding LU->val and ipiv (see lu_cache_get), or NULL
+    size_t mapsize;
+} lu_t;
+
+lu_t *lu_factor(const array2d_t *A);
+void lu_dealloc(lu_t *lu);
+int lu_solve(const lu_t *lu, array_t *b);
+int lu_solve_many(const lu_t *lu, array2d_t *B);
+
+#endif
@@ -0,0 +1,407 @@
+#define _POSIX_C_SOURCE 200809L
+#include "lu_cache.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "MSPLUC1"
+#define CACHE_SUFFIX ".lu"
+
+typedef struct cache_header /* header of a cache entry (64 bytes) */
+{
+  char magic[8];
+  uint64_t key[2];
+  uint64_t n;
+  uint64_t order;   // storage order of the factored matrix
+  uint64_t created; // time the entry was stored
+  uint64_t intsize; // size of the pivot indices (sizeof(lapack_int))
+  uint64_t reserved;
+} cache_header_t;
+
+typedef struct cache_entry /* entry found by lu_cache_evict */
+{
+  char *path;
+  size_t size;
+  double age; // sort key: smaller is evicted first
+} cache_entry_t;
+
+static uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static uint64_t fmix64(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+// Size in bytes of the entry for an n-by-n factorization
+static size_t entry_size(size_t n)
+{
+  return sizeof(cache_header_t) + n * n * sizeof(double) + n * sizeof(lapack_int);
+}
+
+// Writes the path of the entry for key to a new string
+static char *entry_path(const lu_cache_t *cache, const uint64_t key[2])
+{
+  char *path = malloc(strlen(cache->dir) + 40);
+  if (path != NULL)
+    sprintf(path, "%s/%016llx%016llx" CACHE_SUFFIX, cache->dir, (unsigned long long)key[0],
+            (unsigned long long)key[1]);
+  return path;
+}
+
+int lu_cache_key(const char *filename, uint64_t key[2])
+/*
+  Purpose:
+
+    Computes a 128-bit hash (MurmurHash3, x64 variant) of the contents of a
+    file, e.g. the text file with A. The hash is used as the key of the
+    factorization of A in the cache, so A does not have to be parsed to look
+    it up. The hash is not cryptographic, and an entry is not compared
+    with A when it is loaded.
+
+  Arguments:
+    filename   string with filename
+    key        array of length 2 for the hash
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_FILE_ERR if the file cannot be read,
+    and MSP_MEM_ERR if memory allocation fails.
+*/
+{
+  const uint64_t c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+  const size_t bufsize = 1 << 20; // multiple of the 16-byte block size
+  uint64_t h1 = 0, h2 = 0, k1, k2, len = 0;
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+  {
+#ifndef NDEBUG
+    FILE_ERR(filename);
+#endif
+    return MSP_FILE_ERR;
+  }
+  unsigned char *buf = malloc(bufsize);
+  if (buf == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    fclose(fp);
+    return MSP_MEM_ERR;
+  }
+
+  size_t nread;
+  do
+  {
+    nread = fread(buf, 1, bufsize, fp);
+    size_t nblocks = nread / 16;
+    for (size_t b = 0; b < nblocks; b++)
+    {
+      memcpy(&k1, buf + 16 * b, 8);
+      memcpy(&k2, buf + 16 * b + 8, 8);
+      k1 *= c1;
+      k1 = rotl64(k1, 31);
+      k1 *= c2;
+      h1 ^= k1;
+      h1 = rotl64(h1, 27);
+      h1 += h2;
+      h1 = h1 * 5 + 0x52dce729;
+      k2 *= c2;
+      k2 = rotl64(k2, 33);
+      k2 *= c1;
+      h2 ^= k2;
+      h2 = rotl64(h2, 31);
+      h2 += h1;
+      h2 = h2 * 5 + 0x38495ab5;
+    }
+    len += nread;
+    if (nread % 16 != 0)
+    {
+      // tail of the file (only the last read can be shorter than bufsize)
+      unsigned char tail[16] = {0};
+      memcpy(tail, buf + 16 * nblocks, nread % 16);
+      memcpy(&k1, tail, 8);
+      memcpy(&k2, tail + 8, 8);
+      k2 *= c2;
+      k2 = rotl64(k2, 33);
+      k2 *= c1;
+      h2 ^= k2;
+      k1 *= c1;
+      k1 = rotl64(k1, 31);
+      k1 *= c2;
+      h1 ^= k1;
+    }
+  } while (nread == bufsize);
+  int err = ferror(fp);
+  free(buf);
+  fclose(fp);
+  if (err)
+    return MSP_FILE_ERR;
+
+  h1 ^= len;
+  h2 ^= len;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+  key[0] = h1;
+  key[1] = h2;
+  return MSP_SUCCESS;
+}
+
+lu_t *lu_cache_get(const lu_cache_t *cache, const uint64_t key[2])
+/*
+  Purpose:
+
+    Looks up the factorization stored under key. On a hit, the entry is
+    memory-mapped read-only and returned as an lu_t whose factors and
+    pivots point into the mapping, so no data is read or copied until
+    lu_solve touches it. With the LRU policy, the modification time of the
+    entry is updated. The lu_t must be deallocated with lu_dealloc.
+
+  Arguments:
+    cache      a pointer to an lu_cache_t
+    key        hash of A (see lu_cache_key)
+
+  Return value:
+    A pointer to an lu_t, or NULL if there is no valid entry for key.
+*/
+{
+  if (cache == NULL || key == NULL)
+    return NULL;
+  char *path = entry_path(cache, key);
+  if (path == NULL)
+    return NULL;
+  int fd = open(path, O_RDONLY);
+  free(path);
+  if (fd < 0)
+    return NULL;
+
+  cache_header_t hdr;
+  struct stat st;
+  lu_t *lu = NULL;
+  if (fstat(fd, &st) != 0 || pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+      memcmp(hdr.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || hdr.key[0] != key[0] ||
+      hdr.key[1] != key[1] || hdr.order > ColMajor || hdr.intsize != sizeof(lapack_int) ||
+      (size_t)st.st_size != entry_size(hdr.n))
+  {
+    fprintf(stderr, "Warning: ignoring invalid cache entry\n");
+    close(fd);
+    return NULL;
+  }
+
+  size_t n = hdr.n, size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (map != MAP_FAILED)
+  {
+    lu = malloc(sizeof(*lu));
+    array2d_t *LU = malloc(sizeof(*LU));
+    if (lu == NULL || LU == NULL)
+    {
+      free(lu);
+      free(LU);
+      munmap(map, size);
+      lu = NULL;
+    }
+    else
+    {
+      LU->shape[0] = LU->shape[1] = n;
+      LU->order = (enum storage_order)hdr.order;
+      LU->val = (double *)((char *)map + sizeof(hdr));
+      lu->LU = LU;
+      lu->ipiv = (lapack_int *)((char *)map + sizeof(hdr) + n * n * sizeof(double));
+      lu->map = map;
+      lu->mapsize = size;
+      if (cache->policy == CacheLRU)
+        futimens(fd, NULL);
+    }
+  }
+  close(fd);
+  return lu;
+}
+
+int lu_cache_put(const lu_cache_t *cache, const uint64_t key[2], const lu_t *lu)
+/*
+  Purpose:
+
+    Stores a factorization in the cache under key. Entries are evicted
+    first if the size limit would be exceeded (see lu_cache_evict). The
+    entry is written to a temporary file that is renamed when complete, so
+    concurrent readers never see a partial entry.
+
+  Arguments:
+    cache      a pointer to an lu_cache_t
+    key        hash of A (see lu_cache_key)
+    lu         factorization of A
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_ILLEGAL_INPUT if an input is NULL,
+    MSP_FAILURE if the entry is larger than the cache, and MSP_FILE_ERR or
+    MSP_MEM_ERR if the entry could not be written.
+*/
+{
+  if (cache == NULL || key == NULL || lu == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  size_t n = lu->LU->shape[0], size = entry_size(n);
+  if (cache->max_bytes > 0 && size > cache->max_bytes)
+    return MSP_FAILURE;
+  lu_cache_evict(cache, size);
+
+  char *path = entry_path(cache, key);
+  char *tmp = malloc(strlen(cache->dir) + 40);
+  if (path == NULL || tmp == NULL)
+  {
+    free(path);
+    free(tmp);
+    return MSP_MEM_ERR;
+  }
+  sprintf(tmp, "%s/.tmp_XXXXXX", cache->dir);
+  int fd = mkstemp(tmp);
+  if (fd < 0)
+  {
+#ifndef NDEBUG
+    FILE_ERR(tmp);
+#endif
+    free(path);
+    free(tmp);
+    return MSP_FILE_ERR;
+  }
+
+  cache_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  hdr.key[0] = key[0];
+  hdr.key[1] = key[1];
+  hdr.n = n;
+  hdr.order = lu->LU->order;
+  hdr.created = (uint64_t)time(NULL);
+  hdr.intsize = sizeof(lapack_int);
+  FILE *fp = fdopen(fd, "wb");
+  int ok = fp != NULL && fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+           fwrite(lu->LU->val, sizeof(double), n * n, fp) == n * n &&
+           fwrite(lu->ipiv, sizeof(*lu->ipiv), n, fp) == n;
+  if (fp != NULL)
+    ok = (fclose(fp) == 0) && ok;
+  else
+    close(fd);
+  if (ok)
+    ok = rename(tmp, path) == 0;
+  if (!ok)
+  {
+    fprintf(stderr, "%s: failed to write cache entry %s\n", __func__, path);
+    unlink(tmp);
+  }
+  free(path);
+  free(tmp);
+  return ok ? MSP_SUCCESS : MSP_FILE_ERR;
+}
+
+static int cmp_entry(const void *a, const void *b)
+{
+  double x = ((const cache_entry_t *)a)->age, y = ((const cache_entry_t *)b)->age;
+  return (x > y) - (x < y);
+}
+
+int lu_cache_evict(const lu_cache_t *cache, size_t reserve)
+/*
+  Purpose:
+
+    Removes entries until the total size of the cache plus reserve bytes
+    is at most cache->max_bytes (nothing is removed if max_bytes is 0).
+    With CacheLRU the least recently used entries (oldest modification
+    time, which lu_cache_get updates on a hit) are removed first, and with
+    CacheFIFO the entries that were stored first.
+
+  Arguments:
+    cache      a pointer to an lu_cache_t
+    reserve    number of bytes to make room for
+
+  Return value:
+    The number of entries removed, or -1 if the directory cannot be read.
+*/
+{
+  if (cache == NULL || cache->max_bytes == 0)
+    return 0;
+  DIR *d = opendir(cache->dir);
+  if (d == NULL)
+  {
+#ifndef NDEBUG
+    FILE_ERR(cache->dir);
+#endif
+    return -1;
+  }
+
+  cache_entry_t *e = NULL;
+  size_t cnt = 0, cap = 0, total = 0;
+  struct dirent *de;
+  while ((de = readdir(d)) != NULL)
+  {
+    size_t len = strlen(de->d_name), lsuf = strlen(CACHE_SUFFIX);
+    if (len <= lsuf || strcmp(de->d_name + len - lsuf, CACHE_SUFFIX) != 0)
+      continue;
+    char *path = malloc(strlen(cache->dir) + len + 2);
+    if (path == NULL)
+      break;
+    sprintf(path, "%s/%s", cache->dir, de->d_name);
+    struct stat st;
+    cache_header_t hdr;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+    {
+      if (fd >= 0)
+        close(fd);
+      free(path);
+      continue;
+    }
+    close(fd);
+    if (cnt == cap)
+    {
+      cap = cap ? 2 * cap : 16;
+      cache_entry_t *tmp = realloc(e, cap * sizeof(*e));
+      if (tmp == NULL)
+      {
+        free(path);
+        break;
+      }
+      e = tmp;
+    }
+    e[cnt].path = path;
+    e[cnt].size = (size_t)st.st_size;
+    e[cnt].age = (cache->policy == CacheFIFO) ? (double)hdr.created
+                                               : st.st_mtim.tv_sec + 1e-9 * st.st_mtim.tv_nsec;
+    total += e[cnt].size;
+    cnt++;
+  }
+  closedir(d);
+
+  qsort(e, cnt, sizeof(*e), cmp_entry);
+  int removed = 0;
+  for (size_t k = 0; k < cnt; k++)
+  {
+    if (total + reserve > cache->max_bytes && unlink(e[k].path) == 0)
+    {
+      total -= e[k].size;
+      removed++;
+    }
+    free(e[k].path);
+  }
+  free(e);
+  return removed;
+}
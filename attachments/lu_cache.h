@@ -0,0 +1,24 @@
+#ifndef LU_CACHE_H
+#define LU_CACHE_H
+#include <stdint.h>
+#include "lu.h"
+
+enum lu_cache_policy /* which entries are removed first when the cache is full */
+{
+    CacheLRU, // least recently used
+    CacheFIFO // oldest
+};
+
+typedef struct lu_cache /* on-disk cache of LU factorizations */
+{
+    const char *dir;             // cache directory (must exist)
+    size_t max_bytes;            // total size limit of the entries (0: no limit)
+    enum lu_cache_policy policy; // eviction policy
+} lu_cache_t;
+
+int lu_cache_key(const char *filename, uint64_t key[2]);
+lu_t *lu_cache_get(const lu_cache_t *cache, const uint64_t key[2]);
+int lu_cache_put(const lu_cache_t *cache, const uint64_t key[2], const lu_t *lu);
+int lu_cache_evict(const lu_cache_t *cache, size_t reserve);
+
+#endif
@@ -10,7 +10,15 @@ enum storage_order
 enum cstype
 {
     CSC,
-    CSR
+    CSR,
+    SELL
+};
+
+enum symmetry
+{
+    General,
+    Symmetric,
+    SkewSymmetric
 };
 
 #define MSP_SUCCESS 0
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mm_read.h"
+#include "threadpool.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct mm_chunk /* part of the data section parsed by one task */
+{
+  const char *begin, *end; // whole lines
+  coo_t *sp;
+  size_t k;     // index of the first entry
+  size_t count; // number of entries (lines with a nonblank character)
+  int pattern;  // entries without values
+  int status;
+} mm_chunk_t;
+
+// Pass 1: counts the entries of a chunk
+static void count_chunk(void *arg)
+{
+  mm_chunk_t *c = arg;
+  size_t count = 0;
+  int blank = 1;
+  for (const char *p = c->begin; p < c->end; p++)
+  {
+    if (*p == '\n')
+    {
+      count += !blank;
+      blank = 1;
+    }
+    else if (*p != ' ' && *p != '\t' && *p != '\r')
+      blank = 0;
+  }
+  c->count = count + !blank;
+}
+
+// Pass 2: parses the entries of a chunk into their final positions
+static void parse_chunk(void *arg)
+{
+  mm_chunk_t *c = arg;
+  size_t nread;
+  c->status = mm_parse_entries(c->begin, c->end - c->begin, c->sp, c->k, c->count, c->pattern, &nread);
+  if (c->status == MSP_SUCCESS && nread != c->count)
+    c->status = MSP_FAILURE;
+}
+
+coo_t *coo_from_file_parallel(const char *filename, size_t nthreads)
+/*
+  Purpose:
+
+    Reads a sparse matrix from a Matrix Market coordinate file (see
+    coo_from_file) with nthreads threads. The file is memory-mapped, and
+    the data section is split into one chunk of whole lines per thread.
+    The threads first count the entries of their chunks, which gives the
+    position of every chunk in the coo_t, and then parse them in parallel
+    with mm_parse_entries. The validation is the same as in coo_from_file;
+    in addition, every entry must be on a line of its own (as required by
+    the Matrix Market format), and lines after the first nnz entries are
+    rejected.
+
+  Arguments:
+    filename   string with filename
+    nthreads   number of threads (0: one per online processor)
+
+  Return value:
+    A pointer to a coo_t, or NULL if an error occurs.
+*/
+{
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+#ifndef NDEBUG
+    FILE_ERR(filename);
+#endif
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  size_t size = (size_t)st.st_size;
+  const char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+#ifndef NDEBUG
+    FILE_ERR(filename);
+#endif
+    return NULL;
+  }
+  posix_madvise((void *)map, size, POSIX_MADV_SEQUENTIAL);
+
+  size_t shape[2], nnz;
+  enum symmetry sym;
+  int pattern;
+  const char *data = mm_parse_header(map, size, shape, &nnz, &sym, &pattern), *end = map + size;
+  coo_t *sp = data ? coo_alloc(shape, nnz) : NULL;
+  if (sp != NULL)
+    sp->sym = sym;
+  if (nthreads == 0)
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = ncpu > 0 ? (size_t)ncpu : 1;
+  }
+  // A chunk per thread, unless the chunks would be tiny
+  size_t p = nthreads, len = data ? (size_t)(end - data) : 0;
+  if (p > len / 65536 + 1)
+    p = len / 65536 + 1;
+  mm_chunk_t *chunk = calloc(p, sizeof(*chunk));
+  threadpool_t *pool = (p > 1) ? threadpool_alloc(p) : NULL;
+  if (sp == NULL || chunk == NULL || (p > 1 && pool == NULL))
+  {
+    coo_dealloc(sp);
+    free(chunk);
+    threadpool_dealloc(pool);
+    munmap((void *)map, size);
+    return NULL;
+  }
+
+  // Chunk boundaries: the first line break after every (t/p)'th of the data
+  const char *b = data;
+  for (size_t t = 0; t < p; t++)
+  {
+    const char *e = (t + 1 == p) ? end : data + (t + 1) * len / p;
+    if (e < b)
+      e = b;
+    const char *nl = (e < end) ? memchr(e, '\n', end - e) : NULL;
+    e = (t + 1 == p || nl == NULL) ? end : nl + 1;
+    chunk[t] = (mm_chunk_t){b, e, sp, 0, 0, pattern, MSP_SUCCESS};
+    // a chunk that could not be queued was not counted, so the read fails
+    chunk[t].status = threadpool_submit(pool, count_chunk, chunk + t);
+    b = e;
+  }
+  threadpool_wait(pool);
+
+  int status = MSP_SUCCESS;
+  size_t total = 0;
+  for (size_t t = 0; t < p; t++)
+  {
+    if (status == MSP_SUCCESS)
+      status = chunk[t].status;
+    chunk[t].k = total;
+    total += chunk[t].count;
+  }
+  if (status == MSP_SUCCESS && total != nnz)
+  {
+    fprintf(stderr, "%s: expected %zu entries but found %zu\n", __func__, nnz, total);
+    status = MSP_FAILURE;
+  }
+  if (status == MSP_SUCCESS)
+  {
+    for (size_t t = 0; t < p; t++)
+      if ((status = threadpool_submit(pool, parse_chunk, chunk + t)) != MSP_SUCCESS)
+        break;
+    // wait for the queued chunks even if a later one could not be queued
+    threadpool_wait(pool);
+    for (size_t t = 0; t < p && status == MSP_SUCCESS; t++)
+      status = chunk[t].status;
+  }
+
+  threadpool_dealloc(pool);
+  free(chunk);
+  munmap((void *)map, size);
+  if (status != MSP_SUCCESS)
+  {
+    coo_dealloc(sp);
+    return NULL;
+  }
+  sp->nnz = nnz;
+  return sp;
+}
@@ -0,0 +1,7 @@
+#ifndef MM_READ_H
+#define MM_READ_H
+#include "sparse.h"
+
+coo_t *coo_from_file_parallel(const char *filename, size_t nthreads);
+
+#endif
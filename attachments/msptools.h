@@ -6,6 +6,7 @@
 #include "carray2d.h"
 #include "ndarray.h"
 #include "sparse.h"
+#include "bsr.h"
 #include "sllist.h"
 
 #define MSP_VER 1 /* MSPtools Version 1.0.0 */
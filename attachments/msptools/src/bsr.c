@@ -0,0 +1,485 @@
+#include "bsr.h"
+#include <string.h>
+
+bsr_t *bsr_alloc(const size_t shape[2], size_t bs, size_t nblocks)
+/*
+  Purpose:
+
+    Allocates a block compressed sparse row (BSR) matrix with a given
+    number of bs-by-bs blocks. The row and column dimensions must be
+    multiples of bs. The blocks are initialized as zero.
+
+  Arguments:
+    shape      array with row and column dimensions
+    bs         block size
+    nblocks    number of blocks
+
+  Return value:
+    A pointer to a bsr_t, or NULL if an error occurs.
+*/
+{
+  if (bs == 0 || shape[0] % bs || shape[1] % bs)
+  {
+    fprintf(stderr, "%s: the dimensions must be multiples of the block size\n", __func__);
+    return NULL;
+  }
+  bsr_t *sp = malloc(sizeof(*sp));
+  if (sp == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  size_t mb = shape[0] / bs;
+  sp->shape[0] = shape[0];
+  sp->shape[1] = shape[1];
+  sp->bs = bs;
+  sp->nblocks = nblocks;
+  sp->ptr = calloc(mb + 1, sizeof(*sp->ptr));
+  sp->idx = malloc((nblocks ? nblocks : 1) * sizeof(*sp->idx));
+  sp->val = calloc((nblocks ? nblocks : 1) * bs * bs, sizeof(*sp->val));
+  if (sp->ptr == NULL || sp->idx == NULL || sp->val == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    bsr_dealloc(sp);
+    return NULL;
+  }
+  return sp;
+}
+
+void bsr_dealloc(bsr_t *sp)
+// Purpose: Deallocates a bsr_t.
+{
+  if (sp == NULL)
+    return;
+  free(sp->ptr);
+  free(sp->idx);
+  free(sp->val);
+  free(sp);
+}
+
+/* Sorts the entries of sp by block row (counting sort): the entries of
+   block row I are order[cnt[I]], ..., order[cnt[I+1]-1] */
+static void bucket_rows(const coo_t *sp, size_t bs, size_t *order, size_t *cnt)
+{
+  size_t mb = sp->shape[0] / bs;
+  memset(cnt, 0, (mb + 1) * sizeof(*cnt));
+  for (size_t k = 0; k < sp->nnz; k++)
+    cnt[sp->rowidx[k] / bs + 1]++;
+  for (size_t I = 0; I < mb; I++)
+    cnt[I + 1] += cnt[I];
+  for (size_t k = 0; k < sp->nnz; k++)
+    order[cnt[sp->rowidx[k] / bs]++] = k;
+  for (size_t I = mb; I > 0; I--)
+    cnt[I] = cnt[I - 1];
+  cnt[0] = 0;
+}
+
+/* Number of distinct bs-by-bs blocks of sp (mark: zeroed workspace with one
+   element per block column, left nonzero) */
+static size_t count_blocks(const coo_t *sp, size_t bs, const size_t *order, const size_t *cnt, size_t *mark)
+{
+  size_t mb = sp->shape[0] / bs, nblocks = 0;
+  for (size_t I = 0; I < mb; I++)
+    for (size_t l = cnt[I]; l < cnt[I + 1]; l++)
+    {
+      size_t J = sp->colidx[order[l]] / bs;
+      if (mark[J] != I + 1)
+      {
+        mark[J] = I + 1;
+        nblocks++;
+      }
+    }
+  return nblocks;
+}
+
+size_t bsr_block_size(const coo_t *sp)
+/*
+  Purpose:
+
+    Detects the block size of a sparse matrix: for every bs = 1, ...,
+    BSR_MAX_BLOCK that divides both dimensions, the number of distinct
+    bs-by-bs blocks is counted, and the block size with the smallest BSR
+    storage (values including explicit zeros, plus one index per block) is
+    returned. Matrices from discretizations with d degrees of freedom per
+    node typically give bs = d; a matrix without block structure gives 1.
+
+  Arguments:
+    sp          a pointer to a coo_t
+
+  Return value:
+    The block size, or 0 if an error occurs.
+*/
+{
+  if (sp == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return 0;
+  }
+  size_t m = sp->shape[0], n = sp->shape[1];
+  size_t *order = malloc((sp->nnz ? sp->nnz : 1) * sizeof(*order));
+  size_t *cnt = malloc((m + 1) * sizeof(*cnt));
+  size_t *mark = malloc((n ? n : 1) * sizeof(*mark));
+  if (order == NULL || cnt == NULL || mark == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    free(order);
+    free(cnt);
+    free(mark);
+    return 0;
+  }
+  size_t best = 1;
+  double best_bytes = 0.0;
+  for (size_t bs = 1; bs <= BSR_MAX_BLOCK; bs++)
+  {
+    if (m % bs || n % bs)
+      continue;
+    bucket_rows(sp, bs, order, cnt);
+    memset(mark, 0, (n / bs) * sizeof(*mark));
+    size_t nblocks = count_blocks(sp, bs, order, cnt, mark);
+    double bytes = (double)nblocks * (bs * bs * sizeof(double) + sizeof(size_t)) + (m / bs) * sizeof(size_t);
+    if (bs == 1 || bytes < best_bytes)
+    {
+      best = bs;
+      best_bytes = bytes;
+    }
+  }
+  free(order);
+  free(cnt);
+  free(mark);
+  return best;
+}
+
+static int cmp_size(const void *a, const void *b)
+{
+  size_t x = *(const size_t *)a, y = *(const size_t *)b;
+  return (x > y) - (x < y);
+}
+
+bsr_t *bsr_from_coo(const coo_t *sp, size_t bs)
+/*
+  Purpose:
+
+    Converts a sparse matrix in the coordinate format to the block
+    compressed sparse row (BSR) format with bs-by-bs blocks. Entries that
+    are not present within a stored block are explicit zeros. Duplicate
+    entries are summed, and the block columns are sorted within each
+    block row. A symmetric sp must be expanded first (see coo_expand).
+
+  Example:
+
+    ```c
+    coo_t *sp = coo_from_file("A.mtx");
+    bsr_t *A = bsr_from_coo(sp, 0);      // detect the block size
+    coo_dealloc(sp);
+    // .. bsr_spmv(1.0, A, x, 0.0, y) ..
+    bsr_dealloc(A);
+    ```
+
+  Arguments:
+    sp          a pointer to a coo_t
+    bs          block size (0: detect with bsr_block_size)
+
+  Return value:
+    A pointer to a bsr_t, or NULL if an error occurs.
+*/
+{
+  if (sp == NULL)
+    return NULL;
+  if (sp->sym != General)
+  {
+    fprintf(stderr, "%s: expand a symmetric matrix with coo_expand first\n", __func__);
+    return NULL;
+  }
+  if (bs == 0 && (bs = bsr_block_size(sp)) == 0)
+    return NULL;
+  size_t m = sp->shape[0], n = sp->shape[1];
+  if (m % bs || n % bs)
+  {
+    fprintf(stderr, "%s: the dimensions must be multiples of the block size\n", __func__);
+    return NULL;
+  }
+  size_t mb = m / bs, nb = n / bs;
+  size_t *order = malloc((sp->nnz ? sp->nnz : 1) * sizeof(*order));
+  size_t *cnt = malloc((mb + 1) * sizeof(*cnt));
+  size_t *mark = calloc(nb ? nb : 1, sizeof(*mark));
+  if (order == NULL || cnt == NULL || mark == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    free(order);
+    free(cnt);
+    free(mark);
+    return NULL;
+  }
+  bucket_rows(sp, bs, order, cnt);
+  bsr_t *A = bsr_alloc(sp->shape, bs, count_blocks(sp, bs, order, cnt, mark));
+  if (A != NULL)
+  {
+    /* mark[J] = p+1 if block column J is stored at position p; positions
+       increase with the block row, so mark[J] <= ptr[I] means "not in I" */
+    memset(mark, 0, nb * sizeof(*mark));
+    size_t p = 0;
+    for (size_t I = 0; I < mb; I++)
+    {
+      A->ptr[I] = p;
+      for (size_t l = cnt[I]; l < cnt[I + 1]; l++)
+      {
+        size_t J = sp->colidx[order[l]] / bs;
+        if (mark[J] <= A->ptr[I])
+        {
+          A->idx[p] = J;
+          mark[J] = ++p;
+        }
+      }
+      qsort(A->idx + A->ptr[I], p - A->ptr[I], sizeof(*A->idx), cmp_size);
+      for (size_t q = A->ptr[I]; q < p; q++)
+        mark[A->idx[q]] = q + 1;
+      for (size_t l = cnt[I]; l < cnt[I + 1]; l++)
+      {
+        size_t k = order[l], q = mark[sp->colidx[k] / bs] - 1;
+        A->val[q * bs * bs + (sp->rowidx[k] % bs) * bs + sp->colidx[k] % bs] += sp->val[k];
+      }
+    }
+    A->ptr[mb] = p;
+  }
+  free(order);
+  free(cnt);
+  free(mark);
+  return A;
+}
+
+/* y = beta*y + alpha*A*x with B-by-B blocks. With a constant B (see the
+   specializations below), the block loops are unrolled and the B partial
+   sums of a block row are kept in registers. */
+static inline void spmv_blocked(size_t B, size_t mb, const size_t *restrict ptr, const size_t *restrict idx,
+                                const double *restrict val, double alpha, const double *restrict x,
+                                double beta, double *restrict y)
+{
+  for (size_t I = 0; I < mb; I++)
+  {
+    double s[BSR_MAX_BLOCK] = {0.0};
+    for (size_t k = ptr[I]; k < ptr[I + 1]; k++)
+    {
+      const double *a = val + k * B * B, *xb = x + idx[k] * B;
+      for (size_t r = 0; r < B; r++)
+        for (size_t c = 0; c < B; c++)
+          s[r] += a[r * B + c] * xb[c];
+    }
+    for (size_t r = 0; r < B; r++)
+      y[I * B + r] = (beta == 0.0) ? alpha * s[r] : beta * y[I * B + r] + alpha * s[r];
+  }
+}
+
+/* Y = beta*Y + alpha*A*X for RowMajor X and Y with nrhs columns; the B rows
+   of Y of a block row stay in cache while the blocks are applied */
+static inline void spmm_blocked(size_t B, size_t mb, const size_t *restrict ptr, const size_t *restrict idx,
+                                const double *restrict val, double alpha, size_t nrhs,
+                                const double *restrict X, double beta, double *restrict Y)
+{
+  for (size_t I = 0; I < mb; I++)
+  {
+    double *y = Y + I * B * nrhs;
+    if (beta == 0.0)
+      memset(y, 0, B * nrhs * sizeof(*y));
+    else if (beta != 1.0)
+      for (size_t j = 0; j < B * nrhs; j++)
+        y[j] *= beta;
+    for (size_t k = ptr[I]; k < ptr[I + 1]; k++)
+    {
+      const double *a = val + k * B * B, *xb = X + idx[k] * B * nrhs;
+      for (size_t r = 0; r < B; r++)
+        for (size_t c = 0; c < B; c++)
+        {
+          double t = alpha * a[r * B + c];
+          for (size_t j = 0; j < nrhs; j++)
+            y[r * nrhs + j] += t * xb[c * nrhs + j];
+        }
+    }
+  }
+}
+
+#define BSR_KERNELS(B)                                                                            \
+  static void bsr_spmv_##B(size_t mb, const size_t *ptr, const size_t *idx, const double *val,   \
+                           double alpha, const double *x, double beta, double *y)                \
+  {                                                                                               \
+    spmv_blocked(B, mb, ptr, idx, val, alpha, x, beta, y);                                        \
+  }                                                                                               \
+  static void bsr_spmm_##B(size_t mb, const size_t *ptr, const size_t *idx, const double *val,   \
+                           double alpha, size_t nrhs, const double *X, double beta, double *Y)   \
+  {                                                                                               \
+    spmm_blocked(B, mb, ptr, idx, val, alpha, nrhs, X, beta, Y);                                  \
+  }
+
+BSR_KERNELS(1)
+BSR_KERNELS(2)
+BSR_KERNELS(3)
+BSR_KERNELS(4)
+BSR_KERNELS(5)
+BSR_KERNELS(6)
+
+typedef void (*bsr_spmv_kernel_t)(size_t, const size_t *, const size_t *, const double *, double,
+                                  const double *, double, double *);
+typedef void (*bsr_spmm_kernel_t)(size_t, const size_t *, const size_t *, const double *, double, size_t,
+                                  const double *, double, double *);
+
+static const bsr_spmv_kernel_t spmv_kernels[] = {
+    NULL, bsr_spmv_1, bsr_spmv_2, bsr_spmv_3, bsr_spmv_4, bsr_spmv_5, bsr_spmv_6};
+static const bsr_spmm_kernel_t spmm_kernels[] = {
+    NULL, bsr_spmm_1, bsr_spmm_2, bsr_spmm_3, bsr_spmm_4, bsr_spmm_5, bsr_spmm_6};
+
+/* The tables must have a kernel for every block size up to BSR_MAX_BLOCK */
+typedef char bsr_spmv_kernels_check[(sizeof(spmv_kernels) / sizeof(*spmv_kernels) == BSR_MAX_BLOCK + 1) ? 1 : -1];
+typedef char bsr_spmm_kernels_check[(sizeof(spmm_kernels) / sizeof(*spmm_kernels) == BSR_MAX_BLOCK + 1) ? 1 : -1];
+
+/* y = beta*y + alpha*A*x for block sizes without a specialized kernel */
+static void bsr_spmv_any(const bsr_t *A, double alpha, const double *x, double beta, double *y)
+{
+  size_t B = A->bs, mb = A->shape[0] / B;
+  for (size_t I = 0; I < mb; I++)
+    for (size_t r = 0; r < B; r++)
+    {
+      double s = 0.0;
+      for (size_t k = A->ptr[I]; k < A->ptr[I + 1]; k++)
+        for (size_t c = 0; c < B; c++)
+          s += A->val[k * B * B + r * B + c] * x[A->idx[k] * B + c];
+      y[I * B + r] = (beta == 0.0) ? alpha * s : beta * y[I * B + r] + alpha * s;
+    }
+}
+
+int bsr_spmv(double alpha, const bsr_t *A, const array_t *x, double beta, array_t *y)
+/*
+  Purpose:
+
+    Computes the sparse matrix-vector product
+
+      y := alpha*A*x + beta*y
+
+    where A is a BSR matrix. Block sizes 1, ..., BSR_MAX_BLOCK use kernels
+    specialized for the block size (register blocking: the block is
+    unrolled and the partial sums of a block row stay in registers), so
+    only one column index is loaded per block. If beta is zero, y need not
+    be initialized. The vectors x and y must not overlap.
+
+  Arguments:
+    alpha      scalar
+    A          a pointer to a bsr_t
+    x          a pointer to an array_t of length A->shape[1]
+    beta       scalar
+    y          a pointer to an array_t of length A->shape[0]
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_DIM_ERR if the lengths of x and y do not
+    match the shape of A, and MSP_ILLEGAL_INPUT if an input is NULL or x
+    and y are the same array.
+*/
+{
+  if (A == NULL || x == NULL || y == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  if (x->len != A->shape[1] || y->len != A->shape[0])
+    return MSP_DIM_ERR;
+  if (x->val == y->val && x->len > 0)
+    return MSP_ILLEGAL_INPUT;
+  if (A->bs <= BSR_MAX_BLOCK)
+    spmv_kernels[A->bs](A->shape[0] / A->bs, A->ptr, A->idx, A->val, alpha, x->val, beta, y->val);
+  else
+    bsr_spmv_any(A, alpha, x->val, beta, y->val);
+  return MSP_SUCCESS;
+}
+
+int bsr_spmm(double alpha, const bsr_t *A, const array2d_t *X, double beta, array2d_t *Y)
+/*
+  Purpose:
+
+    Computes the sparse matrix-matrix product
+
+      Y := alpha*A*X + beta*Y
+
+    where A is a BSR matrix and X and Y are dense matrices with the same
+    storage order. For RowMajor X and Y, every block of A is loaded once
+    and applied to all columns of X (the innermost loop runs over the
+    columns and vectorizes). For ColMajor X and Y, the columns are
+    multiplied one by one as in bsr_spmv. If beta is zero, Y need not be
+    initialized. X and Y must not overlap.
+
+  Arguments:
+    alpha      scalar
+    A          a pointer to a bsr_t
+    X          a pointer to an array2d_t of shape (A->shape[1], k)
+    beta       scalar
+    Y          a pointer to an array2d_t of shape (A->shape[0], k)
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_DIM_ERR if the shapes or storage orders
+    of X and Y do not match A, and MSP_ILLEGAL_INPUT if an input is NULL
+    or X and Y are the same array.
+*/
+{
+  if (A == NULL || X == NULL || Y == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  size_t m = A->shape[0], n = A->shape[1], nrhs = X->shape[1], B = A->bs;
+  if (X->shape[0] != n || Y->shape[0] != m || Y->shape[1] != nrhs || X->order != Y->order)
+    return MSP_DIM_ERR;
+  if (X->val == Y->val && n * nrhs > 0)
+    return MSP_ILLEGAL_INPUT;
+  if (X->order == RowMajor && B <= BSR_MAX_BLOCK)
+    spmm_kernels[B](m / B, A->ptr, A->idx, A->val, alpha, nrhs, X->val, beta, Y->val);
+  else if (X->order == RowMajor)
+    spmm_blocked(B, m / B, A->ptr, A->idx, A->val, alpha, nrhs, X->val, beta, Y->val);
+  else
+    for (size_t j = 0; j < nrhs; j++)
+    {
+      if (B <= BSR_MAX_BLOCK)
+        spmv_kernels[B](m / B, A->ptr, A->idx, A->val, alpha, X->val + j * n, beta, Y->val + j * m);
+      else
+        bsr_spmv_any(A, alpha, X->val + j * n, beta, Y->val + j * m);
+    }
+  return MSP_SUCCESS;
+}
+
+void bsr_fprint(FILE *stream, const bsr_t *sp)
+/*
+  Purpose:
+
+    Prints a sparse matrix in BSR format (all entries of the stored blocks)
+
+  Arguments:
+    stream       a pointer to a file stream
+    sp           a pointer to a bsr_t
+
+  Return value:
+    None
+*/
+{
+  if (sp == NULL)
+    return;
+  size_t B = sp->bs, mb = sp->shape[0] / B;
+  fprintf(stream, "<bsr_t shape=(%zu,%zu) bs=%zu nblocks=%zu>\n", sp->shape[0], sp->shape[1], B,
+          sp->nblocks);
+  for (size_t I = 0; I < mb; I++)
+    for (size_t k = sp->ptr[I]; k < sp->ptr[I + 1]; k++)
+      for (size_t r = 0; r < B; r++)
+        for (size_t c = 0; c < B; c++)
+          fprintf(stream, "%4zu %4zu % 8.3g\n", I * B + r + 1, sp->idx[k] * B + c + 1,
+                  sp->val[k * B * B + r * B + c]);
+}
+
+void bsr_print(const bsr_t *sp) { bsr_fprint(stdout, sp); }
@@ -1,7 +1,18 @@
+#define _POSIX_C_SOURCE 200809L
 #include "sparse.h"
 #include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define SELL_X86 /* SELL kernels with AVX2/AVX-512 gathers (see sell_kernel) */
+#endif
 
 coo_t *coo_alloc(const size_t shape[2], const size_t capacity)
 /*
@@ -50,6 +61,7 @@ coo_t *coo_alloc(const size_t shape[2], const size_t capacity)
   sp->shape[1] = shape[1];
   sp->capacity = capacity;
   sp->nnz = 0;
+  sp->sym = General;
   sp->rowidx = malloc(capacity * sizeof(*sp->rowidx));
   sp->colidx = malloc(capacity * sizeof(*sp->colidx));
   sp->val = malloc(capacity * sizeof(*sp->val));
@@ -68,12 +80,309 @@ void coo_dealloc(coo_t *sp)
 // Purpose: Deallocates a coo_t.
 {
   if (sp == NULL)
-    free(sp->rowidx);
+    return;
+  free(sp->rowidx);
   free(sp->colidx);
   free(sp->val);
   free(sp);
 }
 
+/* Checks the banner line "%%MatrixMarket matrix coordinate <field> <symmetry>"
+   with field real, integer or pattern, and symmetry general, symmetric or
+   skew-symmetric */
+static int mm_check_banner(const char *line, enum symmetry *sym, int *pattern)
+{
+  char banner[MM_MAX_TOKEN_LENGTH];
+  char mtx[MM_MAX_TOKEN_LENGTH];
+  char crd[MM_MAX_TOKEN_LENGTH];
+  char data_type[MM_MAX_TOKEN_LENGTH];
+  char storage_scheme[MM_MAX_TOKEN_LENGTH];
+
+  if (sscanf(line, "%63s %63s %63s %63s %63s", banner, mtx, crd, data_type, storage_scheme) != 5)
+    return MSP_FAILURE;
+  for (char *p=mtx; *p!='\0'; *p=tolower(*p),p++);  /* convert to lower case */
+  for (char *p=crd; *p!='\0'; *p=tolower(*p),p++);
+  for (char *p=data_type; *p!='\0'; *p=tolower(*p),p++);
+  for (char *p=storage_scheme; *p!='\0'; *p=tolower(*p),p++);
+
+  if ( (strncmp(banner, "%%MatrixMarket", 14) != 0) ||
+       (strcmp(mtx, "matrix") != 0) ||
+       (strcmp(crd, "coordinate") != 0) )
+    return MSP_FAILURE;
+  if (strcmp(data_type, "real") == 0 || strcmp(data_type, "integer") == 0)
+    *pattern = 0;
+  else if (strcmp(data_type, "pattern") == 0)
+    *pattern = 1;
+  else
+  {
+    fprintf(stderr, "%s: unsupported field '%s'\n", __func__, data_type);
+    return MSP_FAILURE;
+  }
+  if (strcmp(storage_scheme, "general") == 0)
+    *sym = General;
+  else if (strcmp(storage_scheme, "symmetric") == 0)
+    *sym = Symmetric;
+  else if (strcmp(storage_scheme, "skew-symmetric") == 0)
+    *sym = SkewSymmetric;
+  else
+  {
+    fprintf(stderr, "%s: unsupported symmetry '%s'\n", __func__, storage_scheme);
+    return MSP_FAILURE;
+  }
+  return MSP_SUCCESS;
+}
+
+/* Matrix Market name of a symmetry */
+static const char *mm_symmetry_name(enum symmetry sym)
+{
+  return (sym == Symmetric) ? "symmetric" : (sym == SkewSymmetric) ? "skew-symmetric" : "general";
+}
+
+/* Checks that a symmetric or skew-symmetric matrix is square */
+static int mm_check_shape(const size_t shape[2], enum symmetry sym)
+{
+  if (sym != General && shape[0] != shape[1])
+  {
+    fprintf(stderr, "%s: a symmetric matrix must be square\n", __func__);
+    return MSP_FAILURE;
+  }
+  return MSP_SUCCESS;
+}
+
+static inline int mm_isspace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; }
+static inline int mm_isdigit(char c) { return c >= '0' && c <= '9'; }
+
+/* Parses an unsigned decimal integer; returns NULL if there is none or if
+   it does not fit in a size_t */
+static const char *mm_parse_size(const char *p, const char *end, size_t *x)
+{
+  if (p == end || !mm_isdigit(*p))
+    return NULL;
+  size_t v = 0;
+  while (p < end && mm_isdigit(*p))
+  {
+    size_t d = (size_t)(*p++ - '0');
+    if (v > (SIZE_MAX - d) / 10)
+      return NULL;
+    v = 10 * v + d;
+  }
+  *x = v;
+  return p;
+}
+
+const char *mm_parse_header(const char *buf, size_t len, size_t shape[2], size_t *nnz, enum symmetry *sym,
+                            int *pattern)
+/*
+  Purpose:
+
+    Parses the banner, the comment lines and the size line of a Matrix
+    Market coordinate file in a memory buffer (which need not be
+    NUL-terminated), with the same validation as coo_from_file.
+
+  Arguments:
+    buf         pointer to the text
+    len         length of the text in bytes
+    shape       row and column dimensions (output)
+    nnz         number of entries (output)
+    sym         General, Symmetric or SkewSymmetric (output)
+    pattern     1 if the entries have no values, 0 otherwise (output)
+
+  Return value:
+    A pointer to the first byte of the data section, or NULL if an error
+    occurs.
+*/
+{
+  if (buf == NULL || shape == NULL || nnz == NULL || sym == NULL || pattern == NULL)
+    return NULL;
+  const char *p = buf, *end = buf + len;
+  char line[MM_MAX_LINE_LENGTH];
+  for (size_t lineno = 0; p < end; lineno++)
+  {
+    const char *eol = memchr(p, '\n', end - p);
+    size_t l = (eol ? eol : end) - p;
+    l = (l < MM_MAX_LINE_LENGTH - 1) ? l : MM_MAX_LINE_LENGTH - 1;
+    memcpy(line, p, l);
+    line[l] = '\0';
+    p = eol ? eol + 1 : end;
+    if (lineno == 0)
+    {
+      if (mm_check_banner(line, sym, pattern) != MSP_SUCCESS)
+        return NULL;
+    }
+    else if (line[0] != '%')
+    {
+      // m, n and nnz (with sscanf, values that overflow a size_t would be undefined)
+      size_t dims[3], k;
+      const char *q = line;
+      for (k = 0; k < 3; k++)
+      {
+        while (q < line + l && mm_isspace(*q))
+          q++;
+        if ((q = mm_parse_size(q, line + l, dims + k)) == NULL)
+          break;
+      }
+      if (k < 3)
+        break;
+      shape[0] = dims[0];
+      shape[1] = dims[1];
+      *nnz = dims[2];
+      return (mm_check_shape(shape, *sym) == MSP_SUCCESS) ? p : NULL;
+    }
+  }
+  fprintf(stderr, "%s: could not read matrix dimensions\n", __func__);
+  return NULL;
+}
+
+/* Powers of ten that are exact in double precision */
+static const double mm_pow10[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* Parses a floating-point number. Numbers with at most 17 significant
+   digits and a decimal exponent of magnitude at most 22 (almost all values
+   in Matrix Market files) are converted with one correctly rounded
+   multiplication or division; everything else (and inf/nan) is passed on
+   to strtod. Returns NULL if there is no number. */
+static const char *mm_parse_double(const char *p, const char *end, double *x)
+{
+  const char *start = p;
+  int neg = 0, ndigits = 0, exp10 = 0, exact = 1;
+  unsigned long long mant = 0;
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = (*p++ == '-');
+  for (; p < end && mm_isdigit(*p); p++, ndigits++)
+  {
+    if (mant < 100000000000000000ULL)
+      mant = 10 * mant + (unsigned long long)(*p - '0');
+    else
+      exp10++, exact &= (*p == '0');
+  }
+  if (p < end && *p == '.')
+    for (p++; p < end && mm_isdigit(*p); p++, ndigits++)
+    {
+      if (mant < 100000000000000000ULL)
+        mant = 10 * mant + (unsigned long long)(*p - '0'), exp10--;
+      else
+        exact &= (*p == '0');
+    }
+  if (ndigits > 0 && p < end && (*p == 'e' || *p == 'E'))
+  {
+    const char *q = p + 1;
+    int eneg = 0, e = 0;
+    if (q < end && (*q == '-' || *q == '+'))
+      eneg = (*q++ == '-');
+    if (q == end || !mm_isdigit(*q))
+      return NULL;
+    for (; q < end && mm_isdigit(*q); q++)
+      e = (e < 10000) ? 10 * e + (*q - '0') : e;
+    exp10 += eneg ? -e : e;
+    p = q;
+  }
+  if (ndigits > 0 && exact && mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22)
+  {
+    double v = (double)mant;
+    v = (exp10 < 0) ? v / mm_pow10[-exp10] : v * mm_pow10[exp10];
+    *x = neg ? -v : v;
+    return p;
+  }
+  /* Slow path: copy the whole token (on the heap if it is longer than a
+     line) and use strtod */
+  const char *tokend = start;
+  while (tokend < end && !mm_isspace(*tokend))
+    tokend++;
+  size_t len = tokend - start;
+  char buf[MM_MAX_LINE_LENGTH], *tok = (len < sizeof(buf)) ? buf : malloc(len + 1);
+  if (tok == NULL)
+    return NULL;
+  memcpy(tok, start, len);
+  tok[len] = '\0';
+  char *tail;
+  *x = strtod(tok, &tail);
+  size_t used = tail - tok;
+  if (tok != buf)
+    free(tok);
+  return (used == 0) ? NULL : start + used;
+}
+
+int mm_parse_entries(const char *buf, size_t len, coo_t *sp, size_t k, size_t count, int pattern, size_t *nread)
+/*
+  Purpose:
+
+    Parses up to count entries "I J A(I,J)" (or "I J" if pattern is
+    nonzero, in which case A(I,J) = 1) of the data section of a Matrix
+    Market coordinate file from a memory buffer (which need not be
+    NUL-terminated) and stores them as entries k, k+1, ... of sp with
+    0-based indices. Integers and most floating-point numbers are parsed
+    without the C library (see coo_from_file). The buffer must end at the
+    end of an entry. If sp->sym is SkewSymmetric, diagonal entries are
+    rejected. This is the kernel of coo_from_file and of readers that
+    split a file into chunks.
+
+  Arguments:
+    buf         pointer to the text
+    len         length of the text in bytes
+    sp          a pointer to a coo_t with capacity at least k+count
+    k           index of the first entry
+    count       maximum number of entries
+    pattern     nonzero if the entries have no values
+    nread       number of entries read (output)
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_ILLEGAL_INPUT if an input is NULL, and
+    MSP_FAILURE if an entry is malformed or has an index out of range.
+*/
+{
+  if (buf == NULL || sp == NULL || nread == NULL)
+    return MSP_ILLEGAL_INPUT;
+  const char *p = buf, *end = buf + len;
+  size_t i, j, n = 0;
+  double v;
+  while (n < count)
+  {
+    while (p < end && mm_isspace(*p))
+      p++;
+    if (p == end)
+      break;
+    if ((p = mm_parse_size(p, end, &i)) == NULL)
+      break;
+    while (p < end && (*p == ' ' || *p == '\t'))
+      p++;
+    if ((p = mm_parse_size(p, end, &j)) == NULL)
+      break;
+    while (p < end && (*p == ' ' || *p == '\t'))
+      p++;
+    if (pattern)
+      v = 1.0;
+    else if ((p = mm_parse_double(p, end, &v)) == NULL)
+      break;
+    if (p < end && !mm_isspace(*p))
+      break;
+    if (i < 1 || i > sp->shape[0] || j < 1 || j > sp->shape[1])
+    {
+      fprintf(stderr, "%s: index (%zu,%zu) out of range\n", __func__, i, j);
+      *nread = n;
+      return MSP_FAILURE;
+    }
+    if (i == j && sp->sym == SkewSymmetric)
+    {
+      fprintf(stderr, "%s: diagonal entry (%zu,%zu) in a skew-symmetric matrix\n", __func__, i, j);
+      *nread = n;
+      return MSP_FAILURE;
+    }
+    sp->rowidx[k + n] = i - 1;
+    sp->colidx[k + n] = j - 1;
+    sp->val[k + n] = v;
+    n++;
+  }
+  *nread = n;
+  if (n < count && p != end)
+  {
+    fprintf(stderr, "%s: could not read triplet\n", __func__);
+    return MSP_FAILURE;
+  }
+  return MSP_SUCCESS;
+}
+
 /* coo_from_file
   Purpose:
 
@@ -93,6 +402,19 @@ void coo_dealloc(coo_t *sp)
    |    IL JL  A(IL, JL)                          | <--+
    +----------------------------------------------+
 
+    The field may be real, integer (read as doubles) or pattern (lines
+    "I J", all values 1), and the symmetry general, symmetric or
+    skew-symmetric. A symmetric or skew-symmetric matrix keeps its
+    symmetry in sp->sym and only the entries of the file (one triangle,
+    A(J,I) = A(I,J) or A(J,I) = -A(I,J) is implied); coo_expand stores
+    both triangles, as does csp_from_coo, and csp_half_from_coo compresses
+    the lower triangle.
+
+    The entries are read in blocks of MM_BLOCK_SIZE bytes and parsed by
+    mm_parse_entries, which converts integers and most floating-point
+    numbers without fscanf/strtod. Entries with indices outside of the
+    dimensions are rejected. See also coo_from_file_parallel.
+
   Arguments:
     filename   string with filename
 
@@ -102,13 +424,9 @@ void coo_dealloc(coo_t *sp)
 coo_t *coo_from_file(const char *filename)
 {
   char buf[MM_MAX_LINE_LENGTH];
-  char banner[MM_MAX_TOKEN_LENGTH];
-  char mtx[MM_MAX_TOKEN_LENGTH]; 
-  char crd[MM_MAX_TOKEN_LENGTH];
-  char data_type[MM_MAX_TOKEN_LENGTH];
-  char storage_scheme[MM_MAX_TOKEN_LENGTH];
-
   size_t m, n, nnz;
+  enum symmetry sym;
+  int pattern;
   /* Open file and read dimensions */
   FILE *fp = fopen(filename, "r");
   if (fp == NULL)
@@ -121,63 +439,122 @@ coo_t *coo_from_file(const char *filename)
 
   /* Read banner/header line */
   char *line = fgets(buf, MM_MAX_LINE_LENGTH, fp);
-  if (line == NULL || sscanf(line, "%s %s %s %s %s", banner, mtx, crd, data_type, storage_scheme) != 5) 
+  if (line == NULL || mm_check_banner(line, &sym, &pattern) != MSP_SUCCESS)
   {
     fclose(fp);
     return NULL;
   }
-  for (char *p=mtx; *p!='\0'; *p=tolower(*p),p++);  /* convert to lower case */
-  for (char *p=crd; *p!='\0'; *p=tolower(*p),p++);  
-  for (char *p=data_type; *p!='\0'; *p=tolower(*p),p++);
-  for (char *p=storage_scheme; *p!='\0'; *p=tolower(*p),p++);
-
-  if ( (strncmp(banner, "%%MatrixMarket", 14) != 0) || 
-       (strncmp(mtx, "matrix", 6) != 0) || 
-       (strncmp(crd, "coordinate", 10) != 0) || 
-       (strncmp(data_type, "real", 4) != 0) ||
-       (strncmp(storage_scheme, "general", 7) != 0) ) {
-    fclose(fp);
-    return NULL;
-  }
   /* Skip comment lines */
   while ((line = fgets(buf, MM_MAX_LINE_LENGTH, fp)) && strncmp(line, "%", 1) == 0)
     continue;
-  if (sscanf(line, "%zu %zu %zu", &m, &n, &nnz) != 3)
+  if (line == NULL || sscanf(line, "%zu %zu %zu", &m, &n, &nnz) != 3)
   {
     fprintf(stderr, "%s: could not read matrix dimensions\n", __func__);
     fclose(fp);
     return NULL;
   }
-  /* Allocate sparse_triplet structure */
+  if (mm_check_shape((size_t[]){m, n}, sym) != MSP_SUCCESS)
+  {
+    fclose(fp);
+    return NULL;
+  }
+  /* Allocate sparse_triplet structure and read buffer */
   coo_t *sp = coo_alloc((size_t[]){m, n}, nnz);
-  if (sp == NULL)
+  char *block = malloc(MM_BLOCK_SIZE);
+  if (sp != NULL)
+    sp->sym = sym;
+  if (sp == NULL || block == NULL)
   {
+#ifndef NDEBUG
+    if (block == NULL)
+      MEM_ERR;
+#endif
+    free(block);
+    coo_dealloc(sp);
     fclose(fp);
     return NULL;
   }
-  /* Read triplets and subtract 1 from indices */
-  for (size_t i = 0; i < nnz; i++)
+  /* Read blocks, parse the complete lines and carry the rest over */
+  size_t k = 0, have = 0, nread;
+  int status = MSP_SUCCESS;
+  while (k < nnz && status == MSP_SUCCESS)
   {
-    if (3 == fscanf(fp, "%zu %zu %lf", sp->rowidx + i, sp->colidx + i,
-                    sp->val + i))
+    size_t len = have + fread(block + have, 1, MM_BLOCK_SIZE - have, fp), cut = len;
+    int last = (len < MM_BLOCK_SIZE);
+    if (!last)
     {
-      sp->rowidx[i]--;
-      sp->colidx[i]--;
+      while (cut > 0 && block[cut - 1] != '\n')
+        cut--;
+      if (cut == 0)
+      {
+        fprintf(stderr, "%s: line too long\n", __func__);
+        status = MSP_FAILURE;
+        break;
+      }
     }
-    else
-    {
+    status = mm_parse_entries(block, cut, sp, k, nnz - k, pattern, &nread);
+    k += nread;
+    have = len - cut;
+    memmove(block, block + cut, have);
+    if (last)
+      break;
+  }
+  free(block);
+  fclose(fp);
+  if (status != MSP_SUCCESS || k < nnz)
+  {
+    if (status == MSP_SUCCESS)
       fprintf(stderr, "%s: could not read triplet\n", __func__);
-      fclose(fp);
-      coo_dealloc(sp);
-      return NULL;
-    }
+    coo_dealloc(sp);
+    return NULL;
   }
   sp->nnz = nnz;
-  /* Close file and return pointer to coo_t */
-  fclose(fp);
   return sp;
 }
 
+coo_t *coo_expand(const coo_t *sp)
+/*
+  Purpose:
+
+    Expands a symmetric or skew-symmetric sparse matrix in COO format, of
+    which only one triangle is stored, to a general one: every
+    off-diagonal entry A(i,j) is complemented by A(j,i) = A(i,j) (or
+    -A(i,j) if skew-symmetric). A general matrix is copied.
+
+  Arguments:
+    sp          a pointer to a coo_t
+
+  Return value:
+    A pointer to a coo_t, or NULL if an error occurs.
+*/
+{
+  if (sp == NULL)
+    return NULL;
+  size_t nnz = sp->nnz;
+  if (sp->sym != General)
+    for (size_t k = 0; k < sp->nnz; k++)
+      nnz += (sp->rowidx[k] != sp->colidx[k]);
+  coo_t *full = coo_alloc(sp->shape, nnz);
+  if (full == NULL)
+    return NULL;
+  double s = (sp->sym == SkewSymmetric) ? -1.0 : 1.0;
+  size_t l = 0;
+  for (size_t k = 0; k < sp->nnz; k++)
+  {
+    full->rowidx[l] = sp->rowidx[k];
+    full->colidx[l] = sp->colidx[k];
+    full->val[l++] = sp->val[k];
+    if (sp->sym != General && sp->rowidx[k] != sp->colidx[k])
+    {
+      full->rowidx[l] = sp->colidx[k];
+      full->colidx[l] = sp->rowidx[k];
+      full->val[l++] = s * sp->val[k];
+    }
+  }
+  full->nnz = l;
+  return full;
+}
+
 /* coo_to_file
   Purpose:
 
@@ -197,6 +574,9 @@ coo_t *coo_from_file(const char *filename)
    |    IL JL  A(IL, JL)                          | <--+
    +----------------------------------------------+
 
+    A symmetric or skew-symmetric sp is written with that symmetry
+    qualifier instead of general.
+
   Arguments:
     filename   string with filename
     sp         pointer to coo_t
@@ -224,7 +604,7 @@ int coo_to_file(const char *filename, const coo_t *sp)
     return MSP_FILE_ERR;
   }
   /* Write sparse_triplet structure to file */
-  fprintf(fp, "%%%%MatrixMarket matrix coordinate real general\n");
+  fprintf(fp, "%%%%MatrixMarket matrix coordinate real %s\n", mm_symmetry_name(sp->sym));
   fprintf(fp, "%zu %zu %zu\n", sp->shape[0], sp->shape[1], sp->nnz);
   for (size_t i = 0; i < sp->nnz; i++)
     fprintf(fp, "%zu %zu %.17g\n", sp->rowidx[i] + 1, sp->colidx[i] + 1, sp->val[i]);
@@ -248,7 +628,8 @@ void coo_fprint(FILE *stream, const coo_t *sp)
 {
   if (sp == NULL)
     return;
-  fprintf(stream, "<coo_t shape=(%zu,%zu) nnz=%zu>\n", sp->shape[0], sp->shape[1], sp->nnz);
+  fprintf(stream, "<coo_t shape=(%zu,%zu) nnz=%zu%s>\n", sp->shape[0], sp->shape[1], sp->nnz,
+          (sp->sym == Symmetric) ? " symmetric" : (sp->sym == SkewSymmetric) ? " skew-symmetric" : "");
   for (size_t i = 0; i < sp->nnz; i++)
     fprintf(stream, "%4zu %4zu % 8.3g\n", sp->rowidx[i] + 1, sp->colidx[i] + 1, sp->val[i]);
 }
@@ -280,12 +661,17 @@ csp_t *csp_alloc(const size_t shape[2], const size_t nnz, enum cstype csx)
   Arguments:
     shape      array with row and column dimensions
     nnz        number of nonzero elements
-    csx        CSC or CSR
+    csx        CSC or CSR (see csp_sell_from_coo for SELL)
 
   Return value:
     A pointer to a csp_t, or NULL if an error occurs.
 */
 {
+  if (csx == SELL)
+  {
+    fprintf(stderr, "%s: use csp_sell_from_coo or csp_sell_from_csp for SELL\n", __func__);
+    return NULL;
+  }
   csp_t *sp = malloc(sizeof(*sp));
   if (sp == NULL) {
 #ifndef NDEBUG
@@ -297,6 +683,15 @@ csp_t *csp_alloc(const size_t shape[2], const size_t nnz, enum cstype csx)
   sp->shape[0] = shape[0];
   sp->shape[1] = shape[1];
   sp->csx = csx;
+  sp->sym = General;
+  sp->chunk = 0;
+  sp->sigma = 0;
+  sp->nnz = nnz;
+  sp->perm = NULL;
+  sp->canonical = 0;
+  sp->readonly = 0;
+  sp->map = NULL;
+  sp->mapsize = 0;
   sp->idx = malloc(nnz * sizeof(*(sp->idx)));
   sp->ptr = malloc((N + 1) * sizeof(*(sp->ptr)));
   sp->val = malloc(nnz * sizeof(*(sp->val)));
@@ -314,22 +709,51 @@ csp_t *csp_alloc(const size_t shape[2], const size_t nnz, enum cstype csx)
 }
 
 void csp_dealloc(csp_t *sp)
-// Purpose: Deallocates a csp_t.
+// Purpose: Deallocates a csp_t (and unmaps its arrays if they are mapped from a file).
 {
   if (sp == NULL)
     return;
+  if (sp->map != NULL)
+  {
+    // ptr, idx, val and perm point into the mapping
+    munmap(sp->map, sp->mapsize);
+    free(sp);
+    return;
+  }
   free(sp->idx);
   free(sp->ptr);
   free(sp->val);
+  free(sp->perm);
   free(sp);
 }
 
+/* Checks that a symmetric or skew-symmetric sp can be compressed in half
+   storage: it must be square, and a skew-symmetric one has no diagonal */
+static int csp_check_half(const coo_t *sp)
+{
+  if (mm_check_shape(sp->shape, sp->sym) != MSP_SUCCESS)
+    return MSP_FAILURE;
+  for (size_t k = 0; sp->sym == SkewSymmetric && k < sp->nnz; k++)
+    if (sp->rowidx[k] == sp->colidx[k])
+    {
+      fprintf(stderr, "%s: diagonal entry in a skew-symmetric matrix\n", __func__);
+      return MSP_FAILURE;
+    }
+  return MSP_SUCCESS;
+}
+
+static csp_t *csp_compress(const coo_t *sp, enum cstype csx);
+static csp_t *csp_compress_canonical(const coo_t *sp, enum cstype csx);
+
 csp_t *csp_from_coo(const coo_t *sp, enum cstype csx)
 /*
   Purpose:
 
     Compresses a sparse matrix in the coordinate format to a compressed
-    sparse matrix. The row indices are not sorted. 
+    sparse matrix. The row indices are not sorted, and duplicate entries
+    are kept (see csp_canonical_from_coo). A symmetric or skew-symmetric
+    sp is expanded (see coo_expand), so the result always stores both
+    triangles and is General; csp_half_from_coo compresses only one.
 
   Example:
 
@@ -344,6 +768,8 @@ csp_t *csp_from_coo(const coo_t *sp, enum cstype csx)
 
   Arguments:
     sp          a pointer to a coo_t
+    csx         CSC, CSR or SELL (with chunk height SELL_CHUNK and sorting
+                window SELL_SIGMA, see csp_sell_from_coo)
 
   Return value:
     A pointer to a csp_t, or NULL if an error occurs.
@@ -351,11 +777,64 @@ csp_t *csp_from_coo(const coo_t *sp, enum cstype csx)
 {
   if (sp == NULL)
     return NULL; /* Check input */
+  if (sp->sym != General)
+  {
+    if (csp_check_half(sp) != MSP_SUCCESS)
+      return NULL;
+    coo_t *full = coo_expand(sp);
+    csp_t *csp = full ? csp_from_coo(full, csx) : NULL;
+    coo_dealloc(full);
+    return csp;
+  }
+  if (csx == SELL)
+    return csp_sell_from_coo(sp, SELL_CHUNK, SELL_SIGMA);
+  return csp_compress(sp, csx);
+}
+
+csp_t *csp_half_from_coo(const coo_t *sp, enum cstype csx, int canonical)
+/*
+  Purpose:
+
+    Compresses a symmetric or skew-symmetric sparse matrix in half
+    storage: only the lower triangle is stored, entries in the upper
+    triangle are moved to it (A(i,j) with i < j becomes A(j,i) = A(i,j) or
+    -A(i,j)), and the result has the symmetry of sp. csp_spmv and
+    csp_spmv_t then use every stored entry twice, which halves the memory
+    traffic for the matrix. sp must not contain both A(i,j) and A(j,i)
+    (nor diagonal entries if skew-symmetric). If canonical is nonzero, the
+    indices are sorted and duplicates summed as in csp_canonical_from_coo.
+
+  Arguments:
+    sp          a pointer to a symmetric or skew-symmetric coo_t
+    csx         CSC or CSR
+    canonical   nonzero for a canonical result
+
+  Return value:
+    A pointer to a csp_t, or NULL if an error occurs.
+*/
+{
+  if (sp == NULL || csx == SELL)
+    return NULL;
+  if (sp->sym == General)
+  {
+    fprintf(stderr, "%s: half storage needs a symmetric or skew-symmetric matrix\n", __func__);
+    return NULL;
+  }
+  if (csp_check_half(sp) != MSP_SUCCESS)
+    return NULL;
+  return canonical ? csp_compress_canonical(sp, csx) : csp_compress(sp, csx);
+}
+
+/* CSC or CSR compression of sp (the lower triangle in half storage if sp
+   is symmetric or skew-symmetric, which csp_check_half has accepted) */
+static csp_t *csp_compress(const coo_t *sp, enum cstype csx)
+{
 
   /* Allocate output */
   csp_t *csp = csp_alloc(sp->shape, sp->nnz, csx);
   if (csp == NULL)
     return NULL;
+  csp->sym = sp->sym;
   /* Allocate workspace */
   size_t N = (csx == CSC) ? sp->shape[1] : sp->shape[0];
   size_t *ws = calloc(N, sizeof(*ws));
@@ -367,11 +846,14 @@ csp_t *csp_from_coo(const coo_t *sp, enum cstype csx)
     csp_dealloc(csp);
     return NULL;
   }
-  /* Compute column counts */
+  /* Compute column counts (lower triangle if symmetric) */
   size_t *spidx = (csx == CSC) ? sp->colidx : sp->rowidx;
   size_t *spidx_other = (csx == CSC) ? sp->rowidx : sp->colidx;
   for (size_t k = 0; k < sp->nnz; k++)
-    ws[spidx[k]]++;
+  {
+    int flip = (sp->sym != General && sp->rowidx[k] < sp->colidx[k]); /* upper triangle */
+    ws[flip ? spidx_other[k] : spidx[k]]++;
+  }
   /* Compute ptr array (store copy in ws)*/
   size_t nz = 0;
   for (size_t k = 0; k < N; k++)
@@ -382,52 +864,1058 @@ csp_t *csp_from_coo(const coo_t *sp, enum cstype csx)
   }
   csp->ptr[N] = nz;
   /* Copy row indices and values */
+  double s = (sp->sym == SkewSymmetric) ? -1.0 : 1.0;
   size_t j = 0;
   for (size_t k = 0; k < sp->nnz; k++)
   {
-    csp->idx[j = ws[spidx[k]]++] = spidx_other[k];
-    csp->val[j] = sp->val[k];
+    if (sp->sym != General && sp->rowidx[k] < sp->colidx[k])
+    {
+      csp->idx[j = ws[spidx_other[k]]++] = spidx[k];
+      csp->val[j] = s * sp->val[k];
+    }
+    else
+    {
+      csp->idx[j = ws[spidx[k]]++] = spidx_other[k];
+      csp->val[j] = sp->val[k];
+    }
   }
   /* Free workspace and return */
   free(ws);
   return csp;
 }
 
-void csp_fprint(FILE *stream, const csp_t *sp)
+csp_t *csp_canonical_from_coo(const coo_t *sp, enum cstype csx)
 /*
   Purpose:
 
-    Prints a sparse matrix in CSC/CSR format
+    Compresses a sparse matrix in the coordinate format to a canonical
+    compressed sparse matrix (CSC or CSR): the indices are sorted in
+    increasing order within each column (CSC) or row (CSR), and duplicate
+    entries are summed, so every index occurs at most once. Entries that
+    sum to zero are kept. The result has canonical set, which allows
+    binary searches within a row or column and faster kernels (e.g. the
+    diagonal entry is the last one of each row of a symmetric CSR
+    matrix in half storage, see csp_half_from_coo). A symmetric or
+    skew-symmetric sp is expanded as in csp_from_coo.
+
+    The conversion takes O(nnz + m + n) time without comparison sorting:
+    a counting sort by the inner index (the transpose) followed by a
+    stable counting sort by the outer index, and one pass that sums the
+    now adjacent duplicates.
 
   Arguments:
-    stream       a pointer to a file stream
-    sp           a pointer to a csp_t
+    sp          a pointer to a coo_t
+    csx         CSC or CSR
 
   Return value:
-    None
+    A pointer to a csp_t, or NULL if an error occurs.
 */
 {
-  if (sp == NULL)
-    return;
-  size_t N = (sp->csx == CSC) ? sp->shape[1] : sp->shape[0];
-  fprintf(stream, "<csp_t %s shape=(%zu,%zu) nnz=%zu>\n",
-          (sp->csx == CSC) ? "csc" : "csr", sp->shape[0], sp->shape[1], sp->ptr[N]);
-  if (sp->csx == CSC)
+  if (sp == NULL || csx == SELL)
+    return NULL;
+  if (sp->sym != General)
   {
-    for (size_t k = 0; k < N; k++)
+    if (csp_check_half(sp) != MSP_SUCCESS)
+      return NULL;
+    coo_t *full = coo_expand(sp);
+    csp_t *csp = full ? csp_compress_canonical(full, csx) : NULL;
+    coo_dealloc(full);
+    return csp;
+  }
+  return csp_compress_canonical(sp, csx);
+}
+
+/* Canonical CSC or CSR compression of sp (see csp_canonical_from_coo; the
+   lower triangle in half storage if sp is symmetric or skew-symmetric) */
+static csp_t *csp_compress_canonical(const coo_t *sp, enum cstype csx)
+{
+  size_t N = (csx == CSC) ? sp->shape[1] : sp->shape[0];
+  size_t M = (csx == CSC) ? sp->shape[0] : sp->shape[1], nnz = sp->nnz;
+  const size_t *spidx = (csx == CSC) ? sp->colidx : sp->rowidx;
+  const size_t *spidx_other = (csx == CSC) ? sp->rowidx : sp->colidx;
+  double s = (sp->sym == SkewSymmetric) ? -1.0 : 1.0;
+
+  csp_t *csp = csp_alloc(sp->shape, nnz, csx);
+  size_t *qptr = calloc(M + 1, sizeof(*qptr)), *ws = calloc(N + 1, sizeof(*ws));
+  size_t *to = malloc((nnz ? nnz : 1) * sizeof(*to));
+  double *tv = malloc((nnz ? nnz : 1) * sizeof(*tv));
+  if (csp == NULL || qptr == NULL || ws == NULL || to == NULL || tv == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    csp_dealloc(csp);
+    free(qptr);
+    free(ws);
+    free(to);
+    free(tv);
+    return NULL;
+  }
+  csp->sym = sp->sym;
+
+  /* Pass 1: counting sort by inner index q (entries in the upper triangle
+     of a symmetric matrix are mirrored) */
+  for (size_t k = 0; k < nnz; k++)
+  {
+    int flip = (sp->sym != General && sp->rowidx[k] < sp->colidx[k]);
+    qptr[(flip ? spidx[k] : spidx_other[k]) + 1]++;
+  }
+  for (size_t q = 0; q < M; q++)
+    qptr[q + 1] += qptr[q];
+  for (size_t k = 0; k < nnz; k++)
+  {
+    int flip = (sp->sym != General && sp->rowidx[k] < sp->colidx[k]);
+    size_t o = flip ? spidx_other[k] : spidx[k], q = flip ? spidx[k] : spidx_other[k];
+    to[qptr[q]] = o;
+    tv[qptr[q]++] = flip ? s * sp->val[k] : sp->val[k];
+  }
+  /* qptr[q] is now the end of bucket q (and the start of bucket q+1) */
+
+  /* Pass 2: stable counting sort by outer index o, visiting q in order */
+  for (size_t l = 0; l < nnz; l++)
+    ws[to[l] + 1]++;
+  for (size_t o = 0; o < N; o++)
+    ws[o + 1] += ws[o];
+  memcpy(csp->ptr, ws, (N + 1) * sizeof(*ws));
+  for (size_t q = 0, l = 0; q < M; q++)
+    for (; l < qptr[q]; l++)
     {
-      for (size_t i = sp->ptr[k]; i < sp->ptr[k + 1]; i++)
-        fprintf(stream, "%4zu %4zu % 8.3g\n", sp->idx[i]+1, k+1, sp->val[i]);
+      size_t j = ws[to[l]]++;
+      csp->idx[j] = q;
+      csp->val[j] = tv[l];
     }
-  }
-  else
+
+  /* Pass 3: sum duplicates (adjacent within each column/row) */
+  size_t nz = 0;
+  for (size_t o = 0; o < N; o++)
   {
-    for (size_t k = 0; k < N; k++)
+    size_t start = nz, end = csp->ptr[o + 1];
+    for (size_t k = csp->ptr[o]; k < end; k++)
     {
-      for (size_t i = sp->ptr[k]; i < sp->ptr[k + 1]; i++)
-        fprintf(stream, "%4zu %4zu % 8.3g\n", k+1, sp->idx[i]+1, sp->val[i]);
+      if (nz > start && csp->idx[nz - 1] == csp->idx[k])
+        csp->val[nz - 1] += csp->val[k];
+      else
+      {
+        csp->idx[nz] = csp->idx[k];
+        csp->val[nz++] = csp->val[k];
+      }
     }
+    csp->ptr[o] = start;
   }
+  csp->ptr[N] = nz;
+  csp->nnz = nz;
+  csp->canonical = 1;
+  free(qptr);
+  free(ws);
+  free(to);
+  free(tv);
+  return csp;
 }
 
-void csp_print(const csp_t *sp) { csp_fprint(stdout, sp); }
+typedef struct sell_row /* row length and row index (SELL sorting) */
+{
+  size_t len;
+  size_t row;
+} sell_row_t;
+
+static int sell_row_cmp(const void *a, const void *b)
+{
+  const sell_row_t *ra = a, *rb = b;
+  if (ra->len != rb->len)
+    return (ra->len < rb->len) ? 1 : -1; /* longest rows first */
+  return (ra->row > rb->row) - (ra->row < rb->row);
+}
+
+/* Allocates a SELL matrix for the given row lengths: sorts the rows by
+   length within windows of sigma rows, sets perm and the chunk pointers,
+   and returns the position of every row in pos (pos[i] = k if perm[k] = i) */
+static csp_t *sell_layout(const size_t shape[2], const size_t *rowlen, size_t chunk, size_t sigma, size_t *pos)
+{
+  size_t m = shape[0], nchunks = (m + chunk - 1) / chunk;
+  sell_row_t *rows = malloc((m ? m : 1) * sizeof(*rows));
+  if (rows == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  for (size_t i = 0; i < m; i++)
+    rows[i] = (sell_row_t){rowlen[i], i};
+  for (size_t i = 0; i < m; i += sigma)
+    qsort(rows + i, (m - i < sigma) ? m - i : sigma, sizeof(*rows), sell_row_cmp);
+  /* Chunk widths (the longest row of each chunk) */
+  size_t total = 0;
+  for (size_t c = 0; c < nchunks; c++)
+  {
+    size_t width = 0;
+    for (size_t k = c * chunk; k < (c + 1) * chunk && k < m; k++)
+      width = (rows[k].len > width) ? rows[k].len : width;
+    total += width * chunk;
+  }
+  csp_t *A = csp_alloc(shape, total ? total : 1, CSR);
+  size_t *perm = malloc((m ? m : 1) * sizeof(*perm));
+  if (A == NULL || perm == NULL)
+  {
+    free(rows);
+    free(perm);
+    csp_dealloc(A);
+    return NULL;
+  }
+  A->csx = SELL;
+  A->chunk = chunk;
+  A->sigma = sigma;
+  A->perm = perm;
+  A->ptr[0] = 0;
+  for (size_t c = 0; c < nchunks; c++)
+  {
+    size_t width = 0;
+    for (size_t k = c * chunk; k < (c + 1) * chunk && k < m; k++)
+      width = (rows[k].len > width) ? rows[k].len : width;
+    A->ptr[c + 1] = A->ptr[c] + width * chunk;
+  }
+  for (size_t k = 0; k < m; k++)
+  {
+    perm[k] = rows[k].row;
+    pos[rows[k].row] = k;
+  }
+  free(rows);
+  return A;
+}
+
+/* Fills the padding of every row with zeros (and a valid column index) */
+static void sell_pad(csp_t *A, const size_t *fill)
+{
+  size_t m = A->shape[0], C = A->chunk, nchunks = (m + C - 1) / C;
+  for (size_t c = 0; c < nchunks; c++)
+  {
+    size_t width = (A->ptr[c + 1] - A->ptr[c]) / C;
+    for (size_t r = 0; r < C; r++)
+    {
+      size_t k = c * C + r, len = (k < m) ? fill[A->perm[k]] : 0;
+      size_t j = (len > 0) ? A->idx[A->ptr[c] + (len - 1) * C + r] : 0;
+      for (size_t l = len; l < width; l++)
+      {
+        A->idx[A->ptr[c] + l * C + r] = j;
+        A->val[A->ptr[c] + l * C + r] = 0.0;
+      }
+    }
+  }
+}
+
+/* Stores the entry (i, j, v) as the next element of row i */
+static inline void sell_put(csp_t *A, const size_t *pos, size_t *fill, size_t i, size_t j, double v)
+{
+  size_t k = pos[i], C = A->chunk;
+  size_t e = A->ptr[k / C] + fill[i]++ * C + k % C;
+  A->idx[e] = j;
+  A->val[e] = v;
+}
+
+/* Checks the SELL parameters and allocates the row workspaces */
+static size_t *sell_workspace(size_t m, size_t chunk, size_t sigma)
+{
+  if (chunk == 0 || sigma == 0)
+  {
+    fprintf(stderr, "%s: chunk and sigma must be positive\n", __func__);
+    return NULL;
+  }
+  size_t *ws = calloc(2 * (m ? m : 1), sizeof(*ws));
+  if (ws == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+  }
+  return ws;
+}
+
+csp_t *csp_sell_from_coo(const coo_t *sp, size_t chunk, size_t sigma)
+/*
+  Purpose:
+
+    Converts a sparse matrix in the coordinate format to the SELL-C-sigma
+    (sliced ELLPACK) format. The rows are sorted by decreasing length
+    within windows of sigma consecutive rows, and grouped into chunks of
+    `chunk` rows. Each chunk is stored as a dense chunk-by-width block in
+    column-major order, where width is the length of its longest row, and
+    shorter rows are padded with zeros. Row k of the chunks is row
+    perm[k] of the matrix.
+
+    A chunk height that matches the SIMD width (e.g. 4 for AVX2 or 8 for
+    AVX-512) lets csp_spmv process the rows of a chunk in SIMD lanes. A
+    larger sigma reduces the padding (sigma = 1 is plain sliced ELLPACK,
+    sigma = m sorts all rows) but scatters the accesses to y. The padding
+    is A->ptr[nchunks] - A->nnz elements.
+
+  Example:
+
+    ```c
+    coo_t *sp = coo_from_file("A.mtx");
+    csp_t *A = csp_sell_from_coo(sp, 8, 256);
+    coo_dealloc(sp);
+    // .. csp_spmv(1.0, A, x, 0.0, y) ..
+    csp_dealloc(A);
+    ```
+
+  Arguments:
+    sp          a pointer to a coo_t
+    chunk       chunk height C (rows per chunk)
+    sigma       sorting window (rows)
+
+  Return value:
+    A pointer to a csp_t, or NULL if an error occurs.
+*/
+{
+  if (sp == NULL)
+    return NULL;
+  if (sp->sym != General)
+  {
+    fprintf(stderr, "%s: expand a symmetric matrix with coo_expand first\n", __func__);
+    return NULL;
+  }
+  size_t m = sp->shape[0];
+  size_t *ws = sell_workspace(m, chunk, sigma), *pos = ws, *fill = ws + m;
+  if (ws == NULL)
+    return NULL;
+  for (size_t k = 0; k < sp->nnz; k++)
+    fill[sp->rowidx[k]]++;
+  csp_t *A = sell_layout(sp->shape, fill, chunk, sigma, pos);
+  if (A != NULL)
+  {
+    memset(fill, 0, m * sizeof(*fill));
+    for (size_t k = 0; k < sp->nnz; k++)
+      sell_put(A, pos, fill, sp->rowidx[k], sp->colidx[k], sp->val[k]);
+    sell_pad(A, fill);
+    A->nnz = sp->nnz;
+  }
+  free(ws);
+  return A;
+}
+
+csp_t *csp_sell_from_csp(const csp_t *A, size_t chunk, size_t sigma)
+/*
+  Purpose:
+
+    Converts a compressed sparse matrix (CSC or CSR, general) to the
+    SELL-C-sigma format (see csp_sell_from_coo).
+
+  Arguments:
+    A           a pointer to a csp_t (CSC or CSR)
+    chunk       chunk height C (rows per chunk)
+    sigma       sorting window (rows)
+
+  Return value:
+    A pointer to a csp_t, or NULL if an error occurs.
+*/
+{
+  if (A == NULL || A->csx == SELL)
+    return NULL;
+  if (A->sym != General)
+  {
+    fprintf(stderr, "%s: expand a symmetric matrix with coo_expand first\n", __func__);
+    return NULL;
+  }
+  size_t m = A->shape[0], N = (A->csx == CSC) ? A->shape[1] : m;
+  size_t *ws = sell_workspace(m, chunk, sigma), *pos = ws, *fill = ws + m;
+  if (ws == NULL)
+    return NULL;
+  for (size_t k = 0; k < N; k++)
+    for (size_t l = A->ptr[k]; l < A->ptr[k + 1]; l++)
+      fill[(A->csx == CSC) ? A->idx[l] : k]++;
+  csp_t *S = sell_layout(A->shape, fill, chunk, sigma, pos);
+  if (S != NULL)
+  {
+    memset(fill, 0, m * sizeof(*fill));
+    for (size_t k = 0; k < N; k++)
+      for (size_t l = A->ptr[k]; l < A->ptr[k + 1]; l++)
+      {
+        if (A->csx == CSC)
+          sell_put(S, pos, fill, A->idx[l], k, A->val[l]);
+        else
+          sell_put(S, pos, fill, k, A->idx[l], A->val[l]);
+      }
+    sell_pad(S, fill);
+    S->nnz = A->ptr[N];
+  }
+  free(ws);
+  return S;
+}
+
+#define CSP_BINARY_MAGIC "MSPCSP"
+#define CSP_BINARY_VERSION 2
+#define CSP_BINARY_BYTEORDER 0x0102030405060708ULL
+
+typedef struct csp_binary_header /* header of a csp_to_binary file (256 bytes) */
+{
+  char magic[8];
+  uint64_t version;
+  uint64_t byteorder; // CSP_BINARY_BYTEORDER in the byte order of the writer
+  uint64_t intsize;   // sizeof(size_t) of the writer
+  uint64_t shape[2];
+  uint64_t csx;
+  uint64_t sym;
+  uint64_t chunk;
+  uint64_t sigma;
+  uint64_t nnz;
+  uint64_t canonical;
+  uint64_t len[4];    // number of elements of the ptr, idx, val and perm sections
+  uint64_t offset[4]; // byte offsets of the sections (multiples of CSP_BINARY_ALIGN)
+  uint64_t checksum;  // of the sections (see csp_hash)
+  uint64_t hdrsum;    // of the header up to this field
+  uint64_t reserved[10];
+} csp_binary_header_t;
+
+/* The header must keep its documented size of 256 bytes */
+typedef char csp_binary_header_size_check[(sizeof(csp_binary_header_t) == 256) ? 1 : -1];
+
+static inline uint64_t csp_rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t csp_fmix(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+/* 64-bit checksum of n bytes, seeded with h (e.g. the checksum of the
+   previous section). Four independent multiply-rotate lanes over 8-byte
+   words keep up with the memory bandwidth. Not cryptographic. */
+static uint64_t csp_hash(const void *buf, size_t n, uint64_t h)
+{
+  const uint64_t c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+  const unsigned char *p = buf;
+  if (n == 0)
+    return h;
+  uint64_t lane[4] = {h, h ^ c1, h ^ c2, h + c1 + c2}, w = 0;
+  size_t k = 0;
+  for (; k + 32 <= n; k += 32)
+    for (int l = 0; l < 4; l++)
+    {
+      memcpy(&w, p + k + 8 * l, 8);
+      lane[l] = csp_rotl(lane[l] ^ (w * c1), 31) * c2;
+    }
+  for (; k + 8 <= n; k += 8)
+  {
+    memcpy(&w, p + k, 8);
+    lane[0] = csp_rotl(lane[0] ^ (w * c1), 31) * c2;
+  }
+  w = 0;
+  memcpy(&w, p + k, n - k);
+  lane[1] ^= csp_fmix(w ^ n);
+  return csp_fmix(lane[0] ^ csp_rotl(lane[1], 17) ^ csp_rotl(lane[2], 31) ^ csp_rotl(lane[3], 47));
+}
+
+/* Offset of the first multiple of CSP_BINARY_ALIGN at or after k */
+static inline uint64_t csp_align(uint64_t k) { return (k + CSP_BINARY_ALIGN - 1) / CSP_BINARY_ALIGN * CSP_BINARY_ALIGN; }
+
+int csp_to_binary(const char *filename, const csp_t *A)
+/*
+  Purpose:
+
+    Writes a compressed sparse matrix (CSC, CSR or SELL, including half
+    storage) to a binary file that csp_from_binary can map into memory
+    without parsing or copying. The file consists of a 256-byte header
+    (format version, byte order, integer size, shape and format of A, the
+    sections, and checksums of the header and of the data) followed by the
+    ptr, idx, val and perm arrays as stored in memory, each starting at a
+    multiple of CSP_BINARY_ALIGN bytes (a page). The file can only be read
+    on machines with the same byte order and size of size_t.
+
+  Example:
+
+    ```c
+    coo_t *sp = coo_from_file("A.mtx");     // slow: parse text once
+    csp_t *A = csp_from_coo(sp, CSR);
+    csp_to_binary("A.csp", A);
+    // .. later runs ..
+    csp_t *B = csp_from_binary("A.csp", 0); // fast: map the file
+    ```
+
+  Arguments:
+    filename   string with filename
+    A          a pointer to a csp_t
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_ILLEGAL_INPUT if an input is NULL, and
+    MSP_FILE_ERR if a file error occurs.
+*/
+{
+  if (filename == NULL || A == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  size_t m = A->shape[0], n = A->shape[1];
+  size_t nptr = ((A->csx == CSC) ? n : (A->csx == CSR) ? m : (m + A->chunk - 1) / A->chunk) + 1;
+  size_t nidx = A->ptr[nptr - 1], nperm = (A->csx == SELL) ? m : 0;
+  const void *data[4] = {A->ptr, A->idx, A->val, A->perm};
+  size_t bytes[4] = {nptr * sizeof(size_t), nidx * sizeof(size_t), nidx * sizeof(double), nperm * sizeof(size_t)};
+
+  csp_binary_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CSP_BINARY_MAGIC, sizeof(CSP_BINARY_MAGIC));
+  hdr.version = CSP_BINARY_VERSION;
+  hdr.byteorder = CSP_BINARY_BYTEORDER;
+  hdr.intsize = sizeof(size_t);
+  hdr.shape[0] = m;
+  hdr.shape[1] = n;
+  hdr.csx = A->csx;
+  hdr.sym = A->sym;
+  hdr.chunk = A->chunk;
+  hdr.sigma = A->sigma;
+  hdr.nnz = A->nnz;
+  hdr.canonical = A->canonical;
+  uint64_t end = sizeof(hdr);
+  for (int s = 0; s < 4; s++)
+  {
+    hdr.len[s] = (s == 0) ? nptr : (s == 3) ? nperm : nidx;
+    hdr.offset[s] = csp_align(end);
+    end = hdr.offset[s] + bytes[s];
+    hdr.checksum = csp_hash(data[s], bytes[s], hdr.checksum);
+  }
+  hdr.hdrsum = csp_hash(&hdr, offsetof(csp_binary_header_t, hdrsum), 0);
+
+  FILE *fp = fopen(filename, "wb");
+  if (fp == NULL)
+  {
+#ifndef NDEBUG
+    FILE_ERR(filename);
+#endif
+    return MSP_FILE_ERR;
+  }
+  static const char zeros[CSP_BINARY_ALIGN];
+  int ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+  end = sizeof(hdr);
+  for (int s = 0; s < 4 && ok; s++)
+  {
+    ok = fwrite(zeros, 1, hdr.offset[s] - end, fp) == hdr.offset[s] - end &&
+         (bytes[s] == 0 || fwrite(data[s], 1, bytes[s], fp) == bytes[s]);
+    end = hdr.offset[s] + bytes[s];
+  }
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok)
+    fprintf(stderr, "%s: failed to write %s\n", __func__, filename);
+  return ok ? MSP_SUCCESS : MSP_FILE_ERR;
+}
+
+/* Checks a header read from a file of size bytes; returns an error message or NULL */
+static const char *csp_check_header(const csp_binary_header_t *hdr, size_t size)
+{
+  if (memcmp(hdr->magic, CSP_BINARY_MAGIC, sizeof(CSP_BINARY_MAGIC)) != 0)
+    return "not a csp_to_binary file";
+  if (hdr->version != CSP_BINARY_VERSION)
+    return "unsupported format version";
+  if (hdr->byteorder != CSP_BINARY_BYTEORDER || hdr->intsize != sizeof(size_t))
+    return "written on a machine with another byte order or size_t";
+  if (hdr->hdrsum != csp_hash(hdr, offsetof(csp_binary_header_t, hdrsum), 0))
+    return "header checksum mismatch";
+  if (hdr->csx > SELL || hdr->sym > SkewSymmetric || (hdr->csx == SELL && hdr->chunk == 0))
+    return "invalid format";
+  uint64_t m = hdr->shape[0], n = hdr->shape[1];
+  uint64_t nptr = ((hdr->csx == CSC) ? n : (hdr->csx == CSR) ? m : (m + hdr->chunk - 1) / hdr->chunk) + 1;
+  if (hdr->len[0] != nptr || hdr->len[2] != hdr->len[1] || hdr->len[3] != ((hdr->csx == SELL) ? m : 0))
+    return "inconsistent section lengths";
+  for (int s = 0; s < 4; s++)
+  {
+    uint64_t elsize = (s == 2) ? sizeof(double) : sizeof(size_t);
+    if (hdr->offset[s] % elsize != 0 || hdr->offset[s] > size || hdr->len[s] > (size - hdr->offset[s]) / elsize)
+      return "truncated file";
+  }
+  return NULL;
+}
+
+csp_t *csp_from_binary(const char *filename, int verify)
+/*
+  Purpose:
+
+    Loads a compressed sparse matrix from a file written by csp_to_binary.
+    The file is memory-mapped read-only, and ptr, idx, val and perm of the
+    returned csp_t point into the mapping: nothing is read or copied until
+    the arrays are used, so a large matrix is available immediately and
+    the pages are shared with other processes (and kept in the page cache)
+    that map the same file. The csp_t has readonly set; its arrays must
+    not be modified. csp_dealloc unmaps the file.
+
+    The header is always validated (version, byte order, size of size_t,
+    header checksum, and section sizes against the file size). If verify
+    is nonzero, the checksum of the data is verified as well, which reads
+    the whole file.
+
+  Arguments:
+    filename   string with filename
+    verify     nonzero to verify the checksum of the data
+
+  Return value:
+    A pointer to a csp_t, or NULL if an error occurs.
+*/
+{
+  if (filename == NULL)
+    return NULL;
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+  {
+#ifndef NDEBUG
+    FILE_ERR(filename);
+#endif
+    return NULL;
+  }
+  csp_binary_header_t hdr;
+  struct stat st;
+  const char *err = NULL;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hdr) ||
+      pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+    err = "truncated file";
+  else
+    err = csp_check_header(&hdr, (size_t)st.st_size);
+  void *map = MAP_FAILED;
+  size_t size = (size_t)st.st_size;
+  if (err == NULL && (map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    err = "mmap failed";
+  close(fd);
+  if (err == NULL && ((size_t *)((char *)map + hdr.offset[0]))[hdr.len[0] - 1] != hdr.len[1])
+    err = "inconsistent section lengths";
+  if (err == NULL && verify)
+  {
+    uint64_t checksum = 0;
+    for (int s = 0; s < 4; s++)
+    {
+      size_t bytes = hdr.len[s] * ((s == 2) ? sizeof(double) : sizeof(size_t));
+      checksum = csp_hash((char *)map + hdr.offset[s], bytes, checksum);
+    }
+    if (checksum != hdr.checksum)
+      err = "data checksum mismatch";
+  }
+  csp_t *A = (err == NULL) ? malloc(sizeof(*A)) : NULL;
+  if (A == NULL)
+  {
+    if (err != NULL)
+      fprintf(stderr, "%s: %s: %s\n", __func__, filename, err);
+#ifndef NDEBUG
+    else
+      MEM_ERR;
+#endif
+    if (map != MAP_FAILED)
+      munmap(map, size);
+    return NULL;
+  }
+  A->shape[0] = hdr.shape[0];
+  A->shape[1] = hdr.shape[1];
+  A->csx = (enum cstype)hdr.csx;
+  A->sym = (enum symmetry)hdr.sym;
+  A->ptr = (size_t *)((char *)map + hdr.offset[0]);
+  A->idx = (size_t *)((char *)map + hdr.offset[1]);
+  A->val = (double *)((char *)map + hdr.offset[2]);
+  A->chunk = hdr.chunk;
+  A->sigma = hdr.sigma;
+  A->nnz = hdr.nnz;
+  A->canonical = (hdr.canonical != 0);
+  A->perm = (hdr.csx == SELL) ? (size_t *)((char *)map + hdr.offset[3]) : NULL;
+  A->readonly = 1;
+  A->map = map;
+  A->mapsize = size;
+  return A;
+}
+
+void csp_fprint(FILE *stream, const csp_t *sp)
+/*
+  Purpose:
+
+    Prints a sparse matrix in CSC/CSR format
+
+  Arguments:
+    stream       a pointer to a file stream
+    sp           a pointer to a csp_t
+
+  Return value:
+    None
+*/
+{
+  if (sp == NULL)
+    return;
+  if (sp->csx == SELL)
+  {
+    /* Row by row in chunk order; zero entries are not printed (padding) */
+    size_t m = sp->shape[0], C = sp->chunk;
+    fprintf(stream, "<csp_t sell shape=(%zu,%zu) nnz=%zu C=%zu sigma=%zu>\n",
+            sp->shape[0], sp->shape[1], sp->nnz, C, sp->sigma);
+    for (size_t k = 0; k < m; k++)
+    {
+      size_t c = k / C, width = (sp->ptr[c + 1] - sp->ptr[c]) / C;
+      for (size_t l = 0; l < width; l++)
+      {
+        size_t e = sp->ptr[c] + l * C + k % C;
+        if (sp->val[e] != 0.0)
+          fprintf(stream, "%4zu %4zu % 8.3g\n", sp->perm[k]+1, sp->idx[e]+1, sp->val[e]);
+      }
+    }
+    return;
+  }
+  size_t N = (sp->csx == CSC) ? sp->shape[1] : sp->shape[0];
+  fprintf(stream, "<csp_t %s shape=(%zu,%zu) nnz=%zu%s>\n",
+          (sp->csx == CSC) ? "csc" : "csr", sp->shape[0], sp->shape[1], sp->ptr[N],
+          (sp->sym == Symmetric) ? " symmetric" : (sp->sym == SkewSymmetric) ? " skew-symmetric" : "");
+  if (sp->csx == CSC)
+  {
+    for (size_t k = 0; k < N; k++)
+    {
+      for (size_t i = sp->ptr[k]; i < sp->ptr[k + 1]; i++)
+        fprintf(stream, "%4zu %4zu % 8.3g\n", sp->idx[i]+1, k+1, sp->val[i]);
+    }
+  }
+  else
+  {
+    for (size_t k = 0; k < N; k++)
+    {
+      for (size_t i = sp->ptr[k]; i < sp->ptr[k + 1]; i++)
+        fprintf(stream, "%4zu %4zu % 8.3g\n", k+1, sp->idx[i]+1, sp->val[i]);
+    }
+  }
+}
+
+void csp_print(const csp_t *sp) { csp_fprint(stdout, sp); }
+
+
+/* y[i] = beta*y[i] + alpha*dot(row i, x) for the rows of a compressed
+   matrix (CSR: A*x, CSC: A^T*x). Four independent accumulators break the
+   dependency chain of the sum so the loop can be vectorized/pipelined. */
+static void csp_gather(size_t N, const size_t *restrict ptr, const size_t *restrict idx,
+                       const double *restrict val, double alpha, const double *restrict x,
+                       double beta, double *restrict y)
+{
+  for (size_t i = 0; i < N; i++)
+  {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t k = ptr[i], end = ptr[i + 1];
+    for (; k + 4 <= end; k += 4)
+    {
+      s0 += val[k] * x[idx[k]];
+      s1 += val[k + 1] * x[idx[k + 1]];
+      s2 += val[k + 2] * x[idx[k + 2]];
+      s3 += val[k + 3] * x[idx[k + 3]];
+    }
+    for (; k < end; k++)
+      s0 += val[k] * x[idx[k]];
+    double s = (s0 + s1) + (s2 + s3);
+    y[i] = (beta == 0.0) ? alpha * s : beta * y[i] + alpha * s;
+  }
+}
+
+/* y += alpha*A*x for the columns of a compressed matrix (CSC: A*x, CSR:
+   A^T*x), i.e., one scaled scatter-add per column; y is scaled by beta
+   first. */
+static void csp_scatter(size_t N, size_t M, const size_t *restrict ptr, const size_t *restrict idx,
+                        const double *restrict val, double alpha, const double *restrict x,
+                        double beta, double *restrict y)
+{
+  if (beta == 0.0)
+    memset(y, 0, M * sizeof(*y));
+  else if (beta != 1.0)
+    for (size_t i = 0; i < M; i++)
+      y[i] *= beta;
+  for (size_t j = 0; j < N; j++)
+  {
+    double t = alpha * x[j];
+    size_t k = ptr[j], end = ptr[j + 1];
+    for (; k + 4 <= end; k += 4)
+    {
+      y[idx[k]] += t * val[k];
+      y[idx[k + 1]] += t * val[k + 1];
+      y[idx[k + 2]] += t * val[k + 2];
+      y[idx[k + 3]] += t * val[k + 3];
+    }
+    for (; k < end; k++)
+      y[idx[k]] += t * val[k];
+  }
+}
+
+/* t[r] = sum of row r of a SELL chunk of height C and width w times x. The
+   rows of the chunk are independent, but without gather instructions (and
+   the default target has none) the compiler keeps this loop scalar. */
+#define SELL_CHUNK_KERNEL(C)                                                    \
+  static void sell_chunk_##C(size_t w, const size_t *restrict idx,             \
+                             const double *restrict val,                       \
+                             const double *restrict x, double *restrict t)     \
+  {                                                                             \
+    double s[C] = {0.0};                                                        \
+    for (size_t l = 0; l < w; l++)                                              \
+      for (size_t r = 0; r < C; r++)                                            \
+        s[r] += val[l * C + r] * x[idx[l * C + r]];                             \
+    for (size_t r = 0; r < C; r++)                                              \
+      t[r] = s[r];                                                              \
+  }
+
+SELL_CHUNK_KERNEL(4)
+SELL_CHUNK_KERNEL(8)
+SELL_CHUNK_KERNEL(16)
+
+#ifdef SELL_X86
+/* The same kernels with explicit gathers of x: a column of a chunk is C/4
+   AVX2 or C/8 AVX-512 vectors (the indices are 64-bit, one per lane). They
+   are compiled for their target only and selected at run time, so the
+   library still runs on any x86-64. */
+#define SELL_CHUNK_AVX2(C)                                                                  \
+  __attribute__((target("avx2,fma"))) static void sell_chunk_avx2_##C(                       \
+      size_t w, const size_t *restrict idx, const double *restrict val,                     \
+      const double *restrict x, double *restrict t)                                         \
+  {                                                                                         \
+    __m256d s[C / 4];                                                                       \
+    for (size_t q = 0; q < C / 4; q++)                                                      \
+      s[q] = _mm256_setzero_pd();                                                           \
+    for (size_t l = 0; l < w; l++)                                                          \
+      for (size_t q = 0; q < C / 4; q++)                                                    \
+      {                                                                                     \
+        __m256i i = _mm256_loadu_si256((const __m256i *)(idx + l * C + 4 * q));            \
+        s[q] = _mm256_fmadd_pd(_mm256_loadu_pd(val + l * C + 4 * q), _mm256_i64gather_pd(x, i, 8), s[q]); \
+      }                                                                                     \
+    for (size_t q = 0; q < C / 4; q++)                                                      \
+      _mm256_storeu_pd(t + 4 * q, s[q]);                                                    \
+  }
+
+#define SELL_CHUNK_AVX512(C)                                                                \
+  __attribute__((target("avx512f"))) static void sell_chunk_avx512_##C(                      \
+      size_t w, const size_t *restrict idx, const double *restrict val,                     \
+      const double *restrict x, double *restrict t)                                         \
+  {                                                                                         \
+    __m512d s[C / 8];                                                                       \
+    for (size_t q = 0; q < C / 8; q++)                                                      \
+      s[q] = _mm512_setzero_pd();                                                           \
+    for (size_t l = 0; l < w; l++)                                                          \
+      for (size_t q = 0; q < C / 8; q++)                                                    \
+      {                                                                                     \
+        __m512i i = _mm512_loadu_si512((const void *)(idx + l * C + 8 * q));                \
+        s[q] = _mm512_fmadd_pd(_mm512_loadu_pd(val + l * C + 8 * q), _mm512_i64gather_pd(i, x, 8), s[q]); \
+      }                                                                                     \
+    for (size_t q = 0; q < C / 8; q++)                                                      \
+      _mm512_storeu_pd(t + 8 * q, s[q]);                                                    \
+  }
+
+SELL_CHUNK_AVX2(4)
+SELL_CHUNK_AVX2(8)
+SELL_CHUNK_AVX2(16)
+SELL_CHUNK_AVX512(8)
+SELL_CHUNK_AVX512(16)
+#endif
+
+typedef void (*sell_kernel_t)(size_t, const size_t *restrict, const double *restrict, const double *restrict,
+                              double *restrict);
+
+/* The chunk kernel for chunk height C: AVX-512 or AVX2 gathers if the CPU
+   has them, otherwise the scalar kernel; NULL if C has no kernel */
+static sell_kernel_t sell_kernel(size_t C)
+{
+#ifdef SELL_X86
+  if (__builtin_cpu_supports("avx512f") && (C == 8 || C == 16))
+    return (C == 8) ? sell_chunk_avx512_8 : sell_chunk_avx512_16;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && (C == 4 || C == 8 || C == 16))
+    return (C == 4) ? sell_chunk_avx2_4 : (C == 8) ? sell_chunk_avx2_8 : sell_chunk_avx2_16;
+#endif
+  return (C == 4) ? sell_chunk_4 : (C == 8) ? sell_chunk_8 : (C == 16) ? sell_chunk_16 : NULL;
+}
+
+/* y = beta*y + alpha*A*x for a SELL matrix */
+static void sell_gather(const csp_t *A, double alpha, const double *restrict x, double beta, double *restrict y)
+{
+  size_t m = A->shape[0], C = A->chunk, nchunks = (m + C - 1) / C;
+  sell_kernel_t kernel = sell_kernel(C);
+  double t[16];
+  for (size_t c = 0; c < nchunks; c++)
+  {
+    size_t w = (A->ptr[c + 1] - A->ptr[c]) / C;
+    size_t rows = (m - c * C < C) ? m - c * C : C;
+    const size_t *idx = A->idx + A->ptr[c], *perm = A->perm + c * C;
+    const double *val = A->val + A->ptr[c];
+    if (kernel)
+      kernel(w, idx, val, x, t);
+    for (size_t r = 0; r < rows; r++)
+    {
+      double s = 0.0;
+      if (kernel)
+        s = t[r];
+      else
+        for (size_t l = 0; l < w; l++)
+          s += val[l * C + r] * x[idx[l * C + r]];
+      y[perm[r]] = (beta == 0.0) ? alpha * s : beta * y[perm[r]] + alpha * s;
+    }
+  }
+}
+
+/* y = beta*y + alpha*A^T*x for a SELL matrix (padding adds zeros) */
+static void sell_scatter(const csp_t *A, double alpha, const double *restrict x, double beta, double *restrict y)
+{
+  size_t m = A->shape[0], n = A->shape[1], C = A->chunk, nchunks = (m + C - 1) / C;
+  if (beta == 0.0)
+    memset(y, 0, n * sizeof(*y));
+  else if (beta != 1.0)
+    for (size_t j = 0; j < n; j++)
+      y[j] *= beta;
+  for (size_t c = 0; c < nchunks; c++)
+  {
+    size_t w = (A->ptr[c + 1] - A->ptr[c]) / C;
+    size_t rows = (m - c * C < C) ? m - c * C : C;
+    for (size_t r = 0; r < rows; r++)
+    {
+      double t = alpha * x[A->perm[c * C + r]];
+      for (size_t l = 0; l < w; l++)
+        y[A->idx[A->ptr[c] + l * C + r]] += t * A->val[A->ptr[c] + l * C + r];
+    }
+  }
+}
+
+/* y = beta*y + A*x for a matrix of which only the lower triangle is stored
+   (half storage). Every stored entry is used twice while it is in
+   registers: A(o,q) for the dot product of outer index o (scaled by
+   alpha_o) and A(q,o) for a scatter-add to y[q] (scaled by alpha_q), so A
+   is read only once. Diagonal entries are used once. In a canonical
+   matrix the diagonal entry can only be the first (CSC) or the last (CSR)
+   of its column/row, so it is peeled off and the inner loop has no
+   branch. */
+static void csp_sym(size_t N, const size_t *restrict ptr, const size_t *restrict idx,
+                    const double *restrict val, double alpha_o, double alpha_q, int canonical,
+                    const double *restrict x, double beta, double *restrict y)
+{
+  if (beta == 0.0)
+    memset(y, 0, N * sizeof(*y));
+  else if (beta != 1.0)
+    for (size_t i = 0; i < N; i++)
+      y[i] *= beta;
+  for (size_t o = 0; o < N; o++)
+  {
+    double s = 0.0, t = alpha_q * x[o];
+    size_t k = ptr[o], end = ptr[o + 1];
+    if (canonical)
+    {
+      if (k < end && idx[k] == o)
+        s += val[k++] * x[o];
+      else if (k < end && idx[end - 1] == o)
+        s += val[--end] * x[o];
+      for (; k < end; k++)
+      {
+        s += val[k] * x[idx[k]];
+        y[idx[k]] += t * val[k];
+      }
+    }
+    else
+      for (; k < end; k++)
+      {
+        size_t q = idx[k];
+        s += val[k] * x[q];
+        if (q != o)
+          y[q] += t * val[k];
+      }
+    y[o] += alpha_o * s;
+  }
+}
+
+/* Shared driver of csp_spmv and csp_spmv_t */
+static int csp_mv(double alpha, const csp_t *A, const array_t *x, double beta, array_t *y, int trans)
+{
+  if (A == NULL || x == NULL || y == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  size_t m = trans ? A->shape[1] : A->shape[0];
+  size_t n = trans ? A->shape[0] : A->shape[1];
+  if (x->len != n || y->len != m)
+    return MSP_DIM_ERR;
+  if (x->val == y->val && m > 0 && n > 0)
+    return MSP_ILLEGAL_INPUT; /* x and y must not overlap */
+  if (A->sym != General && A->csx != SELL)
+  {
+    /* The stored lower triangle L gives A = L + s*L^T - diag, A^T = s*A;
+       CSR rows hold L(o,q), CSC columns hold L(q,o) = s*A(o,q). */
+    double s = (A->sym == SkewSymmetric) ? -1.0 : 1.0, a = trans ? s * alpha : alpha;
+    if (A->csx == CSR)
+      csp_sym(m, A->ptr, A->idx, A->val, a, s * a, A->canonical, x->val, beta, y->val);
+    else
+      csp_sym(m, A->ptr, A->idx, A->val, s * a, a, A->canonical, x->val, beta, y->val);
+  }
+  else if (A->csx == SELL && !trans)
+    sell_gather(A, alpha, x->val, beta, y->val);
+  else if (A->csx == SELL)
+    sell_scatter(A, alpha, x->val, beta, y->val);
+  else if ((A->csx == CSR) != (trans != 0))
+    csp_gather(m, A->ptr, A->idx, A->val, alpha, x->val, beta, y->val);
+  else
+    csp_scatter(n, m, A->ptr, A->idx, A->val, alpha, x->val, beta, y->val);
+  return MSP_SUCCESS;
+}
+
+int csp_spmv(double alpha, const csp_t *A, const array_t *x, double beta, array_t *y)
+/*
+  Purpose:
+
+    Computes the sparse matrix-vector product
+
+      y := alpha*A*x + beta*y
+
+    where A is a compressed sparse matrix (CSC, CSR or SELL). A CSR matrix
+    is multiplied row by row (a gather and a dot product per row), a CSC
+    matrix column by column (a scaled scatter-add per column), and a SELL
+    matrix chunk by chunk with the rows of a chunk in SIMD lanes (kernels
+    for chunk heights 4, 8 and 16 that gather x with AVX2 or AVX-512 on
+    x86-64 CPUs that have them, and are scalar otherwise). A symmetric or skew-symmetric matrix
+    in half storage (see csp_half_from_coo) is multiplied in one pass over the
+    stored triangle: each entry contributes to a dot product and to a
+    scatter-add. If beta is zero, y need not be initialized. The vectors x
+    and y must not overlap.
+
+  Example:
+
+    ```c
+    csp_t *A = csp_from_coo(sp, CSR);
+    array_t *x = array_zeros(A->shape[1]), *y = array_zeros(A->shape[0]);
+    // .. initialize x ..
+    csp_spmv(1.0, A, x, 0.0, y);    // y = A*x
+    ```
+
+  Arguments:
+    alpha      scalar
+    A          a pointer to a csp_t
+    x          a pointer to an array_t of length A->shape[1]
+    beta       scalar
+    y          a pointer to an array_t of length A->shape[0]
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_DIM_ERR if the lengths of x and y do not
+    match the shape of A, and MSP_ILLEGAL_INPUT if an input is NULL or x
+    and y are the same array.
+*/
+{
+  return csp_mv(alpha, A, x, beta, y, 0);
+}
+
+int csp_spmv_t(double alpha, const csp_t *A, const array_t *x, double beta, array_t *y)
+/*
+  Purpose:
+
+    Computes the transposed sparse matrix-vector product
+
+      y := alpha*A^T*x + beta*y
+
+    without forming A^T (a CSR matrix is traversed as the CSC form of A^T,
+    and vice versa). See csp_spmv.
+
+  Arguments:
+    alpha      scalar
+    A          a pointer to a csp_t
+    x          a pointer to an array_t of length A->shape[0]
+    beta       scalar
+    y          a pointer to an array_t of length A->shape[1]
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_DIM_ERR if the lengths of x and y do not
+    match the shape of A, and MSP_ILLEGAL_INPUT if an input is NULL or x
+    and y are the same array.
+*/
+{
+  return csp_mv(alpha, A, x, beta, y, 1);
+}
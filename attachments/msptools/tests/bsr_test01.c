@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "msptools.h"
+
+/* Matrix with dense bs-by-bs blocks on a block tridiagonal pattern */
+static coo_t *block_matrix(size_t nb, size_t bs)
+{
+  coo_t *sp = coo_alloc((size_t[]){nb * bs, nb * bs}, 3 * nb * bs * bs);
+  assert(sp != NULL);
+  size_t k = 0;
+  for (size_t I = 0; I < nb; I++)
+    for (size_t J = (I > 0 ? I - 1 : 0); J <= I + 1 && J < nb; J++)
+      for (size_t r = 0; r < bs; r++)
+        for (size_t c = 0; c < bs; c++, k++)
+        {
+          sp->rowidx[k] = I * bs + r;
+          sp->colidx[k] = J * bs + c;
+          sp->val[k] = (I == J && r == c) ? 10.0 : 1.0 / (1.0 + r + 2 * c + I);
+        }
+  sp->nnz = k;
+  return sp;
+}
+
+int main(void) {
+
+  /* MM1 has no block structure */
+  coo_t *a = coo_from_file("../data/MM1.txt");
+  assert(a != NULL);
+  assert(bsr_block_size(a) == 1);
+  bsr_t *b = bsr_from_coo(a, 1);
+  assert(b != NULL && b->nblocks == a->nnz);
+  bsr_print(b);
+  bsr_dealloc(b);
+  assert(bsr_from_coo(a, 2) == NULL); /* 5 is not a multiple of 2 */
+  coo_dealloc(a);
+
+  for (size_t bs = 1; bs <= 7; bs++)
+  {
+    a = block_matrix(5, bs);
+    size_t n = a->shape[0];
+    if (bs <= BSR_MAX_BLOCK)
+      assert(bsr_block_size(a) == bs || bs == 1);
+    b = bsr_from_coo(a, bs);
+    csp_t *csr = csp_from_coo(a, CSR);
+    assert(b != NULL && csr != NULL && b->nblocks == 13);
+
+    array_t *x = array_zeros(n), *y = array_zeros(n), *ref = array_zeros(n);
+    for (size_t i = 0; i < n; i++)
+    {
+      x->val[i] = 1.0 + i % 3;
+      y->val[i] = ref->val[i] = 0.5 * i;
+    }
+    assert(bsr_spmv(2.0, b, x, -1.0, y) == MSP_SUCCESS);
+    csp_spmv(2.0, csr, x, -1.0, ref);
+    for (size_t i = 0; i < n; i++)
+      assert(fabs(y->val[i] - ref->val[i]) <= 1e-12 * (1.0 + fabs(ref->val[i])));
+
+    /* SpMM with 3 right-hand sides in both storage orders */
+    for (enum storage_order order = RowMajor; order <= ColMajor; order++)
+    {
+      array2d_t *X = array2d_alloc((size_t[]){n, 3}, order), *Y = array2d_alloc((size_t[]){n, 3}, order);
+      assert(X != NULL && Y != NULL);
+      for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < 3; j++)
+          X->val[order == RowMajor ? i * 3 + j : j * n + i] = x->val[i] * (j + 1);
+      assert(bsr_spmm(1.0, b, X, 0.0, Y) == MSP_SUCCESS);
+      csp_spmv(1.0, csr, x, 0.0, ref);
+      for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < 3; j++)
+        {
+          double yij = Y->val[order == RowMajor ? i * 3 + j : j * n + i];
+          assert(fabs(yij - (j + 1) * ref->val[i]) <= 1e-12 * (1.0 + fabs(yij)));
+        }
+      array2d_dealloc(X);
+      array2d_dealloc(Y);
+    }
+    y->len = n - 1;
+    assert(bsr_spmv(1.0, b, x, 0.0, y) == MSP_DIM_ERR);
+
+    array_dealloc(x);
+    array_dealloc(y);
+    array_dealloc(ref);
+    bsr_dealloc(b);
+    csp_dealloc(csr);
+    coo_dealloc(a);
+  }
+  printf("ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "msptools.h"
+
+/* Dense reference: y = alpha*op(A)*x + beta*y */
+static void dense_mv(const coo_t *a, int trans, double alpha, const double *x, double beta, double *y)
+{
+  size_t m = trans ? a->shape[1] : a->shape[0];
+  for (size_t i = 0; i < m; i++)
+    y[i] *= beta;
+  for (size_t k = 0; k < a->nnz; k++)
+  {
+    size_t i = trans ? a->colidx[k] : a->rowidx[k];
+    size_t j = trans ? a->rowidx[k] : a->colidx[k];
+    y[i] += alpha * a->val[k] * x[j];
+  }
+}
+
+int main(void) {
+
+  coo_t *a = coo_from_file("../data/MM1.txt");
+  assert(a != NULL);
+  size_t n = a->shape[0];
+  array_t *x = array_zeros(n), *y = array_zeros(n);
+  double ref[5];
+  assert(x != NULL && y != NULL && n == 5);
+
+  for (enum cstype csx = CSC; csx <= CSR; csx++)
+  {
+    csp_t *b = csp_from_coo(a, csx);
+    assert(b != NULL);
+    for (int trans = 0; trans <= 1; trans++)
+    {
+      for (size_t i = 0; i < n; i++)
+      {
+        x->val[i] = 1.0 + i;
+        y->val[i] = ref[i] = 0.5 * i;
+      }
+      dense_mv(a, trans, 2.0, x->val, -1.0, ref);
+      int ret = trans ? csp_spmv_t(2.0, b, x, -1.0, y) : csp_spmv(2.0, b, x, -1.0, y);
+      assert(ret == MSP_SUCCESS);
+      for (size_t i = 0; i < n; i++)
+        assert(fabs(y->val[i] - ref[i]) <= 1e-12 * (1.0 + fabs(ref[i])));
+      array_print(y);
+    }
+    /* beta = 0 ignores the contents of y */
+    y->val[0] = NAN;
+    assert(csp_spmv(1.0, b, x, 0.0, y) == MSP_SUCCESS && !isnan(y->val[0]));
+    /* dimension check */
+    y->len = n - 1;
+    assert(csp_spmv(1.0, b, x, 0.0, y) == MSP_DIM_ERR);
+    y->len = n;
+    csp_dealloc(b);
+  }
+
+  coo_dealloc(a);
+  array_dealloc(x);
+  array_dealloc(y);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "msptools.h"
+
+int main(void) {
+
+  coo_t *a = coo_from_file("../data/MM1.txt");
+  assert(a != NULL);
+  size_t n = a->shape[0];
+  csp_t *csr = csp_from_coo(a, CSR);
+  array_t *x = array_zeros(n), *y = array_zeros(n), *ref = array_zeros(n);
+  assert(csr != NULL && x != NULL && y != NULL && ref != NULL);
+  for (size_t i = 0; i < n; i++)
+    x->val[i] = 1.0 + i;
+
+  csp_t *b = csp_from_coo(a, SELL);
+  assert(b != NULL && b->csx == SELL && b->nnz == a->nnz);
+  csp_print(b);
+  csp_dealloc(b);
+
+  size_t chunks[] = {1, 2, 3, 4, 8, 16}, sigmas[] = {1, 2, 5};
+  for (size_t c = 0; c < 6; c++)
+    for (size_t s = 0; s < 3; s++)
+      for (int from_csr = 0; from_csr <= 1; from_csr++)
+      {
+        b = from_csr ? csp_sell_from_csp(csr, chunks[c], sigmas[s]) : csp_sell_from_coo(a, chunks[c], sigmas[s]);
+        assert(b != NULL);
+        /* padding is at least 0 and the rows are a permutation */
+        size_t nchunks = (n + chunks[c] - 1) / chunks[c];
+        assert(b->ptr[nchunks] >= b->nnz);
+        for (int trans = 0; trans <= 1; trans++)
+        {
+          for (size_t i = 0; i < n; i++)
+            y->val[i] = ref->val[i] = 0.5 * i;
+          assert((trans ? csp_spmv_t(2.0, csr, x, -1.0, ref) : csp_spmv(2.0, csr, x, -1.0, ref)) == MSP_SUCCESS);
+          assert((trans ? csp_spmv_t(2.0, b, x, -1.0, y) : csp_spmv(2.0, b, x, -1.0, y)) == MSP_SUCCESS);
+          for (size_t i = 0; i < n; i++)
+            assert(fabs(y->val[i] - ref->val[i]) <= 1e-12 * (1.0 + fabs(ref->val[i])));
+        }
+        csp_dealloc(b);
+      }
+  array_print(y);
+
+  /* invalid parameters */
+  assert(csp_sell_from_coo(a, 0, 1) == NULL);
+  assert(csp_alloc(a->shape, a->nnz, SELL) == NULL);
+
+  coo_dealloc(a);
+  csp_dealloc(csr);
+  array_dealloc(x);
+  array_dealloc(y);
+  array_dealloc(ref);
+  return EXIT_SUCCESS;
+}
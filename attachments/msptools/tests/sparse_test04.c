@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "msptools.h"
+
+int main(void) {
+
+  /* Header and entries from a memory buffer */
+  const char *text =
+    "%%MatrixMarket matrix coordinate real general\n"
+    "% comment\n"
+    "  3 4 6\n"
+    "1 1 1.5\n"
+    "2 3 -2e-3\n"
+    "3 4 0.1\r\n"
+    "1 4 123456789012345678901234567890\n"
+    "\n"
+    "3 1\t-.5E+2\n"
+    "2 2 4.9406564584124654e-324\n";
+  size_t shape[2], nnz, nread;
+  enum symmetry sym;
+  int pattern;
+  const char *data = mm_parse_header(text, strlen(text), shape, &nnz, &sym, &pattern);
+  assert(data != NULL);
+  assert(shape[0] == 3 && shape[1] == 4 && nnz == 6 && sym == General && pattern == 0);
+
+  coo_t *a = coo_alloc(shape, nnz);
+  assert(a != NULL);
+  assert(mm_parse_entries(data, strlen(data), a, 0, nnz, pattern, &nread) == MSP_SUCCESS);
+  assert(nread == nnz);
+  double ref[] = {1.5, -2e-3, 0.1, 123456789012345678901234567890.0, -.5E+2, 4.9406564584124654e-324};
+  for (size_t k = 0; k < nnz; k++)
+    assert(a->val[k] == ref[k]);
+  assert(a->rowidx[2] == 2 && a->colidx[2] == 3);
+  assert(a->rowidx[4] == 2 && a->colidx[4] == 0);
+
+  /* Long values go through strtod without truncation (the last one is
+     longer than a line buffer) */
+  char *longtext = malloc(2100);
+  assert(longtext != NULL);
+  const char *longvals[] = {
+    "1234567890123456789012345678901234567890123456789012345678901234567890",
+    "0.00000000000000000000000000000000000000000000000000000000000000012345", NULL};
+  for (int l = 0; l < 3; l++)
+  {
+    if (longvals[l] == NULL)
+    {
+      strcpy(longtext, "1 1 0.");
+      memset(longtext + 6, '0', 2000);
+      strcpy(longtext + 2006, "25e2000\n");
+    }
+    else
+      sprintf(longtext, "1 1 %s\n", longvals[l]);
+    assert(mm_parse_entries(longtext, strlen(longtext), a, 0, 1, 0, &nread) == MSP_SUCCESS && nread == 1);
+    assert(a->val[0] == strtod(longtext + 4, NULL));
+  }
+  assert(a->val[0] == 0.25);
+  free(longtext);
+
+  /* Malformed entries and indices out of range */
+  assert(mm_parse_entries("1 1 2.0x\n", 9, a, 0, 1, 0, &nread) == MSP_FAILURE);
+  assert(mm_parse_entries("1 1\n", 4, a, 0, 1, 0, &nread) == MSP_FAILURE);
+  assert(mm_parse_entries("4 1 1.0\n", 8, a, 0, 1, 0, &nread) == MSP_FAILURE);
+  assert(mm_parse_entries("0 1 1.0\n", 8, a, 0, 1, 0, &nread) == MSP_FAILURE);
+  /* 2^64 + 1 must not wrap around to 1 */
+  const char *wrap = "18446744073709551617 1 1.0\n";
+  assert(mm_parse_entries(wrap, strlen(wrap), a, 0, 1, 0, &nread) == MSP_FAILURE);
+  const char *huge = "%%MatrixMarket matrix coordinate real general\n99999999999999999999999 1 1\n";
+  assert(mm_parse_header(huge, strlen(huge), shape, &nnz, &sym, &pattern) == NULL);
+  const char *dense = "%%MatrixMarket matrix array real general\n3 3\n";
+  assert(mm_parse_header(dense, strlen(dense), shape, &nnz, &sym, &pattern) == NULL);
+
+  /* Buffered reader */
+  coo_t *b = coo_from_file("../data/MM1.txt");
+  assert(b != NULL);
+  coo_print(b);
+
+  coo_dealloc(a);
+  coo_dealloc(b);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "msptools.h"
+
+/* Dense reference: y = alpha*op(A)*x + beta*y for a general COO matrix */
+static void dense_mv(const coo_t *a, int trans, double alpha, const double *x, double beta, double *y)
+{
+  size_t m = trans ? a->shape[1] : a->shape[0];
+  for (size_t i = 0; i < m; i++)
+    y[i] *= beta;
+  for (size_t k = 0; k < a->nnz; k++)
+  {
+    size_t i = trans ? a->colidx[k] : a->rowidx[k];
+    size_t j = trans ? a->rowidx[k] : a->colidx[k];
+    y[i] += alpha * a->val[k] * x[j];
+  }
+}
+
+/* Half storage SpMV (CSC and CSR, A*x and A^T*x) against the expanded matrix */
+static void check_mv(const coo_t *a)
+{
+  coo_t *full = coo_expand(a);
+  assert(full != NULL && full->sym == General);
+  size_t n = a->shape[0];
+  array_t *x = array_zeros(n), *y = array_zeros(n);
+  double *ref = malloc(n * sizeof(*ref));
+  assert(x != NULL && y != NULL && ref != NULL);
+  for (enum cstype csx = CSC; csx <= CSR; csx++)
+  {
+    csp_t *b = csp_half_from_coo(a, csx, 0);
+    assert(b != NULL && b->sym == a->sym && b->ptr[n] == a->nnz);
+    for (int trans = 0; trans <= 1; trans++)
+    {
+      for (size_t i = 0; i < n; i++)
+      {
+        x->val[i] = 1.0 + i;
+        y->val[i] = ref[i] = 0.5 * i;
+      }
+      dense_mv(full, trans, 2.0, x->val, -1.0, ref);
+      int ret = trans ? csp_spmv_t(2.0, b, x, -1.0, y) : csp_spmv(2.0, b, x, -1.0, y);
+      assert(ret == MSP_SUCCESS);
+      for (size_t i = 0; i < n; i++)
+        assert(fabs(y->val[i] - ref[i]) <= 1e-12 * (1.0 + fabs(ref[i])));
+    }
+    csp_print(b);
+    csp_dealloc(b);
+  }
+  coo_dealloc(full);
+  array_dealloc(x);
+  array_dealloc(y);
+  free(ref);
+}
+
+/* Reads a Matrix Market text from memory */
+static coo_t *from_text(const char *text)
+{
+  size_t shape[2], nnz, nread;
+  enum symmetry sym;
+  int pattern;
+  const char *data = mm_parse_header(text, strlen(text), shape, &nnz, &sym, &pattern);
+  if (data == NULL)
+    return NULL;
+  coo_t *a = coo_alloc(shape, nnz);
+  assert(a != NULL);
+  a->sym = sym;
+  if (mm_parse_entries(data, strlen(data), a, 0, nnz, pattern, &nread) != MSP_SUCCESS || nread != nnz)
+  {
+    coo_dealloc(a);
+    return NULL;
+  }
+  a->nnz = nnz;
+  return a;
+}
+
+int main(void) {
+
+  /* Symmetric matrix in half storage */
+  coo_t *a = coo_from_file("../data/MM2.txt");
+  assert(a != NULL && a->sym == Symmetric && a->nnz == 9);
+  coo_print(a);
+  check_mv(a);
+
+  /* Entries in the upper triangle are moved to the lower triangle */
+  for (size_t k = 0; k < a->nnz; k += 2)
+  {
+    size_t i = a->rowidx[k];
+    a->rowidx[k] = a->colidx[k];
+    a->colidx[k] = i;
+  }
+  check_mv(a);
+  csp_t *half = csp_half_from_coo(a, CSR, 0);
+  assert(half != NULL && csp_sell_from_csp(half, 8, 1) == NULL);
+  csp_dealloc(half);
+  assert(csp_sell_from_coo(a, 8, 1) == NULL);
+
+  /* csp_from_coo stores both triangles (also SELL) */
+  coo_t *full = coo_expand(a);
+  assert(full != NULL);
+  for (enum cstype csx = CSC; csx <= SELL; csx++)
+  {
+    csp_t *b = csp_from_coo(a, csx), *c = csp_canonical_from_coo(a, (csx == SELL) ? CSR : csx);
+    assert(b != NULL && b->sym == General && b->nnz == full->nnz);
+    assert(c != NULL && c->sym == General && c->canonical);
+    csp_dealloc(b);
+    csp_dealloc(c);
+  }
+  coo_dealloc(full);
+  assert(csp_half_from_coo(full = coo_from_file("../data/MM1.txt"), CSR, 0) == NULL);
+  coo_dealloc(full);
+  coo_dealloc(a);
+
+  /* Skew-symmetric integer matrix */
+  a = from_text("%%MatrixMarket matrix coordinate integer skew-symmetric\n"
+                "4 4 4\n2 1 3\n3 1 -1\n4 2 7\n4 3 2\n");
+  assert(a != NULL && a->sym == SkewSymmetric && a->val[2] == 7.0);
+  check_mv(a);
+  size_t i = a->rowidx[1];
+  a->rowidx[1] = a->colidx[1];
+  a->colidx[1] = i;
+  a->val[1] = -a->val[1];
+  check_mv(a);
+  coo_dealloc(a);
+  assert(from_text("%%MatrixMarket matrix coordinate real skew-symmetric\n2 2 1\n1 1 1.0\n") == NULL);
+
+  /* Symmetric pattern matrix */
+  a = from_text("%%MatrixMarket matrix coordinate pattern symmetric\n"
+                "% comment\n3 3 4\n1 1\n2 1\n3 2\n3 3\n");
+  assert(a != NULL && a->sym == Symmetric && a->val[1] == 1.0);
+  check_mv(a);
+  coo_dealloc(a);
+
+  /* Unsupported or inconsistent headers */
+  assert(from_text("%%MatrixMarket matrix coordinate complex general\n2 2 1\n1 1 1.0 0.0\n") == NULL);
+  assert(from_text("%%MatrixMarket matrix coordinate real hermitian\n2 2 1\n1 1 1.0\n") == NULL);
+  assert(from_text("%%MatrixMarket matrix coordinate real symmetric\n2 3 1\n1 1 1.0\n") == NULL);
+  assert(from_text("%%MatrixMarket matrix coordinate pattern general\n2 2 1\n1 1 1.0\n") == NULL);
+
+  return EXIT_SUCCESS;
+}
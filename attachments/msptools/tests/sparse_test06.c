@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "msptools.h"
+
+#define BINFILE "../data/MM1_copy.bin"
+
+/* Checks that two compressed sparse matrices have the same layout and entries */
+static void check_equal(const csp_t *a, const csp_t *b)
+{
+  assert(a->shape[0] == b->shape[0] && a->shape[1] == b->shape[1]);
+  assert(a->csx == b->csx && a->sym == b->sym && a->nnz == b->nnz);
+  size_t m = a->shape[0];
+  size_t nptr = ((a->csx == CSC) ? a->shape[1] : (a->csx == CSR) ? m : (m + a->chunk - 1) / a->chunk) + 1;
+  assert(memcmp(a->ptr, b->ptr, nptr * sizeof(size_t)) == 0);
+  assert(memcmp(a->idx, b->idx, a->ptr[nptr - 1] * sizeof(size_t)) == 0);
+  assert(memcmp(a->val, b->val, a->ptr[nptr - 1] * sizeof(double)) == 0);
+  if (a->csx == SELL)
+    assert(a->chunk == b->chunk && memcmp(a->perm, b->perm, m * sizeof(size_t)) == 0);
+}
+
+/* Changes one byte of a file */
+static void corrupt(const char *filename, long offset)
+{
+  FILE *fp = fopen(filename, "r+b");
+  assert(fp != NULL);
+  fseek(fp, offset, SEEK_SET);
+  int c = fgetc(fp);
+  fseek(fp, offset, SEEK_SET);
+  fputc(c ^ 0x10, fp);
+  fclose(fp);
+}
+
+int main(void) {
+
+  coo_t *a = coo_from_file("../data/MM1.txt");
+  coo_t *s = coo_from_file("../data/MM2.txt");
+  assert(a != NULL && s != NULL);
+  csp_t *mats[4] = {csp_from_coo(a, CSC), csp_from_coo(a, CSR), csp_sell_from_coo(a, 4, 2),
+                    csp_half_from_coo(s, CSR, 0)};
+
+  for (int k = 0; k < 4; k++)
+  {
+    assert(mats[k] != NULL && !mats[k]->readonly);
+    assert(csp_to_binary(BINFILE, mats[k]) == MSP_SUCCESS);
+    csp_t *b = csp_from_binary(BINFILE, 1);
+    assert(b != NULL && b->readonly);
+    assert((size_t)((char *)b->ptr - (char *)b->map) % CSP_BINARY_ALIGN == 0);
+    assert((size_t)((char *)b->val - (char *)b->map) % CSP_BINARY_ALIGN == 0);
+    check_equal(mats[k], b);
+
+    /* SpMV with the mapped matrix */
+    size_t m = b->shape[0], n = b->shape[1];
+    array_t *x = array_zeros(n), *y = array_zeros(m), *yref = array_zeros(m);
+    for (size_t i = 0; i < n; i++)
+      x->val[i] = 1.0 + i;
+    assert(csp_spmv(1.0, mats[k], x, 0.0, yref) == MSP_SUCCESS);
+    assert(csp_spmv(1.0, b, x, 0.0, y) == MSP_SUCCESS);
+    assert(memcmp(y->val, yref->val, m * sizeof(double)) == 0);
+    array_dealloc(x);
+    array_dealloc(y);
+    array_dealloc(yref);
+    csp_dealloc(b);
+  }
+  csp_print(mats[3]);
+
+  /* A corrupted value is detected by the data checksum */
+  corrupt(BINFILE, 3 * CSP_BINARY_ALIGN); /* first value (small matrix: one page per section) */
+  csp_t *b = csp_from_binary(BINFILE, 0);
+  assert(b != NULL);
+  csp_dealloc(b);
+  assert(csp_from_binary(BINFILE, 1) == NULL);
+
+  /* A corrupted header is always detected */
+  assert(csp_to_binary(BINFILE, mats[3]) == MSP_SUCCESS);
+  corrupt(BINFILE, 40); /* shape */
+  assert(csp_from_binary(BINFILE, 0) == NULL);
+  assert(csp_from_binary("../data/MM1.txt", 0) == NULL);
+  remove(BINFILE);
+
+  for (int k = 0; k < 4; k++)
+    csp_dealloc(mats[k]);
+  coo_dealloc(a);
+  coo_dealloc(s);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "msptools.h"
+
+/* Checks that the indices are strictly increasing in each column/row */
+static void check_canonical(const csp_t *b)
+{
+  size_t N = (b->csx == CSC) ? b->shape[1] : b->shape[0];
+  assert(b->canonical && b->ptr[0] == 0 && b->ptr[N] == b->nnz);
+  for (size_t o = 0; o < N; o++)
+    for (size_t k = b->ptr[o] + 1; k < b->ptr[o + 1]; k++)
+      assert(b->idx[k - 1] < b->idx[k]);
+}
+
+/* Checks y = A*x and y = A^T*x for two matrices that represent the same A */
+static void check_mv(const csp_t *a, const csp_t *b)
+{
+  size_t m = a->shape[0], n = a->shape[1], len = (m > n) ? m : n;
+  array_t *x = array_zeros(len), *y = array_zeros(len), *z = array_zeros(len);
+  assert(x != NULL && y != NULL && z != NULL);
+  for (int trans = 0; trans <= 1; trans++)
+  {
+    x->len = trans ? m : n;
+    y->len = z->len = trans ? n : m;
+    for (size_t i = 0; i < x->len; i++)
+      x->val[i] = 1.0 + i;
+    assert((trans ? csp_spmv_t(1.0, a, x, 0.0, y) : csp_spmv(1.0, a, x, 0.0, y)) == MSP_SUCCESS);
+    assert((trans ? csp_spmv_t(1.0, b, x, 0.0, z) : csp_spmv(1.0, b, x, 0.0, z)) == MSP_SUCCESS);
+    for (size_t i = 0; i < y->len; i++)
+      assert(fabs(y->val[i] - z->val[i]) <= 1e-12 * (1.0 + fabs(y->val[i])));
+  }
+  array_dealloc(x);
+  array_dealloc(y);
+  array_dealloc(z);
+}
+
+int main(void) {
+
+  coo_t *a = coo_from_file("../data/MM1.txt");
+  assert(a != NULL);
+
+  /* Entries in reverse order, each one split into three duplicates */
+  coo_t *d = coo_alloc(a->shape, 3 * a->nnz);
+  assert(d != NULL);
+  for (size_t k = 0; k < a->nnz; k++)
+    for (size_t l = 0; l < 3; l++)
+    {
+      size_t e = 3 * (a->nnz - 1 - k) + l;
+      d->rowidx[e] = a->rowidx[k];
+      d->colidx[e] = a->colidx[k];
+      d->val[e] = (l == 0) ? a->val[k] : (l == 1) ? 1.0 : -1.0;
+    }
+  d->nnz = 3 * a->nnz;
+
+  for (enum cstype csx = CSC; csx <= CSR; csx++)
+  {
+    csp_t *ref = csp_from_coo(a, csx), *b = csp_canonical_from_coo(d, csx);
+    assert(ref != NULL && !ref->canonical && b != NULL);
+    check_canonical(b);
+    assert(b->nnz == a->nnz);
+    check_mv(ref, b);
+    csp_print(b);
+
+    /* The flag is kept in binary files */
+    assert(csp_to_binary("../data/MM1_copy.bin", b) == MSP_SUCCESS);
+    csp_t *c = csp_from_binary("../data/MM1_copy.bin", 1);
+    assert(c != NULL && c->canonical);
+    check_mv(ref, c);
+    csp_dealloc(c);
+    remove("../data/MM1_copy.bin");
+
+    csp_dealloc(ref);
+    csp_dealloc(b);
+  }
+  assert(csp_canonical_from_coo(a, SELL) == NULL);
+  coo_dealloc(d);
+  coo_dealloc(a);
+
+  /* Half storage with entries in both triangles (canonical SpMV fast path) */
+  coo_t *s = coo_from_file("../data/MM2.txt");
+  assert(s != NULL);
+  for (size_t k = 1; k < s->nnz; k += 2)
+  {
+    size_t i = s->rowidx[k];
+    s->rowidx[k] = s->colidx[k];
+    s->colidx[k] = i;
+  }
+  coo_t *full = coo_expand(s);
+  csp_t *ref = csp_from_coo(full, CSR);
+  assert(full != NULL && ref != NULL);
+  for (enum cstype csx = CSC; csx <= CSR; csx++)
+  {
+    csp_t *b = csp_half_from_coo(s, csx, 1);
+    assert(b != NULL && b->sym == Symmetric && b->nnz == s->nnz);
+    check_canonical(b);
+    check_mv(ref, b);
+    csp_dealloc(b);
+  }
+  csp_dealloc(ref);
+  coo_dealloc(full);
+  coo_dealloc(s);
+
+  return EXIT_SUCCESS;
+}
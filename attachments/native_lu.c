@@ -0,0 +1,378 @@
+#include "native_lu.h"
+#include <stdlib.h>
+#include <math.h>
+
+// Panels with at most NATIVE_NB columns are factored by the unblocked kernel
+#define NATIVE_NB 16
+
+// Cache blocking of the matrix-matrix update: packed blocks of A (GEMM_MC x
+// GEMM_KC) and B (GEMM_KC x GEMM_NC) are multiplied by a GEMM_MR x GEMM_NR
+// register-blocked micro-kernel
+#define GEMM_MC 96
+#define GEMM_KC 256
+#define GEMM_NC 2048
+#define GEMM_MR 8
+#define GEMM_NR 4
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// C := C - A*B for an mr-by-nr block of C, with A and B packed (kc steps)
+static void micro_kernel(size_t kc, const double *restrict a, const double *restrict b,
+                         double *restrict C, size_t ldc, size_t mr, size_t nr)
+{
+  double acc[GEMM_MR * GEMM_NR] = {0.0};
+  for (size_t p = 0; p < kc; p++)
+  {
+    for (size_t j = 0; j < GEMM_NR; j++)
+    {
+      double bj = b[j];
+      for (size_t i = 0; i < GEMM_MR; i++)
+        acc[i + j * GEMM_MR] += a[i] * bj;
+    }
+    a += GEMM_MR;
+    b += GEMM_NR;
+  }
+  for (size_t j = 0; j < nr; j++)
+    for (size_t i = 0; i < mr; i++)
+      C[i + j * ldc] -= acc[i + j * GEMM_MR];
+}
+
+// C := C - A*B with A m-by-k, B k-by-n and C m-by-n (ColMajor)
+static void gemm_sub(size_t m, size_t n, size_t k,
+                     const double *restrict A, size_t lda,
+                     const double *restrict B, size_t ldb,
+                     double *restrict C, size_t ldc)
+{
+  if (m == 0 || n == 0 || k == 0)
+    return;
+  double *Ap = malloc(GEMM_MC * GEMM_KC * sizeof(double));
+  double *Bp = malloc(GEMM_KC * (MIN(GEMM_NC, n) + GEMM_NR) * sizeof(double));
+  if (Ap == NULL || Bp == NULL)
+  {
+    // Unpacked fallback: column-oriented updates
+    free(Ap);
+    free(Bp);
+    for (size_t j = 0; j < n; j++)
+      for (size_t p = 0; p < k; p++)
+      {
+        double bpj = B[p + j * ldb];
+        for (size_t i = 0; i < m; i++)
+          C[i + j * ldc] -= A[i + p * lda] * bpj;
+      }
+    return;
+  }
+
+  for (size_t jj = 0; jj < n; jj += GEMM_NC)
+  {
+    size_t nc = MIN(GEMM_NC, n - jj);
+    for (size_t pp = 0; pp < k; pp += GEMM_KC)
+    {
+      size_t kc = MIN(GEMM_KC, k - pp);
+
+      // Pack B(pp:pp+kc, jj:jj+nc) in panels of GEMM_NR columns (zero padded)
+      for (size_t jr = 0; jr < nc; jr += GEMM_NR)
+      {
+        double *bp = Bp + jr * kc;
+        size_t nr = MIN(GEMM_NR, nc - jr);
+        for (size_t p = 0; p < kc; p++)
+          for (size_t j = 0; j < GEMM_NR; j++)
+            *bp++ = (j < nr) ? B[pp + p + (jj + jr + j) * ldb] : 0.0;
+      }
+
+      for (size_t ii = 0; ii < m; ii += GEMM_MC)
+      {
+        size_t mc = MIN(GEMM_MC, m - ii);
+
+        // Pack A(ii:ii+mc, pp:pp+kc) in panels of GEMM_MR rows (zero padded)
+        for (size_t ir = 0; ir < mc; ir += GEMM_MR)
+        {
+          double *ap = Ap + ir * kc;
+          size_t mr = MIN(GEMM_MR, mc - ir);
+          for (size_t p = 0; p < kc; p++)
+          {
+            const double *a = A + ii + ir + (pp + p) * lda;
+            for (size_t i = 0; i < GEMM_MR; i++)
+              *ap++ = (i < mr) ? a[i] : 0.0;
+          }
+        }
+
+        for (size_t jr = 0; jr < nc; jr += GEMM_NR)
+          for (size_t ir = 0; ir < mc; ir += GEMM_MR)
+            micro_kernel(kc, Ap + ir * kc, Bp + jr * kc,
+                         C + ii + ir + (jj + jr) * ldc, ldc,
+                         MIN(GEMM_MR, mc - ir), MIN(GEMM_NR, nc - jr));
+      }
+    }
+  }
+  free(Ap);
+  free(Bp);
+}
+
+// Swaps rows k and ipiv[k]-1 for k = k0..k1-1 in the n columns of A
+static void laswp(size_t n, double *A, size_t lda, const int *ipiv, size_t k0, size_t k1)
+{
+  for (size_t j = 0; j < n; j++)
+  {
+    double *a = A + j * lda;
+    for (size_t k = k0; k < k1; k++)
+    {
+      size_t p = (size_t)ipiv[k] - 1;
+      if (p != k)
+      {
+        double t = a[k];
+        a[k] = a[p];
+        a[p] = t;
+      }
+    }
+  }
+}
+
+// Solves L*X = B in place with L m-by-m unit lower triangular (recursive)
+static void trsm_llnu(size_t m, size_t n, const double *L, size_t ldl, double *B, size_t ldb)
+{
+  if (m <= NATIVE_NB)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      double *b = B + j * ldb;
+      for (size_t k = 0; k < m; k++)
+      {
+        double bk = b[k];
+        const double *l = L + k * ldl;
+        for (size_t i = k + 1; i < m; i++)
+          b[i] -= l[i] * bk;
+      }
+    }
+    return;
+  }
+  size_t m1 = m / 2;
+  trsm_llnu(m1, n, L, ldl, B, ldb);
+  gemm_sub(m - m1, n, m1, L + m1, ldl, B, ldb, B + m1, ldb);
+  trsm_llnu(m - m1, n, L + m1 + m1 * ldl, ldl, B + m1, ldb);
+}
+
+// Unblocked LU factorization with partial pivoting of an m-by-n panel
+static int getf2(size_t m, size_t n, double *A, size_t lda, int *ipiv)
+{
+  int info = 0;
+  size_t mn = MIN(m, n);
+  for (size_t j = 0; j < mn; j++)
+  {
+    double *a = A + j * lda;
+    size_t p = j;
+    double amax = fabs(a[j]);
+    for (size_t i = j + 1; i < m; i++)
+    {
+      if (fabs(a[i]) > amax)
+      {
+        amax = fabs(a[i]);
+        p = i;
+      }
+    }
+    ipiv[j] = (int)p + 1;
+    if (amax == 0.0)
+    {
+      if (info == 0)
+        info = (int)j + 1;
+      continue;
+    }
+    if (p != j)
+    {
+      for (size_t c = 0; c < n; c++)
+      {
+        double t = A[j + c * lda];
+        A[j + c * lda] = A[p + c * lda];
+        A[p + c * lda] = t;
+      }
+    }
+    double r = 1.0 / a[j];
+    for (size_t i = j + 1; i < m; i++)
+      a[i] *= r;
+    for (size_t c = j + 1; c < n; c++)
+    {
+      double *ac = A + c * lda;
+      double ajc = ac[j];
+      for (size_t i = j + 1; i < m; i++)
+        ac[i] -= a[i] * ajc;
+    }
+  }
+  return info;
+}
+
+// Recursive LU factorization with partial pivoting (as in LAPACK's DGETRF2)
+static int rgetrf(size_t m, size_t n, double *A, size_t lda, int *ipiv)
+{
+  size_t mn = MIN(m, n);
+  if (mn == 0)
+    return 0;
+  if (n <= NATIVE_NB)
+    return getf2(m, n, A, lda, ipiv);
+
+  // at least one column on the left, or a wide panel (m < n) would recurse on itself when mn == 1
+  size_t n1 = (mn > 1) ? mn / 2 : 1, n2 = n - n1;
+  double *A12 = A + n1 * lda, *A21 = A + n1, *A22 = A + n1 + n1 * lda;
+
+  // [A11; A21] = P1*[L11; L21]*U11
+  int info = rgetrf(m, n1, A, lda, ipiv);
+
+  // A12 = L11^-1 * P1*A12 and A22 = A22 - A21*A12
+  laswp(n2, A12, lda, ipiv, 0, n1);
+  trsm_llnu(n1, n2, A, lda, A12, lda);
+  gemm_sub(m - n1, n2, n1, A21, lda, A12, lda, A22, lda);
+
+  // A22 = P2*L22*U22
+  int iinfo = rgetrf(m - n1, n2, A22, lda, ipiv + n1);
+  if (info == 0 && iinfo > 0)
+    info = iinfo + (int)n1;
+  for (size_t k = n1; k < mn; k++)
+    ipiv[k] += (int)n1;
+
+  // Apply P2 to A21
+  laswp(n1, A, lda, ipiv, n1, mn);
+  return info;
+}
+
+int native_dgetrf(int m, int n, double *A, int lda, int *ipiv)
+/*
+  Purpose:
+
+    Computes the LU factorization P*A = L*U of a ColMajor m-by-n matrix with
+    partial pivoting, with the same arguments and output as LAPACK's DGETRF
+    (pivot indices are 1-based). The factorization is recursive: the left
+    half of the columns is factored, the right half is updated with a
+    triangular solve and a cache-blocked matrix-matrix product, and the
+    trailing submatrix is factored recursively. Most of the flops are thus
+    spent in the matrix-matrix product, which works on blocks that stay in
+    cache. Panels of at most 16 columns use an unblocked kernel.
+
+    A RowMajor matrix is factored by passing its buffer, i.e. A^T (see
+    call_dgesv), and solving with trans = 'T'.
+
+  Return value:
+    0 if successful, -1 if an argument is illegal, and i > 0 if U(i,i) is
+    exactly zero (the factorization is completed, but U is singular).
+*/
+{
+  if (m < 0 || n < 0 || lda < (m > 1 ? m : 1) || A == NULL || ipiv == NULL)
+    return -1;
+  return rgetrf((size_t)m, (size_t)n, A, (size_t)lda, ipiv);
+}
+
+int native_dtrsm(char uplo, char trans, char diag, int m, int nrhs, const double *A, int lda, double *B, int ldb)
+/*
+  Purpose:
+
+    Solves op(A)*X = B in place, where A is an m-by-m triangular ColMajor
+    matrix ('L'ower or 'U'pper), op(A) is A or A^T ('N' or 'T'), and the
+    diagonal of A is assumed to be ones if diag = 'U'.
+
+  Return value:
+    0 if successful, and -1 if an argument is illegal.
+*/
+{
+  if (m < 0 || nrhs < 0 || lda < (m > 1 ? m : 1) || ldb < (m > 1 ? m : 1))
+    return -1;
+  int lower = (uplo == 'L' || uplo == 'l');
+  int notrans = (trans == 'N' || trans == 'n');
+  int unit = (diag == 'U' || diag == 'u');
+  size_t M = (size_t)m, ld = (size_t)lda;
+
+  if (lower && notrans && unit)
+  {
+    trsm_llnu(M, (size_t)nrhs, A, ld, B, (size_t)ldb);
+    return 0;
+  }
+  for (int j = 0; j < nrhs; j++)
+  {
+    double *b = B + (size_t)j * ldb;
+    if (notrans && lower)
+    {
+      // forward substitution, column oriented
+      for (size_t k = 0; k < M; k++)
+      {
+        if (!unit)
+          b[k] /= A[k + k * ld];
+        for (size_t i = k + 1; i < M; i++)
+          b[i] -= A[i + k * ld] * b[k];
+      }
+    }
+    else if (notrans)
+    {
+      // backward substitution, column oriented
+      for (size_t k = M; k-- > 0;)
+      {
+        if (!unit)
+          b[k] /= A[k + k * ld];
+        for (size_t i = 0; i < k; i++)
+          b[i] -= A[i + k * ld] * b[k];
+      }
+    }
+    else if (lower)
+    {
+      // L^T is upper triangular: backward substitution with column dot products
+      for (size_t i = M; i-- > 0;)
+      {
+        double s = b[i];
+        for (size_t k = i + 1; k < M; k++)
+          s -= A[k + i * ld] * b[k];
+        b[i] = unit ? s : s / A[i + i * ld];
+      }
+    }
+    else
+    {
+      // U^T is lower triangular: forward substitution with column dot products
+      for (size_t i = 0; i < M; i++)
+      {
+        double s = b[i];
+        for (size_t k = 0; k < i; k++)
+          s -= A[k + i * ld] * b[k];
+        b[i] = unit ? s : s / A[i + i * ld];
+      }
+    }
+  }
+  return 0;
+}
+
+int native_dgetrs(char trans, int n, int nrhs, const double *A, int lda, const int *ipiv, double *B, int ldb)
+/*
+  Purpose:
+
+    Solves A*X = B (trans = 'N') or A^T*X = B (trans = 'T') with the LU
+    factors computed by native_dgetrf, with the same arguments as LAPACK's
+    DGETRS. B is overwritten by the solution X.
+
+  Return value:
+    0 if successful, and -1 if an argument is illegal.
+*/
+{
+  if (n < 0 || nrhs < 0 || lda < (n > 1 ? n : 1) || ldb < (n > 1 ? n : 1))
+    return -1;
+  if (trans == 'N' || trans == 'n')
+  {
+    // X = U^-1 * L^-1 * P*B
+    laswp((size_t)nrhs, B, (size_t)ldb, ipiv, 0, (size_t)n);
+    native_dtrsm('L', 'N', 'U', n, nrhs, A, lda, B, ldb);
+    native_dtrsm('U', 'N', 'N', n, nrhs, A, lda, B, ldb);
+  }
+  else
+  {
+    // X = P^T * L^-T * U^-T * B
+    native_dtrsm('U', 'T', 'N', n, nrhs, A, lda, B, ldb);
+    native_dtrsm('L', 'T', 'U', n, nrhs, A, lda, B, ldb);
+    for (size_t j = 0; j < (size_t)nrhs; j++)
+    {
+      double *b = B + j * ldb;
+      for (size_t k = (size_t)n; k-- > 0;)
+      {
+        size_t p = (size_t)ipiv[k] - 1;
+        if (p != k)
+        {
+          double t = b[k];
+          b[k] = b[p];
+          b[p] = t;
+        }
+      }
+    }
+  }
+  return 0;
+}
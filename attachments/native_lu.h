@@ -0,0 +1,9 @@
+#ifndef NATIVE_LU_H
+#define NATIVE_LU_H
+
+/* Native replacements for LAPACK's DGETRF/DGETRS (ColMajor, 1-based pivots) */
+int native_dgetrf(int m, int n, double *A, int lda, int *ipiv);
+int native_dgetrs(char trans, int n, int nrhs, const double *A, int lda, const int *ipiv, double *B, int ldb);
+int native_dtrsm(char uplo, char trans, char diag, int m, int nrhs, const double *A, int lda, double *B, int ldb);
+
+#endif
@@ -0,0 +1,407 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ooc_lu.h"
+#include "array2d.h"
+#include "lapack.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+typedef struct io_req /* panel transfer run on the I/O thread */
+{
+  int fd;
+  double *buf;
+  size_t count; // number of doubles
+  off_t off;    // byte offset in the file
+  int write;
+  int err;
+} io_req_t;
+
+// Reads or writes count doubles at byte offset off, retrying partial transfers
+static int transfer(int fd, double *buf, size_t count, off_t off, int write)
+{
+  char *p = (char *)buf;
+  size_t left = count * sizeof(double);
+  while (left > 0)
+  {
+    ssize_t r = write ? pwrite(fd, p, left, off) : pread(fd, p, left, off);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return -1;
+    p += r;
+    off += r;
+    left -= (size_t)r;
+  }
+  return 0;
+}
+
+static void io_task(void *arg)
+{
+  io_req_t *req = arg;
+  req->err = transfer(req->fd, req->buf, req->count, req->off, req->write);
+}
+
+// Byte offset of element (i, j) of A in the panel file (panel j/nb is a
+// ColMajor n-by-nb block)
+static off_t panel_offset(const ooc_lu_t *lu, size_t i, size_t j)
+{
+  size_t k = j / lu->nb;
+  return (off_t)((k * lu->nb * lu->n + (j - k * lu->nb) * lu->n + i) * sizeof(double));
+}
+
+// Number of columns of panel k
+static size_t panel_width(const ooc_lu_t *lu, size_t k)
+{
+  size_t w = lu->n - k * lu->nb;
+  return (w < lu->nb) ? w : lu->nb;
+}
+
+// Queues the transfer of panel k on the I/O thread
+static void panel_io(ooc_lu_t *lu, io_req_t *req, size_t k, double *buf, int write)
+{
+  req->fd = lu->fd;
+  req->buf = buf;
+  req->count = lu->n * panel_width(lu, k);
+  req->off = panel_offset(lu, 0, k * lu->nb);
+  req->write = write;
+  req->err = 0;
+  // a transfer that cannot be queued is done synchronously
+  if (threadpool_submit(lu->io, io_task, req) != MSP_SUCCESS)
+    io_task(req);
+}
+
+/* ooc_lu_from_file : loads a matrix into an out-of-core LU object
+
+Purpose:
+Reads a square matrix from a text file (in the format read by
+array2d_from_file) into a binary panel file without holding A in memory. The
+matrix is split into np column panels of nb columns, and each panel is stored
+in the file as a contiguous ColMajor n-by-nb block. The file is a temporary
+file in $TMPDIR (or /tmp) that is removed when it is closed.
+
+At most mem_limit bytes are used for matrix data: three panels are kept in
+memory during the factorization, so nb = mem_limit / (3*8*n) (at most n).
+The rows of A are read in blocks that fit in the same buffers.
+
+Return value:
+A pointer to an ooc_lu_t, or NULL if an error occurs (e.g. if A is not
+square or mem_limit is too small for a single column per panel).
+*/
+ooc_lu_t *ooc_lu_from_file(const char *file_A, size_t mem_limit)
+{
+  FILE *fa = fopen(file_A, "r");
+  char *line = NULL;
+  size_t sz_line = 0, n = 0;
+  ooc_lu_t *lu = NULL;
+  if (fa == NULL)
+  {
+    fprintf(stderr, "Error: could not open %s\n", file_A);
+    return NULL;
+  }
+
+  // the first line of A determines its order
+  if (getline(&line, &sz_line, fa) < 0 || (n = array2d_parse_row(line, NULL, 0)) == 0)
+  {
+    fprintf(stderr, "Error: could not read the first row of %s\n", file_A);
+    goto fail;
+  }
+  if (!lapack_int_fits(n))
+  {
+    fprintf(stderr, "Error: n = %zu is too large for the LAPACK integer type\n", n);
+    goto fail;
+  }
+  size_t nb = mem_limit / (3 * sizeof(double) * n);
+  if (nb == 0)
+  {
+    fprintf(stderr, "Error: a memory limit of %zu bytes is too small for n = %zu\n", mem_limit, n);
+    goto fail;
+  }
+  if (nb > n)
+    nb = n;
+
+  lu = calloc(1, sizeof(*lu));
+  if (lu == NULL)
+    goto mem_fail;
+  lu->fd = -1;
+  lu->n = n;
+  lu->nb = nb;
+  lu->np = (n + nb - 1) / nb;
+  lu->ipiv = malloc(n * sizeof(*lu->ipiv));
+  lu->buf = malloc(3 * n * nb * sizeof(double));
+  lu->io = threadpool_alloc(1);
+  if (lu->ipiv == NULL || lu->buf == NULL || lu->io == NULL)
+    goto mem_fail;
+
+  const char *dir = getenv("TMPDIR");
+  char *path = malloc(strlen(dir ? dir : "/tmp") + 32);
+  if (path == NULL)
+    goto mem_fail;
+  sprintf(path, "%s/msp_ooc_XXXXXX", dir ? dir : "/tmp");
+  lu->fd = mkstemp(path);
+  if (lu->fd >= 0)
+    unlink(path);
+  else
+    fprintf(stderr, "Error: could not create a panel file in %s\n", dir ? dir : "/tmp");
+  free(path);
+  if (lu->fd < 0)
+    goto fail;
+
+  // read blocks of rows and scatter their columns to the panels (the panel
+  // buffers hold chunk rows and one column of chunk elements)
+  size_t chunk = 3 * nb * n / (n + 1), rows = 0, i0 = 0;
+  if (chunk > n)
+    chunk = n;
+  double *rowbuf = lu->buf, *colbuf = lu->buf + chunk * n;
+  for (int more = 1; more;)
+  {
+    rows = 0;
+    do
+    {
+      if (array2d_parse_row(line, rowbuf + rows * n, n) != n)
+      {
+        if (strspn(line, " \t\r\n") == strlen(line))
+        {
+          more = 0;
+          break;
+        }
+        fprintf(stderr, "Error: different column counts encountered.\n");
+        goto fail;
+      }
+      rows++;
+      if (getline(&line, &sz_line, fa) < 0)
+      {
+        more = 0;
+        break;
+      }
+    } while (rows < chunk);
+    if (i0 + rows > n)
+    {
+      fprintf(stderr, "Error: %s has more rows than columns\n", file_A);
+      goto fail;
+    }
+    for (size_t j = 0; j < n && rows > 0; j++)
+    {
+      for (size_t r = 0; r < rows; r++)
+        colbuf[r] = rowbuf[r * n + j];
+      if (transfer(lu->fd, colbuf, rows, panel_offset(lu, i0, j), 1) != 0)
+      {
+        fprintf(stderr, "Error: failed to write the panel file\n");
+        goto fail;
+      }
+    }
+    i0 += rows;
+  }
+  if (i0 != n)
+  {
+    fprintf(stderr, "Error: matrix A in %s is not square\n", file_A);
+    goto fail;
+  }
+  fclose(fa);
+  free(line);
+  return lu;
+
+mem_fail:
+  fprintf(stderr, "Error: Failed to allocate memory\n");
+fail:
+  fclose(fa);
+  free(line);
+  ooc_lu_dealloc(lu);
+  return NULL;
+}
+
+void ooc_lu_dealloc(ooc_lu_t *lu)
+/* Purpose: Deallocates an ooc_lu_t and removes its panel file. */
+{
+  if (lu == NULL)
+    return;
+  threadpool_dealloc(lu->io);
+  if (lu->fd >= 0)
+    close(lu->fd);
+  free(lu->ipiv);
+  free(lu->buf);
+  free(lu);
+}
+
+/* ooc_lu_factor : left-looking out-of-core LU factorization
+
+Purpose:
+Computes the LU factorization with partial pivoting of the matrix in the
+panel file of lu, panel by panel. For panel j, the panel is read into memory
+and updated with the factors of all previous panels k < j, which are streamed
+from disk one at a time: the row interchanges of panel k are applied, the
+block row of U is computed with DTRSM and the rows below are updated with
+DGEMM. The panel is then factored with DGETRF and written back. Only three
+panels are in memory at any time, and the next panel k+1 is read by the I/O
+thread while panel k is being applied, so the reads (O(np^2) panels in
+total) overlap with the computation.
+
+The interchanges of panel j are not applied to the L factors of earlier
+panels (as DGETRF does); ooc_lu_solve applies them to b in the same order
+instead.
+
+Return value:
+The function returns the output `info` from LAPACK (info > 0 if U(info,info)
+is exactly zero) with the following exceptions: the return value is
+
+  -9 if the input lu is NULL
+  -13 if reading or writing the panel file fails.
+*/
+int ooc_lu_factor(ooc_lu_t *lu)
+{
+  if (lu == NULL)
+  {
+    return -9;
+  }
+  size_t n = lu->n, nb = lu->nb;
+  lapack_int in = (lapack_int)n, info = 0;
+  double *T = lu->buf, *S[2] = {lu->buf + n * nb, lu->buf + 2 * n * nb};
+  io_req_t req[2];
+
+  for (size_t j = 0; j < lu->np; j++)
+  {
+    lapack_int wj = (lapack_int)panel_width(lu, j);
+    panel_io(lu, req, j, T, 0);
+    if (j > 0)
+      panel_io(lu, req + 1, 0, S[0], 0);
+    threadpool_wait(lu->io);
+    if (req[0].err)
+      return -13;
+
+    for (size_t k = 0; k < j; k++)
+    {
+      // panel k is in S[k%2]; prefetch panel k+1 while it is applied
+      threadpool_wait(lu->io);
+      if (req[(k + 1) % 2].err)
+        return -13;
+      if (k + 1 < j)
+        panel_io(lu, req + k % 2, k + 1, S[(k + 1) % 2], 0);
+      const double *P = S[k % 2];
+      size_t r0 = k * nb;
+      lapack_int wk = (lapack_int)nb, mb = (lapack_int)(n - r0 - nb);
+
+      // interchanges of panel k
+      for (size_t r = r0; r < r0 + nb; r++)
+      {
+        size_t p = (size_t)lu->ipiv[r] - 1;
+        if (p == r)
+          continue;
+        for (size_t c = 0; c < (size_t)wj; c++)
+        {
+          double t = T[r + c * n];
+          T[r + c * n] = T[p + c * n];
+          T[p + c * n] = t;
+        }
+      }
+
+      // U_kj = L_kk^-1 * A_kj, A_ij = A_ij - L_ik*U_kj for the rows below
+      char side = 'L', uplo = 'L', trans = 'N', diag = 'U';
+      double one = 1.0, mone = -1.0;
+      dtrsm_(&side, &uplo, &trans, &diag, &wk, &wj, &one, (double *)P + r0, &in, T + r0, &in);
+      if (mb > 0)
+        dgemm_(&trans, &trans, &mb, &wj, &wk, &mone, (double *)P + r0 + nb, &in, T + r0, &in,
+               &one, T + r0 + nb, &in);
+    }
+
+    // factor the part of the panel on and below the diagonal
+    size_t rj = j * nb;
+    lapack_int m = (lapack_int)(n - rj), pinfo;
+    dgetrf_(&m, &wj, T + rj, &in, lu->ipiv + rj, &pinfo);
+    for (size_t r = rj; r < rj + (size_t)wj; r++)
+      lu->ipiv[r] += (lapack_int)rj;
+    if (pinfo > 0 && info == 0)
+      info = (lapack_int)rj + pinfo;
+
+    panel_io(lu, req, j, T, 1);
+    threadpool_wait(lu->io);
+    if (req[0].err)
+      return -13;
+  }
+  lu->factored = 1;
+  return (int)info;
+}
+
+/* ooc_lu_solve : solves A*x = b with the factors from ooc_lu_factor
+
+Purpose:
+Solves A*x = b by a forward sweep over the panels (interchanges and L) and a
+backward sweep in reverse order (U), streaming each panel from disk once per
+sweep with the next panel prefetched. Upon exit, b is overwritten by x.
+
+Return value:
+  0 on success,
+  -9 if the input lu and/or b is NULL,
+  -10 if lu has not been factored,
+  -11 if the length of b does not match A,
+  -13 if reading the panel file fails.
+*/
+int ooc_lu_solve(ooc_lu_t *lu, array_t *b)
+{
+  if (lu == NULL || b == NULL)
+  {
+    return -9;
+  }
+  if (!lu->factored)
+  {
+    return -10;
+  }
+  if (b->len != lu->n)
+  {
+    return -11;
+  }
+  size_t n = lu->n, nb = lu->nb, np = lu->np;
+  lapack_int in = (lapack_int)n, nrhs = 1, inc = 1;
+  double *x = b->val, *S[2] = {lu->buf, lu->buf + n * nb}, one = 1.0, mone = -1.0;
+  char side = 'L', uplo, trans = 'N', diag;
+  io_req_t req[2];
+
+  // forward sweep: x = L^-1 * P * b, panel by panel
+  panel_io(lu, req, 0, S[0], 0);
+  for (size_t k = 0; k < np; k++)
+  {
+    threadpool_wait(lu->io);
+    if (req[k % 2].err)
+      return -13;
+    if (k + 1 < np)
+      panel_io(lu, req + (k + 1) % 2, k + 1, S[(k + 1) % 2], 0);
+    double *P = S[k % 2];
+    size_t r0 = k * nb;
+    lapack_int wk = (lapack_int)panel_width(lu, k), mb = (lapack_int)(n - r0) - wk;
+    for (size_t r = r0; r < r0 + (size_t)wk; r++)
+    {
+      size_t p = (size_t)lu->ipiv[r] - 1;
+      double t = x[r];
+      x[r] = x[p];
+      x[p] = t;
+    }
+    uplo = 'L';
+    diag = 'U';
+    dtrsm_(&side, &uplo, &trans, &diag, &wk, &nrhs, &one, P + r0, &in, x + r0, &in);
+    if (mb > 0)
+      dgemv_(&trans, &mb, &wk, &mone, P + r0 + wk, &in, x + r0, &inc, &one, x + r0 + wk, &inc);
+  }
+
+  // backward sweep: x = U^-1 * x, last panel first
+  threadpool_wait(lu->io);
+  panel_io(lu, req, np - 1, S[0], 0);
+  for (size_t s = 0; s < np; s++)
+  {
+    size_t k = np - 1 - s;
+    threadpool_wait(lu->io);
+    if (req[s % 2].err)
+      return -13;
+    if (k > 0)
+      panel_io(lu, req + (s + 1) % 2, k - 1, S[(s + 1) % 2], 0);
+    double *P = S[s % 2];
+    size_t r0 = k * nb;
+    lapack_int wk = (lapack_int)panel_width(lu, k), mb = (lapack_int)r0;
+    uplo = 'U';
+    diag = 'N';
+    dtrsm_(&side, &uplo, &trans, &diag, &wk, &nrhs, &one, P + r0, &in, x + r0, &in);
+    if (mb > 0)
+      dgemv_(&trans, &mb, &wk, &mone, P, &in, x + r0, &inc, &one, x, &inc);
+  }
+  return 0;
+}
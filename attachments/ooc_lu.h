@@ -0,0 +1,24 @@
+#ifndef OOC_LU_H
+#define OOC_LU_H
+#include "array.h"
+#include "threadpool.h"
+#include "lapack.h"
+
+typedef struct ooc_lu /* LU factorization of a matrix kept in an on-disk panel file */
+{
+    size_t n;         // order of A
+    size_t nb;        // panel width (columns per panel)
+    size_t np;        // number of panels
+    int fd;           // panel file (an unlinked temporary file)
+    lapack_int *ipiv; // pivot indices (1-based, as from DGETRF)
+    double *buf;      // three in-memory panels of n*nb elements
+    threadpool_t *io; // I/O thread that prefetches panels
+    int factored;
+} ooc_lu_t;
+
+ooc_lu_t *ooc_lu_from_file(const char *file_A, size_t mem_limit);
+void ooc_lu_dealloc(ooc_lu_t *lu);
+int ooc_lu_factor(ooc_lu_t *lu);
+int ooc_lu_solve(ooc_lu_t *lu, array_t *b);
+
+#endif
@@ -0,0 +1,364 @@
+#define _POSIX_C_SOURCE 200809L
+#include "par_spmv.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct spmv_part /* work of one thread: the merge path from (i0,k0) to (i1,k1) */
+{
+  size_t i0, k0; // first row and first nonzero
+  size_t i1, k1; // row and nonzero where the next part starts
+  double carry;  // partial sum of row i1 (if k1 > ptr[i1])
+} spmv_part_t;
+
+struct spmv_plan
+{
+  size_t shape[2];
+  size_t nthreads;
+  size_t *ptr, *idx; // copy of A, first touched by the thread that uses it
+  double *val;
+  spmv_part_t *part;
+  pthread_t *threads;
+  pthread_mutex_t lock;
+  pthread_cond_t start; // signaled when a new product is posted or on shutdown
+  pthread_cond_t done;  // signaled when the last thread has finished
+  const csp_t *A;       // source matrix (only during spmv_plan_alloc)
+  double alpha, beta;
+  const double *x;
+  double *y;
+  size_t generation; // number of products posted
+  size_t running;    // threads that have not finished the current product
+  int shutdown;
+};
+
+typedef struct spmv_worker
+{
+  spmv_plan_t *plan;
+  size_t t;
+} spmv_worker_t;
+
+/* Finds the point (i, d-i) where diagonal d crosses the merge path of the
+   row ends ptr[1..m] and the nonzero indices 0..nnz-1 */
+static size_t merge_path_search(size_t d, const size_t *ptr, size_t m, size_t nnz)
+{
+  size_t lo = (d > nnz) ? d - nnz : 0, hi = (d < m) ? d : m;
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    if (ptr[mid + 1] > d - 1 - mid)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+/* Copies the part of A that thread t works on (first touch) */
+static void touch_part(spmv_plan_t *plan, size_t t)
+{
+  const spmv_part_t *p = plan->part + t;
+  const csp_t *A = plan->A;
+  memcpy(plan->idx + p->k0, A->idx + p->k0, (p->k1 - p->k0) * sizeof(size_t));
+  memcpy(plan->val + p->k0, A->val + p->k0, (p->k1 - p->k0) * sizeof(double));
+  size_t iend = (t + 1 == plan->nthreads) ? plan->shape[0] + 1 : p->i1;
+  memcpy(plan->ptr + p->i0, A->ptr + p->i0, (iend - p->i0) * sizeof(size_t));
+}
+
+/* Runs thread t's share of y = alpha*A*x + beta*y; the partial sum of the
+   last (unfinished) row is left in carry */
+static void run_part(spmv_plan_t *plan, size_t t)
+{
+  spmv_part_t *p = plan->part + t;
+  const size_t *restrict ptr = plan->ptr, *restrict idx = plan->idx;
+  const double *restrict val = plan->val, *restrict x = plan->x;
+  double *restrict y = plan->y;
+  double alpha = plan->alpha, beta = plan->beta;
+  size_t k = p->k0;
+  for (size_t i = p->i0; i < p->i1; i++)
+  {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t end = ptr[i + 1];
+    for (; k + 4 <= end; k += 4)
+    {
+      s0 += val[k] * x[idx[k]];
+      s1 += val[k + 1] * x[idx[k + 1]];
+      s2 += val[k + 2] * x[idx[k + 2]];
+      s3 += val[k + 3] * x[idx[k + 3]];
+    }
+    for (; k < end; k++)
+      s0 += val[k] * x[idx[k]];
+    double s = (s0 + s1) + (s2 + s3);
+    y[i] = (beta == 0.0) ? alpha * s : beta * y[i] + alpha * s;
+  }
+  double c = 0.0;
+  for (; k < p->k1; k++)
+    c += val[k] * x[idx[k]];
+  p->carry = c;
+}
+
+// Worker loop: runs part t of every posted product until shutdown
+static void *worker(void *arg)
+{
+  spmv_worker_t *w = arg;
+  spmv_plan_t *plan = w->plan;
+  size_t t = w->t, seen = 0;
+  free(w);
+  pthread_mutex_lock(&plan->lock);
+  for (;;)
+  {
+    while (plan->generation == seen && !plan->shutdown)
+      pthread_cond_wait(&plan->start, &plan->lock);
+    if (plan->shutdown)
+      break;
+    seen = plan->generation;
+    pthread_mutex_unlock(&plan->lock);
+
+    if (seen == 1)
+      touch_part(plan, t);
+    else
+      run_part(plan, t);
+
+    pthread_mutex_lock(&plan->lock);
+    if (--plan->running == 0)
+      pthread_cond_signal(&plan->done);
+  }
+  pthread_mutex_unlock(&plan->lock);
+  return NULL;
+}
+
+// Posts the next job (touch or product) to all workers and waits for it
+static void post(spmv_plan_t *plan)
+{
+  pthread_mutex_lock(&plan->lock);
+  plan->generation++;
+  plan->running = plan->nthreads;
+  pthread_cond_broadcast(&plan->start);
+  while (plan->running > 0)
+    pthread_cond_wait(&plan->done, &plan->lock);
+  pthread_mutex_unlock(&plan->lock);
+}
+
+spmv_plan_t *spmv_plan_alloc(const csp_t *A, size_t nthreads, enum spmv_split split)
+/*
+  Purpose:
+
+    Prepares the parallel sparse matrix-vector product y := alpha*A*x +
+    beta*y for a CSR matrix A. The work is divided into one contiguous part
+    per thread, either by merge-path partitioning (SpmvMergePath), which
+    gives every thread the same number of rows plus nonzeros and splits
+    long rows between threads, or by a static split into equal numbers of
+    rows (SpmvRowSplit). For matrices with very uneven row lengths (e.g.
+    power-law graphs), a row split leaves most threads waiting for the one
+    that owns the heaviest rows.
+
+    The plan starts nthreads persistent worker threads and keeps its own
+    copy of A->ptr, A->idx and A->val, where each part is copied by the
+    thread that later multiplies with it. With the first-touch page
+    placement of Linux and most other systems, every part is thus stored on
+    the NUMA node of its thread. Threads are not pinned; bind the process
+    (e.g. numactl --cpunodebind or OMP_PROC_BIND-like settings of the job
+    scheduler) to keep them close to their data. A may be modified or
+    deallocated after the call.
+
+  Example:
+
+    ```c
+    spmv_plan_t *plan = spmv_plan_alloc(A, 8, SpmvMergePath);
+    if (plan==NULL) exit(EXIT_FAILURE);
+    for (size_t it=0;it<100;it++)
+      spmv_plan_exec(plan, 1.0, x, 0.0, y);   // y = A*x
+    spmv_plan_dealloc(plan);
+    ```
+
+  Arguments:
+    A            a pointer to a csp_t in CSR format (not half storage)
+    nthreads     number of threads (0: one per online processor)
+    split        SpmvMergePath or SpmvRowSplit
+
+  Return value:
+    A pointer to an spmv_plan_t, or NULL if an error occurs.
+*/
+{
+  if (A == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return NULL;
+  }
+  if (A->csx != CSR || A->sym != General)
+  {
+    fprintf(stderr, "%s: A must be a general matrix in CSR format\n", __func__);
+    return NULL;
+  }
+  if (nthreads == 0)
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = ncpu > 0 ? (size_t)ncpu : 1;
+  }
+  size_t m = A->shape[0], nnz = A->ptr[m];
+  spmv_plan_t *plan = calloc(1, sizeof(*plan));
+  if (plan == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  pthread_mutex_init(&plan->lock, NULL);
+  pthread_cond_init(&plan->start, NULL);
+  pthread_cond_init(&plan->done, NULL);
+  plan->shape[0] = m;
+  plan->shape[1] = A->shape[1];
+  // Left untouched here so that the workers place the pages
+  plan->ptr = malloc((m + 1) * sizeof(*plan->ptr));
+  plan->idx = malloc((nnz ? nnz : 1) * sizeof(*plan->idx));
+  plan->val = malloc((nnz ? nnz : 1) * sizeof(*plan->val));
+  plan->part = calloc(nthreads, sizeof(*plan->part));
+  plan->threads = malloc(nthreads * sizeof(*plan->threads));
+  if (!plan->ptr || !plan->idx || !plan->val || !plan->part || !plan->threads)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    spmv_plan_dealloc(plan);
+    return NULL;
+  }
+
+  // Parts: diagonals t*(m+nnz)/p of the merge path, or rows t*m/p
+  for (size_t t = 0; t <= nthreads; t++)
+  {
+    size_t i, k;
+    if (split == SpmvMergePath)
+    {
+      size_t d = (size_t)((double)t / nthreads * (m + nnz));
+      d = (t == nthreads || d > m + nnz) ? m + nnz : d;
+      i = merge_path_search(d, A->ptr, m, nnz);
+      k = d - i;
+    }
+    else
+    {
+      i = (t == nthreads) ? m : (size_t)((double)t / nthreads * m);
+      k = A->ptr[i];
+    }
+    if (t < nthreads)
+    {
+      plan->part[t].i0 = i;
+      plan->part[t].k0 = k;
+    }
+    if (t > 0)
+    {
+      plan->part[t - 1].i1 = i;
+      plan->part[t - 1].k1 = k;
+    }
+  }
+
+  for (size_t t = 0; t < nthreads; t++)
+  {
+    spmv_worker_t *w = malloc(sizeof(*w));
+    if (w != NULL)
+      *w = (spmv_worker_t){plan, t};
+    if (w == NULL || pthread_create(plan->threads + t, NULL, worker, w) != 0)
+    {
+      fprintf(stderr, "%s: failed to create thread\n", __func__);
+      free(w);
+      spmv_plan_dealloc(plan);
+      return NULL;
+    }
+    plan->nthreads++;
+  }
+
+  // Generation 1: every worker copies its part of A
+  plan->A = A;
+  post(plan);
+  plan->A = NULL;
+  return plan;
+}
+
+void spmv_plan_dealloc(spmv_plan_t *plan)
+// Purpose: Stops the worker threads and deallocates the plan.
+{
+  if (plan == NULL)
+    return;
+  pthread_mutex_lock(&plan->lock);
+  plan->shutdown = 1;
+  pthread_cond_broadcast(&plan->start);
+  pthread_mutex_unlock(&plan->lock);
+  for (size_t t = 0; t < plan->nthreads; t++)
+    pthread_join(plan->threads[t], NULL);
+  pthread_mutex_destroy(&plan->lock);
+  pthread_cond_destroy(&plan->start);
+  pthread_cond_destroy(&plan->done);
+  free(plan->ptr);
+  free(plan->idx);
+  free(plan->val);
+  free(plan->part);
+  free(plan->threads);
+  free(plan);
+}
+
+int spmv_plan_exec(spmv_plan_t *plan, double alpha, const array_t *x, double beta, array_t *y)
+/*
+  Purpose:
+
+    Computes y := alpha*A*x + beta*y in parallel with the matrix and the
+    partitioning of the plan. If beta is zero, y need not be initialized.
+    The vectors x and y must not overlap. Calls with the same plan must not
+    run concurrently.
+
+  Arguments:
+    plan       a pointer to an spmv_plan_t
+    alpha      scalar
+    x          a pointer to an array_t of length A->shape[1]
+    beta       scalar
+    y          a pointer to an array_t of length A->shape[0]
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_DIM_ERR if the lengths of x and y do not
+    match the shape of A, and MSP_ILLEGAL_INPUT if an input is NULL or x
+    and y are the same array.
+*/
+{
+  if (plan == NULL || x == NULL || y == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  if (x->len != plan->shape[1] || y->len != plan->shape[0])
+    return MSP_DIM_ERR;
+  if (x->val == y->val && x->len > 0)
+    return MSP_ILLEGAL_INPUT;
+  plan->alpha = alpha;
+  plan->beta = beta;
+  plan->x = x->val;
+  plan->y = y->val;
+  post(plan);
+
+  // Fix-up: add the partial sums of the rows that were split between threads
+  for (size_t t = 0; t < plan->nthreads; t++)
+  {
+    const spmv_part_t *p = plan->part + t;
+    if (p->i1 < plan->shape[0] && p->k1 > plan->ptr[p->i1])
+      y->val[p->i1] += alpha * p->carry;
+  }
+  return MSP_SUCCESS;
+}
+
+double spmv_plan_imbalance(const spmv_plan_t *plan)
+/* Purpose: Returns the largest number of rows plus nonzeros of a thread divided by the average (1 is perfect balance). */
+{
+  if (plan == NULL || plan->nthreads == 0)
+    return 0.0;
+  size_t max = 0, total = 0;
+  for (size_t t = 0; t < plan->nthreads; t++)
+  {
+    const spmv_part_t *p = plan->part + t;
+    size_t work = (p->i1 - p->i0) + (p->k1 - p->k0);
+    max = (work > max) ? work : max;
+    total += work;
+  }
+  return total ? (double)max * plan->nthreads / total : 1.0;
+}
@@ -0,0 +1,19 @@
+#ifndef PAR_SPMV_H
+#define PAR_SPMV_H
+#include "array.h"
+#include "sparse.h"
+
+enum spmv_split
+{
+    SpmvMergePath, // equal share of rows + nonzeros per thread
+    SpmvRowSplit   // equal share of rows per thread
+};
+
+typedef struct spmv_plan spmv_plan_t; /* partitioned CSR matrix and its worker threads */
+
+spmv_plan_t *spmv_plan_alloc(const csp_t *A, size_t nthreads, enum spmv_split split);
+void spmv_plan_dealloc(spmv_plan_t *plan);
+int spmv_plan_exec(spmv_plan_t *plan, double alpha, const array_t *x, double beta, array_t *y);
+double spmv_plan_imbalance(const spmv_plan_t *plan);
+
+#endif
@@ -1,111 +1,550 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "msptools.h"
+#include "call_dgesv.h"
+#include "lu_cache.h"
+#include "solve_server.h"
+#ifndef MSP_NO_LAPACK
+#include "call_dgels.h"
+#include "lsq_stream.h"
+#include "ooc_lu.h"
 
-/* C prototype for LAPACK routine DGESV */
-void dgesv_(int *n,    /* columns/rows in A          */
-            int *nrhs, /* number of right-hand sides */
-            double *A,       /* array A                    */
-            int *lda,  /* leading dimension of A     */
-            int *ipiv,       /* pivoting array             */
-            double *B,       /* array B                    */
-            int *ldb,  /* leading dimension of B     */
-            int *info        /* status code                */
-);
+// Rows of A and b read at a time by --lstsq --stream
+#define STREAM_CHUNK 4096
 
+// Solves min ||A*x-b|| for every column b of B with ls_factor and ls_solve; X has the storage order of B
+static int solve_lstsq_many(const array2d_t *A, const array2d_t *B, const char *file_x) {
 
-int call_dgesv(array2d_t * A, array_t * b);
+    size_t m = A->shape[0], n = A->shape[1], nrhs = B->shape[1];
+    if (B->shape[0] != m) {
+        fprintf(stderr,"Error matrix A and matrix B not compatible");
+        return EXIT_FAILURE;
+    }
+    ls_t *ls = ls_factor(A);
+    array2d_t *X = array2d_alloc((size_t[]){n, nrhs}, B->order);
+    array_t *b = array_alloc(m);
+    int info = (ls && X && b) ? 0 : -15;
+    for (size_t j = 0; j < nrhs && info == 0; j++) {
+        for (size_t i = 0; i < m; i++)
+            b->val[i] = (B->order == ColMajor) ? B->val[i + j * m] : B->val[i * nrhs + j];
+        b->len = m;
+        info = ls_solve(ls, b);
+        for (size_t i = 0; i < n && info == 0; i++)
+            X->val[(X->order == ColMajor) ? i + j * n : i * nrhs + j] = b->val[i];
+    }
+    if (info == 0)
+        array2d_to_file(file_x, X);
+    else
+        fprintf(stderr,"Error: least-squares problem could not be solved\n");
+    ls_dealloc(ls);
+    array2d_dealloc(X);
+    array_dealloc(b);
+    return (info == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Solves the least-squares problem min ||A*x-b|| (--lstsq)
+static int solve_lstsq(const char *file_A, const char *file_b, const char *file_x, int stream) {
+
+    if (stream) {
+        // A is read in blocks of rows, so it never has to fit in memory
+        array_t *x = lsq_stream_from_files(file_A, file_b, STREAM_CHUNK);
+        if (!x) {
+            fprintf(stderr,"Error: least-squares problem could not be solved\n");
+            return EXIT_FAILURE;
+        }
+        array_to_file(file_x, x);
+        array_dealloc(x);
+        return EXIT_SUCCESS;
+    }
+
+    array2d_t *A = array2d_from_file(file_A);
+    array2d_t *B = array2d_from_file(file_b);
+    if (!A || !B) {
+        fprintf(stderr,"Error reading file %s\n", A ? file_b : file_A);
+        array2d_dealloc(A);
+        array2d_dealloc(B);
+        return EXIT_FAILURE;
+    }
+    int ret;
+    if (B->shape[0] == 1 || B->shape[1] == 1) {
+        // a single row or column is one right-hand side (same layout in either order)
+        size_t len = B->shape[0] * B->shape[1];
+        array_t b = {len, len, B->val};
+        ret = (call_dgels(A, &b) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+        if (ret == EXIT_SUCCESS)
+            array_to_file(file_x, &b);
+        else
+            fprintf(stderr,"Error: least-squares problem could not be solved\n");
+    } else {
+        // several right-hand sides share one QR factorization of A
+        ret = solve_lstsq_many(A, B, file_x);
+    }
+    array2d_dealloc(A);
+    array2d_dealloc(B);
+    return ret;
+}
+
+// Solves A*x = b out of core with at most mem_limit bytes of matrix data (--ooc)
+static int solve_ooc(const char *file_A, const char *file_b, const char *file_x, size_t mem_limit) {
+
+    ooc_lu_t *lu = ooc_lu_from_file(file_A, mem_limit);
+    array_t *b = array_from_file(file_b);
+    if (!lu || !b) {
+        if (lu && !b)
+            fprintf(stderr,"Error reading file %s\n", file_b);
+        ooc_lu_dealloc(lu);
+        array_dealloc(b);
+        return EXIT_FAILURE;
+    }
+    int info = ooc_lu_factor(lu);
+    if (info == 0)
+        info = ooc_lu_solve(lu, b);
+    ooc_lu_dealloc(lu);
+    if (info != 0) {
+        fprintf(stderr,"Error: system could not be solved");
+        array_dealloc(b);
+        return EXIT_FAILURE;
+    }
+    array_to_file(file_x, b);
+    array_dealloc(b);
+    return EXIT_SUCCESS;
+}
+
+// JSON has no inf/nan, so non-finite values are written as null
+static void json_number(const char *key, double v, const char *sep) {
+    if (isfinite(v))
+        printf("\"%s\": %.6e%s", key, v, sep);
+    else
+        printf("\"%s\": null%s", key, sep);
+}
+
+// Prints the diagnostics of call_dgesv_diag (--diag) or emits them as JSON (--json)
+static void print_diag(const dgesv_diag_t *d, size_t n, int json) {
+    double cond = (d->rcond > 0.0) ? 1.0 / d->rcond : INFINITY;
+    if (json) {
+        printf("{\"n\": %zu, ", n);
+        json_number("anorm", d->anorm, ", ");
+        json_number("rcond", d->rcond, ", ");
+        json_number("cond1", cond, ", ");
+        json_number("berr", d->berr, ", ");
+        json_number("resid", d->resid, "}\n");
+    } else {
+        printf("condition number (1-norm) ~ %.3e (rcond %.3e)\n", cond, d->rcond);
+        printf("componentwise backward error %.3e, residual %.3e\n", d->berr, d->resid);
+    }
+}
+#endif
+
+// Parses a size such as 512M or 8G (suffixes K, M, G and T are powers of 1024)
+static int parse_size(const char *str, size_t *size) {
+    char *end;
+    double v = strtod(str, &end);
+    if (end == str || !(v > 0))
+        return -1;
+    if (*end != '\0') {
+        const char *suffix = "KMGT", *p = strchr(suffix, toupper((unsigned char)*end));
+        if (p == NULL || end[1] != '\0')
+            return -1;
+        for (; p >= suffix; p--)
+            v *= 1024;
+    }
+    // (double)SIZE_MAX rounds up, so every smaller value converts to a size_t
+    if (v >= (double)SIZE_MAX)
+        return -1;
+    *size = (size_t)v;
+    return 0;
+}
+
+// Solves A*X = B with the factorization of A from the cache, or factors A and stores it (--cache)
+static int solve_cached(const char *file_A, const char *file_b, const char *file_x, const lu_cache_t *cache) {
+
+    // a missing cache directory is created (but not its parents)
+    if (mkdir(cache->dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr,"Error: could not create the cache directory %s\n", cache->dir);
+        return EXIT_FAILURE;
+    }
+    uint64_t key[2];
+    if (lu_cache_key(file_A, key) != MSP_SUCCESS) {
+        fprintf(stderr,"Error reading file %s\n", file_A);
+        return EXIT_FAILURE;
+    }
+    lu_t *lu = lu_cache_get(cache, key);
+    if (lu) {
+        fprintf(stderr,"cache: hit\n");
+    } else {
+        // Miss: factor A and store the factorization for the next solve with the same A
+        array2d_t *A = array2d_from_file(file_A);
+        if (!A) {
+            fprintf(stderr,"Error reading file %s\n", file_A);
+            return EXIT_FAILURE;
+        }
+        lu = lu_factor(A);
+        array2d_dealloc(A);
+        if (!lu) {
+            fprintf(stderr,"Error: system could not be solved");
+            return EXIT_FAILURE;
+        }
+        if (lu_cache_put(cache, key, lu) != MSP_SUCCESS)
+            fprintf(stderr,"Warning: factorization was not stored in the cache\n");
+        fprintf(stderr,"cache: miss\n");
+    }
+
+    array2d_t *B = array2d_from_file(file_b);
+    if (!B) {
+        fprintf(stderr,"Error reading file %s\n", file_b);
+        lu_dealloc(lu);
+        return EXIT_FAILURE;
+    }
+    // the entry is found by the hash of the file with A, so its order is checked against B
+    int vec = (B->shape[0] == 1 || B->shape[1] == 1);
+    if ((vec ? B->shape[0] * B->shape[1] : B->shape[0]) != lu->LU->shape[0]) {
+        fprintf(stderr,"Error matrix A and matrix B not compatible");
+        lu_dealloc(lu);
+        array2d_dealloc(B);
+        return EXIT_FAILURE;
+    }
+    int info;
+    if (vec) {
+        // a single row or column is one right-hand side (same layout in either order)
+        size_t len = B->shape[0] * B->shape[1];
+        array_t b = {len, len, B->val};
+        info = lu_solve(lu, &b);
+        if (info == 0)
+            array_to_file(file_x, &b);
+    } else {
+        info = lu_solve_many(lu, B);
+        if (info == 0)
+            array2d_to_file(file_x, B);
+    }
+    lu_dealloc(lu);
+    array2d_dealloc(B);
+    if (info != 0) {
+        fprintf(stderr,"Error: system could not be solved");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Solves A*X = B on a server started with --serve; A is sent once and then kept under its name (--connect).
+// Without a name, A is kept under the hash of its contents, so a changed A is sent again.
+static int solve_remote(const char *path, const char *name, const char *file_A, const char *file_b, const char *file_x) {
+
+    char hashname[40];
+    if (!name) {
+        uint64_t key[2];
+        if (lu_cache_key(file_A, key) != MSP_SUCCESS) {
+            fprintf(stderr,"Error reading file %s\n", file_A);
+            return EXIT_FAILURE;
+        }
+        snprintf(hashname, sizeof(hashname), "%016llx%016llx", (unsigned long long)key[0], (unsigned long long)key[1]);
+        name = hashname;
+    }
+    int fd = solve_client_connect(path);
+    if (fd < 0) {
+        return EXIT_FAILURE;
+    }
+    array2d_t *B = array2d_from_file(file_b);
+    if (!B) {
+        fprintf(stderr,"Error reading file %s\n", file_b);
+        solve_client_close(fd);
+        return EXIT_FAILURE;
+    }
+    // a single row is one right-hand side (the same values as a single column)
+    int single = (B->shape[0] == 1 || B->shape[1] == 1);
+    if (B->shape[0] == 1) {
+        B->shape[0] = B->shape[1];
+        B->shape[1] = 1;
+    }
+
+    int info = solve_client_solve(fd, name, B);
+    if (info == -14) {
+        // the server does not have A yet
+        array2d_t *A = array2d_from_file(file_A);
+        if (!A) {
+            fprintf(stderr,"Error reading file %s\n", file_A);
+            solve_client_close(fd);
+            return EXIT_FAILURE;
+        }
+        info = solve_client_load(fd, name, A);
+        array2d_dealloc(A);
+        if (info == 0)
+            info = solve_client_solve(fd, name, B);
+    }
+    solve_client_close(fd);
+    if (info != 0) {
+        fprintf(stderr,"Error: system could not be solved (status %d)\n", info);
+        array2d_dealloc(B);
+        return EXIT_FAILURE;
+    }
+
+    if (single) {
+        array_t x = {B->shape[0], B->shape[0], B->val};
+        array_to_file(file_x, &x);
+    } else {
+        array2d_to_file(file_x, B);
+    }
+    array2d_dealloc(B);
+    return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[]) {
 
+    // Parses the options (arguments starting with --) in front of the file names
+    int mixed = 0, autodetect = 0, lstsq = 0, stream = 0, diag = 0, json = 0, ooc = 0;
+    size_t mem_limit = (size_t)1 << 30;
+    lu_cache_t cache = {NULL, 0, CacheLRU};
+    const char *serve = NULL, *connect = NULL, *name = NULL;
+    size_t nthreads = 0;
+    int stop = 0;
+    int k = 1;
+    for (; k < argc && strncmp(argv[k], "--", 2) == 0; k++) {
+        if (strcmp(argv[k], "--mixed") == 0) {
+            mixed = 1;
+        } else if (strcmp(argv[k], "--auto") == 0) {
+            autodetect = 1;
+        } else if (strcmp(argv[k], "--lstsq") == 0) {
+            lstsq = 1;
+        } else if (strcmp(argv[k], "--stream") == 0) {
+            stream = 1;
+        } else if (strcmp(argv[k], "--diag") == 0) {
+            diag = 1;
+        } else if (strcmp(argv[k], "--json") == 0) {
+            diag = json = 1;
+        } else if (strcmp(argv[k], "--ooc") == 0) {
+            ooc = 1;
+        } else if (strncmp(argv[k], "--mem-limit=", 12) == 0) {
+            if (parse_size(argv[k] + 12, &mem_limit) != 0) {
+                fprintf(stderr,"Invalid memory limit %s\n", argv[k] + 12);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[k], "--cache=", 8) == 0) {
+            cache.dir = argv[k] + 8;
+        } else if (strncmp(argv[k], "--cache-max=", 12) == 0) {
+            if (parse_size(argv[k] + 12, &cache.max_bytes) != 0) {
+                fprintf(stderr,"Invalid cache size %s\n", argv[k] + 12);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[k], "--cache-evict=", 14) == 0) {
+            if (strcmp(argv[k] + 14, "lru") == 0) {
+                cache.policy = CacheLRU;
+            } else if (strcmp(argv[k] + 14, "fifo") == 0) {
+                cache.policy = CacheFIFO;
+            } else {
+                fprintf(stderr,"Invalid eviction policy %s (use lru or fifo)\n", argv[k] + 14);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[k], "--serve=", 8) == 0) {
+            serve = argv[k] + 8;
+        } else if (strncmp(argv[k], "--threads=", 10) == 0) {
+            nthreads = strtoul(argv[k] + 10, NULL, 10);
+        } else if (strncmp(argv[k], "--connect=", 10) == 0) {
+            connect = argv[k] + 10;
+        } else if (strncmp(argv[k], "--name=", 7) == 0) {
+            name = argv[k] + 7;
+        } else if (strcmp(argv[k], "--stop") == 0) {
+            stop = 1;
+        } else {
+            fprintf(stderr,"Unknown option %s\n", argv[k]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Daemon mode and server commands without files
+    if (serve && argc == k) {
+        solve_server_t *srv = solve_server_alloc(serve, nthreads);
+        if (!srv) {
+            return EXIT_FAILURE;
+        }
+        int ret = solve_server_run(srv);
+        solve_server_dealloc(srv);
+        return ret == MSP_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (connect && stop && argc == k) {
+        int fd = solve_client_connect(connect);
+        int ret = (fd >= 0) ? solve_client_stop(fd) : -13;
+        if (fd >= 0)
+            solve_client_close(fd);
+        return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Checks that theres the correct amount of input variables when calling the script
-    if (argc != 4) {
-        fprintf(stderr,"Usage: %s A b x\n", argv[0]);
+    if (argc - k != 3 || serve || stop) {
+        fprintf(stderr,"Usage: %s [--mixed | --auto | --diag | --json | --lstsq [--stream] |\n", argv[0]);
+        fprintf(stderr,"       --ooc [--mem-limit=SIZE] |\n");
+        fprintf(stderr,"       --cache=DIR [--cache-max=SIZE] [--cache-evict=lru|fifo] |\n");
+        fprintf(stderr,"       --connect=SOCKET [--name=NAME]] A b x\n");
+        fprintf(stderr,"       %s --serve=SOCKET [--threads=N]\n", argv[0]);
+        fprintf(stderr,"       %s --connect=SOCKET --stop\n", argv[0]);
+        fprintf(stderr,"       (b may have several columns, one per right-hand side)\n");
+        fprintf(stderr,"  --mixed   single-precision LU with double-precision refinement\n");
+        fprintf(stderr,"  --auto    detect triangular, banded and SPD matrices\n");
+        fprintf(stderr,"  --diag    print a condition estimate and the backward error\n");
+        fprintf(stderr,"  --json    as --diag, but written as JSON to stdout\n");
+        fprintf(stderr,"  --lstsq   least-squares solution for a tall A (one QR factorization for all columns of b)\n");
+        fprintf(stderr,"  --stream  read A in blocks of rows (with --lstsq)\n");
+        fprintf(stderr,"  --ooc     out-of-core LU for an A larger than memory (single b)\n");
+        fprintf(stderr,"  --mem-limit=SIZE  memory for matrix data with --ooc, e.g. 8G (default 1G)\n");
+        fprintf(stderr,"  --cache=DIR       reuse the LU factorization of the same A stored in DIR (created if missing)\n");
+        fprintf(stderr,"  --cache-max=SIZE  size limit of the cache, e.g. 4G (default: no limit)\n");
+        fprintf(stderr,"  --cache-evict=P   remove least recently used (lru, default) or oldest (fifo) entries\n");
+        fprintf(stderr,"  --serve=SOCKET    run a solver daemon that keeps factorizations resident\n");
+        fprintf(stderr,"  --threads=N       worker threads of the daemon (default: one per processor)\n");
+        fprintf(stderr,"  --connect=SOCKET  solve on the daemon; A is sent on first use only\n");
+        fprintf(stderr,"  --name=NAME       name of A on the daemon (default: a hash of the contents of A;\n"
+                       "                    a named A is not sent again when the file changes)\n");
+        fprintf(stderr,"  --stop            stop the daemon\n");
         return EXIT_FAILURE;
     }
+    const char *file_A = argv[k], *file_b = argv[k + 1], *file_x = argv[k + 2];
 
-    // Saves the first and second input text files as A and b
-    array2d_t *A = array2d_from_file(argv[1]);
-    array_t *b = array_from_file(argv[2]);
+    if (stream && !lstsq) {
+        fprintf(stderr,"Error: --stream requires --lstsq\n");
+        return EXIT_FAILURE;
+    }
+    if (ooc && (mixed || autodetect || lstsq || diag)) {
+        fprintf(stderr,"Error: --ooc cannot be combined with other solver options\n");
+        return EXIT_FAILURE;
+    }
+    if (connect && (mixed || autodetect || lstsq || diag || ooc || cache.dir)) {
+        fprintf(stderr,"Error: --connect cannot be combined with other solver options\n");
+        return EXIT_FAILURE;
+    }
+    if (cache.dir && (mixed || autodetect || lstsq || diag || ooc)) {
+        fprintf(stderr,"Error: --cache cannot be combined with other solver options\n");
+        return EXIT_FAILURE;
+    }
+    if (!cache.dir && (cache.max_bytes || cache.policy != CacheLRU)) {
+        fprintf(stderr,"Error: --cache-max and --cache-evict require --cache\n");
+        return EXIT_FAILURE;
+    }
+    if (diag && (mixed || autodetect || lstsq)) {
+        fprintf(stderr,"Error: --diag and --json cannot be combined with --mixed, --auto or --lstsq\n");
+        return EXIT_FAILURE;
+    }
+#ifdef MSP_NO_LAPACK
+    if (mixed || autodetect || lstsq || diag || ooc) {
+        fprintf(stderr,"Error: --mixed, --auto, --diag, --json, --lstsq and --ooc require LAPACK (built with LAPACK=native)\n");
+        return EXIT_FAILURE;
+    }
+#else
+    if (lstsq) {
+        return solve_lstsq(file_A, file_b, file_x, stream);
+    }
+    if (ooc) {
+        return solve_ooc(file_A, file_b, file_x, mem_limit);
+    }
+#endif
+    if (cache.dir) {
+        return solve_cached(file_A, file_b, file_x, &cache);
+    }
+    if (connect) {
+        return solve_remote(connect, name, file_A, file_b, file_x);
+    }
+
+    // Saves the first and second input text files as A and B
+    array2d_t *A = array2d_from_file(file_A);
+    array2d_t *B = array2d_from_file(file_b);
 
     // Error handeling
     // (these might be irrelevant since we also do these checks in call_dgesv)
     if (!A) {
-        fprintf(stderr,"Error reading file %s\n",argv[1]);
+        fprintf(stderr,"Error reading file %s\n",file_A);
         return EXIT_FAILURE;
     }
-    if (!b) {
-        fprintf(stderr,"Error reading file %s\n",argv[2]);
+    if (!B) {
+        fprintf(stderr,"Error reading file %s\n",file_b);
         return EXIT_FAILURE;
     }
     if (A->shape[0] != A->shape[1]){
          fprintf(stderr,"Error matrix A is not square");
          return EXIT_FAILURE;
     }
-    if (A->shape[0] != b->len){
-        fprintf(stderr,"Error matrix A and vector b not compatible");
-        return EXIT_FAILURE;
-    }
 
-    // call our function to solve the linear system
-    int info = call_dgesv(A, b);
+    // A file with a single row or a single column is one right-hand side
+    if (B->shape[0] == 1 || B->shape[1] == 1) {
+        size_t len = B->shape[0] * B->shape[1];
+        array_t *b = array_alloc(len);
+        if (!b) {
+            return EXIT_FAILURE;
+        }
+        memcpy(b->val, B->val, len * sizeof(*b->val));
+        b->len = len;
+        array2d_dealloc(B);
 
-    // check if the problem was solved
-    if (info != 0)
-    {
-      fprintf(stderr,"Error: system could not be solved");
-      return EXIT_FAILURE;
-    }
-    
-    // Saves the solution to the given text file.
-    array_to_file(argv[3], b);
+        if (A->shape[0] != b->len){
+            fprintf(stderr,"Error matrix A and vector b not compatible");
+            return EXIT_FAILURE;
+        }
 
-  return EXIT_SUCCESS;
-}
+        // call our function to solve the linear system
+        int info;
+#ifndef MSP_NO_LAPACK
+        if (mixed) {
+            int iter;
+            double resid;
+            info = call_dgesv_mixed(A, b, 0.0, 0, &iter, &resid);
+            if (info == 0) {
+                if (iter >= 0)
+                    printf("mixed precision: %d refinement steps, residual %.3e\n", iter, resid);
+                else
+                    printf("mixed precision: no convergence, used double precision, residual %.3e\n", resid);
+            }
+        } else if (autodetect) {
+            enum solve_path path;
+            info = call_dgesv_auto(A, b, &path);
+            printf("auto: used %s solver\n", solve_path_name(path));
+        } else if (diag) {
+            dgesv_diag_t d;
+            info = call_dgesv_diag(A, b, &d);
+            if (info >= 0)
+                print_diag(&d, b->len, json);
+        } else
+#endif
+        {
+            info = call_dgesv(A, b);
+        }
 
-// Function we made in the previous problem
-int call_dgesv(array2d_t * A, array_t * b) {
- 
-  if (A == NULL || b == NULL){
-    return -9;
-  }
-
-  if (A->shape[0] != A->shape[1]){
-    return -10;
-  }
-
-  if (A->shape[0] != b->len){
-   return -11;
-  }
-
-  int m = (int) A->shape[0], n = (int) A->shape[1];
-    int nrhs = 1, ldb=m, lda=m, info;
-    int ipiv[n];
-    
-    if (A->order == ColMajor){
-        dgesv_( &m, &nrhs, A->val, &lda, ipiv, b->val, &ldb, &info );
-    } else{
-        int nm = n*m;
-        double xrow[nm];
-
-        for (size_t i = 0; i < nm; i++){
-           xrow[i] = A->val[i];
+        // check if the problem was solved
+        if (info != 0)
+        {
+          fprintf(stderr,"Error: system could not be solved");
+          return EXIT_FAILURE;
         }
-        int k = 0;
-
-        
-        for (size_t i = 0; i < n; i++){
-            
-            for (size_t j = 0; j < n; j++)
-            {
-               A->val[k] = xrow[i+n*j];
-               k = k+1;
-            }
+
+        // Saves the solution to the given text file.
+        array_to_file(file_x, b);
+        array_dealloc(b);
+    } else {
+        if (A->shape[0] != B->shape[0]){
+            fprintf(stderr,"Error matrix A and matrix B not compatible");
+            return EXIT_FAILURE;
+        }
+
+        if (mixed || autodetect || diag) {
+            fprintf(stderr,"Error: --mixed, --auto, --diag and --json support a single right-hand side only");
+            return EXIT_FAILURE;
         }
-        
-        dgesv_( &m, &nrhs, A->val, &lda, ipiv, b->val, &ldb, &info );
 
+        // solve for all columns of B with a single factorization
+        int info = call_dgesv_multi(A, B);
+
+        if (info != 0)
+        {
+          fprintf(stderr,"Error: system could not be solved");
+          return EXIT_FAILURE;
+        }
+
+        // Saves the solution X (one column per right-hand side)
+        array2d_to_file(file_x, B);
+        array2d_dealloc(B);
     }
-    
-    return info;
-}
\ No newline at end of file
+    array2d_dealloc(A);
+
+  return EXIT_SUCCESS;
+}
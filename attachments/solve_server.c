@@ -0,0 +1,641 @@
+#define _POSIX_C_SOURCE 200809L
+#include "solve_server.h"
+#include "lu.h"
+#include "threadpool.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SOLVE_MAGIC 0x4d53504cu
+
+typedef struct matrix_entry /* resident factorization */
+{
+  char name[SOLVE_NAME_MAX];
+  lu_t *lu;
+  size_t refs; // one for the list plus one per solve in progress
+  struct matrix_entry *next;
+} matrix_entry_t;
+
+struct solve_server
+{
+  char *path;
+  int listen_fd;
+  threadpool_t *pool;
+  pthread_mutex_t lock;     // protects the fields below
+  matrix_entry_t *matrices; // resident factorizations
+  int *conns;               // open connections
+  size_t nconns, capconns;
+  int stopping;
+};
+
+typedef struct connection
+{
+  solve_server_t *srv;
+  int fd;
+} connection_t;
+
+// Reads exactly len bytes (returns 0, or -1 on error or end of file)
+static int recv_full(int fd, void *buf, size_t len)
+{
+  char *p = buf;
+  while (len > 0)
+  {
+    ssize_t r = recv(fd, p, len, 0);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return -1;
+    p += r;
+    len -= (size_t)r;
+  }
+  return 0;
+}
+
+// Writes exactly len bytes (returns 0, or -1 on error)
+static int send_full(int fd, const void *buf, size_t len)
+{
+  const char *p = buf;
+  while (len > 0)
+  {
+    ssize_t r = send(fd, p, len, MSG_NOSIGNAL);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r < 0)
+      return -1;
+    p += r;
+    len -= (size_t)r;
+  }
+  return 0;
+}
+
+static int send_reply(int fd, int status, size_t n, size_t nrhs, const double *data)
+{
+  solve_reply_t rep = {SOLVE_MAGIC, status, n, data ? nrhs : 0};
+  if (send_full(fd, &rep, sizeof(rep)) != 0)
+    return -1;
+  return data ? send_full(fd, data, n * nrhs * sizeof(*data)) : 0;
+}
+
+// Checks that an n-by-m matrix of doubles can be sent (n, m and n*m fit in an int)
+static int valid_dims(uint64_t n, uint64_t m)
+{
+  return n > 0 && m > 0 && n <= INT_MAX && m <= INT_MAX && n * m <= INT_MAX;
+}
+
+// Removes name from the list and returns the entry (with its list reference) or NULL
+static matrix_entry_t *unlink_entry(solve_server_t *srv, const char *name)
+{
+  for (matrix_entry_t **p = &srv->matrices; *p; p = &(*p)->next)
+  {
+    if (strcmp((*p)->name, name) == 0)
+    {
+      matrix_entry_t *e = *p;
+      *p = e->next;
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static void release_entry(solve_server_t *srv, matrix_entry_t *e)
+{
+  if (e == NULL)
+    return;
+  pthread_mutex_lock(&srv->lock);
+  size_t refs = --e->refs;
+  pthread_mutex_unlock(&srv->lock);
+  if (refs == 0)
+  {
+    lu_dealloc(e->lu);
+    free(e);
+  }
+}
+
+static int handle_load(solve_server_t *srv, int fd, const solve_request_t *req)
+{
+  if (!valid_dims(req->n, req->n))
+  {
+    send_reply(fd, -11, 0, 0, NULL);
+    return -1; // the payload cannot be skipped
+  }
+  size_t n = req->n;
+  array2d_t *A = array2d_alloc((size_t[]){n, n}, ColMajor);
+  if (A == NULL)
+  {
+    send_reply(fd, -12, 0, 0, NULL);
+    return -1;
+  }
+  if (recv_full(fd, A->val, n * n * sizeof(*A->val)) != 0)
+  {
+    array2d_dealloc(A);
+    return -1;
+  }
+  matrix_entry_t *e = malloc(sizeof(*e));
+  if (e == NULL)
+  {
+    array2d_dealloc(A);
+    return send_reply(fd, -12, 0, 0, NULL);
+  }
+  // lu_factor returns NULL for a singular A, and also if malloc fails (which sets ENOMEM)
+  errno = 0;
+  lu_t *lu = lu_factor(A);
+  int err = errno;
+  array2d_dealloc(A);
+  if (lu == NULL)
+  {
+    free(e);
+    return send_reply(fd, err == ENOMEM ? -12 : 1, 0, 0, NULL);
+  }
+  strcpy(e->name, req->name);
+  e->lu = lu;
+  e->refs = 1;
+  pthread_mutex_lock(&srv->lock);
+  matrix_entry_t *old = unlink_entry(srv, req->name);
+  e->next = srv->matrices;
+  srv->matrices = e;
+  pthread_mutex_unlock(&srv->lock);
+  release_entry(srv, old);
+  return send_reply(fd, 0, 0, 0, NULL);
+}
+
+static int handle_solve(solve_server_t *srv, int fd, const solve_request_t *req)
+{
+  if (!valid_dims(req->n, req->nrhs))
+  {
+    send_reply(fd, -11, 0, 0, NULL);
+    return -1;
+  }
+  size_t n = req->n, nrhs = req->nrhs;
+  array2d_t *B = array2d_alloc((size_t[]){n, nrhs}, ColMajor);
+  if (B == NULL)
+  {
+    send_reply(fd, -12, 0, 0, NULL);
+    return -1;
+  }
+  if (recv_full(fd, B->val, n * nrhs * sizeof(*B->val)) != 0)
+  {
+    array2d_dealloc(B);
+    return -1;
+  }
+
+  // Holds a reference, so the factorization survives a concurrent drop or reload
+  pthread_mutex_lock(&srv->lock);
+  matrix_entry_t *e = srv->matrices;
+  while (e && strcmp(e->name, req->name) != 0)
+    e = e->next;
+  if (e)
+    e->refs++;
+  pthread_mutex_unlock(&srv->lock);
+
+  int status;
+  if (e == NULL)
+    status = -14;
+  else if (e->lu->LU->shape[0] != n)
+    status = -11;
+  else
+    status = lu_solve_many(e->lu, B);
+  release_entry(srv, e);
+  int ret = send_reply(fd, status, n, nrhs, status == 0 ? B->val : NULL);
+  array2d_dealloc(B);
+  return ret;
+}
+
+static int handle_drop(solve_server_t *srv, int fd, const solve_request_t *req)
+{
+  pthread_mutex_lock(&srv->lock);
+  matrix_entry_t *e = unlink_entry(srv, req->name);
+  pthread_mutex_unlock(&srv->lock);
+  release_entry(srv, e);
+  return send_reply(fd, e ? 0 : -14, 0, 0, NULL);
+}
+
+// Stops accepting connections and ends the open ones after their current request
+static int handle_stop(solve_server_t *srv, int fd)
+{
+  pthread_mutex_lock(&srv->lock);
+  srv->stopping = 1;
+  shutdown(srv->listen_fd, SHUT_RDWR);
+  for (size_t k = 0; k < srv->nconns; k++)
+    shutdown(srv->conns[k], SHUT_RD);
+  pthread_mutex_unlock(&srv->lock);
+  return send_reply(fd, 0, 0, 0, NULL);
+}
+
+// Worker task: answers the requests on one connection until it is closed
+static void serve_connection(void *arg)
+{
+  connection_t *c = arg;
+  solve_server_t *srv = c->srv;
+  int fd = c->fd;
+  free(c);
+
+  solve_request_t req;
+  while (recv_full(fd, &req, sizeof(req)) == 0 && req.magic == SOLVE_MAGIC)
+  {
+    req.name[SOLVE_NAME_MAX - 1] = '\0';
+    int ret;
+    if (req.op == SolveOpLoad)
+      ret = handle_load(srv, fd, &req);
+    else if (req.op == SolveOpSolve)
+      ret = handle_solve(srv, fd, &req);
+    else if (req.op == SolveOpDrop)
+      ret = handle_drop(srv, fd, &req);
+    else if (req.op == SolveOpStop)
+      ret = handle_stop(srv, fd);
+    else
+      ret = -1;
+    if (ret != 0)
+      break;
+  }
+
+  pthread_mutex_lock(&srv->lock);
+  for (size_t k = 0; k < srv->nconns; k++)
+  {
+    if (srv->conns[k] == fd)
+    {
+      srv->conns[k] = srv->conns[--srv->nconns];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&srv->lock);
+  close(fd);
+}
+
+static int unix_address(const char *path, struct sockaddr_un *addr)
+{
+  if (strlen(path) >= sizeof(addr->sun_path))
+  {
+    fprintf(stderr, "Error: socket path %s is too long\n", path);
+    return -1;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, path);
+  return 0;
+}
+
+solve_server_t *solve_server_alloc(const char *path, size_t nthreads)
+/*
+  Purpose:
+
+    Creates a solver daemon that listens on the Unix domain socket path.
+    The daemon keeps named LU factorizations resident, so a client pays
+    for parsing and factoring A once and every following solve with A
+    costs O(n^2) plus the transfer of b and x (see solve_server.h for the
+    protocol). Each connection is served by a task on a pool of nthreads
+    worker threads, so up to nthreads clients are served concurrently and
+    further connections wait for a free worker. A stale socket file left by
+    a server that is no longer running is replaced.
+
+  Example:
+
+    ```c
+    solve_server_t *srv = solve_server_alloc("/tmp/solve.sock", 4);
+    if (srv==NULL) exit(EXIT_FAILURE);
+    solve_server_run(srv);   // returns when a client sends SolveOpStop
+    solve_server_dealloc(srv);
+    ```
+
+  Arguments:
+    path         path of the socket
+    nthreads     number of worker threads (0: one per online processor)
+
+  Return value:
+    A pointer to a solve_server_t, or NULL if an error occurs.
+*/
+{
+  struct sockaddr_un addr;
+  if (path == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return NULL;
+  }
+  if (unix_address(path, &addr) != 0)
+    return NULL;
+  solve_server_t *srv = calloc(1, sizeof(*srv));
+  if (srv == NULL || (srv->path = malloc(strlen(path) + 1)) == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    free(srv);
+    return NULL;
+  }
+  strcpy(srv->path, path);
+  pthread_mutex_init(&srv->lock, NULL);
+
+  // A socket file that refuses connections belongs to a server that has exited
+  srv->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (srv->listen_fd >= 0 && connect(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+  {
+    fprintf(stderr, "Error: a server is already listening on %s\n", path);
+    close(srv->listen_fd);
+    srv->listen_fd = -1;
+    solve_server_dealloc(srv);
+    return NULL;
+  }
+  if (srv->listen_fd >= 0 && errno == ECONNREFUSED)
+    unlink(path);
+  if (srv->listen_fd >= 0)
+    close(srv->listen_fd);
+
+  srv->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (srv->listen_fd < 0 || bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(srv->listen_fd, SOMAXCONN) != 0)
+  {
+    fprintf(stderr, "Error: cannot listen on %s (%s)\n", path, strerror(errno));
+    if (srv->listen_fd >= 0)
+      close(srv->listen_fd);
+    srv->listen_fd = -1;
+    solve_server_dealloc(srv);
+    return NULL;
+  }
+  if (nthreads == 0)
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = ncpu > 0 ? (size_t)ncpu : 1;
+  }
+  srv->pool = threadpool_alloc(nthreads);
+  if (srv->pool == NULL)
+  {
+    solve_server_dealloc(srv);
+    return NULL;
+  }
+  return srv;
+}
+
+int solve_server_run(solve_server_t *srv)
+/*
+  Purpose:
+
+    Accepts connections and hands them to the worker pool until a client
+    sends SolveOpStop. Returns after all connections have been closed.
+
+  Return value:
+    MSP_SUCCESS if the server was stopped by a client, MSP_ILLEGAL_INPUT if
+    srv is NULL, and MSP_FAILURE if accepting connections fails.
+*/
+{
+  if (srv == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  int ret = MSP_SUCCESS;
+  for (;;)
+  {
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    pthread_mutex_lock(&srv->lock);
+    int stopping = srv->stopping;
+    pthread_mutex_unlock(&srv->lock);
+    if (fd < 0)
+    {
+      if (errno == EINTR && !stopping)
+        continue;
+      if (!stopping)
+      {
+        fprintf(stderr, "%s: accept failed (%s)\n", __func__, strerror(errno));
+        ret = MSP_FAILURE;
+      }
+      break;
+    }
+    if (stopping)
+    {
+      close(fd);
+      break;
+    }
+
+    connection_t *c = malloc(sizeof(*c));
+    pthread_mutex_lock(&srv->lock);
+    if (c != NULL && srv->nconns == srv->capconns)
+    {
+      size_t cap = srv->capconns ? 2 * srv->capconns : 16;
+      int *conns = realloc(srv->conns, cap * sizeof(*conns));
+      if (conns != NULL)
+      {
+        srv->conns = conns;
+        srv->capconns = cap;
+      }
+    }
+    int ok = c != NULL && srv->nconns < srv->capconns;
+    if (ok)
+      srv->conns[srv->nconns++] = fd;
+    pthread_mutex_unlock(&srv->lock);
+    if (ok)
+    {
+      c->srv = srv;
+      c->fd = fd;
+      ok = threadpool_submit(srv->pool, serve_connection, c) == MSP_SUCCESS;
+      if (!ok)
+      {
+        pthread_mutex_lock(&srv->lock);
+        srv->nconns--;
+        pthread_mutex_unlock(&srv->lock);
+      }
+    }
+    if (!ok)
+    {
+#ifndef NDEBUG
+      MEM_ERR;
+#endif
+      free(c);
+      close(fd);
+    }
+  }
+  threadpool_wait(srv->pool);
+  return ret;
+}
+
+void solve_server_dealloc(solve_server_t *srv)
+/* Purpose: Stops the workers, removes the socket and deallocates the resident factorizations. */
+{
+  if (srv == NULL)
+    return;
+  threadpool_dealloc(srv->pool);
+  if (srv->listen_fd >= 0)
+  {
+    close(srv->listen_fd);
+    unlink(srv->path);
+  }
+  while (srv->matrices)
+  {
+    matrix_entry_t *e = srv->matrices;
+    srv->matrices = e->next;
+    lu_dealloc(e->lu);
+    free(e);
+  }
+  pthread_mutex_destroy(&srv->lock);
+  free(srv->conns);
+  free(srv->path);
+  free(srv);
+}
+
+int solve_client_connect(const char *path)
+/* Purpose: Connects to the server listening on path. Returns the socket, or -1 if an error occurs. */
+{
+  struct sockaddr_un addr;
+  if (path == NULL || unix_address(path, &addr) != 0)
+    return -1;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    fprintf(stderr, "Error: cannot connect to %s (%s)\n", path, strerror(errno));
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+// Sends a request and receives the reply header (returns the status or -13 on I/O errors)
+static int client_call(int fd, uint32_t op, const char *name, size_t n, size_t nrhs,
+                       const double *data, solve_reply_t *rep)
+{
+  solve_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.magic = SOLVE_MAGIC;
+  req.op = op;
+  req.n = n;
+  req.nrhs = nrhs;
+  if (name)
+    strcpy(req.name, name);
+  if (send_full(fd, &req, sizeof(req)) != 0 ||
+      (data && send_full(fd, data, n * nrhs * sizeof(*data)) != 0) ||
+      recv_full(fd, rep, sizeof(*rep)) != 0 || rep->magic != SOLVE_MAGIC)
+    return -13;
+  return rep->status;
+}
+
+// Returns a ColMajor copy of A (or A->val if A is ColMajor already)
+static double *colmajor(const array2d_t *A)
+{
+  size_t m = A->shape[0], n = A->shape[1];
+  if (A->order == ColMajor)
+    return A->val;
+  double *work = malloc(m * n * sizeof(*work));
+  if (work != NULL)
+    for (size_t i = 0; i < m; i++)
+      for (size_t j = 0; j < n; j++)
+        work[i + j * m] = A->val[i * n + j];
+  return work;
+}
+
+static int check_name(const char *name)
+{
+  if (name == NULL)
+    return -9;
+  return strlen(name) < SOLVE_NAME_MAX ? 0 : -11;
+}
+
+int solve_client_load(int fd, const char *name, const array2d_t *A)
+/*
+  Purpose:
+
+    Sends A to the server, which factors it and keeps the factorization
+    under name (replacing a matrix with the same name).
+
+  Arguments:
+    fd         socket from solve_client_connect
+    name       name of the matrix (at most SOLVE_NAME_MAX-1 characters)
+    A          a pointer to a square array2d_t
+
+  Return value:
+    0 if successful, a positive value if A is singular, -9 if name and/or A
+    is NULL, -10 if A is not square, -11 if the dimensions or the name are
+    too large, -12 in case of memory allocation errors, and -13 in case of
+    I/O errors.
+*/
+{
+  int ret = check_name(name);
+  if (ret != 0 || A == NULL)
+    return ret ? ret : -9;
+  if (A->shape[0] != A->shape[1])
+    return -10;
+  if (!valid_dims(A->shape[0], A->shape[1]))
+    return -11;
+  double *data = colmajor(A);
+  if (data == NULL)
+    return -12;
+  solve_reply_t rep;
+  ret = client_call(fd, SolveOpLoad, name, A->shape[0], A->shape[0], data, &rep);
+  if (data != A->val)
+    free(data);
+  return ret;
+}
+
+int solve_client_solve(int fd, const char *name, array2d_t *B)
+/*
+  Purpose:
+
+    Solves A*X = B on the server, where A is the matrix loaded as name.
+    Upon exit, B is overwritten by the solution X.
+
+  Arguments:
+    fd         socket from solve_client_connect
+    name       name of the matrix
+    B          a pointer to an array2d_t with n rows (one column per right-hand side)
+
+  Return value:
+    The output `info` from DGETRS, -9 if name and/or B is NULL, -11 if the
+    dimensions of A and B are incompatible, -12 in case of memory
+    allocation errors, -13 in case of I/O errors, and -14 if the server has
+    no matrix called name.
+*/
+{
+  int ret = check_name(name);
+  if (ret != 0 || B == NULL)
+    return ret ? ret : -9;
+  size_t m = B->shape[0], k = B->shape[1];
+  if (!valid_dims(m, k))
+    return -11;
+  double *data = colmajor(B);
+  if (data == NULL)
+    return -12;
+  solve_reply_t rep;
+  ret = client_call(fd, SolveOpSolve, name, m, k, data, &rep);
+  if (ret == 0)
+  {
+    if (rep.n != m || rep.nrhs != k || recv_full(fd, data, m * k * sizeof(*data)) != 0)
+      ret = -13;
+    else if (data != B->val)
+      for (size_t i = 0; i < m; i++)
+        for (size_t j = 0; j < k; j++)
+          B->val[i * k + j] = data[i + j * m];
+  }
+  if (data != B->val)
+    free(data);
+  return ret;
+}
+
+int solve_client_drop(int fd, const char *name)
+/* Purpose: Removes the matrix called name from the server. Returns 0, -14 if there is no such matrix, or -13 on I/O errors. */
+{
+  int ret = check_name(name);
+  if (ret != 0)
+    return ret;
+  solve_reply_t rep;
+  return client_call(fd, SolveOpDrop, name, 0, 0, NULL, &rep);
+}
+
+int solve_client_stop(int fd)
+/* Purpose: Asks the server to stop. Returns 0, or -13 on I/O errors. */
+{
+  solve_reply_t rep;
+  return client_call(fd, SolveOpStop, NULL, 0, 0, NULL, &rep);
+}
+
+void solve_client_close(int fd)
+/* Purpose: Closes a connection from solve_client_connect (the server keeps the loaded matrices). */
+{
+  if (fd >= 0)
+    close(fd);
+}
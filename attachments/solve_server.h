@@ -0,0 +1,60 @@
+#ifndef SOLVE_SERVER_H
+#define SOLVE_SERVER_H
+#include <stdint.h>
+#include "array2d.h"
+
+/*
+  Protocol (native byte order, Unix domain stream socket): every request is
+  a solve_request_t followed by a payload of doubles, and is answered by a
+  solve_reply_t followed by a payload. Matrices are sent in ColMajor order.
+
+    SolveOpLoad   A (n*n)          -> status        factor A and keep it as name
+    SolveOpSolve  B (n*nrhs)       -> status, X     solve A*X = B with A = name
+    SolveOpDrop   -                -> status        remove name
+    SolveOpStop   -                -> status        stop the server
+
+  The status is 0, the `info` from DGETRF/DGETRS, or a negative error code
+  (-11 incompatible dimensions, -12 memory, -13 I/O, -14 unknown name).
+*/
+
+#define SOLVE_NAME_MAX 256
+
+enum solve_op
+{
+    SolveOpLoad = 1,
+    SolveOpSolve,
+    SolveOpDrop,
+    SolveOpStop
+};
+
+typedef struct solve_request
+{
+    uint32_t magic;
+    uint32_t op;   // enum solve_op
+    uint64_t n;    // order of A
+    uint64_t nrhs; // number of right-hand sides (SolveOpSolve)
+    char name[SOLVE_NAME_MAX];
+} solve_request_t;
+
+typedef struct solve_reply
+{
+    uint32_t magic;
+    int32_t status;
+    uint64_t n;
+    uint64_t nrhs; // number of columns in the payload
+} solve_reply_t;
+
+typedef struct solve_server solve_server_t; /* resident solver daemon */
+
+solve_server_t *solve_server_alloc(const char *path, size_t nthreads);
+int solve_server_run(solve_server_t *srv);
+void solve_server_dealloc(solve_server_t *srv);
+
+int solve_client_connect(const char *path);
+int solve_client_load(int fd, const char *name, const array2d_t *A);
+int solve_client_solve(int fd, const char *name, array2d_t *B);
+int solve_client_drop(int fd, const char *name);
+int solve_client_stop(int fd);
+void solve_client_close(int fd);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef SPARSE_H
 #define SPARSE_H
 #include "misc.h"
+#include "array.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -9,23 +10,37 @@ typedef struct coo /* coordinate sparse format (COO) */
     size_t shape[2];
     size_t nnz;
     size_t capacity;
+    enum symmetry sym; // Symmetric/SkewSymmetric: only one triangle is stored
     size_t *rowidx;
     size_t *colidx;
     double *val;
 } coo_t;
 
-typedef struct csp /* compressed sparse format (CSC/CSR) */
+typedef struct csp /* compressed sparse format (CSC/CSR/SELL) */
 {
     size_t shape[2];
     enum cstype csx;
+    enum symmetry sym; // Symmetric/SkewSymmetric: only the lower triangle is stored (see csp_half_from_coo)
     size_t *ptr;
     size_t *idx;
     double *val;
+    size_t chunk; // SELL: chunk height C
+    size_t sigma; // SELL: sorting window
+    size_t nnz;   // SELL: number of nonzeros (the rest of idx/val is padding)
+    size_t *perm; // SELL: row k of the chunks is row perm[k] of A (NULL for CSC/CSR)
+    int canonical;  // CSC/CSR: indices sorted and unique in each column/row (see csp_canonical_from_coo)
+    int readonly;   // ptr, idx, val and perm are in a read-only file mapping (see csp_from_binary)
+    void *map;      // the file mapping, or NULL
+    size_t mapsize;
 } csp_t;
 
 coo_t *coo_alloc(const size_t shape[2], const size_t capacity);
 void coo_dealloc(coo_t *sp);
 coo_t *coo_from_file(const char *filename);
+coo_t *coo_expand(const coo_t *sp);
+const char *mm_parse_header(const char *buf, size_t len, size_t shape[2], size_t *nnz, enum symmetry *sym,
+                            int *pattern);
+int mm_parse_entries(const char *buf, size_t len, coo_t *sp, size_t k, size_t count, int pattern, size_t *nread);
 int coo_to_file(const char *filename, const coo_t *sp);
 void coo_fprint(FILE *stream, const coo_t *sp);
 void coo_print(const coo_t *sp);
@@ -33,9 +48,30 @@ void coo_print(const coo_t *sp);
 csp_t *csp_alloc(const size_t shape[2], const size_t nnz, enum cstype csx);
 void csp_dealloc(csp_t *sp);
 csp_t *csp_from_coo(const coo_t *sp, enum cstype csx);
+csp_t *csp_canonical_from_coo(const coo_t *sp, enum cstype csx);
+csp_t *csp_half_from_coo(const coo_t *sp, enum cstype csx, int canonical);
+csp_t *csp_sell_from_coo(const coo_t *sp, size_t chunk, size_t sigma);
+csp_t *csp_sell_from_csp(const csp_t *A, size_t chunk, size_t sigma);
+int csp_to_binary(const char *filename, const csp_t *A);
+csp_t *csp_from_binary(const char *filename, int verify);
 void csp_fprint(FILE *stream, const csp_t *sp);
 void csp_print(const csp_t *sp);
 
+int csp_spmv(double alpha, const csp_t *A, const array_t *x, double beta, array_t *y);
+int csp_spmv_t(double alpha, const csp_t *A, const array_t *x, double beta, array_t *y);
+
+#ifndef SELL_CHUNK
+#define SELL_CHUNK 8 /* default chunk height of csp_from_coo(sp, SELL) */
+#endif
+
+#ifndef SELL_SIGMA
+#define SELL_SIGMA 256 /* default sorting window of csp_from_coo(sp, SELL) */
+#endif
+
+#ifndef CSP_BINARY_ALIGN
+#define CSP_BINARY_ALIGN 4096 /* alignment of the sections of csp_to_binary files (page size) */
+#endif
+
 #ifndef MM_MAX_TOKEN_LENGTH
 #define MM_MAX_TOKEN_LENGTH 64
 #endif
@@ -44,4 +80,8 @@ void csp_print(const csp_t *sp);
 #define MM_MAX_LINE_LENGTH 1025
 #endif
 
+#ifndef MM_BLOCK_SIZE
+#define MM_BLOCK_SIZE (1 << 20) /* read buffer of coo_from_file */
+#endif
+
 #endif
\ No newline at end of file
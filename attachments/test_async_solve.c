@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+#include <assert.h>
+#include "msptools.h"
+#include "async_solve.h"
+
+#define N 8
+#define NJOBS 16
+
+// A gate that holds the (only) worker in a callback, so the jobs behind it stay queued
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int gate_open;
+
+static void gate_callback(int info, void *data)
+{
+  (void)info;
+  (void)data;
+  pthread_mutex_lock(&lock);
+  while (!gate_open)
+    pthread_cond_wait(&cond, &lock);
+  pthread_mutex_unlock(&lock);
+}
+
+static void gate_set(int open)
+{
+  pthread_mutex_lock(&lock);
+  gate_open = open;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+}
+
+// Counts the calls; the count is read under the lock
+static void count_callback(int info, void *data)
+{
+  assert(info == 0);
+  pthread_mutex_lock(&lock);
+  (*(int *)data)++;
+  pthread_mutex_unlock(&lock);
+}
+
+static int count_get(const int *count)
+{
+  pthread_mutex_lock(&lock);
+  int c = *count;
+  pthread_mutex_unlock(&lock);
+  return c;
+}
+
+// A diagonally dominant system A*x = b with x(i) = 1 + i
+typedef struct system
+{
+  array2d_t *A;
+  array_t *b;
+} system_t;
+
+static void system_init(system_t *s, size_t seed)
+{
+  s->A = array2d_alloc((size_t[]){N, N}, RowMajor);
+  s->b = array_alloc(N);
+  assert(s->A != NULL && s->b != NULL);
+  for (size_t i = 0; i < N; i++)
+  {
+    double sum = 0.0;
+    for (size_t j = 0; j < N; j++)
+    {
+      double a = (i == j) ? (double)N : 1.0 / (1.0 + (double)((seed + 3 * i + j) % 7));
+      s->A->val[i * N + j] = a;
+      sum += a * (1.0 + j);
+    }
+    s->b->val[i] = sum;
+  }
+  s->b->len = N;
+}
+
+static void system_check(system_t *s)
+{
+  for (size_t i = 0; i < N; i++)
+    assert(fabs(s->b->val[i] - (1.0 + i)) < 1e-12);
+  array2d_dealloc(s->A);
+  array_dealloc(s->b);
+}
+
+// solve_job_poll before and after completion; solve_job_wait may be repeated
+static void test_poll_wait(void)
+{
+  async_solver_t *solver = async_solver_alloc(1);
+  assert(solver != NULL);
+  system_t s;
+  system_init(&s, 0);
+  int count = 0;
+  gate_set(0);
+  solve_job_t *blocker = async_dgesv_multi(solver, NULL, NULL, gate_callback, NULL);
+  solve_job_t *job = async_dgesv(solver, s.A, s.b, count_callback, &count);
+  assert(blocker != NULL && job != NULL);
+  assert(solve_job_poll(job) == 0 && solve_job_poll(blocker) == 0);
+  assert(count_get(&count) == 0);
+
+  gate_set(1);
+  assert(solve_job_wait(blocker) < 0); // call_dgesv_multi rejects NULL
+  assert(solve_job_wait(job) == 0);
+  assert(solve_job_poll(job) == 1);
+  assert(solve_job_wait(job) == 0);
+  assert(solve_job_poll(NULL) == 0 && solve_job_wait(NULL) == -9);
+  system_check(&s);
+
+  solve_job_dealloc(blocker);
+  solve_job_dealloc(job);
+  async_solver_dealloc(solver);
+  assert(count == 1);
+  printf("poll/wait: ok\n");
+}
+
+// The callback has run (exactly once) whenever solve_job_wait returns
+static void test_callback(void)
+{
+  async_solver_t *solver = async_solver_alloc(4);
+  assert(solver != NULL);
+  system_t s[NJOBS];
+  int count[NJOBS] = {0};
+  solve_job_t *jobs[NJOBS];
+  for (size_t k = 0; k < NJOBS; k++)
+  {
+    system_init(s + k, k);
+    jobs[k] = async_dgesv(solver, s[k].A, s[k].b, count_callback, count + k);
+    assert(jobs[k] != NULL);
+  }
+  for (size_t k = 0; k < NJOBS; k++)
+  {
+    assert(solve_job_wait(jobs[k]) == 0);
+    assert(count_get(count + k) == 1);
+    system_check(s + k);
+    solve_job_dealloc(jobs[k]);
+  }
+  async_solver_dealloc(solver);
+  for (size_t k = 0; k < NJOBS; k++)
+    assert(count[k] == 1);
+  printf("callback: ok\n");
+}
+
+// solve_job_detach before the job has run and after it has completed
+static void test_detach(void)
+{
+  async_solver_t *solver = async_solver_alloc(1);
+  assert(solver != NULL);
+  system_t s[2];
+  int count[2] = {0};
+  system_init(s, 0);
+  system_init(s + 1, 1);
+
+  gate_set(0);
+  solve_job_t *blocker = async_dgesv_multi(solver, NULL, NULL, gate_callback, NULL);
+  solve_job_t *job = async_dgesv(solver, s[0].A, s[0].b, count_callback, count);
+  assert(blocker != NULL && job != NULL);
+  solve_job_detach(job); // queued: the worker deallocates it
+  solve_job_detach(blocker);
+  gate_set(1);
+
+  job = async_dgesv(solver, s[1].A, s[1].b, count_callback, count + 1);
+  assert(job != NULL);
+  assert(solve_job_wait(job) == 0);
+  solve_job_detach(job); // completed: deallocated here
+  solve_job_detach(NULL);
+
+  async_solver_dealloc(solver);
+  assert(count[0] == 1 && count[1] == 1);
+  system_check(s);
+  system_check(s + 1);
+  printf("detach: ok\n");
+}
+
+// async_solver_dealloc completes the jobs that are still queued
+static void test_dealloc(void)
+{
+  async_solver_t *solver = async_solver_alloc(1);
+  assert(solver != NULL);
+  system_t s[NJOBS];
+  int count[NJOBS] = {0};
+  solve_job_t *jobs[NJOBS];
+  gate_set(0);
+  solve_job_t *blocker = async_dgesv_multi(solver, NULL, NULL, gate_callback, NULL);
+  assert(blocker != NULL);
+  for (size_t k = 0; k < NJOBS; k++)
+  {
+    system_init(s + k, k);
+    jobs[k] = async_dgesv(solver, s[k].A, s[k].b, count_callback, count + k);
+    assert(jobs[k] != NULL);
+  }
+  assert(solve_job_poll(jobs[NJOBS - 1]) == 0);
+  gate_set(1);
+  async_solver_dealloc(solver);
+
+  solve_job_dealloc(blocker);
+  for (size_t k = 0; k < NJOBS; k++)
+  {
+    assert(solve_job_poll(jobs[k]) == 1 && count[k] == 1);
+    assert(solve_job_wait(jobs[k]) == 0);
+    system_check(s + k);
+    solve_job_dealloc(jobs[k]);
+  }
+  assert(async_dgesv(NULL, NULL, NULL, NULL, NULL) == NULL);
+  printf("dealloc with queued jobs: ok\n");
+}
+
+int main(void)
+{
+  test_poll_wait();
+  test_callback();
+  test_detach();
+  test_dealloc();
+  return EXIT_SUCCESS;
+}
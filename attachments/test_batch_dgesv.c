@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "msptools.h"
+#include "call_dgesv.h"
+#include "batch_dgesv.h"
+
+// Entry (i,j) of A[k] and entry i of b[k] in a batch with the given storage order
+#define AIDX(order, batch, n, k, i, j) ((order) == RowMajor ? ((k) * (n) + (i)) * (n) + (j) : (k) + (batch) * ((i) + (n) * (j)))
+#define BIDX(order, batch, n, k, i) ((order) == RowMajor ? (k) * (n) + (i) : (k) + (batch) * (i))
+
+/* Solves a batch of random systems (system `singular` has a zero column, if
+   it is less than batch) and compares the others with call_dgesv */
+static void check(size_t batch, size_t n, enum storage_order order, threadpool_t *pool, size_t singular)
+{
+  ndarray_t *A = ndarray_alloc(3, (size_t[]){batch, n, n}, order);
+  ndarray_t *B = ndarray_alloc(2, (size_t[]){batch, n}, order);
+  array2d_t *Ak = array2d_alloc((size_t[]){n, n}, RowMajor);
+  array_t *bk = array_alloc(n);
+  assert(A != NULL && B != NULL && Ak != NULL && bk != NULL);
+  srand((unsigned)(batch + 31 * n));
+  for (size_t k = 0; k < batch; k++)
+    for (size_t i = 0; i < n; i++)
+    {
+      for (size_t j = 0; j < n; j++)
+        A->val[AIDX(order, batch, n, k, i, j)] = (k == singular && j == n / 2) ? 0.0 : (double)rand() / RAND_MAX - 0.5;
+      B->val[BIDX(order, batch, n, k, i)] = (double)rand() / RAND_MAX;
+    }
+  double *A0 = malloc(batch * n * n * sizeof(double)), *B0 = malloc(batch * n * sizeof(double));
+  assert(A0 != NULL && B0 != NULL);
+  memcpy(A0, A->val, batch * n * n * sizeof(double));
+  memcpy(B0, B->val, batch * n * sizeof(double));
+
+  int info = call_dgesv_batch(A, B, pool);
+  assert(info == (singular < batch ? (int)singular + 1 : 0));
+  for (size_t k = 0; k < batch; k++)
+  {
+    if (k == singular)
+      continue;
+    for (size_t i = 0; i < n; i++)
+    {
+      for (size_t j = 0; j < n; j++)
+        Ak->val[i * n + j] = A0[AIDX(order, batch, n, k, i, j)];
+      bk->val[i] = B0[BIDX(order, batch, n, k, i)];
+    }
+    bk->len = n;
+    assert(call_dgesv(Ak, bk) == 0);
+    for (size_t i = 0; i < n; i++)
+      assert(fabs(B->val[BIDX(order, batch, n, k, i)] - bk->val[i]) <= 1e-8 * (1.0 + fabs(bk->val[i])));
+  }
+  ndarray_dealloc(A);
+  ndarray_dealloc(B);
+  array2d_dealloc(Ak);
+  array_dealloc(bk);
+  free(A0);
+  free(B0);
+}
+
+int main(void)
+{
+  threadpool_t *pool = threadpool_alloc(3);
+  assert(pool != NULL);
+
+  // the specialized kernels (n = 2..32) and the generic one (n = 1, 33, 40)
+  for (size_t n = 1; n <= 33; n++)
+    for (int p = 0; p < 2; p++)
+    {
+      check(37, n, RowMajor, p ? pool : NULL, 37);
+      check(37, n, ColMajor, p ? pool : NULL, 37);
+    }
+  check(21, 40, RowMajor, pool, 21);
+  check(21, 40, ColMajor, pool, 21);
+  printf("batch vs call_dgesv: ok\n");
+
+  // the first singular system is reported, the other systems are solved
+  check(50, 6, RowMajor, pool, 29);
+  check(50, 6, ColMajor, pool, 29);
+  check(50, 6, ColMajor, NULL, 0);
+  check(3, 33, RowMajor, pool, 2);
+  printf("singular systems: ok\n");
+
+  // shapes and storage orders
+  ndarray_t *A = ndarray_alloc(3, (size_t[]){4, 3, 3}, RowMajor), *B = ndarray_alloc(2, (size_t[]){4, 3}, RowMajor);
+  ndarray_t *C = ndarray_alloc(2, (size_t[]){4, 3}, ColMajor), *D = ndarray_alloc(3, (size_t[]){4, 3, 2}, RowMajor);
+  assert(A != NULL && B != NULL && C != NULL && D != NULL);
+  assert(call_dgesv_batch(NULL, B, pool) == -9);
+  assert(call_dgesv_batch(D, B, pool) == -10);
+  assert(call_dgesv_batch(A, C, pool) == -11);
+  ndarray_dealloc(A);
+  ndarray_dealloc(B);
+  ndarray_dealloc(C);
+  ndarray_dealloc(D);
+  printf("input checks: ok\n");
+
+  threadpool_dealloc(pool);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,271 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <assert.h>
+#include "msptools.h"
+#include "call_dgesv.h"
+#include "lapack.h"
+
+typedef double (*entry_t)(size_t i, size_t j, size_t n);
+
+// Returns the n-by-n matrix with entries a(i,j) in the given storage order
+static array2d_t *matrix(entry_t a, size_t n, enum storage_order order)
+{
+  array2d_t *A = array2d_alloc((size_t[]){n, n}, order);
+  assert(A != NULL);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      A->val[(order == RowMajor) ? i * n + j : i + j * n] = a(i, j, n);
+  return A;
+}
+
+static array_t *rhs(size_t n)
+{
+  array_t *b = array_alloc(n);
+  assert(b != NULL);
+  for (size_t i = 0; i < n; i++)
+    b->val[i] = 1.0 + (double)(i % 7) - 0.1 * i;
+  b->len = n;
+  return b;
+}
+
+static double lower(size_t i, size_t j, size_t n) { return (j > i) ? 0.0 : (i == j) ? 2.0 + i % 3 : 1.0 / (1.0 + i + j + n); }
+static double upper(size_t i, size_t j, size_t n) { return lower(j, i, n) + (i == j ? 1.0 : 0.0); }
+
+// Nonsymmetric with lower bandwidth 2 and upper bandwidth 1
+static double band(size_t i, size_t j, size_t n)
+{
+  (void)n;
+  if (j + 2 < i || i + 1 < j)
+    return 0.0;
+  return (i == j) ? 4.0 : (i > j) ? -1.0 / (1.0 + i - j) : 0.5;
+}
+
+// Dense symmetric positive definite (diagonally dominant)
+static double spd(size_t i, size_t j, size_t n) { return (i == j) ? (double)n : 1.0 / (1.0 + (double)(i + j)); }
+
+// Dense symmetric with a positive diagonal, but indefinite
+static double indefinite(size_t i, size_t j, size_t n)
+{
+  (void)n;
+  return (i == j) ? 1.0 + 0.1 * i : 3.0 / (1.0 + (double)((i > j) ? i - j : j - i)) + 0.01 * (i + j);
+}
+
+// call_dgesv_auto takes the expected path and agrees with call_dgesv
+static void check_auto(entry_t a, size_t n, enum storage_order order, enum solve_path expected)
+{
+  array2d_t *A = matrix(a, n, order), *Aref = matrix(a, n, order);
+  array_t *b = rhs(n), *bref = rhs(n);
+  enum solve_path path = (expected == SolveGeneral) ? SolveSPD : SolveGeneral;
+  assert(call_dgesv_auto(A, b, &path) == 0);
+  assert(path == expected);
+  assert(call_dgesv(Aref, bref) == 0);
+  for (size_t i = 0; i < n; i++)
+    assert(fabs(b->val[i] - bref->val[i]) <= 1e-10 * (1.0 + fabs(bref->val[i])));
+  array2d_dealloc(A);
+  array2d_dealloc(Aref);
+  array_dealloc(b);
+  array_dealloc(bref);
+}
+
+static void test_auto(void)
+{
+  enum storage_order orders[2] = {RowMajor, ColMajor};
+  for (int o = 0; o < 2; o++)
+  {
+    check_auto(lower, 30, orders[o], SolveTriangular);
+    check_auto(upper, 30, orders[o], SolveTriangular);
+    check_auto(band, 40, orders[o], SolveBanded);
+    check_auto(spd, 25, orders[o], SolveSPD);
+    // DPOTRF fails: A is restored from its upper triangle and solved by call_dgesv
+    check_auto(indefinite, 25, orders[o], SolveGeneral);
+  }
+  // too wide a band for band storage
+  check_auto(band, 10, RowMajor, SolveGeneral);
+
+  array2d_t *A = matrix(spd, 3, RowMajor);
+  array_t *b = rhs(2);
+  assert(call_dgesv_auto(A, b, NULL) == -11);
+  assert(call_dgesv_auto(NULL, b, NULL) == -9);
+  array2d_dealloc(A);
+  array_dealloc(b);
+  printf("auto: ok\n");
+}
+
+// Hilbert matrix (cond_inf about 3.4e10 for n = 8)
+static double hilbert(size_t i, size_t j, size_t n)
+{
+  (void)n;
+  return 1.0 / (double)(i + j + 1);
+}
+
+/* Refinement converges for a well-conditioned A; for an ill-conditioned A it
+   does not, and the double-precision solution is returned with iter < 0 */
+static void check_mixed(entry_t a, size_t n, enum storage_order order, int converges)
+{
+  array2d_t *A = matrix(a, n, order), *Aref = matrix(a, n, order);
+  array_t *b = rhs(n), *bref = rhs(n);
+  // b = A*1, so x = 1 is the exact solution
+  for (size_t i = 0; i < n; i++)
+  {
+    b->val[i] = 0.0;
+    for (size_t j = 0; j < n; j++)
+      b->val[i] += a(i, j, n);
+    bref->val[i] = b->val[i];
+  }
+  int iter = 0;
+  double resid = -1.0;
+  assert(call_dgesv_mixed(A, b, 0.0, 10, &iter, &resid) == 0);
+  assert(call_dgesv(Aref, bref) == 0);
+  if (converges)
+    assert(iter >= 0 && iter <= 10);
+  else
+    assert(iter == -11);
+  assert(resid >= 0.0 && resid < 1e-12);
+  for (size_t i = 0; i < n; i++)
+  {
+    assert(fabs(b->val[i] - 1.0) < 1e-4);
+    assert(fabs(b->val[i] - bref->val[i]) < 1e-6);
+  }
+  // A is not modified
+  array2d_t *A0 = matrix(a, n, order);
+  assert(memcmp(A->val, A0->val, n * n * sizeof(double)) == 0);
+  array2d_dealloc(A0);
+  array2d_dealloc(A);
+  array2d_dealloc(Aref);
+  array_dealloc(b);
+  array_dealloc(bref);
+}
+
+static void test_mixed(void)
+{
+  enum storage_order orders[2] = {RowMajor, ColMajor};
+  for (int o = 0; o < 2; o++)
+  {
+    check_mixed(spd, 50, orders[o], 1);
+    check_mixed(band, 50, orders[o], 1);
+    check_mixed(hilbert, 8, orders[o], 0);
+  }
+  printf("mixed: ok\n");
+}
+
+// Random matrix with entries in [-0.5, 0.5] (the same for every (i,j) and n)
+static double random_entry(size_t i, size_t j, size_t n)
+{
+  unsigned long long h = (i * 2654435761ULL) ^ (j * 40503ULL + n);
+  h = (h ^ (h >> 13)) * 0x5bd1e995ULL;
+  return (double)((h >> 11) % 1000) / 999.0 - 0.5;
+}
+
+/* Compares the diagnostics of call_dgesv_diag with DGECON on the ColMajor LU
+   factors of A, the exact 1-norm condition number from A^-1, and the
+   backward error and residual of the returned x */
+static void check_diag(entry_t a, size_t n, enum storage_order order)
+{
+  array2d_t *A = matrix(a, n, order), *A0 = matrix(a, n, ColMajor), *F = matrix(a, n, ColMajor);
+  array2d_t *Ainv = array2d_alloc((size_t[]){n, n}, ColMajor);
+  array_t *b = rhs(n), *b0 = rhs(n);
+  lapack_int *ipiv = malloc(2 * n * sizeof(*ipiv)), in = (lapack_int)n, info;
+  double *work = malloc(4 * n * sizeof(double));
+  assert(Ainv != NULL && ipiv != NULL && work != NULL);
+  dgesv_diag_t d;
+  assert(call_dgesv_diag(A, b, &d) == 0);
+
+  // reference: DGECON with the 1-norm on the factors of A (not A^T)
+  double anorm = 0.0, ainvnorm = 0.0, rcond;
+  for (size_t j = 0; j < n; j++)
+  {
+    double s = 0.0;
+    for (size_t i = 0; i < n; i++)
+      s += fabs(A0->val[i + j * n]);
+    anorm = fmax(anorm, s);
+  }
+  char norm = '1';
+  dgetrf_(&in, &in, F->val, &in, ipiv, &info);
+  assert(info == 0);
+  dgecon_(&norm, &in, F->val, &in, &anorm, &rcond, work, ipiv + n, &info);
+  assert(info == 0);
+  assert(fabs(d.anorm - anorm) <= 1e-14 * anorm);
+  // the estimate for a RowMajor A comes from the factors of A^T, so it may differ slightly
+  if (order == ColMajor)
+    assert(fabs(d.rcond - rcond) <= 1e-12 * rcond);
+  else
+    assert(d.rcond <= 3.0 * rcond && rcond <= 3.0 * d.rcond);
+
+  // DGECON underestimates ||A^-1||_1, so rcond is at least the exact value
+  for (size_t k = 0; k < n * n; k++)
+    Ainv->val[k] = (k % (n + 1) == 0) ? 1.0 : 0.0;
+  memcpy(F->val, A0->val, n * n * sizeof(double));
+  assert(call_dgesv_multi(F, Ainv) == 0);
+  for (size_t j = 0; j < n; j++)
+  {
+    double s = 0.0;
+    for (size_t i = 0; i < n; i++)
+      s += fabs(Ainv->val[i + j * n]);
+    ainvnorm = fmax(ainvnorm, s);
+  }
+  double exact = 1.0 / (anorm * ainvnorm);
+  assert(d.rcond >= exact * (1.0 - 1e-6) && d.rcond <= 10.0 * exact);
+
+  /* backward error and residual of x; the residual is only accurate to about
+     n*eps*(|A|*|x|+|b|), so both are compared to that level */
+  double berr = 0.0, resid = 0.0, scale = 0.0;
+  for (size_t i = 0; i < n; i++)
+  {
+    double r = b0->val[i], den = fabs(b0->val[i]);
+    for (size_t j = 0; j < n; j++)
+    {
+      r -= A0->val[i + j * n] * b->val[j];
+      den += fabs(A0->val[i + j * n]) * fabs(b->val[j]);
+    }
+    berr = fmax(berr, fabs(r) / den);
+    resid = fmax(resid, fabs(r));
+    scale = fmax(scale, den);
+  }
+  assert(d.berr >= 0.0 && d.berr <= n * DBL_EPSILON && berr <= n * DBL_EPSILON);
+  assert(fabs(d.resid - resid) <= n * DBL_EPSILON * scale);
+
+  array2d_dealloc(A);
+  array2d_dealloc(A0);
+  array2d_dealloc(F);
+  array2d_dealloc(Ainv);
+  array_dealloc(b);
+  array_dealloc(b0);
+  free(ipiv);
+  free(work);
+}
+
+static void test_diag(void)
+{
+  enum storage_order orders[2] = {RowMajor, ColMajor};
+  for (int o = 0; o < 2; o++)
+  {
+    check_diag(random_entry, 30, orders[o]);
+    check_diag(band, 40, orders[o]);
+    check_diag(hilbert, 7, orders[o]);
+  }
+
+  // singular A: rcond is 0 and berr and resid are NAN
+  array2d_t *A = matrix(random_entry, 5, RowMajor);
+  array_t *b = rhs(5);
+  dgesv_diag_t d;
+  for (size_t i = 0; i < 5; i++)
+    A->val[i * 5 + 2] = 0.0;
+  assert(call_dgesv_diag(A, b, &d) > 0);
+  assert(d.rcond == 0.0 && isnan(d.berr) && isnan(d.resid));
+  assert(call_dgesv_diag(A, b, NULL) == -9);
+  array2d_dealloc(A);
+  array_dealloc(b);
+  printf("diag: ok\n");
+}
+
+int main(void)
+{
+  test_auto();
+  test_mixed();
+  test_diag();
+  return EXIT_SUCCESS;
+}
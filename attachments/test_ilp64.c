@@ -0,0 +1,156 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <unistd.h>
+#include <assert.h>
+#include "msptools.h"
+#include "call_dgesv.h"
+#include "call_dgels.h"
+#include "lu.h"
+#include "lapack.h"
+
+// Physical memory in bytes
+static double phys_mem(void)
+{
+  long pages = sysconf(_SC_PHYS_PAGES), size = sysconf(_SC_PAGESIZE);
+  return (pages > 0 && size > 0) ? (double)pages * size : 0.0;
+}
+
+// Dimensions that do not fit in a lapack_int are rejected before any call to LAPACK
+static void test_guards(void)
+{
+  double val[4] = {0};
+  size_t big = (size_t)LAPACK_INT_MAX + 1;
+  array2d_t A = {{big, big}, ColMajor, val};
+  array_t b = {big, big, val};
+  assert(call_dgesv(&A, &b) == -11);
+  assert(lu_factor(&A) == NULL);
+
+  array2d_t B = {{big, 1}, ColMajor, val};
+  assert(call_dgesv_multi(&A, &B) == -11);
+
+  array2d_t T = {{big, 2}, ColMajor, val};
+  assert(call_dgels(&T, &b) == -14);
+  printf("guards: ok\n");
+}
+
+// Least-squares fit of b = 3 + 2*t with m rows; A has 2*m elements
+static void test_dgels(size_t m, enum storage_order order)
+{
+  double need = 1.25 * 3.0 * m * sizeof(double);
+  if (phys_mem() < need)
+  {
+    printf("dgels m = %zu: skipped (needs %.1f GiB of memory)\n", m, need / (1 << 30));
+    return;
+  }
+  array2d_t *A = array2d_alloc((size_t[]){m, 2}, order);
+  array_t *b = array_alloc(m);
+  assert(A != NULL && b != NULL);
+  for (size_t i = 0; i < m; i++)
+  {
+    double t = (double)i / m;
+    size_t k0 = (order == ColMajor) ? i : 2 * i, k1 = (order == ColMajor) ? m + i : 2 * i + 1;
+    A->val[k0] = 1.0;
+    A->val[k1] = t;
+    b->val[i] = 3.0 + 2.0 * t;
+  }
+  b->len = m;
+  assert(call_dgels(A, b) == 0);
+  assert(b->len == 2);
+  assert(fabs(b->val[0] - 3.0) < 1e-6 && fabs(b->val[1] - 2.0) < 1e-6);
+  printf("dgels m = %zu (%zu elements): ok\n", m, 2 * m);
+  array2d_dealloc(A);
+  array_dealloc(b);
+}
+
+// ls_factor/ls_solve with several right-hand sides against call_dgels on a random m-by-n A
+static void test_ls(size_t m, size_t n, size_t nrhs, enum storage_order order)
+{
+  array2d_t *A = array2d_alloc((size_t[]){m, n}, order);
+  array2d_t *A2 = array2d_alloc((size_t[]){m, n}, order);
+  array_t *b = array_alloc(m), *b2 = array_alloc(m);
+  assert(A != NULL && A2 != NULL && b != NULL && b2 != NULL);
+  srand(1);
+  for (size_t k = 0; k < m * n; k++)
+    A->val[k] = (double)rand() / RAND_MAX - 0.5;
+  ls_t *ls = ls_factor(A);
+  assert(ls != NULL);
+  for (size_t j = 0; j < nrhs; j++)
+  {
+    for (size_t i = 0; i < m; i++)
+      b->val[i] = b2->val[i] = (double)rand() / RAND_MAX - 0.5;
+    b->len = b2->len = m;
+    memcpy(A2->val, A->val, m * n * sizeof(double));
+    assert(ls_solve(ls, b) == 0 && b->len == n);
+    assert(call_dgels(A2, b2) == 0 && b2->len == n);
+    for (size_t i = 0; i < n; i++)
+      assert(fabs(b->val[i] - b2->val[i]) <= 1e-10 * (1.0 + fabs(b2->val[i])));
+  }
+  b->len = m - 1;
+  assert(ls_solve(ls, b) == -14);
+  printf("ls m = %zu, n = %zu, %zu right-hand sides (%s): ok\n", m, n, nrhs,
+         order == ColMajor ? "ColMajor" : "RowMajor");
+  ls_dealloc(ls);
+  array2d_dealloc(A);
+  array2d_dealloc(A2);
+  array_dealloc(b);
+  array_dealloc(b2);
+}
+
+// Solves a diagonally dominant n-by-n system with known solution x = 1
+static void test_dgesv(size_t n)
+{
+  double need = 1.25 * (double)n * n * sizeof(double);
+  if (phys_mem() < need)
+  {
+    printf("dgesv n = %zu: skipped (needs %.1f GiB of memory)\n", n, need / (1 << 30));
+    return;
+  }
+  array2d_t *A = array2d_alloc((size_t[]){n, n}, RowMajor);
+  array_t *b = array_alloc(n);
+  assert(A != NULL && b != NULL);
+  for (size_t i = 0; i < n; i++)
+  {
+    double s = 0.0;
+    for (size_t j = 0; j < n; j++)
+    {
+      double a = (i == j) ? (double)n : 1.0 / (1.0 + (double)((i + 2 * j) % 17));
+      A->val[i * n + j] = a;
+      s += a;
+    }
+    b->val[i] = s;
+  }
+  b->len = n;
+  assert(call_dgesv(A, b) == 0);
+  for (size_t i = 0; i < n; i++)
+    assert(fabs(b->val[i] - 1.0) < 1e-8);
+  printf("dgesv n = %zu (%zu elements): ok\n", n, n * n);
+  array2d_dealloc(A);
+  array_dealloc(b);
+}
+
+int main(int argc, char *argv[])
+{
+  // test_ilp64 [n]: optionally also solves a dense n-by-n system (n > 46340 for more than 2^31 elements)
+  printf("sizeof(lapack_int) = %zu\n", sizeof(lapack_int));
+  test_guards();
+  test_dgesv(200);
+  test_dgels(1000, ColMajor);
+  test_dgels(1000, RowMajor);
+  test_ls(200, 7, 5, ColMajor);
+  test_ls(200, 7, 5, RowMajor);
+
+  // More than 2^31 elements with m < 2^31 (LP64 and ILP64)
+  test_dgels(((size_t)1 << 30) + 1, ColMajor);
+#ifdef MSP_ILP64
+  // m itself exceeds the range of a 32-bit int
+  test_dgels((size_t)INT_MAX + 2, RowMajor);
+#endif
+  if (argc > 1)
+    test_dgesv(strtoul(argv[1], NULL, 10));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "msptools.h"
+#include "lu_cache.h"
+
+#define N 4
+
+static char dir[64];
+
+// Writes text to dir/name and returns the path in buf
+static const char *write_file(char *buf, const char *name, const char *text)
+{
+  sprintf(buf, "%s/%s", dir, name);
+  FILE *fp = fopen(buf, "w");
+  assert(fp != NULL);
+  fputs(text, fp);
+  fclose(fp);
+  return buf;
+}
+
+// Factorization of a diagonally dominant N-by-N matrix that depends on seed
+static lu_t *test_lu(size_t seed)
+{
+  array2d_t *A = array2d_alloc((size_t[]){N, N}, RowMajor);
+  assert(A != NULL);
+  for (size_t i = 0; i < N; i++)
+    for (size_t j = 0; j < N; j++)
+      A->val[i * N + j] = (i == j) ? 10.0 + seed : 1.0 / (1.0 + (double)((seed + i + 2 * j) % 5));
+  lu_t *lu = lu_factor(A);
+  array2d_dealloc(A);
+  assert(lu != NULL);
+  return lu;
+}
+
+static size_t count_entries(const lu_cache_t *cache, const uint64_t keys[][2], size_t nkeys, int present[])
+{
+  size_t cnt = 0;
+  for (size_t k = 0; k < nkeys; k++)
+  {
+    lu_t *lu = lu_cache_get(cache, keys[k]);
+    present[k] = (lu != NULL);
+    cnt += present[k];
+    lu_dealloc(lu);
+  }
+  return cnt;
+}
+
+// Sets the modification time of the entry for key to `ago` seconds in the past
+static void set_age(const uint64_t key[2], time_t ago)
+{
+  char path[128];
+  sprintf(path, "%s/%016llx%016llx.lu", dir, (unsigned long long)key[0], (unsigned long long)key[1]);
+  struct timespec ts[2] = {{time(NULL) - ago, 0}, {time(NULL) - ago, 0}};
+  assert(utimensat(AT_FDCWD, path, ts, 0) == 0);
+}
+
+// The key depends on the contents of the file only (also for more than one read buffer)
+static void test_key(void)
+{
+  char p1[128], p2[128], p3[128];
+  uint64_t k1[2], k2[2], k3[2];
+  write_file(p1, "a.txt", "1 2\n3 4\n");
+  write_file(p2, "b.txt", "1 2\n3 4\n");
+  write_file(p3, "c.txt", "1 2\n3 5\n");
+  assert(lu_cache_key(p1, k1) == MSP_SUCCESS && lu_cache_key(p2, k2) == MSP_SUCCESS);
+  assert(lu_cache_key(p3, k3) == MSP_SUCCESS);
+  assert(k1[0] == k2[0] && k1[1] == k2[1]);
+  assert(k1[0] != k3[0] || k1[1] != k3[1]);
+
+  // files of 2^20 and 2^20 + 1 bytes that differ in the last byte
+  char *big = malloc((1 << 20) + 2);
+  assert(big != NULL);
+  memset(big, '1', (1 << 20) + 1);
+  big[(1 << 20) + 1] = '\0';
+  write_file(p1, "d.txt", big);
+  big[1 << 20] = '2';
+  write_file(p2, "e.txt", big);
+  big[1 << 20] = '\0';
+  write_file(p3, "f.txt", big);
+  free(big);
+  assert(lu_cache_key(p1, k1) == MSP_SUCCESS && lu_cache_key(p2, k2) == MSP_SUCCESS);
+  assert(lu_cache_key(p3, k3) == MSP_SUCCESS);
+  assert(k1[0] != k2[0] || k1[1] != k2[1]);
+  assert(k1[0] != k3[0] || k1[1] != k3[1]);
+
+  sprintf(p1, "%s/missing.txt", dir);
+  assert(lu_cache_key(p1, k1) == MSP_FILE_ERR);
+  printf("key: ok\n");
+}
+
+// An entry is returned as stored, and a truncated entry is ignored
+static void test_put_get(void)
+{
+  lu_cache_t cache = {dir, 0, CacheLRU};
+  uint64_t key[2] = {0x0123456789abcdefULL, 42}, other[2] = {1, 2};
+  lu_t *lu = test_lu(0);
+  assert(lu_cache_get(&cache, key) == NULL);
+  assert(lu_cache_put(&cache, key, lu) == MSP_SUCCESS);
+  assert(lu_cache_get(&cache, other) == NULL);
+
+  lu_t *hit = lu_cache_get(&cache, key);
+  assert(hit != NULL && hit->LU->shape[0] == N && hit->LU->shape[1] == N && hit->LU->order == lu->LU->order);
+  assert(memcmp(hit->LU->val, lu->LU->val, N * N * sizeof(double)) == 0);
+  assert(memcmp(hit->ipiv, lu->ipiv, N * sizeof(*lu->ipiv)) == 0);
+
+  // both solve A*x = b
+  array_t *b = array_alloc(N), *c = array_alloc(N);
+  assert(b != NULL && c != NULL);
+  for (size_t i = 0; i < N; i++)
+    b->val[i] = c->val[i] = 1.0 + i;
+  b->len = c->len = N;
+  assert(lu_solve(lu, b) == 0 && lu_solve(hit, c) == 0);
+  for (size_t i = 0; i < N; i++)
+    assert(b->val[i] == c->val[i]);
+  c->len = N - 1;
+  assert(lu_solve(hit, c) == -11);
+  lu_dealloc(hit);
+
+  char path[128];
+  sprintf(path, "%s/%016llx%016llx.lu", dir, (unsigned long long)key[0], (unsigned long long)key[1]);
+  assert(truncate(path, 64 + N * N * sizeof(double)) == 0);
+  assert(lu_cache_get(&cache, key) == NULL);
+  assert(unlink(path) == 0);
+
+  array_dealloc(b);
+  array_dealloc(c);
+  lu_dealloc(lu);
+  printf("put/get: ok\n");
+}
+
+// Three entries in a cache with room for two
+static void test_evict(enum lu_cache_policy policy)
+{
+  lu_cache_t cache = {dir, 0, policy};
+  uint64_t keys[3][2] = {{1, 1}, {2, 2}, {3, 3}};
+  int present[3];
+  lu_t *lu[3];
+  for (size_t k = 0; k < 3; k++)
+    lu[k] = test_lu(k);
+
+  assert(lu_cache_put(&cache, keys[0], lu[0]) == MSP_SUCCESS);
+  char path[128];
+  struct stat st;
+  sprintf(path, "%s/%016llx%016llx.lu", dir, 1ULL, 1ULL);
+  assert(stat(path, &st) == 0);
+  cache.max_bytes = 2 * (size_t)st.st_size + 1;
+  if (policy == CacheFIFO)
+    sleep(1); // the creation time has a resolution of one second
+  assert(lu_cache_put(&cache, keys[1], lu[1]) == MSP_SUCCESS);
+  assert(count_entries(&cache, keys, 3, present) == 2);
+
+  // entry 0 is used most recently but was stored first
+  set_age(keys[0], 100);
+  set_age(keys[1], 200);
+  lu_t *hit = lu_cache_get(&cache, keys[0]);
+  assert(hit != NULL);
+  lu_dealloc(hit);
+  if (policy == CacheFIFO)
+    sleep(1);
+  assert(lu_cache_put(&cache, keys[2], lu[2]) == MSP_SUCCESS);
+
+  // count_entries updates the modification times, so it is called last
+  int evicted = (policy == CacheLRU) ? 1 : 0;
+  sprintf(path, "%s/%016llx%016llx.lu", dir, (unsigned long long)evicted + 1, (unsigned long long)evicted + 1);
+  assert(access(path, F_OK) != 0);
+  assert(count_entries(&cache, keys, 3, present) == 2 && !present[evicted] && present[2]);
+
+  // an entry larger than the cache is not stored, and a limit of 0 removes nothing
+  cache.max_bytes = (size_t)st.st_size - 1;
+  assert(lu_cache_put(&cache, keys[1], lu[1]) == MSP_FAILURE);
+  cache.max_bytes = 0;
+  assert(lu_cache_evict(&cache, 0) == 0);
+  cache.max_bytes = 1;
+  assert(lu_cache_evict(&cache, 0) == 2);
+  assert(count_entries(&cache, keys, 3, present) == 0);
+
+  for (size_t k = 0; k < 3; k++)
+    lu_dealloc(lu[k]);
+  printf("evict (%s): ok\n", policy == CacheLRU ? "lru" : "fifo");
+}
+
+int main(void)
+{
+  snprintf(dir, sizeof(dir), "/tmp/test_lu_cache.XXXXXX");
+  assert(mkdtemp(dir) != NULL);
+  test_key();
+  test_put_get();
+  test_evict(CacheLRU);
+  test_evict(CacheFIFO);
+
+  char path[128];
+  for (char c = 'a'; c <= 'f'; c++)
+  {
+    sprintf(path, "%s/%c.txt", dir, c);
+    assert(unlink(path) == 0);
+  }
+  assert(rmdir(dir) == 0);
+  return EXIT_SUCCESS;
+}
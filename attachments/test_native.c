@@ -0,0 +1,53 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+#include "native_lu.h"
+
+// Factors a random ColMajor m-by-n matrix and checks that P*A = L*U
+static void test_getrf(int m, int n)
+{
+  int mn = (m < n) ? m : n;
+  double *A0 = malloc((size_t)m * n * sizeof(double)), *A = malloc((size_t)m * n * sizeof(double));
+  int *ipiv = malloc((mn > 0 ? mn : 1) * sizeof(int));
+  assert(A0 != NULL && A != NULL && ipiv != NULL);
+  srand(m * 1000 + n);
+  for (size_t k = 0; k < (size_t)m * n; k++)
+    A[k] = A0[k] = (double)rand() / RAND_MAX - 0.5;
+  assert(native_dgetrf(m, n, A, m, ipiv) == 0);
+
+  // apply the row interchanges to A0
+  for (int k = 0; k < mn; k++)
+  {
+    assert(ipiv[k] >= k + 1 && ipiv[k] <= m);
+    for (int c = 0; c < n; c++)
+    {
+      double t = A0[k + (size_t)c * m];
+      A0[k + (size_t)c * m] = A0[ipiv[k] - 1 + (size_t)c * m];
+      A0[ipiv[k] - 1 + (size_t)c * m] = t;
+    }
+  }
+  double err = 0.0;
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < n; j++)
+    {
+      double s = 0.0;
+      for (int k = 0; k <= ((i < j) ? i : j) && k < mn; k++)
+        s += ((i == k) ? 1.0 : A[i + (size_t)k * m]) * A[k + (size_t)j * m];
+      err = fmax(err, fabs(s - A0[i + (size_t)j * m]));
+    }
+  printf("getrf %4d x %4d: max |P*A - L*U| = %.3e\n", m, n, err);
+  assert(err < 1e-12 * n);
+  free(A0);
+  free(A);
+  free(ipiv);
+}
+
+int main(void)
+{
+  // square, tall and wide matrices, including wide panels below and above the recursion cutoff
+  int dims[][2] = {{1, 1}, {50, 50}, {200, 37}, {37, 200}, {1, 40}, {3, 100}, {17, 18}, {100, 333}};
+  for (size_t k = 0; k < sizeof(dims) / sizeof(*dims); k++)
+    test_getrf(dims[k][0], dims[k][1]);
+  return EXIT_SUCCESS;
+}
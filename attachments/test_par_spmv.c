@@ -0,0 +1,112 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+#include "msptools.h"
+#include "par_spmv.h"
+
+#define M 12
+#define N 300
+#define LONG_ROW 250
+
+/* M-by-N matrix with empty rows (0, 5, 6 and M-1), one row with LONG_ROW
+   nonzeros (row 3), and short rows otherwise */
+static csp_t *test_matrix(void)
+{
+  coo_t *sp = coo_alloc((size_t[]){M, N}, LONG_ROW + 4 * M);
+  assert(sp != NULL);
+  size_t k = 0;
+  for (size_t i = 1; i < M - 1; i++)
+  {
+    if (i == 5 || i == 6)
+      continue;
+    size_t len = (i == 3) ? LONG_ROW : 1 + i % 4;
+    for (size_t l = 0; l < len; l++)
+    {
+      sp->rowidx[k] = i;
+      sp->colidx[k] = (7 * i + 13 * l) % N;
+      sp->val[k++] = 1.0 / (1.0 + (double)((i + l) % 9)) - 0.25;
+    }
+  }
+  sp->nnz = k;
+  csp_t *A = csp_from_coo(sp, CSR);
+  coo_dealloc(sp);
+  assert(A != NULL);
+  return A;
+}
+
+/* Compares spmv_plan_exec with csp_spmv for y := alpha*A*x + beta*y; with
+   beta = 0, y starts as NaN (it need not be initialized) */
+static void check(const csp_t *A, size_t nthreads, enum spmv_split split, double alpha, double beta)
+{
+  size_t m = A->shape[0], n = A->shape[1];
+  array_t *x = array_alloc(n), *y = array_alloc(m), *yref = array_alloc(m);
+  assert(x != NULL && y != NULL && yref != NULL);
+  x->len = n;
+  y->len = yref->len = m;
+  for (size_t j = 0; j < n; j++)
+    x->val[j] = 1.0 + (double)(j % 17) / 8.0;
+  for (size_t i = 0; i < m; i++)
+  {
+    yref->val[i] = 0.5 + (double)i;
+    y->val[i] = (beta == 0.0) ? NAN : yref->val[i];
+  }
+  if (beta == 0.0)
+    for (size_t i = 0; i < m; i++)
+      yref->val[i] = 0.0;
+  assert(csp_spmv(alpha, A, x, beta, yref) == MSP_SUCCESS);
+
+  spmv_plan_t *plan = spmv_plan_alloc(A, nthreads, split);
+  assert(plan != NULL);
+  // twice, so that the second product sees the result of the first as y
+  for (int rep = 0; rep < 2; rep++)
+  {
+    assert(spmv_plan_exec(plan, alpha, x, beta, y) == MSP_SUCCESS);
+    for (size_t i = 0; i < m; i++)
+      assert(fabs(y->val[i] - yref->val[i]) <= 1e-12 * (1.0 + fabs(yref->val[i])));
+    if (rep == 0)
+      assert(csp_spmv(alpha, A, x, beta, yref) == MSP_SUCCESS);
+  }
+  spmv_plan_dealloc(plan);
+  array_dealloc(x);
+  array_dealloc(y);
+  array_dealloc(yref);
+}
+
+int main(void)
+{
+  csp_t *A = test_matrix();
+  size_t nnz = A->ptr[M];
+  // with 8 threads, every thread gets about (M+nnz)/8 < LONG_ROW/3 rows plus nonzeros
+  assert((M + nnz) / 8 < LONG_ROW / 3);
+  size_t nthreads[] = {1, 3, 8, M + nnz + 5};
+  double betas[] = {0.0, 1.0, -0.75};
+  for (size_t t = 0; t < 4; t++)
+    for (size_t b = 0; b < 3; b++)
+    {
+      check(A, nthreads[t], SpmvMergePath, 1.5, betas[b]);
+      check(A, nthreads[t], SpmvRowSplit, -2.0, betas[b]);
+    }
+  printf("merge path and row split vs csp_spmv: ok\n");
+
+  // more threads than the merge path has rows and nonzeros
+  spmv_plan_t *plan = spmv_plan_alloc(A, M + nnz + 5, SpmvMergePath);
+  assert(plan != NULL && spmv_plan_imbalance(plan) > 1.0);
+  spmv_plan_dealloc(plan);
+  plan = spmv_plan_alloc(A, 8, SpmvMergePath);
+  assert(plan != NULL && spmv_plan_imbalance(plan) < 1.1);
+
+  // x and y swapped
+  array_t *x = array_zeros(N), *y = array_zeros(M);
+  assert(x != NULL && y != NULL);
+  assert(spmv_plan_exec(plan, 1.0, y, 0.0, x) == MSP_DIM_ERR);
+  assert(spmv_plan_exec(plan, 1.0, x, 0.0, y) == MSP_SUCCESS);
+  spmv_plan_dealloc(plan);
+  printf("imbalance and dimension checks: ok\n");
+
+  array_dealloc(x);
+  array_dealloc(y);
+  csp_dealloc(A);
+  return EXIT_SUCCESS;
+}
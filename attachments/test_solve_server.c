@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <assert.h>
+#include "msptools.h"
+#include "solve_server.h"
+
+#define N 40
+#define ROUNDS 200
+
+static char path[64];
+
+static void *run_server(void *arg)
+{
+  assert(solve_server_run(arg) == MSP_SUCCESS);
+  return NULL;
+}
+
+// A diagonally dominant RowMajor N-by-N matrix; b = A*x with x(i) = 1 + i
+static array2d_t *test_matrix(array2d_t **B)
+{
+  array2d_t *A = array2d_alloc((size_t[]){N, N}, RowMajor);
+  *B = array2d_alloc((size_t[]){N, 2}, RowMajor);
+  assert(A != NULL && *B != NULL);
+  for (size_t i = 0; i < N; i++)
+  {
+    double s = 0.0;
+    for (size_t j = 0; j < N; j++)
+    {
+      double a = (i == j) ? (double)N : 1.0 / (1.0 + (double)((3 * i + j) % 11));
+      A->val[i * N + j] = a;
+      s += a * (1.0 + j);
+    }
+    (*B)->val[2 * i] = s;
+    (*B)->val[2 * i + 1] = 2.0 * s;
+  }
+  return A;
+}
+
+// Solves with name and checks X = [x, 2x] if the server has the matrix
+static int solve_and_check(int fd, const char *name, const array2d_t *B0)
+{
+  array2d_t *B = array2d_alloc(B0->shape, RowMajor);
+  assert(B != NULL);
+  memcpy(B->val, B0->val, 2 * N * sizeof(double));
+  int info = solve_client_solve(fd, name, B);
+  for (size_t i = 0; i < N && info == 0; i++)
+    assert(fabs(B->val[2 * i] - (1.0 + i)) < 1e-10 && fabs(B->val[2 * i + 1] - 2.0 * (1.0 + i)) < 1e-10);
+  array2d_dealloc(B);
+  return info;
+}
+
+typedef struct client
+{
+  const array2d_t *B;
+  size_t solved, missing;
+} client_t;
+
+// Solves repeatedly while the main thread drops and reloads the matrix
+static void *run_client(void *arg)
+{
+  client_t *c = arg;
+  int fd = solve_client_connect(path);
+  assert(fd >= 0);
+  for (size_t k = 0; k < ROUNDS; k++)
+  {
+    int info = solve_and_check(fd, "shared", c->B);
+    assert(info == 0 || info == -14);
+    if (info == 0)
+      c->solved++;
+    else
+      c->missing++;
+  }
+  solve_client_close(fd);
+  return NULL;
+}
+
+int main(void)
+{
+  snprintf(path, sizeof(path), "/tmp/test_solve_server.%ld.sock", (long)getpid());
+  solve_server_t *srv = solve_server_alloc(path, 4);
+  assert(srv != NULL);
+  pthread_t server;
+  assert(pthread_create(&server, NULL, run_server, srv) == 0);
+
+  array2d_t *B, *A = test_matrix(&B);
+  int fd = solve_client_connect(path);
+  assert(fd >= 0);
+
+  // load, solve (several times with one factorization), drop
+  assert(solve_client_load(fd, "A", A) == 0);
+  assert(solve_and_check(fd, "A", B) == 0);
+  assert(solve_and_check(fd, "A", B) == 0);
+  assert(solve_client_drop(fd, "A") == 0);
+  assert(solve_client_drop(fd, "A") == -14);
+  printf("load/solve/drop: ok\n");
+
+  // unknown name: the client loads A and solves again (as solve --connect does)
+  assert(solve_and_check(fd, "A", B) == -14);
+  assert(solve_client_load(fd, "A", A) == 0);
+  assert(solve_and_check(fd, "A", B) == 0);
+  printf("reload after -14: ok\n");
+
+  // a B with the wrong number of rows, a singular A, and a non-square A
+  array2d_t *C = array2d_alloc((size_t[]){N - 1, 1}, RowMajor), *Z = array2d_alloc((size_t[]){3, 3}, RowMajor);
+  array2d_t *R = array2d_alloc((size_t[]){3, 2}, RowMajor);
+  assert(C != NULL && Z != NULL && R != NULL);
+  assert(solve_client_solve(fd, "A", C) == -11);
+  assert(solve_client_load(fd, "Z", Z) > 0);
+  assert(solve_and_check(fd, "Z", B) == -14);
+  assert(solve_client_load(fd, "R", R) == -10);
+  printf("dimension checks: ok\n");
+
+  // two clients solve with one name while it is dropped and reloaded
+  assert(solve_client_load(fd, "shared", A) == 0);
+  client_t clients[2] = {{B, 0, 0}, {B, 0, 0}};
+  pthread_t threads[2];
+  for (int t = 0; t < 2; t++)
+    assert(pthread_create(threads + t, NULL, run_client, clients + t) == 0);
+  for (size_t k = 0; k < ROUNDS / 4; k++)
+  {
+    assert(solve_client_drop(fd, "shared") == 0);
+    assert(solve_client_load(fd, "shared", A) == 0);
+    assert(solve_client_load(fd, "shared", A) == 0); // replaces the entry in use
+  }
+  for (int t = 0; t < 2; t++)
+  {
+    pthread_join(threads[t], NULL);
+    assert(clients[t].solved + clients[t].missing == ROUNDS);
+  }
+  printf("concurrent drop/reload: ok (%zu solved, %zu missing)\n", clients[0].solved + clients[1].solved,
+         clients[0].missing + clients[1].missing);
+
+  assert(solve_client_stop(fd) == 0);
+  solve_client_close(fd);
+  pthread_join(server, NULL);
+  solve_server_dealloc(srv);
+  assert(access(path, F_OK) != 0);
+
+  array2d_dealloc(A);
+  array2d_dealloc(B);
+  array2d_dealloc(C);
+  array2d_dealloc(Z);
+  array2d_dealloc(R);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "msptools.h"
+#include "tiled.h"
+#include "lapack.h"
+
+// ||b - A*x||_inf / (||A||_inf * ||x||_inf) for a ColMajor A
+static double rel_residual(const array2d_t *A, const double *b, const double *x)
+{
+  size_t n = A->shape[0];
+  double rmax = 0.0, anorm = 0.0, xmax = 0.0;
+  for (size_t i = 0; i < n; i++)
+  {
+    double r = b[i], s = 0.0;
+    for (size_t j = 0; j < n; j++)
+    {
+      r -= A->val[i + j * n] * x[j];
+      s += fabs(A->val[i + j * n]);
+    }
+    rmax = fmax(rmax, fabs(r));
+    anorm = fmax(anorm, s);
+    xmax = fmax(xmax, fabs(x[i]));
+  }
+  return rmax / (anorm * xmax);
+}
+
+/* Factors a random SPD matrix and a random general matrix of order n with
+   tile size nb and nthreads workers, and checks the residual of a solve */
+static void check(size_t n, size_t nb, size_t nthreads)
+{
+  array2d_t *S = array2d_alloc((size_t[]){n, n}, ColMajor), *G = array2d_alloc((size_t[]){n, n}, ColMajor);
+  array2d_t *F = array2d_alloc((size_t[]){n, n}, ColMajor);
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  lapack_int *ipiv = malloc(n * sizeof(*ipiv));
+  assert(S != NULL && G != NULL && F != NULL && b != NULL && x != NULL && ipiv != NULL);
+  srand((unsigned)(n + 100 * nb));
+  for (size_t j = 0; j < n; j++)
+  {
+    for (size_t i = 0; i <= j; i++)
+      S->val[i + j * n] = S->val[j + i * n] = (double)rand() / RAND_MAX - 0.5;
+    S->val[j + j * n] += n;
+    b[j] = (double)rand() / RAND_MAX;
+  }
+  for (size_t k = 0; k < n * n; k++)
+    G->val[k] = (double)rand() / RAND_MAX - 0.5;
+
+  lapack_int in = (lapack_int)n, nrhs = 1, info;
+  char uplo = 'L', trans = 'N';
+  tiled_t *T = array2d_to_tiled(S, nb);
+  assert(T != NULL && T->mt == (n + nb - 1) / nb);
+  assert(tiled_dpotrf(T, nthreads) == 0);
+  assert(tiled_to_array2d(T, F) == MSP_SUCCESS);
+  tiled_dealloc(T);
+  memcpy(x, b, n * sizeof(double));
+  dpotrs_(&uplo, &in, &nrhs, F->val, &in, x, &in, &info);
+  assert(info == 0 && rel_residual(S, b, x) < 1e-14);
+
+  T = array2d_to_tiled(G, nb);
+  assert(T != NULL);
+  assert(tiled_dgetrf(T, ipiv, nthreads) == 0);
+  assert(tiled_to_array2d(T, F) == MSP_SUCCESS);
+  tiled_dealloc(T);
+  memcpy(x, b, n * sizeof(double));
+  dgetrs_(&trans, &in, &nrhs, F->val, &in, ipiv, x, &in, &info);
+  assert(info == 0 && rel_residual(G, b, x) < 1e-13);
+
+  array2d_dealloc(S);
+  array2d_dealloc(G);
+  array2d_dealloc(F);
+  free(b);
+  free(x);
+  free(ipiv);
+}
+
+// Singular and indefinite matrices are reported as by DGETRF and DPOTRF
+static void test_info(void)
+{
+  size_t n = 20, nb = 6;
+  array2d_t *A = array2d_alloc((size_t[]){n, n}, RowMajor);
+  lapack_int ipiv[20];
+  assert(A != NULL);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      A->val[i * n + j] = (j == 13) ? 0.0 : (i == j) ? 4.0 : 1.0 / (1.0 + i + 2 * j);
+  tiled_t *T = array2d_to_tiled(A, nb);
+  assert(T != NULL && tiled_dgetrf(T, ipiv, 3) == 14);
+  tiled_dealloc(T);
+
+  // the round trip through tile layout keeps the RowMajor order
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      A->val[i * n + j] = (i == j) ? ((i == 9) ? -1.0 : 4.0) : 0.1;
+  T = array2d_to_tiled(A, nb);
+  array2d_t *B = array2d_alloc((size_t[]){n, n}, RowMajor);
+  assert(T != NULL && B != NULL && tiled_to_array2d(T, B) == MSP_SUCCESS);
+  assert(memcmp(A->val, B->val, n * n * sizeof(double)) == 0);
+  assert(tiled_dpotrf(T, 3) == 10);
+  tiled_dealloc(T);
+  array2d_dealloc(A);
+  array2d_dealloc(B);
+}
+
+int main(void)
+{
+  // ragged edge tiles (n not a multiple of nb), and more workers than tiles
+  const size_t cases[][2] = {{1, 4}, {7, 3}, {50, 8}, {67, 16}, {100, 32}, {64, 16}};
+  const size_t threads[] = {1, 3, 4};
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    for (size_t t = 0; t < 3; t++)
+      check(cases[c][0], cases[c][1], threads[t]);
+  printf("tiled dpotrf/dgetrf residuals: ok\n");
+  test_info();
+  printf("tiled info: ok\n");
+  return EXIT_SUCCESS;
+}
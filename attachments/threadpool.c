@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+#include "threadpool.h"
+#include "misc.h"
+#include <stdio.h>
+#include <pthread.h>
+
+typedef struct task /* queued task */
+{
+  void (*fn)(void *);
+  void *arg;
+  struct task *next;
+} task_t;
+
+struct threadpool
+{
+  size_t nthreads;
+  pthread_t *threads;
+  pthread_mutex_t lock;
+  pthread_cond_t has_task; // signaled when a task is queued or on shutdown
+  pthread_cond_t idle;     // signaled when the last pending task completes
+  task_t *head, *tail;     // FIFO task queue
+  size_t pending;          // queued and running tasks
+  int shutdown;
+};
+
+// Worker loop: runs queued tasks until the pool is shut down
+static void *worker(void *arg)
+{
+  threadpool_t *pool = arg;
+  pthread_mutex_lock(&pool->lock);
+  for (;;)
+  {
+    while (pool->head == NULL && !pool->shutdown)
+      pthread_cond_wait(&pool->has_task, &pool->lock);
+    if (pool->head == NULL)
+      break; // shutdown and queue drained
+    task_t *t = pool->head;
+    pool->head = t->next;
+    if (pool->head == NULL)
+      pool->tail = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    t->fn(t->arg);
+    free(t);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0)
+      pthread_cond_broadcast(&pool->idle);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+threadpool_t *threadpool_alloc(size_t nthreads)
+/*
+  Purpose:
+
+    Starts a pool of worker threads that run submitted tasks in FIFO order.
+
+  Example:
+
+    ```c
+    threadpool_t *pool = threadpool_alloc(4);
+    if (pool==NULL) exit(EXIT_FAILURE);
+    for (size_t k=0;k<100;k++) threadpool_submit(pool, work, args + k);
+    threadpool_wait(pool);   // all 100 tasks are done
+    threadpool_dealloc(pool);
+    ```
+
+  Arguments:
+    nthreads     number of worker threads (at least 1)
+
+  Return value:
+    A pointer to a threadpool_t, or NULL if an error occurs.
+*/
+{
+  threadpool_t *pool = calloc(1, sizeof(*pool));
+  if (pool == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  if (nthreads == 0)
+    nthreads = 1;
+  pool->threads = malloc(nthreads * sizeof(*pool->threads));
+  if (pool->threads == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->has_task, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  for (size_t k = 0; k < nthreads; k++)
+  {
+    if (pthread_create(pool->threads + k, NULL, worker, pool) != 0)
+    {
+      fprintf(stderr, "%s: failed to create thread\n", __func__);
+      break;
+    }
+    pool->nthreads++;
+  }
+  if (pool->nthreads == 0)
+  {
+    threadpool_dealloc(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void threadpool_dealloc(threadpool_t *pool)
+/* Purpose: Runs the remaining tasks, stops the workers and deallocates the pool. */
+{
+  if (pool == NULL)
+    return;
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->has_task);
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t k = 0; k < pool->nthreads; k++)
+    pthread_join(pool->threads[k], NULL);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->has_task);
+  pthread_cond_destroy(&pool->idle);
+  free(pool->threads);
+  free(pool);
+}
+
+size_t threadpool_size(const threadpool_t *pool)
+/* Purpose: Returns the number of worker threads (1 for a NULL pool). */
+{
+  return pool ? pool->nthreads : 1;
+}
+
+int threadpool_submit(threadpool_t *pool, void (*fn)(void *), void *arg)
+/*
+  Purpose:
+
+    Queues the task fn(arg). If pool is NULL, the task is run immediately
+    in the calling thread.
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_ILLEGAL_INPUT if fn is NULL, and
+    MSP_MEM_ERR if the task could not be queued.
+*/
+{
+  if (fn == NULL)
+    return MSP_ILLEGAL_INPUT;
+  if (pool == NULL)
+  {
+    fn(arg);
+    return MSP_SUCCESS;
+  }
+  task_t *t = malloc(sizeof(*t));
+  if (t == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return MSP_MEM_ERR;
+  }
+  t->fn = fn;
+  t->arg = arg;
+  t->next = NULL;
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail)
+    pool->tail->next = t;
+  else
+    pool->head = t;
+  pool->tail = t;
+  pool->pending++;
+  pthread_cond_signal(&pool->has_task);
+  pthread_mutex_unlock(&pool->lock);
+  return MSP_SUCCESS;
+}
+
+void threadpool_wait(threadpool_t *pool)
+/* Purpose: Blocks until all submitted tasks have completed. */
+{
+  if (pool == NULL)
+    return;
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0)
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
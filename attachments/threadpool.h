@@ -0,0 +1,13 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <stdlib.h>
+
+typedef struct threadpool threadpool_t; /* fixed-size pool of worker threads */
+
+threadpool_t *threadpool_alloc(size_t nthreads);
+void threadpool_dealloc(threadpool_t *pool);
+size_t threadpool_size(const threadpool_t *pool);
+int threadpool_submit(threadpool_t *pool, void (*fn)(void *), void *arg);
+void threadpool_wait(threadpool_t *pool);
+
+#endif
@@ -0,0 +1,486 @@
+#include "tiled.h"
+#include "dag.h"
+#include "lapack.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+tiled_t *tiled_alloc(const size_t shape[2], size_t nb)
+/*
+  Purpose:
+
+    Allocates an m-by-n matrix in tile layout. The matrix is split into
+    nb-by-nb tiles that are each stored contiguously in ColMajor order, so
+    a task working on one tile touches a single block of memory. Tiles in
+    the last tile row/column are padded to full size. The elements are
+    initialized with the value zero.
+
+  Arguments:
+    shape      number of rows and columns
+    nb         tile size (at least 1)
+
+  Return value:
+    A pointer to a tiled_t, or NULL if an error occurs.
+*/
+{
+  if (nb == 0)
+    return NULL;
+  tiled_t *T = malloc(sizeof(*T));
+  if (T == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    return NULL;
+  }
+  T->shape[0] = shape[0];
+  T->shape[1] = shape[1];
+  T->nb = nb;
+  T->mt = (shape[0] + nb - 1) / nb;
+  T->nt = (shape[1] + nb - 1) / nb;
+  T->val = calloc(T->mt * T->nt * nb * nb + 1, sizeof(double));
+  if (T->val == NULL)
+  {
+#ifndef NDEBUG
+    MEM_ERR;
+#endif
+    free(T);
+    return NULL;
+  }
+  return T;
+}
+
+void tiled_dealloc(tiled_t *T)
+// Purpose: Deallocates a tiled_t.
+{
+  if (T == NULL)
+    return;
+  free(T->val);
+  free(T);
+}
+
+double *tiled_tile(const tiled_t *T, size_t i, size_t j)
+// Purpose: Returns a pointer to tile (i,j) (leading dimension T->nb).
+{
+  return T->val + (i + j * T->mt) * T->nb * T->nb;
+}
+
+tiled_t *array2d_to_tiled(const array2d_t *A, size_t nb)
+/*
+  Purpose:
+
+    Copies a RowMajor or ColMajor array2d_t into a new tiled_t with tile
+    size nb.
+
+  Return value:
+    A pointer to a tiled_t, or NULL if an error occurs.
+*/
+{
+  if (A == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return NULL;
+  }
+  tiled_t *T = tiled_alloc(A->shape, nb);
+  if (T == NULL)
+    return NULL;
+  size_t m = A->shape[0], n = A->shape[1];
+  size_t st0 = (A->order == RowMajor) ? n : 1;
+  size_t st1 = (A->order == RowMajor) ? 1 : m;
+  for (size_t j = 0; j < n; j++)
+  {
+    for (size_t i = 0; i < m; i++)
+    {
+      double *t = tiled_tile(T, i / nb, j / nb);
+      t[i % nb + (j % nb) * nb] = A->val[i * st0 + j * st1];
+    }
+  }
+  return T;
+}
+
+int tiled_to_array2d(const tiled_t *T, array2d_t *A)
+/*
+  Purpose:
+
+    Copies a tiled_t into an existing array2d_t of the same shape (in the
+    storage order of A).
+
+  Return value:
+    MSP_SUCCESS if successful, MSP_ILLEGAL_INPUT if T or A is NULL, and
+    MSP_DIM_ERR if the shapes differ.
+*/
+{
+  if (T == NULL || A == NULL)
+  {
+#ifndef NDEBUG
+    INPUT_ERR;
+#endif
+    return MSP_ILLEGAL_INPUT;
+  }
+  if (A->shape[0] != T->shape[0] || A->shape[1] != T->shape[1])
+    return MSP_DIM_ERR;
+  size_t m = A->shape[0], n = A->shape[1], nb = T->nb;
+  size_t st0 = (A->order == RowMajor) ? n : 1;
+  size_t st1 = (A->order == RowMajor) ? 1 : m;
+  for (size_t j = 0; j < n; j++)
+  {
+    for (size_t i = 0; i < m; i++)
+    {
+      const double *t = tiled_tile(T, i / nb, j / nb);
+      A->val[i * st0 + j * st1] = t[i % nb + (j % nb) * nb];
+    }
+  }
+  return MSP_SUCCESS;
+}
+
+// Rows (or columns) of tile row (or column) k of an n-by-n tiled matrix
+static lapack_int tile_dim(const tiled_t *A, size_t k)
+{
+  return (lapack_int)MIN(A->nb, A->shape[0] - k * A->nb);
+}
+
+typedef struct tile_task /* argument of the tile kernels */
+{
+  tiled_t *A;
+  size_t i, j, k; // tile indices (meaning depends on the kernel)
+  lapack_int *ipiv;
+  lapack_int *info; // shared status of the factorization
+} tile_task_t;
+
+/* Tiled Cholesky kernels (lower triangle) */
+
+// A_kk = L_kk*L_kk^T
+static void task_potrf(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) != 0)
+    return;
+  char uplo = 'L';
+  lapack_int n = tile_dim(t->A, t->k), lda = (lapack_int)t->A->nb, info;
+  dpotrf_(&uplo, &n, tiled_tile(t->A, t->k, t->k), &lda, &info);
+  if (info > 0)
+    __atomic_store_n(t->info, (lapack_int)(t->k * t->A->nb) + info, __ATOMIC_RELEASE);
+}
+
+// A_ik = A_ik*L_kk^-T
+static void task_trsm_chol(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) != 0)
+    return;
+  char side = 'R', uplo = 'L', trans = 'T', diag = 'N';
+  lapack_int m = tile_dim(t->A, t->i), n = tile_dim(t->A, t->k), lda = (lapack_int)t->A->nb;
+  double one = 1.0;
+  dtrsm_(&side, &uplo, &trans, &diag, &m, &n, &one, tiled_tile(t->A, t->k, t->k), &lda,
+         tiled_tile(t->A, t->i, t->k), &lda);
+}
+
+// A_ii = A_ii - A_ik*A_ik^T
+static void task_syrk(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) != 0)
+    return;
+  char uplo = 'L', trans = 'N';
+  lapack_int n = tile_dim(t->A, t->i), k = tile_dim(t->A, t->k), lda = (lapack_int)t->A->nb;
+  double alpha = -1.0, beta = 1.0;
+  dsyrk_(&uplo, &trans, &n, &k, &alpha, tiled_tile(t->A, t->i, t->k), &lda, &beta,
+         tiled_tile(t->A, t->i, t->i), &lda);
+}
+
+// A_ij = A_ij - A_ik*A_jk^T
+static void task_gemm_chol(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) != 0)
+    return;
+  char transa = 'N', transb = 'T';
+  lapack_int m = tile_dim(t->A, t->i), n = tile_dim(t->A, t->j), k = tile_dim(t->A, t->k);
+  lapack_int lda = (lapack_int)t->A->nb;
+  double alpha = -1.0, beta = 1.0;
+  dgemm_(&transa, &transb, &m, &n, &k, &alpha, tiled_tile(t->A, t->i, t->k), &lda,
+         tiled_tile(t->A, t->j, t->k), &lda, &beta, tiled_tile(t->A, t->i, t->j), &lda);
+}
+
+/* tiled_dpotrf : tiled Cholesky factorization
+
+Purpose:
+Computes the Cholesky factorization A = L*L^T of a symmetric positive definite
+matrix in tile layout. Only the lower triangle (tiles (i,j) with i >= j) is
+referenced and it is overwritten by L, as with DPOTRF and uplo = 'L'.
+
+The factorization is expressed as a graph of tile tasks (POTRF on the
+diagonal tile, TRSM on the tiles below it, SYRK/GEMM on the trailing
+submatrix) whose dependencies follow from the tiles they read and write. The
+graph is executed by nthreads workers with work stealing (see dag_run), so
+the factorization of diagonal tile k+1 starts as soon as it has been updated
+instead of waiting for the whole trailing update of step k.
+
+The tile kernels call BLAS/LAPACK, which should run single-threaded (e.g.
+OPENBLAS_NUM_THREADS=1) so that the workers do not oversubscribe the cores.
+
+Return value:
+The function returns 0 on success, and i > 0 if the leading minor of order i
+is not positive definite (as DPOTRF). Otherwise the return value is
+
+  -9 if the input A is NULL
+  -10 if A is not square
+  -11 if n does not fit in a lapack_int (see lapack.h)
+  -12 in case of memory allocation errors.
+*/
+int tiled_dpotrf(tiled_t *A, size_t nthreads)
+{
+  if (A == NULL)
+  {
+    return -9;
+  }
+  if (A->shape[0] != A->shape[1])
+  {
+    return -10;
+  }
+  if (!lapack_int_fits(A->shape[0]))
+  {
+    return -11;
+  }
+
+  lapack_int info = 0;
+  size_t nt = A->nt;
+  dag_t *dag = dag_alloc();
+  if (dag == NULL)
+  {
+    return -12;
+  }
+  int status = MSP_SUCCESS;
+  for (size_t k = 0; k < nt && status == MSP_SUCCESS; k++)
+  {
+    tile_task_t t = {A, k, k, k, NULL, &info};
+    double *Akk = tiled_tile(A, k, k);
+    status = dag_insert(dag, task_potrf, &t, sizeof(t), 1, (dag_dep_t[]){{Akk, DagWrite}});
+    for (size_t i = k + 1; i < nt && status == MSP_SUCCESS; i++)
+    {
+      t.i = i;
+      status = dag_insert(dag, task_trsm_chol, &t, sizeof(t), 2,
+                          (dag_dep_t[]){{Akk, DagRead}, {tiled_tile(A, i, k), DagWrite}});
+    }
+    for (size_t i = k + 1; i < nt && status == MSP_SUCCESS; i++)
+    {
+      double *Aik = tiled_tile(A, i, k);
+      t.i = i;
+      t.j = i;
+      status = dag_insert(dag, task_syrk, &t, sizeof(t), 2,
+                          (dag_dep_t[]){{Aik, DagRead}, {tiled_tile(A, i, i), DagWrite}});
+      for (size_t j = k + 1; j < i && status == MSP_SUCCESS; j++)
+      {
+        t.j = j;
+        status = dag_insert(dag, task_gemm_chol, &t, sizeof(t), 3,
+                            (dag_dep_t[]){{Aik, DagRead}, {tiled_tile(A, j, k), DagRead},
+                                          {tiled_tile(A, i, j), DagWrite}});
+      }
+    }
+  }
+  if (status == MSP_SUCCESS)
+    status = dag_run(dag, nthreads);
+  dag_dealloc(dag);
+  return (status == MSP_SUCCESS) ? (int)info : -12;
+}
+
+/* Tiled LU kernels */
+
+// Swaps rows r and ipiv[r]-1 of tile column j for the pivots of panel k
+static void swap_rows(tiled_t *A, const lapack_int *ipiv, size_t k, size_t j)
+{
+  size_t nb = A->nb, r0 = k * nb, r1 = r0 + tile_dim(A, k), n = tile_dim(A, j);
+  for (size_t r = r0; r < r1; r++)
+  {
+    size_t p = (size_t)ipiv[r] - 1;
+    if (p == r)
+      continue;
+    double *x = tiled_tile(A, r / nb, j) + r % nb;
+    double *y = tiled_tile(A, p / nb, j) + p % nb;
+    for (size_t c = 0; c < n; c++)
+    {
+      double tmp = x[c * nb];
+      x[c * nb] = y[c * nb];
+      y[c * nb] = tmp;
+    }
+  }
+}
+
+// Factors tile column k from the diagonal down (partial pivoting over all
+// of its tiles) on a contiguous copy
+static void task_panel(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) < 0)
+    return;
+  tiled_t *A = t->A;
+  size_t nb = A->nb, k = t->k, mt = A->mt;
+  lapack_int m = (lapack_int)(A->shape[0] - k * nb), n = tile_dim(A, k), info;
+  double *W = malloc((size_t)m * n * sizeof(double));
+  lapack_int *piv = malloc((size_t)n * sizeof(*piv));
+  if (W == NULL || piv == NULL)
+  {
+    free(W);
+    free(piv);
+    __atomic_store_n(t->info, -12, __ATOMIC_RELEASE);
+    return;
+  }
+  for (size_t i = k; i < mt; i++)
+  {
+    size_t mb = tile_dim(A, i), r0 = (i - k) * nb;
+    const double *Aik = tiled_tile(A, i, k);
+    for (size_t c = 0; c < (size_t)n; c++)
+      memcpy(W + r0 + c * m, Aik + c * nb, mb * sizeof(double));
+  }
+  dgetrf_(&m, &n, W, &m, piv, &info);
+  for (size_t i = k; i < mt; i++)
+  {
+    size_t mb = tile_dim(A, i), r0 = (i - k) * nb;
+    double *Aik = tiled_tile(A, i, k);
+    for (size_t c = 0; c < (size_t)n; c++)
+      memcpy(Aik + c * nb, W + r0 + c * m, mb * sizeof(double));
+  }
+  for (lapack_int r = 0; r < n; r++)
+    t->ipiv[k * nb + r] = piv[r] + (lapack_int)(k * nb);
+  if (info > 0 && __atomic_load_n(t->info, __ATOMIC_ACQUIRE) == 0)
+    __atomic_store_n(t->info, (lapack_int)(k * nb) + info, __ATOMIC_RELEASE);
+  free(piv);
+  free(W);
+}
+
+// Applies the pivots of panel k to tile column j > k and computes U_kj = L_kk^-1*A_kj
+static void task_rowpanel(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) < 0)
+    return; // a panel failed to allocate and left its pivots unset
+  swap_rows(t->A, t->ipiv, t->k, t->j);
+  char side = 'L', uplo = 'L', trans = 'N', diag = 'U';
+  lapack_int m = tile_dim(t->A, t->k), n = tile_dim(t->A, t->j), lda = (lapack_int)t->A->nb;
+  double one = 1.0;
+  dtrsm_(&side, &uplo, &trans, &diag, &m, &n, &one, tiled_tile(t->A, t->k, t->k), &lda,
+         tiled_tile(t->A, t->k, t->j), &lda);
+}
+
+// Applies the pivots of panel k to tile column j < k (the L factor)
+static void task_swap_left(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) < 0)
+    return;
+  swap_rows(t->A, t->ipiv, t->k, t->j);
+}
+
+// A_ij = A_ij - L_ik*U_kj
+static void task_gemm_lu(void *arg)
+{
+  tile_task_t *t = arg;
+  if (__atomic_load_n(t->info, __ATOMIC_ACQUIRE) < 0)
+    return;
+  char trans = 'N';
+  lapack_int m = tile_dim(t->A, t->i), n = tile_dim(t->A, t->j), k = tile_dim(t->A, t->k);
+  lapack_int lda = (lapack_int)t->A->nb;
+  double alpha = -1.0, beta = 1.0;
+  dgemm_(&trans, &trans, &m, &n, &k, &alpha, tiled_tile(t->A, t->i, t->k), &lda,
+         tiled_tile(t->A, t->k, t->j), &lda, &beta, tiled_tile(t->A, t->i, t->j), &lda);
+}
+
+// Inserts a task that writes tiles k..mt-1 of tile column j after reading tile (k,k)
+static int insert_column_task(dag_t *dag, void (*fn)(void *), tile_task_t *t, dag_dep_t *deps)
+{
+  tiled_t *A = t->A;
+  size_t nd = 0;
+  deps[nd++] = (dag_dep_t){tiled_tile(A, t->k, t->k), DagRead};
+  for (size_t i = t->k; i < A->mt; i++)
+    deps[nd++] = (dag_dep_t){tiled_tile(A, i, t->j), DagWrite};
+  return dag_insert(dag, fn, t, sizeof(*t), nd, deps);
+}
+
+/* tiled_dgetrf : tiled LU factorization with partial pivoting
+
+Purpose:
+Computes the factorization A = P*L*U of a square matrix in tile layout with
+the same result as LAPACK's DGETRF: A is overwritten by L (unit diagonal not
+stored) and U, and ipiv (length n) holds the 1-based pivot indices. After
+converting the factors to a ColMajor array2d_t with tiled_to_array2d, they
+can be used as an lu_t to solve systems with lu_solve.
+
+Each step k consists of a panel task (DGETRF with partial pivoting on tile
+column k, copied to contiguous storage), a task per tile column j > k that
+applies the row interchanges and computes the block row of U (DTRSM), and a
+DGEMM task per trailing tile. The interchanges are also applied to the
+previous tile columns by separate tasks. The tasks are executed by nthreads
+workers with work stealing (see dag_run), so the panel of step k+1 overlaps
+the trailing update of step k (lookahead). As in tiled_dpotrf, BLAS should
+run single-threaded.
+
+Return value:
+The function returns 0 on success, and i > 0 if U(i,i) is exactly zero (as
+DGETRF). Otherwise the return value is
+
+  -9 if the input A and/or ipiv is NULL
+  -10 if A is not square
+  -11 if n does not fit in a lapack_int (see lapack.h)
+  -12 in case of memory allocation errors.
+*/
+int tiled_dgetrf(tiled_t *A, lapack_int *ipiv, size_t nthreads)
+{
+  if (A == NULL || ipiv == NULL)
+  {
+    return -9;
+  }
+  if (A->shape[0] != A->shape[1])
+  {
+    return -10;
+  }
+  if (!lapack_int_fits(A->shape[0]))
+  {
+    return -11;
+  }
+
+  lapack_int info = 0;
+  size_t nt = A->nt;
+  dag_t *dag = dag_alloc();
+  dag_dep_t *deps = malloc((A->mt + 1) * sizeof(*deps));
+  if (dag == NULL || deps == NULL)
+  {
+    dag_dealloc(dag);
+    free(deps);
+    return -12;
+  }
+  int status = MSP_SUCCESS;
+  for (size_t k = 0; k < nt && status == MSP_SUCCESS; k++)
+  {
+    tile_task_t t = {A, k, k, k, ipiv, &info};
+    size_t nd = 0;
+    for (size_t i = k; i < A->mt; i++)
+      deps[nd++] = (dag_dep_t){tiled_tile(A, i, k), DagWrite};
+    status = dag_insert(dag, task_panel, &t, sizeof(t), nd, deps);
+    for (size_t j = k + 1; j < nt && status == MSP_SUCCESS; j++)
+    {
+      t.j = j;
+      status = insert_column_task(dag, task_rowpanel, &t, deps);
+      for (size_t i = k + 1; i < A->mt && status == MSP_SUCCESS; i++)
+      {
+        t.i = i;
+        status = dag_insert(dag, task_gemm_lu, &t, sizeof(t), 3,
+                            (dag_dep_t[]){{tiled_tile(A, i, k), DagRead}, {tiled_tile(A, k, j), DagRead},
+                                          {tiled_tile(A, i, j), DagWrite}});
+      }
+    }
+    for (size_t j = 0; j < k && status == MSP_SUCCESS; j++)
+    {
+      t.j = j;
+      status = insert_column_task(dag, task_swap_left, &t, deps);
+    }
+  }
+  if (status == MSP_SUCCESS)
+    status = dag_run(dag, nthreads);
+  dag_dealloc(dag);
+  free(deps);
+  return (status == MSP_SUCCESS) ? (int)info : -12;
+}
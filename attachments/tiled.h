@@ -0,0 +1,23 @@
+#ifndef TILED_H
+#define TILED_H
+#include "array2d.h"
+#include "lapack.h"
+
+typedef struct tiled /* matrix stored as contiguous square tiles */
+{
+    size_t shape[2]; // rows and columns of the matrix
+    size_t nb;       // tile size
+    size_t mt, nt;   // number of tile rows and tile columns
+    double *val;     // tile (i,j) is a ColMajor nb-by-nb block at val + (i + j*mt)*nb*nb
+} tiled_t;
+
+tiled_t *tiled_alloc(const size_t shape[2], size_t nb);
+void tiled_dealloc(tiled_t *T);
+double *tiled_tile(const tiled_t *T, size_t i, size_t j);
+tiled_t *array2d_to_tiled(const array2d_t *A, size_t nb);
+int tiled_to_array2d(const tiled_t *T, array2d_t *A);
+
+int tiled_dpotrf(tiled_t *A, size_t nthreads);
+int tiled_dgetrf(tiled_t *A, lapack_int *ipiv, size_t nthreads);
+
+#endif